@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+static uint64_t state = 0x2545f4914f6cdd1du;
+
+uint32_t bench_random(uint32_t bound)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state % bound);
+}
+
+void bench_append(darray_t char **text, const char *format, ...)
+{
+    va_list args, copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    size_t length = (size_t)vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    // room for the terminator vsnprintf writes, which is not counted
+    size_t count = darray_count(*text);
+    if (darray_capacity(*text) < count + length + 1)
+        darray_resize(*text, 2 * (count + length + 1));
+    vsnprintf(*text + count, length + 1, format, args);
+    va_end(args);
+
+    darray_truncate(*text, count + length);
+}
+
+double bench_best(void (*run)(void *context), void *context, int rounds)
+{
+    uint64_t best = UINT64_MAX;
+    for (int round = 0; round < rounds; ++round)
+    {
+        uint64_t start = jac_now();
+        run(context);
+        uint64_t elapsed = jac_now() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return (double)best / 1e9;
+}
+
+void bench_report(const char *name, double seconds, double units, const char *unit)
+{
+    printf("%-32s %10.3f ms %10.2f ns/%s\n", name, seconds * 1e3, seconds * 1e9 / units, unit);
+}
+
+size_t bench_scale(int argc, char *argv[], size_t fallback)
+{
+    long scale = (argc > 1) ? atol(argv[1]) : 0;
+    return (scale > 0) ? (size_t)scale : fallback;
+}
@@ -0,0 +1,30 @@
+#ifndef JAC_BENCH_H_
+#define JAC_BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "darray.h"
+
+/*
+ * What the benchmark programs share. Each one generates its own input from a
+ * fixed seed, so that runs compare across commits, and reports the best of a
+ * few rounds, the one the rest of the machine disturbed least.
+ */
+
+// xorshift from a fixed seed
+uint32_t bench_random(uint32_t bound);
+
+// appends to a generated source. the terminator is left to the generator
+void bench_append(darray_t char **text, const char *format, ...);
+
+// the best of 'rounds' runs of 'run', in seconds
+double bench_best(void (*run)(void *context), void *context, int rounds);
+
+// a line of the report: the time, and the time per unit of work
+void bench_report(const char *name, double seconds, double units, const char *unit);
+
+// the first argument as a positive number, or 'fallback'
+size_t bench_scale(int argc, char *argv[], size_t fallback);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Keyword classification, on identifier-heavy source: words that are
+ * keywords, words that share their first and last characters or their
+ * length, and plain names. Built twice, with the perfect hash of src/lex.c
+ * and with the linear scan it replaced, see JAC_LEX_LINEAR_KEYWORDS, and both
+ * must find the same number of keywords.
+ *
+ * usage: bench_keywords [<megabytes>]
+ */
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "bench.h"
+#include "intern.h"
+#include "lex.h"
+
+#ifdef JAC_LEX_LINEAR_KEYWORDS
+#define CLASSIFIER "linear scan"
+#else
+#define CLASSIFIER "perfect hash"
+#endif
+
+#define ROUNDS 5
+
+static const char *const keywords[] = {
+    "return", "extern", "func", "mut", "global", "local", "if",  "elif", "else", "bool",
+    "u8",     "u16",    "u32",  "u64", "i8",     "i16",   "i32", "i64",  "f32",  "f64",
+};
+
+// a probe of the hash lands on a keyword's slot, and the comparison decides
+static const char *const near_misses[] = {
+    "returns", "externs", "fnc",  "mat", "goal", "label", "iff", "elf", "eye", "bowl",
+    "u9",      "u17",     "u320", "uu4", "ix",   "i116",  "i2",  "i4",  "ff2", "f6",
+};
+
+typedef struct tokenize_run tokenize_run;
+
+struct tokenize_run
+{
+    const char *source;
+    size_t tokens;
+    size_t keywords;
+};
+
+static darray_t char *generate_source(size_t size, size_t *words)
+{
+    size_t keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+    darray_t char *text = darray_new(char);
+    for (*words = 0; darray_count(text) < size; ++*words)
+    {
+        uint32_t choice = bench_random(10);
+        if (choice < 4)
+            bench_append(&text, "%s", keywords[bench_random((uint32_t)keyword_count)]);
+        else if (choice < 6)
+            bench_append(&text, "%s", near_misses[bench_random((uint32_t)keyword_count)]);
+        else
+            bench_append(&text, "name_%u", bench_random(5000));
+        darray_push(text, (*words % 12 == 11) ? '\n' : ' ');
+    }
+    darray_push(text, '\0');
+    return text;
+}
+
+static void tokenize(void *context)
+{
+    tokenize_run *run = context;
+
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    jac_interner interner;
+    jac_init_interner(&interner);
+    jac_token_list tokens;
+    jac_tokenize(run->source, &strings, &interner, &tokens);
+
+    run->tokens = darray_count(tokens.kinds);
+    run->keywords = 0;
+    for (size_t i = 0; i < run->tokens; ++i)
+    {
+        enum jac_token_kind kind = (enum jac_token_kind)tokens.kinds[i];
+        run->keywords += (kind != JAC_TOKEN_IDENTIFIER) && (kind != JAC_TOKEN_EOF);
+    }
+
+    jac_free_tokens(&tokens);
+    jac_free_interner(&interner);
+    jac_free_arena(&strings);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = bench_scale(argc, argv, 16);
+    size_t words;
+    darray_t char *source = generate_source(megabytes << 20, &words);
+
+    tokenize_run run = {.source = source};
+    double seconds = bench_best(tokenize, &run, ROUNDS);
+    printf("keywords, %s: %zu words, %zu tokens, %zu keywords\n", CLASSIFIER, words, run.tokens, run.keywords);
+    bench_report("tokenize", seconds, (double)words, "word");
+
+    darray_free(source);
+    return 0;
+}
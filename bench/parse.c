@@ -0,0 +1,231 @@
+/*
+ * Parser throughput, on generated source that takes every path of the
+ * statement and expression dispatch: definitions of each type, assignments,
+ * calls nested in calls, address-of, hints, extern blocks and nested scopes.
+ * The tokens are lexed once and replayed, so only the parser is timed, at a
+ * few sizes, where the time per token must stay flat, and on every thread.
+ *
+ * usage: bench_parse [<megabytes>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "bench.h"
+#include "intern.h"
+#include "lex.h"
+#include "thread.h"
+
+#define ROUNDS 5
+
+static const char *const types[] = {"bool", "u8",  "u16", "u32", "u64", "i8",  "i16",
+                                    "i32",  "i64", "f32", "f64", "*u8", "**i32", "Custom"};
+
+/*
+ * GENERATED SOURCE
+ */
+
+static void append_expression(darray_t char **text, int depth);
+
+static void append_call(darray_t char **text, int depth)
+{
+    bench_append(text, "fn%u(", bench_random(1000));
+    for (uint32_t argument = bench_random(4); argument > 0; --argument)
+    {
+        append_expression(text, depth + 1);
+        if (argument > 1)
+            bench_append(text, ", ");
+    }
+    bench_append(text, ")");
+}
+
+static void append_expression(darray_t char **text, int depth)
+{
+    switch (bench_random(depth > 2 ? 4 : 6))
+    {
+    case 0:
+        bench_append(text, "%u", bench_random(100000));
+        break;
+    case 1:
+        bench_append(text, "\"text %u\"", bench_random(1000));
+        break;
+    case 2:
+        bench_append(text, "v%u", bench_random(64));
+        break;
+    case 3:
+        bench_append(text, "&v%u", bench_random(64));
+        break;
+    default:
+        append_call(text, depth);
+        break;
+    }
+}
+
+static void append_header(darray_t char **text, size_t function)
+{
+    size_t type_count = sizeof(types) / sizeof(types[0]);
+    bench_append(text, "func fn%zu(", function);
+    for (uint32_t argument = 1 + bench_random(4); argument > 0; --argument)
+        bench_append(text, "%s: a%u%s", types[bench_random((uint32_t)type_count)], argument,
+                     (argument > 1) ? ", " : ")");
+    if (bench_random(4))
+        bench_append(text, " -> %s", types[bench_random((uint32_t)type_count)]);
+}
+
+static darray_t char *generate_source(size_t size)
+{
+    size_t type_count = sizeof(types) / sizeof(types[0]);
+    darray_t char *text = darray_new(char);
+    for (size_t function = 0; darray_count(text) < size; ++function)
+    {
+        if (bench_random(16) == 0)
+        {
+            bench_append(&text, "extern {\n");
+            for (uint32_t header = 1 + bench_random(8); header > 0; --header)
+            {
+                bench_append(&text, "    ");
+                append_header(&text, function++);
+                bench_append(&text, ";\n");
+            }
+            bench_append(&text, "}\n");
+        }
+
+        if (bench_random(8) == 0)
+            bench_append(&text, "#(%s)\n", bench_random(2) ? "inline" : "noinline");
+        append_header(&text, function);
+        bench_append(&text, " {\n");
+
+        uint32_t depth = 1;
+        for (uint32_t statements = 4 + bench_random(28); statements > 0; --statements)
+        {
+            bench_append(&text, "%*s", (int)(4 * depth), "");
+            switch (bench_random(8))
+            {
+            case 0:
+            case 1:
+                bench_append(&text, "%s: v%u := ", types[bench_random((uint32_t)type_count)], bench_random(64));
+                append_expression(&text, 0);
+                bench_append(&text, ";\n");
+                break;
+            case 2:
+                bench_append(&text, "v%u := ", bench_random(64));
+                append_expression(&text, 0);
+                bench_append(&text, ";\n");
+                break;
+            case 3:
+            case 4:
+                append_call(&text, 0);
+                bench_append(&text, ";\n");
+                break;
+            case 5:
+                bench_append(&text, "{\n");
+                ++depth;
+                break;
+            case 6:
+                if (depth > 1)
+                {
+                    bench_append(&text, "}\n");
+                    --depth;
+                    break;
+                }
+                bench_append(&text, "return;\n");
+                break;
+            default:
+                bench_append(&text, "v%u := ", bench_random(64));
+                append_call(&text, 1);
+                bench_append(&text, ";\n");
+                break;
+            }
+        }
+        for (; depth > 1; --depth)
+            bench_append(&text, "%*s}\n", (int)(4 * (depth - 1)), "");
+        bench_append(&text, "    return ");
+        append_expression(&text, 0);
+        bench_append(&text, ";\n}\n");
+    }
+    darray_push(text, '\0');
+    return text;
+}
+
+/*
+ * RUNS
+ */
+
+typedef struct parse_run parse_run;
+
+struct parse_run
+{
+    const jac_token_list *tokens;
+    jac_interner *interner;
+    unsigned jobs; // 0 for jac_parse_unit
+    bool parsed;
+};
+
+static void parse(void *context)
+{
+    parse_run *run = context;
+    jac_lexer lexer;
+    jac_init_replay_lexer(&lexer, run->tokens, 0, run->interner);
+
+    jac_ast_unit unit;
+    if (run->jobs == 0)
+        run->parsed = jac_parse_unit(&lexer, &unit);
+    else
+        run->parsed = jac_parse_unit_parallel(&lexer, run->jobs, &unit);
+
+    if (run->parsed)
+        jac_free_unit(&unit);
+    jac_free_lexer(&lexer);
+}
+
+static bool bench_size(size_t size, bool parallel)
+{
+    darray_t char *source = generate_source(size);
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    jac_interner interner;
+    jac_init_interner(&interner);
+    jac_token_list tokens;
+    bool lexed = jac_tokenize(source, &strings, &interner, &tokens);
+    double count = (double)darray_count(tokens.kinds);
+
+    char name[64];
+    parse_run run = {.tokens = &tokens, .interner = &interner};
+    double seconds = bench_best(parse, &run, ROUNDS);
+    bool parsed = lexed && run.parsed;
+    snprintf(name, sizeof name, "parse %zu KB", size >> 10);
+    bench_report(name, seconds, count, "token");
+
+    if (parsed && parallel)
+    {
+        run.jobs = jac_hardware_threads();
+        seconds = bench_best(parse, &run, ROUNDS);
+        parsed = run.parsed;
+        snprintf(name, sizeof name, "parse %zu KB, -j%u", size >> 10, run.jobs);
+        bench_report(name, seconds, count, "token");
+    }
+
+    jac_free_tokens(&tokens);
+    jac_free_interner(&interner);
+    jac_free_arena(&strings);
+    darray_free(source);
+    return parsed;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = bench_scale(argc, argv, 16);
+
+    // a quarter and a half of the size first
+    for (size_t size = (megabytes << 20) / 4; size <= (megabytes << 20); size *= 2)
+    {
+        if (!bench_size(size, size == (megabytes << 20)))
+        {
+            fprintf(stderr, "error: the generated source does not parse.\n");
+            return 1;
+        }
+    }
+    return 0;
+}
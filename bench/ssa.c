@@ -0,0 +1,160 @@
+/*
+ * Compile time of the SSA phases on large functions. The functions are built
+ * directly by the generator of the pass tests, see tests/ir_test.h: blocks
+ * branching at random, loops included, over slots of a few kinds. Each phase
+ * is timed on its own, at a few sizes, and reported per instruction of the
+ * function as generated, which must stay flat as the functions grow. Every
+ * round builds the same function again, from a seed whose entry reaches a
+ * good part of it.
+ *
+ * usage: bench_ssa [<thousands of blocks>]
+ */
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "bench.h"
+#include "ir_test.h"
+#include "opt.h"
+#include "ssa.h"
+#include "test.h"
+#include "trace.h"
+
+#define ROUNDS    5
+#define PER_BLOCK 8
+
+enum phase
+{
+    PHASE_CFG,
+    PHASE_DOMINATORS, // the tree and the frontiers
+    PHASE_SSA,        // jac_construct_ssa, the CFG again and the promotion
+    PHASE_VERIFY,
+    PHASE_SCCP,
+    PHASE_DCE,
+    PHASE_COUNT,
+};
+
+static const char *const phase_names[PHASE_COUNT] = {"cfg", "dominators", "ssa", "verify", "sccp", "dce"};
+
+// the best time of each phase, over the rounds
+static uint64_t best[PHASE_COUNT];
+
+static uint64_t start;
+
+static void end_phase(enum phase phase)
+{
+    uint64_t elapsed = jac_now() - start;
+    if (elapsed < best[phase])
+        best[phase] = elapsed;
+    start = jac_now();
+}
+
+static size_t build(test_builder *builder, uint64_t seed, unsigned blocks, jac_memory_arena *arena)
+{
+    test_seed(seed);
+    test_init_builder(builder, arena);
+    size_t f = test_add_function(builder, JAC_TYPE_INT32);
+    test_build_random(builder, f, blocks, PER_BLOCK, 0);
+    return f;
+}
+
+// the first seed from which the entry reaches at least a quarter of the blocks
+static uint64_t find_seed(unsigned blocks, jac_memory_arena *arena, jac_memory_arena *scratch, uint32_t *reachable)
+{
+    uint64_t seed = 0x2545f4914f6cdd1du;
+    for (;; ++seed)
+    {
+        test_builder builder;
+        size_t f = build(&builder, seed, blocks, arena);
+        jac_ir_function *function = builder.unit.functions + f;
+        jac_build_cfg(function, arena);
+        jac_dominator_tree tree;
+        jac_build_dominators(function, scratch, &tree);
+        *reachable = tree.reachable;
+        jac_reset_arena(scratch);
+        jac_reset_arena(arena);
+        if (*reachable >= blocks / 4)
+            return seed;
+    }
+}
+
+static bool run_round(uint64_t seed, unsigned blocks, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    size_t f = build(&builder, seed, blocks, arena);
+    jac_ir_function *function = builder.unit.functions + f;
+
+    start = jac_now();
+    jac_build_cfg(function, arena);
+    end_phase(PHASE_CFG);
+
+    jac_dominator_tree tree;
+    jac_build_dominators(function, scratch, &tree);
+    jac_dominance_frontiers(function, &tree, scratch);
+    end_phase(PHASE_DOMINATORS);
+    jac_reset_arena(scratch);
+
+    start = jac_now();
+    jac_construct_ssa(&builder.unit, arena);
+    end_phase(PHASE_SSA);
+
+    bool verified = jac_verify_unit(&builder.unit, stderr);
+    end_phase(PHASE_VERIFY);
+
+    jac_propagate_constants(function, scratch);
+    end_phase(PHASE_SCCP);
+
+    jac_eliminate_dead_code(function, arena, scratch);
+    end_phase(PHASE_DCE);
+
+    jac_reset_arena(scratch);
+    jac_reset_arena(arena);
+    return verified;
+}
+
+static bool bench_blocks(unsigned blocks, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    uint32_t reachable;
+    uint64_t seed = find_seed(blocks, arena, scratch, &reachable);
+
+    test_builder builder;
+    size_t f = build(&builder, seed, blocks, arena);
+    size_t instructions = test_count_instructions(builder.unit.functions + f);
+    jac_reset_arena(arena);
+
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        best[phase] = UINT64_MAX;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        if (!run_round(seed, blocks, arena, scratch))
+            return false;
+    }
+
+    printf("ssa, %u blocks, %u reachable, %zu instructions:\n", blocks, reachable, instructions);
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        bench_report(phase_names[phase], (double)best[phase] / 1e9, (double)instructions, "instruction");
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned blocks = (unsigned)bench_scale(argc, argv, 16) * 1000;
+
+    jac_memory_arena arena, scratch;
+    jac_init_arena(&arena);
+    jac_init_arena(&scratch);
+
+    // a quarter and a half of the size first
+    bool verified = true;
+    for (unsigned size = blocks / 4; verified && (size <= blocks); size *= 2)
+        verified = bench_blocks(size, &arena, &scratch);
+
+    jac_free_arena(&scratch);
+    jac_free_arena(&arena);
+    if (!verified)
+    {
+        fprintf(stderr, "error: a generated function did not verify.\n");
+        return 1;
+    }
+    return 0;
+}
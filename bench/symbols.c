@@ -0,0 +1,152 @@
+/*
+ * The checker's symbol table, on two generated units: many functions, each
+ * name overloaded on its argument type and called from all over the unit, and
+ * functions of deeply nested scopes, each declaring a variable, shadowing the
+ * argument now and then, and reading one from any scope around it. Both are
+ * parsed once and only jac_check_unit is timed, the first at a few sizes.
+ *
+ * usage: bench_symbols [<thousands of functions>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "bench.h"
+#include "intern.h"
+#include "ir.h"
+#include "lex.h"
+
+#define ROUNDS         5
+#define SCOPE_DEPTH    256
+#define DEEP_FUNCTIONS 64
+
+/*
+ * GENERATED SOURCE
+ */
+
+// 'functions' in all, two overloads of each name
+static darray_t char *generate_functions(size_t functions)
+{
+    uint32_t names = (uint32_t)(functions / 2);
+    darray_t char *text = darray_new(char);
+    bench_append(&text, "extern {\n    func sink(i32: v) -> i32;\n}\n");
+    for (uint32_t name = 0; name < names; ++name)
+    {
+        bench_append(&text, "func fn%u(i32: a) -> i32 {\n", name);
+        bench_append(&text, "    i32: r := fn%u(a);\n", bench_random(names));
+        bench_append(&text, "    i64: w := %u;\n", bench_random(1000));
+        bench_append(&text, "    w := fn%u(w);\n", bench_random(names));
+        bench_append(&text, "    return sink(r);\n}\n");
+        bench_append(&text, "func fn%u(i64: a) -> i64 {\n    return a;\n}\n", name);
+    }
+    darray_push(text, '\0');
+    return text;
+}
+
+static darray_t char *generate_scopes(size_t functions, size_t depth, size_t *statements)
+{
+    darray_t char *text = darray_new(char);
+    *statements = 0;
+    for (size_t function = 0; function < functions; ++function)
+    {
+        bench_append(&text, "func deep%zu(i32: a) -> i32 {\n    i32: v0 := a;\n", function);
+        for (uint32_t level = 1; level < depth; ++level)
+        {
+            bench_append(&text, "%*s{\n", (int)(4 * level), "");
+            bench_append(&text, "%*si32: v%u := v%u;\n", (int)(4 * level + 4), "", level, bench_random(level));
+            if (bench_random(8) == 0)
+            {
+                bench_append(&text, "%*si32: a := v%u;\n", (int)(4 * level + 4), "", bench_random(level));
+                *statements += 1;
+            }
+            bench_append(&text, "%*sv%u := a;\n", (int)(4 * level + 4), "", bench_random(level + 1));
+            *statements += 2;
+        }
+        for (uint32_t level = (uint32_t)depth - 1; level > 0; --level)
+            bench_append(&text, "%*s}\n", (int)(4 * level), "");
+        bench_append(&text, "    return v0;\n}\n");
+    }
+    darray_push(text, '\0');
+    return text;
+}
+
+/*
+ * RUNS
+ */
+
+typedef struct check_run check_run;
+
+struct check_run
+{
+    jac_ast_unit unit;
+    jac_lexer lexer;
+    jac_memory_arena strings;
+    jac_interner interner;
+    bool checked;
+};
+
+static bool parse(check_run *run, const char *source)
+{
+    jac_init_arena(&run->strings);
+    jac_init_interner(&run->interner);
+    jac_init_lexer(&run->lexer, source, &run->strings, &run->interner);
+    return jac_parse_unit(&run->lexer, &run->unit) && !run->lexer.invalid;
+}
+
+static void check(void *context)
+{
+    check_run *run = context;
+    jac_memory_arena arena;
+    jac_init_arena(&arena);
+    jac_ir_unit ir;
+    run->checked = jac_check_unit(&run->unit, &run->lexer.lines, &arena, &ir);
+    jac_free_arena(&arena);
+}
+
+static bool bench_source(const char *name, const char *source, double units, const char *unit)
+{
+    check_run run;
+    if (!parse(&run, source))
+        return false;
+
+    double seconds = bench_best(check, &run, ROUNDS);
+    if (run.checked)
+        bench_report(name, seconds, units, unit);
+
+    jac_free_unit(&run.unit);
+    jac_free_lexer(&run.lexer);
+    jac_free_interner(&run.interner);
+    jac_free_arena(&run.strings);
+    return run.checked;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t functions = bench_scale(argc, argv, 50) * 1000;
+    char name[64];
+
+    // a quarter and a half of the count first, the time per function must stay flat
+    bool valid = true;
+    for (size_t count = functions / 4; valid && (count <= functions); count *= 2)
+    {
+        darray_t char *source = generate_functions(count);
+        snprintf(name, sizeof name, "check %zu functions", count);
+        valid = bench_source(name, source, (double)count, "function");
+        darray_free(source);
+    }
+
+    size_t statements;
+    darray_t char *source = generate_scopes(DEEP_FUNCTIONS, SCOPE_DEPTH, &statements);
+    snprintf(name, sizeof name, "check %d scopes deep", SCOPE_DEPTH);
+    valid = valid && bench_source(name, source, (double)statements, "statement");
+    darray_free(source);
+
+    if (!valid)
+    {
+        fprintf(stderr, "error: the generated source does not check.\n");
+        return 1;
+    }
+    return 0;
+}
@@ -1,26 +1,101 @@
 #ifndef JAC_ARENA_H_
 #define JAC_ARENA_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "darray.h"
+#include "stats.h"
 
+typedef struct jac_arena_chunk jac_arena_chunk;
 typedef struct jac_memory_arena jac_memory_arena;
+typedef struct jac_arena_mark jac_arena_mark;
+
+// default size of a chunk, allocations larger than a quarter of it get a chunk of their own
+#define JAC_ARENA_CHUNK_SIZE (64 * 1024)
+
+// every allocation is rounded up to a multiple of the granule, which keeps the
+// cursor aligned for anything up to it without any adjusting
+#define JAC_ARENA_GRANULE 8
 
+#define JAC_ALIGNOF(type) offsetof(struct { char c; type t; }, t)
+
+struct jac_arena_chunk
+{
+    jac_arena_chunk *previous;
+    size_t size;
+    char data[];
+};
+
+/*
+ * Bump allocator over a list of chunks. Chunks are never moved or resized,
+ * so every allocation stays put until the arena is rewound past it, reset or
+ * freed. Chunks released by a rewind or reset are kept for reuse.
+ */
 struct jac_memory_arena
 {
-    darray_t char *memory;
+    darray_allocator allocator; // see jac_arena_darray_new
+    jac_arena_chunk *chunk;     // the newest, links to the older ones
+    jac_arena_chunk *spare;
+    char *cursor;
+    char *end;
 };
 
-static inline void *jac_arena_alloc_impl(jac_memory_arena *arena, unsigned count)
+// position to rewind the arena to, e.g. when backtracking a speculative parse
+struct jac_arena_mark
+{
+    jac_arena_chunk *chunk;
+    char *cursor;
+};
+
+// NOTE: no memory is allocated until the first allocation
+void jac_init_arena(jac_memory_arena *arena);
+
+void *jac_arena_alloc_slow(jac_memory_arena *arena, size_t size, size_t alignment);
+
+static inline void *jac_arena_alloc_aligned(jac_memory_arena *arena, size_t size, size_t alignment)
+{
+    size = (size + JAC_ARENA_GRANULE - 1) & ~(size_t)(JAC_ARENA_GRANULE - 1);
+    JAC_COUNT_ARENA_ALLOCATION(size);
+
+    if ((alignment <= JAC_ARENA_GRANULE) && (size <= (size_t)(arena->end - arena->cursor)))
+    {
+        void *memory = arena->cursor;
+        arena->cursor += size;
+        return memory;
+    }
+
+    return jac_arena_alloc_slow(arena, size, alignment);
+}
+
+// 'count' bytes, aligned to JAC_ARENA_GRANULE
+static inline void *jac_arena_alloc_impl(jac_memory_arena *arena, size_t count)
 {
-    arena->memory = (char *)darray_grow_impl((size_t *)arena->memory, count);
-    return (void *)(darray_last(arena->memory) - count);
+    return jac_arena_alloc_aligned(arena, count, JAC_ARENA_GRANULE);
 }
 
-#define jac_arena_alloc(arena, type) jac_arena_alloc_impl(arena, sizeof(type))
+#define jac_arena_alloc(arena, type) ((type *)jac_arena_alloc_aligned(arena, sizeof(type), JAC_ALIGNOF(type)))
 
-static inline void jac_free_arena(jac_memory_arena *arena)
+// 'count' elements and one to spare, so that even an empty array is an
+// allocation of its own. NOTE: not zeroed
+#define jac_arena_alloc_array(arena, type, count)                                                                      \
+    ((type *)jac_arena_alloc_aligned(arena, ((count) + 1) * sizeof(type), JAC_ALIGNOF(type)))
+
+// darray whose storage comes from the arena, and is reclaimed along with it,
+// so there is no need to darray_free it
+#define jac_arena_darray_new(arena, type) darray_new_with(type, &(arena)->allocator)
+
+static inline jac_arena_mark jac_arena_get_mark(const jac_memory_arena *arena)
 {
-    darray_free(arena->memory);
+    return (jac_arena_mark){.chunk = arena->chunk, .cursor = arena->cursor};
 }
 
+// releases everything allocated since 'mark' was taken
+void jac_arena_rewind(jac_memory_arena *arena, jac_arena_mark mark);
+
+// releases every allocation, but keeps the chunks for reuse
+void jac_reset_arena(jac_memory_arena *arena);
+
+void jac_free_arena(jac_memory_arena *arena);
+
 #endif
@@ -2,124 +2,107 @@
 #define JAC_AST_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include "darray.h"
 #include "lex.h"
 #include "symbol.h"
+#include "type.h"
 
-typedef struct jac_ast_unit_statement jac_ast_unit_statement;
-typedef struct jac_ast_function_definition jac_ast_function_definition;
-typedef struct jac_ast_function_call jac_ast_function_call;
-typedef struct jac_ast_variable_definition jac_ast_variable_definition;
-typedef struct jac_ast_assignment jac_ast_assignment;
-typedef struct jac_ast_expression_statement jac_ast_expression_statement;
-typedef struct jac_ast_expression jac_ast_expression;
-typedef struct jac_ast_statement_return jac_ast_statement_return;
-typedef struct jac_ast_scope_statement jac_ast_scope_statement;
+typedef struct jac_ast_data jac_ast_data;
+typedef struct jac_ast_unit jac_ast_unit;
 
-typedef darray_t jac_function *jac_ast_extern_block;
-typedef darray_t jac_ast_unit_statement *jac_ast_unit;
-typedef darray_t jac_ast_scope_statement *jac_ast_block;
+// index of a node in its unit. node 0 is the root, which is never anyone's
+// child, so 0 also stands for a missing optional child
+typedef uint32_t jac_ast_node;
 
+#define JAC_AST_ROOT 0
+#define JAC_AST_NONE 0
+
+// what a node's token and data hold, per kind. [lhs, rhs) is a range of
+// child nodes in the unit's extra data, unless stated otherwise
 enum jac_ast_kind
 {
-    JAC_AST_FUNCTION_DEFINITION,
-    JAC_AST_EXTERN_BLOCK,
-    JAC_AST_FUNCTION_HEADER,
-    JAC_AST_STATEMENT_RETURN,
-    JAC_AST_EXPRESSION_STATEMENT,
-    JAC_AST_FUNCTION_CALL,
-    JAC_AST_EXPRESSION_LITERAL,
-    JAC_AST_EXPRESSION_IDENTIFIER,
-    JAC_AST_EXPRESSION_ADDROF,
-    JAC_AST_VARIABLE_DECLARATION,
-    JAC_AST_VARIABLE_DEFINITION,
-    JAC_AST_BLOCK,
-    JAC_AST_TYPE,
-    JAC_AST_TYPE_POINTER,
-    JAC_AST_TYPE_NORMAL,
-    JAC_AST_ASSIGNMENT,
+    JAC_AST_ROOT_UNIT,             // [lhs, rhs) function definitions, hints and extern blocks
+    JAC_AST_FUNCTION_DEFINITION,   // identifier, lhs header, rhs block
+    JAC_AST_EXTERN_BLOCK,          // 'extern', [lhs, rhs) function headers
+    JAC_AST_FUNCTION_HEADER,       // identifier, [lhs, rhs) return type or NONE, arguments
+    JAC_AST_BLOCK,                 // '{', [lhs, rhs) scope statements
+    JAC_AST_STATEMENT_RETURN,      // 'return', lhs expression or NONE
+    JAC_AST_VARIABLE_DECLARATION,  // identifier, lhs type
+    JAC_AST_VARIABLE_DEFINITION,   // identifier, lhs type, rhs expression
+    JAC_AST_ASSIGNMENT,            // identifier, lhs expression
+    JAC_AST_FUNCTION_CALL,         // identifier, [lhs, rhs) argument expressions
+    JAC_AST_EXPRESSION_LITERAL,    // literal
+    JAC_AST_EXPRESSION_IDENTIFIER, // identifier
+    JAC_AST_EXPRESSION_ADDROF,     // identifier
+    JAC_AST_TYPE,                  // type name, lhs indirection, rhs enum jac_type_kind
+    JAC_AST_HINT,                  // identifier, lhs the hinted definition, or another hint of it
 };
 
-struct jac_ast_unit_statement
+struct jac_ast_data
 {
-    union {
-        jac_ast_function_definition *func_def;
-        jac_ast_extern_block extern_block;
-    } opt;
-
-    enum jac_ast_kind holds;
+    uint32_t lhs;
+    uint32_t rhs;
 };
 
-struct jac_ast_function_definition
+// the whole tree as a flat pool of nodes, in parallel arrays. children are
+// added before their parents, and lists of them are contiguous ranges in
+// 'extra', so a traversal mostly walks memory in order
+struct jac_ast_unit
 {
-    jac_function header;
-    jac_ast_block block;
-};
+    darray_t uint8_t *kinds;
+    darray_t jac_ast_data *data;
+    darray_t uint32_t *extra;
 
-struct jac_ast_function_call
-{
-    const jac_token *identifier;
-    darray_t jac_ast_expression *arguments;
-};
+    // one per node, at the same index. punctuation without a node of its own
+    // is left out
+    jac_token_list tokens;
 
-struct jac_ast_variable_definition
-{
-    jac_symbol declaration;
-    jac_ast_expression *expression;
+    // the arrays live in an AST cache, and are only read
+    bool mapped;
 };
 
-struct jac_ast_assignment
+static inline enum jac_ast_kind jac_ast_kind_of(const jac_ast_unit *unit, jac_ast_node node)
 {
-    const jac_token *identifier;
-    jac_ast_expression *expression;
-};
+    return (enum jac_ast_kind)unit->kinds[node];
+}
 
-struct jac_ast_expression_statement
+static inline jac_token jac_ast_token(const jac_ast_unit *unit, jac_ast_node node)
 {
-    union {
-        jac_ast_function_call *call;
-        jac_ast_variable_definition *var_def;
-        jac_ast_assignment *assignment;
-    } opt;
+    return jac_get_token(&unit->tokens, node);
+}
 
-    enum jac_ast_kind holds;
-};
-
-struct jac_ast_expression
+// the children of a node whose data is a range, see enum jac_ast_kind
+static inline const jac_ast_node *jac_ast_children(const jac_ast_unit *unit, jac_ast_node node, size_t *count)
 {
-    union {
-        const jac_token *literal;
-        const jac_token *identifier;
-        const jac_token *addrof;
-        jac_ast_expression_statement *expr_statement;
-    } opt;
-
-    enum jac_ast_kind holds;
-};
+    jac_ast_data data = unit->data[node];
+    *count = data.rhs - data.lhs;
+    return unit->extra + data.lhs;
+}
 
-struct jac_ast_statement_return
-{
-    jac_ast_expression *expression;
-};
+// JAC_AST_TYPE, or JAC_AST_NONE for no type at all
+jac_type jac_ast_type(const jac_ast_unit *unit, jac_ast_node node);
 
-struct jac_ast_scope_statement
-{
-    union {
-        jac_ast_block block;
-        jac_ast_statement_return *ret;
-        jac_ast_expression_statement *expr_statement;
-    } opt;
+// JAC_AST_FUNCTION_HEADER, with the arguments spilling to 'allocator', which
+// may be null, for the heap
+void jac_ast_function(const jac_ast_unit *unit, jac_ast_node node, darray_allocator *allocator,
+                      jac_function *function);
 
-    enum jac_ast_kind holds;
-};
+bool jac_parse_unit(jac_lexer *lexer, jac_ast_unit *unit);
 
-struct jac_memory_arena;
+// the same unit and diagnostics as jac_parse_unit, with the top-level
+// statements parsed on up to 'jobs' threads. NOTE: 'lexer' must be replaying
+// the whole source, see jac_init_replay_lexer
+bool jac_parse_unit_parallel(jac_lexer *lexer, unsigned jobs, jac_ast_unit *unit);
 
-bool jac_parse_unit(struct jac_memory_arena *arena, darray_t jac_token *tokens, jac_ast_unit *unit);
+void jac_free_unit(jac_ast_unit *unit);
 
-void jac_free_unit(jac_ast_unit unit);
+// prints the first difference to 'stream'. interned strings are compared by
+// value, so the units may have interners of their own
+bool jac_compare_units(const jac_ast_unit *a, const jac_ast_unit *b, FILE *stream);
 
-void jac_print_unit(const jac_ast_unit unit, int indent);
+void jac_print_unit(const jac_ast_unit *unit, int indent);
 
 #endif
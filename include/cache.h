@@ -0,0 +1,45 @@
+#ifndef JAC_CACHE_H_
+#define JAC_CACHE_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ast.h"
+#include "intern.h"
+#include "lex.h"
+#include "source.h"
+
+/*
+ * Parsed units saved next to their source, so an unchanged file skips lexing
+ * and parsing. The file holds every array of the unit, darray headers and all,
+ * plus the interned strings, at offsets from its start. Loading maps the file
+ * and points the unit at it, there is no decoding pass. A cache is only used
+ * for a source of the same length and hash, written by the same version of jac.
+ */
+
+typedef struct jac_ast_cache jac_ast_cache;
+
+struct jac_ast_cache
+{
+    jac_source file;
+};
+
+// on a hit, 'unit' and 'interner' read from the cache until it is closed. a
+// miss for any reason, stale or corrupt alike, touches neither, and leaves the
+// cache as closed
+bool jac_load_ast_cache(const char *path, const jac_source *source, jac_ast_cache *cache, jac_ast_unit *unit,
+                        jac_interner *interner);
+
+// replaces the file at 'path' as a whole, or leaves it be. the unit's own
+// tokens carry no line table, so it is passed along
+bool jac_write_ast_cache(const char *path, const jac_source *source, const jac_ast_unit *unit,
+                         const jac_line_table *lines);
+
+// lexes and parses the source again, and reports any difference to 'stream'.
+// a loaded unit carries the cached line table in its tokens
+bool jac_verify_ast_cache(const jac_source *source, const jac_ast_unit *cached, FILE *stream);
+
+// does nothing for a cache that is zeroed, missed or already closed
+void jac_close_ast_cache(jac_ast_cache *cache);
+
+#endif
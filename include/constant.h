@@ -0,0 +1,44 @@
+#ifndef JAC_CONSTANT_H_
+#define JAC_CONSTANT_H_
+
+#include <stdint.h>
+
+enum jac_type_kind
+{
+    JAC_TYPE_NONE,
+    JAC_TYPE_CUSTOM,
+    JAC_TYPE_BOOL,
+    JAC_TYPE_INT8,
+    JAC_TYPE_UINT8,
+    JAC_TYPE_INT16,
+    JAC_TYPE_UINT16,
+    JAC_TYPE_INT32,
+    JAC_TYPE_UINT32,
+    JAC_TYPE_INT64,
+    JAC_TYPE_UINT64,
+    JAC_TYPE_FLOAT32,
+    JAC_TYPE_FLOAT64,
+};
+
+typedef struct jac_constant jac_constant;
+
+// value of a numeric literal, decoded once by the lexer
+struct jac_constant
+{
+    union {
+        uint64_t u;
+        int64_t i;
+        double f;
+    } opt;
+
+    enum
+    {
+        JAC_CONSTANT_UINT,
+        JAC_CONSTANT_INT,
+        JAC_CONSTANT_FLOAT,
+    } holds;
+
+    enum jac_type_kind type; // of the suffix, JAC_TYPE_NONE until the checker gives it the type of its use
+};
+
+#endif
@@ -35,6 +35,15 @@ extern void  darray_dealloc(void* ptr);
 #    define DARRAY_DEALLOC(ptr)        free(ptr)
 #endif
 
+/* arrays may draw their storage from an allocator of their own, e.g. an
+ arena. sizes are in bytes, and 'ptr' is null for new arrays. */
+typedef struct darray_allocator darray_allocator;
+
+struct darray_allocator {
+    void* (*reallocate)(darray_allocator* allocator, void* ptr, size_t old_size, size_t size);
+    void (*deallocate)(darray_allocator* allocator, void* ptr);
+};
+
 #define DARRAY_ASSERT(expr, msg)                                                                   \
     do {                                                                                           \
         if (!(expr)) {                                                                             \
@@ -55,6 +64,7 @@ enum {
     DARRAY_TAG_STRIDE_,
     DARRAY_TAG_COUNT_,
     DARRAY_TAG_CAPACITY_,
+    DARRAY_TAG_ALLOCATOR_,
     DARRAY_ENUM_END_,
 };
 
@@ -74,38 +84,60 @@ DARRAY_INLINE void darray_set_field_(size_t* block, int field, size_t value) {
 
 #define darray_capacity(array) darray_fetch_field_((const size_t*)(array), DARRAY_TAG_CAPACITY_)
 
+#define darray_allocator(array)                                                                    \
+    ((darray_allocator*)darray_fetch_field_((const size_t*)(array), DARRAY_TAG_ALLOCATOR_))
+
 /*
  * IMPLEMENTATION
  */
 
 DARRAY_INLINE
-void* darray_new_impl(size_t stride, size_t count) {
+void* darray_new_with_impl(size_t stride, size_t count, darray_allocator* allocator) {
     DARRAY_ASSERT(stride != 0, "cannot create array with stride of 0.");
 
-    size_t* head = (size_t*)DARRAY_ALLOC(stride * (count + 1) + DARRAY_HEADER_STRIDE_);
+    size_t  capacity = (count + 1) * DARRAY_GROWTH_FACTOR + 0.5f;
+    size_t  bytes    = stride * capacity + DARRAY_HEADER_STRIDE_;
+    size_t* head     = (size_t*)(allocator ? allocator->reallocate(allocator, NULL, 0, bytes)
+                                           : DARRAY_ALLOC(bytes));
     DARRAY_ASSERT(head != NULL, "no memory to allocate array.");
 
     size_t* block = head + DARRAY_ENUM_END_;
     darray_set_field_(block, DARRAY_TAG_STRIDE_, stride);
     darray_set_field_(block, DARRAY_TAG_COUNT_, 0);
-    darray_set_field_(block, DARRAY_TAG_CAPACITY_, (count + 1) * DARRAY_GROWTH_FACTOR + 0.5f);
+    darray_set_field_(block, DARRAY_TAG_CAPACITY_, capacity);
+    darray_set_field_(block, DARRAY_TAG_ALLOCATOR_, (size_t)allocator);
     return block;
 }
 
+DARRAY_INLINE
+void* darray_new_impl(size_t stride, size_t count) {
+    return darray_new_with_impl(stride, count, NULL);
+}
+
 DARRAY_INLINE void darray_free_impl(size_t* block) {
     DARRAY_ASSERT_DEBUG(block != NULL, "array argument is null.");
 
-    size_t* head = block - DARRAY_ENUM_END_;
-    DARRAY_DEALLOC(head);
+    size_t*           head      = block - DARRAY_ENUM_END_;
+    darray_allocator* allocator = darray_allocator(block);
+    if (allocator)
+        allocator->deallocate(allocator, head);
+    else
+        DARRAY_DEALLOC(head);
 }
 
 DARRAY_INLINE void* darray_resize_impl(size_t* block, size_t new_capacity) {
     DARRAY_ASSERT_DEBUG(block != NULL, "array argument is null.");
 
-    size_t  stride   = darray_stride(block);
-    size_t  bytes    = new_capacity * stride + DARRAY_HEADER_STRIDE_;
+    size_t            stride    = darray_stride(block);
+    size_t            bytes     = new_capacity * stride + DARRAY_HEADER_STRIDE_;
+    darray_allocator* allocator = darray_allocator(block);
 
-    size_t* new_head = (size_t*)DARRAY_REALLOC(block - DARRAY_ENUM_END_, bytes);
+    size_t* new_head;
+    if (allocator) {
+        size_t old_bytes = darray_capacity(block) * stride + DARRAY_HEADER_STRIDE_;
+        new_head = (size_t*)allocator->reallocate(allocator, block - DARRAY_ENUM_END_, old_bytes, bytes);
+    } else
+        new_head = (size_t*)DARRAY_REALLOC(block - DARRAY_ENUM_END_, bytes);
     DARRAY_ASSERT(new_head != NULL, "no memory to reallocate array.");
 
     size_t* new_block = new_head + DARRAY_ENUM_END_;
@@ -125,9 +157,11 @@ DARRAY_INLINE void* darray_grow_impl(size_t* block, unsigned amount) {
     size_t capacity   = darray_capacity(block);
     size_t grown_size = count + amount;
 
-    if (grown_size >= capacity) {
-        size_t new_capacity = amount * capacity * DARRAY_GROWTH_FACTOR + 0.5f;
-        block               = (size_t*)darray_resize_impl(block, new_capacity);
+    if (grown_size > capacity) {
+        size_t new_capacity = capacity * DARRAY_GROWTH_FACTOR + 0.5f;
+        if (new_capacity < grown_size)
+            new_capacity = grown_size;
+        block = (size_t*)darray_resize_impl(block, new_capacity);
     }
 
     darray_set_field_(block, DARRAY_TAG_COUNT_, grown_size);
@@ -199,10 +233,15 @@ DARRAY_INLINE void darray_remove_impl(size_t* block, size_t index, size_t amount
 
 #define darray_new_reserved(type, count) ((type*)(darray_new_impl(sizeof(type), count)))
 
+#define darray_new_with(type, allocator) ((type*)(darray_new_with_impl(sizeof(type), 0, allocator)))
+
 #define darray_free(array)               darray_free_impl((size_t*)(array))
 
 #define darray_clear(array)              darray_set_field_((size_t*)(array), DARRAY_TAG_COUNT_, 0)
 
+#define darray_truncate(array, count)                                                              \
+    darray_set_field_((size_t*)(array), DARRAY_TAG_COUNT_, count)
+
 #define darray_last(array)               ((array) + darray_count(array) - 1)
 
 #define darray_resize(array, count)                                                                \
@@ -218,6 +257,14 @@ DARRAY_INLINE void darray_remove_impl(size_t* block, size_t index, size_t amount
         *darray_last(array) = (value);                                                             \
     } while (0)
 
+// copies 'amount' values to the end, 'values' must not point into the array
+#define darray_append(array, values, amount)                                                       \
+    do {                                                                                           \
+        size_t darray_at_ = darray_count(array);                                                   \
+        (array)           = darray_grow_impl((size_t*)(array), amount);                            \
+        memcpy((array) + darray_at_, values, (size_t)(amount) * sizeof(*(array)));                 \
+    } while (0)
+
 #define darray_pop(array) darray_pop_impl((size_t*)(array))
 
 #define darray_insert(array, index, value)                                                         \
@@ -229,4 +276,79 @@ DARRAY_INLINE void darray_remove_impl(size_t* block, size_t index, size_t amount
 
 #define darray_foreach(array, type, it)         for (type* it = (array); it <= darray_last(array); ++it)
 
+/*
+ * SMALL ARRAYS
+ *
+ * Arrays with room for 'n' elements inside themselves, which only spill to
+ * the heap, or to an allocator, once they outgrow it. The inline elements are
+ * never pointed to, so a copy reads the same elements as the original. Once
+ * spilled, though, both point to the same spill, which a push to either may
+ * move or free. So ownership moves with a copy: darray_small_init the source,
+ * or only read from it afterwards. Declare one with darray_small_t, and
+ * darray_small_init it before use.
+ */
+
+#define darray_small_t(type, n)                                                                    \
+    struct {                                                                                       \
+        type*  spill;                                                                              \
+        size_t count;                                                                              \
+        size_t capacity;                                                                           \
+        type   local[n];                                                                           \
+    }
+
+DARRAY_INLINE void* darray_small_grow_impl(
+    void* spill, const void* local, size_t* capacity, size_t stride, darray_allocator* allocator
+) {
+    size_t old_capacity = *capacity;
+    size_t new_capacity = old_capacity * DARRAY_GROWTH_FACTOR + 1.5f;
+    void*  old_spill    = spill;
+
+    if (allocator)
+        spill = allocator->reallocate(
+            allocator, spill, old_spill ? old_capacity * stride : 0, new_capacity * stride
+        );
+    else
+        spill = old_spill ? DARRAY_REALLOC(spill, new_capacity * stride)
+                          : DARRAY_ALLOC(new_capacity * stride);
+    DARRAY_ASSERT(spill != NULL, "no memory to grow array.");
+
+    if (!old_spill)
+        memcpy(spill, local, old_capacity * stride);
+
+    *capacity = new_capacity;
+    return spill;
+}
+
+#define darray_small_init(array)                                                                   \
+    do {                                                                                           \
+        (array).spill    = NULL;                                                                   \
+        (array).count    = 0;                                                                      \
+        (array).capacity = sizeof((array).local) / sizeof((array).local[0]);                       \
+    } while (0)
+
+#define darray_small_data(array)  ((array).spill ? (array).spill : (array).local)
+
+#define darray_small_count(array) ((array).count)
+
+/* 'allocator' may be null, for the heap */
+#define darray_small_push(array, value, allocator)                                                 \
+    do {                                                                                           \
+        if ((array).count == (array).capacity)                                                     \
+            (array).spill = darray_small_grow_impl(                                                \
+                (array).spill, (array).local, &(array).capacity, sizeof((array).local[0]),         \
+                allocator                                                                          \
+            );                                                                                     \
+        darray_small_data(array)[(array).count++] = (value);                                       \
+    } while (0)
+
+/* only needed for arrays spilling to the heap */
+#define darray_small_free(array)                                                                   \
+    do {                                                                                           \
+        DARRAY_DEALLOC((array).spill);                                                             \
+        darray_small_init(array);                                                                  \
+    } while (0)
+
+#define darray_small_foreach(array, type, it)                                                      \
+    for (type* it = darray_small_data(array); it < darray_small_data(array) + (array).count; ++it)
+
 #endif
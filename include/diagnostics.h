@@ -1,12 +1,17 @@
 #ifndef JAC_DIAGNOSTICS_H_
 #define JAC_DIAGNOSTICS_H_
 
+#include <stdarg.h>
 #include <stdio.h>
 
+struct jac_line_table;
 struct jac_token;
 
-void jac_print_diagnostic(const struct jac_token* token, const char* fmt, ...);
+void jac_print_diagnostic(const struct jac_line_table* lines, const struct jac_token* token, const char* fmt, ...);
 
-void jac_log_diagnostic(FILE* file, const struct jac_token* token, const char* fmt, ...);
+void jac_log_diagnostic(FILE* file, const struct jac_line_table* lines, const struct jac_token* token, const char* fmt, ...);
+
+// appends the diagnostic to 'buffer', a darray of char, instead of printing it
+void jac_buffer_diagnostic(char** buffer, const struct jac_line_table* lines, const struct jac_token* token, const char* fmt, va_list args);
 
 #endif
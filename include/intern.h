@@ -0,0 +1,63 @@
+#ifndef JAC_INTERN_H_
+#define JAC_INTERN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "darray.h"
+
+// stable identifier of an interned string, 0 is never handed out
+typedef uint32_t jac_intern_id;
+
+#define JAC_INTERN_NONE ((jac_intern_id)0)
+
+typedef struct jac_interned jac_interned;
+typedef struct jac_interner jac_interner;
+
+struct jac_interned
+{
+    uintptr_t value; // address of the bytes, less the interner's base
+    uint32_t length;
+    uint32_t hash;
+};
+
+// open addressing hash table from string contents to ids. interned bytes are
+// copied into 'storage', where they stay put for the lifetime of the interner.
+// a mapped interner reads its entries straight from an AST cache, with the
+// values relative to the mapping. it has no slots until something is interned
+struct jac_interner
+{
+    jac_memory_arena storage;
+    darray_t jac_interned *entries;
+    jac_intern_id *slots;
+    uint32_t slot_mask;
+    uintptr_t base; // 0 unless mapped
+};
+
+uint32_t jac_hash_string(const char *value, size_t length);
+
+// the full 64 bits, for keying whole sources
+uint64_t jac_hash_bytes(const char *value, size_t length);
+
+void jac_init_interner(jac_interner *interner);
+
+// NOTE: 'entries' is a darray that must outlive the interner
+void jac_init_mapped_interner(jac_interner *interner, jac_interned *entries, uintptr_t base);
+
+jac_intern_id jac_intern(jac_interner *interner, const char *value, size_t length, uint32_t hash);
+
+// NOTE: null-terminated
+static inline const char *jac_interned_value(const jac_interner *interner, jac_intern_id id)
+{
+    return (const char *)(interner->base + interner->entries[id].value);
+}
+
+static inline size_t jac_interned_length(const jac_interner *interner, jac_intern_id id)
+{
+    return interner->entries[id].length;
+}
+
+void jac_free_interner(jac_interner *interner);
+
+#endif
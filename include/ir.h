@@ -2,8 +2,10 @@
 #define JAC_IR_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "ast.h"
+#include "constant.h"
 #include "darray.h"
 #include "symbol.h"
 #include "type.h"
@@ -16,15 +18,65 @@ typedef struct jac_ir_block jac_ir_block;
 typedef struct jac_ir_function jac_ir_function;
 typedef struct jac_ir_unit jac_ir_unit;
 
+// operands per op. a block ends in at most one of RET, JUMP and BRANCH, one
+// without falls off the end of the function. phis come before anything else
 enum jac_ir_op
 {
-    JAC_IR_RET,
-    JAC_IR_CALL,
-    JAC_IR_ADDR,
-    JAC_IR_STORE,
-    JAC_IR_LOAD,
+    JAC_IR_RET,    // the value, if any
+    JAC_IR_CALL,   // the arguments
+    JAC_IR_ADDR,   // none, see jac_ir_instruction.local
+    JAC_IR_STORE,  // the value
+    JAC_IR_LOAD,   // none
+    JAC_IR_JUMP,   // none, see jac_ir_instruction.targets
+    JAC_IR_BRANCH, // the condition
+    JAC_IR_PHI,    // a value per predecessor, in the order of jac_ir_block.predecessors
+
+    // the operators of docs/README.md, which the checker does not lower yet.
+    // arithmetic is in the type of the result, and wraps around. comparisons
+    // and the logical ops give a bool, from operands of the type of the first
+    JAC_IR_ADD, // the two operands, for each below
+    JAC_IR_SUB,
+    JAC_IR_MUL,
+    JAC_IR_DIV,
+    JAC_IR_AND,
+    JAC_IR_OR,
+    JAC_IR_EQ,
+    JAC_IR_NE,
+    JAC_IR_LT,
+    JAC_IR_LE,
+    JAC_IR_GT,
+    JAC_IR_GE,
+    JAC_IR_NEG, // the operand, for each below
+    JAC_IR_NOT,
 };
 
+#define JAC_IR_NO_BLOCK UINT32_MAX
+
+static inline bool jac_ir_is_unary(enum jac_ir_op op)
+{
+    return (op == JAC_IR_NEG) || (op == JAC_IR_NOT);
+}
+
+static inline bool jac_ir_is_binary(enum jac_ir_op op)
+{
+    return (op >= JAC_IR_ADD) && (op <= JAC_IR_GE);
+}
+
+// the ops that define a value
+static inline bool jac_ir_has_result(enum jac_ir_op op)
+{
+    return (op == JAC_IR_CALL) || (op == JAC_IR_ADDR) || (op == JAC_IR_LOAD) || (op == JAC_IR_PHI) ||
+           jac_ir_is_binary(op) || jac_ir_is_unary(op);
+}
+
+// the ops that end a block, and only ever the last of it
+static inline bool jac_ir_is_terminator(enum jac_ir_op op)
+{
+    return (op == JAC_IR_RET) || (op == JAC_IR_JUMP) || (op == JAC_IR_BRANCH);
+}
+
+// a value, or a stack slot. values are numbered per function, the arguments
+// first, and each is defined once. slots are numbered apart from them
 struct jac_ir_symbol
 {
     jac_symbol sym;
@@ -33,8 +85,16 @@ struct jac_ir_symbol
 
 struct jac_ir_literal
 {
-    size_t str_index;
-    const struct jac_token *value;
+    union {
+        jac_constant constant;
+        size_t str_index; // into jac_ir_unit.str_literals
+    } opt;
+
+    enum
+    {
+        JAC_IR_LITERAL_CONSTANT,
+        JAC_IR_LITERAL_STRING,
+    } holds;
 };
 
 struct jac_ir_value
@@ -48,38 +108,79 @@ struct jac_ir_value
     {
         JAC_IR_VALUE_VARIABLE,
         JAC_IR_VALUE_LITERAL,
+        JAC_IR_VALUE_UNDEF, // read before any store, only ever in unreachable code
     } holds;
 };
 
+// most instructions take one or two operands
+typedef darray_small_t(jac_ir_value, 2) jac_ir_value_list;
+
 struct jac_ir_instruction
 {
     jac_ir_symbol result;
-    darray_t jac_ir_value *operands;
+    jac_ir_value_list operands;
+    size_t callee;       // JAC_IR_CALL, into jac_ir_unit.functions
+    uint32_t local;      // JAC_IR_ADDR, JAC_IR_STORE and JAC_IR_LOAD, into jac_ir_function.locals
+    uint32_t targets[2]; // JAC_IR_JUMP, and JAC_IR_BRANCH if true and if false
     enum jac_ir_op op;
 };
 
+// indices into jac_ir_function.blocks. most blocks have an edge or two each way
+typedef darray_small_t(uint32_t, 2) jac_ir_block_list;
+
 struct jac_ir_block
 {
     darray_t jac_ir_instruction *instructions;
-    size_t id;
+    size_t id; // its index
+    jac_ir_block_list successors;   // see jac_build_cfg
+    jac_ir_block_list predecessors; // one per edge, so a block may be listed twice
 };
 
+// the targets of the last instruction, in its 'targets'. none for a ret, or
+// for a block left without a terminator
+static inline uint32_t jac_ir_target_count(const jac_ir_block *block)
+{
+    size_t count = darray_count(block->instructions);
+    if (count == 0)
+        return 0;
+
+    enum jac_ir_op op = block->instructions[count - 1].op;
+    return (op == JAC_IR_JUMP) ? 1 : (op == JAC_IR_BRANCH) ? 2 : 0;
+}
+
+// what a #(inline) or #(noinline) in front of a definition asks of the inliner
+enum jac_ir_inlining
+{
+    JAC_IR_INLINE_AUTO, // as the cost model decides
+    JAC_IR_INLINE_ALWAYS,
+    JAC_IR_INLINE_NEVER,
+};
+
+// the first block is the entry, which nothing branches to
 struct jac_ir_function
 {
     jac_function header;
     darray_t jac_ir_block *blocks;
-    size_t tmp_counter;
+    darray_t jac_ir_symbol *locals; // stack slots, the arguments are stored into their own on entry
+    size_t tmp_counter;             // next value id
+    enum jac_ir_inlining inlining;
 };
 
 struct jac_ir_unit
 {
     darray_t jac_ir_function *functions;
     darray_t jac_symbol *globals;
-    const darray_t char **str_literals;
+    darray_t jac_intern_id *str_literals;
+    jac_type_table types;
 };
 
-bool jac_check_unit(const jac_ast_unit unit, jac_ir_unit *ir);
+struct jac_memory_arena;
+
+// NOTE: the IR, arrays included, is allocated from 'arena', and released along with it
+bool jac_check_unit(const jac_ast_unit *ast, const jac_line_table *lines, struct jac_memory_arena *arena,
+                    jac_ir_unit *ir);
 
-void jac_print_ir(const jac_ir_unit *unit, int indent);
+// mangled names are made as they are printed, into 'arena'
+void jac_print_ir(const jac_ir_unit *unit, const jac_interner *interner, struct jac_memory_arena *arena, int indent);
 
 #endif
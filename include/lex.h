@@ -1,23 +1,46 @@
 #ifndef JAC_LEX_H_
 #define JAC_LEX_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "constant.h"
 #include "darray.h"
+#include "intern.h"
 
-typedef struct jac_token_diagnostics jac_token_diagnostics;
+typedef struct jac_line_table jac_line_table;
 typedef struct jac_token jac_token;
+typedef struct jac_token_list jac_token_list;
 
 enum jac_token_kind
 {
     JAC_TOKEN_EOF = '\0',
     JAC_TOKEN_IDENTIFIER,
-    JAC_TOKEN_INT_LITERAL,
+    JAC_TOKEN_NUM_LITERAL,
     JAC_TOKEN_STR_LITERAL,
 
     JAC_TOKEN_RETURN,
     JAC_TOKEN_EXTERN,
     JAC_TOKEN_FUNC,
-    JAC_TOKEN_INT32,
+    JAC_TOKEN_MUT,
+    JAC_TOKEN_GLOBAL,
+    JAC_TOKEN_LOCAL,
+    JAC_TOKEN_IF,
+    JAC_TOKEN_ELIF,
+    JAC_TOKEN_ELSE,
+
+    JAC_TOKEN_BOOL,
     JAC_TOKEN_UINT8,
+    JAC_TOKEN_UINT16,
+    JAC_TOKEN_UINT32,
+    JAC_TOKEN_UINT64,
+    JAC_TOKEN_INT8,
+    JAC_TOKEN_INT16,
+    JAC_TOKEN_INT32,
+    JAC_TOKEN_INT64,
+    JAC_TOKEN_FLOAT32,
+    JAC_TOKEN_FLOAT64,
 
     JAC_TOKEN_SEMICOLON = ';',
     JAC_TOKEN_COLON = ':',
@@ -31,26 +54,130 @@ enum jac_token_kind
     JAC_TOKEN_GT = '>',
     JAC_TOKEN_AMPERSAND = '&',
     JAC_TOKEN_EQUALS = '=',
+    JAC_TOKEN_HASH = '#',
 };
 
-struct jac_token_diagnostics
+// offsets of the line starts in a source, recorded while lexing. tokens only
+// carry their source offset, and are resolved to a line and column when a
+// diagnostic actually needs one
+struct jac_line_table
 {
-    const char *source_line;
-    size_t length;
-    size_t line;
-    size_t column;
+    const char *source;
+    darray_t uint32_t *starts;
 };
 
+// 1-based line and column of the byte at 'offset'
+void jac_locate(const jac_line_table *lines, uint32_t offset, size_t *line, size_t *column);
+
+// a single token, as handed out by the lexer. see jac_token_list for how
+// tokens are stored in bulk
 struct jac_token
 {
-    jac_token_diagnostics diagnostics;
-    darray_t char *value;
+    const char *value; // NOTE: not null-terminated, see jac_token_length
+    uint32_t offset;   // into the source, see jac_locate
+    uint32_t length;
     enum jac_token_kind kind;
+    jac_intern_id id;      // identifiers and string literals only
+    jac_constant constant; // numeric literals only
+};
+
+struct jac_memory_arena;
+
+static inline const char *jac_token_value(const jac_token *token)
+{
+    return token->value;
+}
+
+static inline size_t jac_token_length(const jac_token *token)
+{
+    return token->length;
+}
+
+static inline bool jac_token_equals(const jac_token *a, const jac_token *b)
+{
+    if ((a->id != JAC_INTERN_NONE) && (b->id != JAC_INTERN_NONE))
+        return a->id == b->id;
+
+    return (jac_token_length(a) == jac_token_length(b)) &&
+           (memcmp(jac_token_value(a), jac_token_value(b), jac_token_length(a)) == 0);
+}
+
+// printf helpers for token values, e.g. printf("'" JAC_TOKEN_FMT "'", JAC_TOKEN_ARG(token))
+#define JAC_TOKEN_FMT        "%.*s"
+#define JAC_TOKEN_ARG(token) (int)jac_token_length(token), jac_token_value(token)
+
+#define JAC_LEXER_LOOKAHEAD 4
+
+typedef struct jac_lexer jac_lexer;
+
+// pull-based lexer, tokens are produced on demand into a small ring buffer.
+// a replaying lexer hands out the tokens of a list instead of scanning
+struct jac_lexer
+{
+    const char *source;
+    const char *c;
+    jac_line_table lines;
+    struct jac_memory_arena *strings;
+    jac_interner *interner;
+
+    const jac_token_list *tokens; // replaying only
+    size_t next;
+
+    jac_token lookahead[JAC_LEXER_LOOKAHEAD];
+    size_t head, count;
+    bool invalid;
+    bool quiet; // invalid tokens are flagged, but not reported
 };
 
-// NOTE: expects null-termination
-darray_t jac_token *jac_tokenize(const char *source);
+// NOTE: expects null-termination, and 'source' to outlive the tokens.
+// escaped string literals are decoded into 'strings'. identifiers and string
+// literals are interned into 'interner' as they are scanned
+void jac_init_lexer(jac_lexer *lexer, const char *source, struct jac_memory_arena *strings, jac_interner *interner);
+
+// replays 'tokens' from 'position' on. the line table stays with the list
+void jac_init_replay_lexer(jac_lexer *lexer, const jac_token_list *tokens, size_t position, jac_interner *interner);
+
+// index of the next token to be consumed, replaying only
+size_t jac_lexer_position(const jac_lexer *lexer);
+
+// NOTE: 'k' must be less than JAC_LEXER_LOOKAHEAD, and the token is only
+// valid until the next call to jac_next_token
+const jac_token *jac_peek_token(jac_lexer *lexer, size_t k);
+
+jac_token jac_next_token(jac_lexer *lexer);
+
+// NOTE: diagnostics are printed well after lexing, so the line table is kept
+// until the lexer is freed
+void jac_free_lexer(jac_lexer *lexer);
+
+// tokens as parallel arrays. jac_tokenize takes over the line table from the
+// lexer, lists filled by jac_push_token have none
+struct jac_token_list
+{
+    darray_t uint8_t *kinds;
+    darray_t uint32_t *offsets;
+    darray_t uint32_t *lengths;
+    darray_t jac_intern_id *ids; // index into 'constants' for numeric literals
+    darray_t jac_constant *constants;
+    jac_line_table lines;
+    const jac_interner *interner;
+};
+
+void jac_init_tokens(jac_token_list *tokens, const char *source, const jac_interner *interner);
+
+// returns the index of the token in the list
+uint32_t jac_push_token(jac_token_list *tokens, const jac_token *token);
+
+// appends the tokens of 'from' starting at index 'begin'
+void jac_append_tokens(jac_token_list *tokens, const jac_token_list *from, size_t begin);
+
+// lexes the whole source up front. returns false if the source is invalid,
+// without reporting why, a streaming jac_lexer does that
+bool jac_tokenize(const char *source, struct jac_memory_arena *strings, jac_interner *interner, jac_token_list *tokens);
+
+jac_token jac_get_token(const jac_token_list *tokens, size_t index);
 
-void jac_free_tokens(darray_t jac_token *tokens);
+// NOTE: also takes a zeroed list
+void jac_free_tokens(jac_token_list *tokens);
 
 #endif
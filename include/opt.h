@@ -0,0 +1,78 @@
+#ifndef JAC_OPT_H_
+#define JAC_OPT_H_
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "constant.h"
+#include "ir.h"
+
+/*
+ * Passes over the IR in SSA form, see ssa.h. Each keeps the CFG in step with
+ * the terminators, and the IR valid for jac_verify_function.
+ */
+
+/*
+ * FOLDING
+ */
+
+// the value of 'constant' as one of 'kind': in 'u' for bool and the unsigned
+// kinds, in 'i' for the signed ones, cut to their width, and in 'f' for the
+// floats, rounded to theirs. fails for kinds that are not primitive, and for
+// floats out of the range of an integer kind
+bool jac_convert_constant(const jac_constant *constant, enum jac_type_kind kind, jac_constant *result);
+
+// whether 'constant' keeps its value as one of 'kind': no fraction into an
+// integer kind, no negative into an unsigned one, and nothing out of range
+bool jac_constant_fits(const jac_constant *constant, enum jac_type_kind kind);
+
+// 'op' over operands converted to 'kind', with the wraparound of its width.
+// fails where the instruction would trap, on integer division by zero or of
+// the least signed value by -1, and for ops 'kind' does not have
+bool jac_fold_unary(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *operand, jac_constant *result);
+
+bool jac_fold_binary(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *left, const jac_constant *right,
+                     jac_constant *result);
+
+/*
+ * SCCP
+ */
+
+// sparse conditional constant propagation, after Wegman and Zadeck. values
+// found constant become literals, and branches on known conditions jumps. the
+// blocks found unreachable are left for later passes
+// NOTE: needs the CFG
+void jac_propagate_constants(jac_ir_function *function, jac_memory_arena *scratch);
+
+/*
+ * DEAD CODE
+ */
+
+// removes the blocks the entry does not reach, the instructions whose value
+// is unused and which have no effect, and the stores to slots never read.
+// then merges each block into its predecessor, if that is the only one and
+// jumps straight to it. the blocks left are renumbered in order
+// NOTE: needs the CFG
+void jac_eliminate_dead_code(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch);
+
+/*
+ * INLINING
+ */
+
+// replaces calls with a copy of the callee, where its #(inline) or
+// #(noinline), or else the cost model, has it. callers come after their
+// callees, so what those inlined comes along, and calls within a cycle of
+// the call graph are never inlined. a caller that inlined anything goes
+// through jac_propagate_constants and jac_eliminate_dead_code again. each
+// decision is a remark
+// NOTE: needs the CFG of every function
+void jac_inline_calls(jac_ir_unit *unit, jac_memory_arena *arena, jac_memory_arena *scratch);
+
+/*
+ * PIPELINE
+ */
+
+// runs the passes over every function in SSA form, see jac_construct_ssa
+void jac_optimize_unit(jac_ir_unit *unit, jac_memory_arena *arena);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef JAC_SOURCE_H_
+#define JAC_SOURCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct jac_source jac_source;
+
+struct jac_source
+{
+    const char *text; // NOTE: always null-terminated
+    size_t length;
+    size_t mapped_size; // 0 when read onto the heap
+};
+
+// maps regular files read-only, and falls back to reading pipes, stdin ("-")
+// and anything else that cannot be mapped
+bool jac_load_source(const char *path, jac_source *source);
+
+void jac_free_source(jac_source *source);
+
+static inline bool jac_source_is_mapped(const jac_source *source)
+{
+    return source->mapped_size != 0;
+}
+
+#endif
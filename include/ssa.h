@@ -0,0 +1,102 @@
+#ifndef JAC_SSA_H_
+#define JAC_SSA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "ir.h"
+
+/*
+ * Control flow and SSA form over jac_ir_function. The checker leaves every
+ * variable in a stack slot of its own. SSA construction promotes the slots
+ * whose address never escapes into values, with phis where definitions
+ * meet, and leaves the others to memory. The analyses are rebuilt by whoever
+ * needs them, in a scratch arena, while the CFG edges belong to the IR.
+ */
+
+/*
+ * CFG
+ */
+
+// the edges, from the terminators. a block without one has no successors
+void jac_build_cfg(jac_ir_function *function, jac_memory_arena *arena);
+
+// removes an edge, and the operands of the phis along it. the terminator of
+// 'from' is left to the caller
+void jac_remove_edge(jac_ir_function *function, uint32_t from, uint32_t to);
+
+// builds the CFG again after terminators changed, keeping each phi operand
+// with the edge it came in by. the predecessors must name the blocks by their
+// indices now. operands of the edges that are gone are dropped, and the new
+// edges bring undefined ones
+void jac_update_cfg(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch);
+
+/*
+ * DOMINATORS
+ */
+
+typedef struct jac_dominator_tree jac_dominator_tree;
+
+// per block, after Cooper, Harvey and Kennedy. blocks the entry does not reach
+// have no immediate dominator, and are left out of everything else
+struct jac_dominator_tree
+{
+    uint32_t *idom;       // the entry is its own, JAC_IR_NO_BLOCK if unreachable
+    uint32_t *postorder;  // number in a postorder of the CFG
+    uint32_t *order;      // the reachable blocks, in reverse postorder
+    uint32_t reachable;   // count of 'order'
+    uint32_t *children;   // of each block in the tree, from 'first_child'
+    uint32_t *first_child; // per block, into 'children', with a sentinel at the end
+    uint32_t *enter;      // preorder interval in the tree, see jac_dominates
+    uint32_t *exit;
+};
+
+// NOTE: needs the CFG
+void jac_build_dominators(const jac_ir_function *function, jac_memory_arena *arena, jac_dominator_tree *tree);
+
+// whether every path from the entry to 'b' goes through 'a'. a block dominates itself
+static inline bool jac_dominates(const jac_dominator_tree *tree, uint32_t a, uint32_t b)
+{
+    return (tree->idom[b] != JAC_IR_NO_BLOCK) && (tree->enter[a] <= tree->enter[b]) &&
+           (tree->exit[b] <= tree->exit[a]);
+}
+
+static inline bool jac_is_reachable(const jac_dominator_tree *tree, uint32_t block)
+{
+    return tree->idom[block] != JAC_IR_NO_BLOCK;
+}
+
+// per block, where its dominance ends. each list is free of duplicates
+jac_ir_block_list *jac_dominance_frontiers(const jac_ir_function *function, const jac_dominator_tree *tree,
+                                           jac_memory_arena *arena);
+
+/*
+ * CONSTRUCTION
+ */
+
+// rewrites the loads and stores of the slots marked in 'promote' into values.
+// the other slots are kept, and renumbered. IR goes in 'arena', and the
+// analyses it needs in 'scratch', which is rewound afterwards
+// NOTE: needs the CFG
+void jac_promote_locals(jac_ir_function *function, const bool *promote, jac_memory_arena *arena,
+                        jac_memory_arena *scratch);
+
+// builds the CFG of every function, and promotes every slot whose address
+// does not escape it
+void jac_construct_ssa(jac_ir_unit *unit, jac_memory_arena *arena);
+
+/*
+ * VERIFIER
+ */
+
+// checks the CFG against the terminators, and that each value is defined once,
+// before it is used, by an instruction that dominates the use. problems are
+// reported to 'stream'
+bool jac_verify_function(const jac_ir_unit *unit, const jac_ir_function *function, jac_memory_arena *scratch,
+                         FILE *stream);
+
+bool jac_verify_unit(const jac_ir_unit *unit, FILE *stream);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef JAC_STATS_H_
+#define JAC_STATS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+enum jac_phase
+{
+    JAC_PHASE_DRIVER, // anything outside of the phases below
+    JAC_PHASE_READ,
+    JAC_PHASE_LEX,
+    JAC_PHASE_PARSE,
+    JAC_PHASE_CHECK,
+    JAC_PHASE_OPT, // SSA construction, and the passes over it
+    JAC_PHASE_GEN,
+    JAC_PHASE_WRITE,
+    JAC_PHASE_COUNT,
+};
+
+typedef struct jac_memory_stats jac_memory_stats;
+
+struct jac_memory_stats
+{
+    size_t allocations;
+    size_t reallocations;
+    size_t frees;
+    size_t bytes;     // requested by allocations, and by reallocations growing a block
+    size_t peak_live; // highest live heap bytes while in the phase
+    size_t arena_allocations;
+    size_t arena_bytes;
+};
+
+/*
+ * Memory telemetry. Builds defining DARRAY_CUSTOM_ALLOC route every darray,
+ * small array and arena chunk through counting allocators, tagged by the
+ * current phase. Allocations served from arena chunks are counted apart, as
+ * they never reach the heap. Counting is off until jac_enable_memory_stats,
+ * which must be called before anything is allocated.
+ */
+
+extern bool jac_memory_stats_enabled;
+
+const char *jac_phase_name(enum jac_phase phase);
+
+// returns the phase left, to restore it afterwards
+enum jac_phase jac_enter_phase(enum jac_phase phase);
+
+// returns false if the build has no allocation hooks
+bool jac_enable_memory_stats(void);
+
+void jac_count_arena_allocation(size_t size);
+
+#ifdef DARRAY_CUSTOM_ALLOC
+#define JAC_COUNT_ARENA_ALLOCATION(size)                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (jac_memory_stats_enabled)                                                                                  \
+            jac_count_arena_allocation(size);                                                                          \
+    } while (0)
+#else
+#define JAC_COUNT_ARENA_ALLOCATION(size) ((void)0)
+#endif
+
+// 'lines' of source compiled, to put the totals in proportion
+void jac_print_memory_stats(FILE *stream, size_t lines);
+
+void jac_write_memory_stats_json(FILE *stream, const char *source_path, size_t source_bytes, size_t lines);
+
+/*
+ * Pass statistics, of what the passes over the IR did. Those run on the main
+ * thread, so counting takes no lock, and is always on.
+ */
+
+enum jac_counter
+{
+    JAC_COUNTER_FOLDED,          // instructions of a known value, removed
+    JAC_COUNTER_FOLDED_BRANCHES, // branches on a known condition, made jumps
+    JAC_COUNTER_UNREACHABLE_BLOCKS,
+    JAC_COUNTER_DEAD_INSTRUCTIONS, // of an unused value and no effect
+    JAC_COUNTER_DEAD_STORES,       // to slots never read
+    JAC_COUNTER_MERGED_BLOCKS,     // into their single predecessor
+    JAC_COUNTER_INLINED,           // calls replaced by the body of the callee
+    JAC_COUNTER_COUNT,
+};
+
+void jac_count(enum jac_counter counter, size_t count);
+
+void jac_print_pass_stats(FILE *stream);
+
+/*
+ * Pass remarks, a line for each decision a pass made and why, for --remarks.
+ * They are kept until printed, and only while enabled.
+ */
+
+extern bool jac_remarks_enabled;
+
+void jac_remark(const char *fmt, ...);
+
+// and forgets them
+void jac_print_remarks(FILE *stream);
+
+#endif
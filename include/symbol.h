@@ -1,28 +1,150 @@
 #ifndef JAC_SYMBOL_H_
 #define JAC_SYMBOL_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "darray.h"
+#include "intern.h"
+#include "lex.h"
 #include "type.h"
 
-struct jac_token;
-
 typedef struct jac_symbol jac_symbol;
 typedef struct jac_function jac_function;
 
 struct jac_symbol
 {
-    const struct jac_token *identifier;
+    jac_token identifier;
     jac_type type;
 };
 
+// most functions take a couple of arguments at most
+typedef darray_small_t(jac_symbol, 2) jac_symbol_list;
+
 struct jac_function
 {
     jac_type ret_type;
-    const struct jac_token *identifier;
-    const darray_t char *mangled;
-    darray_t jac_symbol *args;
+    jac_token identifier;
+    jac_symbol_list args;
+};
+
+struct jac_memory_arena;
+
+// null-terminated, in 'arena'. only what gets emitted needs a mangled name,
+// overloads are told apart by jac_function_index
+const char *jac_mangle_function_name(struct jac_memory_arena *arena, const jac_function *function);
+
+/*
+ * SYMBOL TABLE
+ */
+
+typedef struct jac_binding jac_binding;
+typedef struct jac_symbol_slot jac_symbol_slot;
+typedef struct jac_symbol_table jac_symbol_table;
+
+struct jac_binding
+{
+    jac_intern_id name;
+    uint32_t value;
+    uint32_t shadowed; // index of the binding of the same name further out, plus 1. 0 if there is none
+};
+
+struct jac_symbol_slot
+{
+    jac_intern_id name;
+    uint32_t binding; // index of the innermost binding, plus 1. 0 while the name is unbound
+};
+
+// interned names to values, in nested scopes. the hash table keeps every name
+// it has seen, pointing to the innermost binding, and the bindings of the open
+// scopes are a stack. leaving a scope only unwinds its own bindings
+struct jac_symbol_table
+{
+    jac_symbol_slot *slots;
+    uint32_t slot_mask;
+    uint32_t names;
+    darray_t jac_binding *bindings;
+    darray_t uint32_t *scopes; // where each open scope starts in 'bindings'
+};
+
+// NOTE: starts out with one scope open
+void jac_init_symbol_table(jac_symbol_table *table);
+
+void jac_push_scope(jac_symbol_table *table);
+
+void jac_pop_scope(jac_symbol_table *table);
+
+// binds 'name' in the innermost scope, shadowing any outer binding. fails if
+// the scope already binds it, and sets 'previous' to that value
+bool jac_declare_symbol(jac_symbol_table *table, jac_intern_id name, uint32_t value, uint32_t *previous);
+
+// the value of the innermost binding of 'name'
+bool jac_lookup_symbol(const jac_symbol_table *table, jac_intern_id name, uint32_t *value);
+
+void jac_free_symbol_table(jac_symbol_table *table);
+
+/*
+ * FUNCTION INDEX
+ */
+
+typedef struct jac_overload jac_overload;
+typedef struct jac_overload_slot jac_overload_slot;
+typedef struct jac_function_index jac_function_index;
+
+struct jac_overload
+{
+    uint32_t function; // the caller's own index
+    uint32_t hash;     // of the parameter types
+    uint32_t params;   // start of the parameter types in the index
+    uint32_t next;     // next overload of the same name and arity, plus 1. 0 for the last
 };
 
-const char *jac_mangle_function_name(const struct jac_token *identifier, darray_t jac_symbol *args);
+struct jac_overload_slot
+{
+    jac_intern_id name; // JAC_INTERN_NONE for an empty slot
+    uint32_t arity;
+    uint32_t first; // plus 1
+};
+
+// functions by name and parameter types. one hash probe on the name and the
+// arity finds the overloads that could take a call, a short list to match the
+// signature hash against, without any strings involved
+struct jac_function_index
+{
+    jac_overload_slot *slots;
+    uint32_t slot_mask;
+    uint32_t used;
+    darray_t jac_overload *overloads;
+    darray_t jac_type_id *types;
+};
+
+uint32_t jac_signature_hash(const jac_type_id *params, uint32_t arity);
+
+void jac_init_function_index(jac_function_index *index);
+
+// adds an overload, unless one with the same parameter types is there already.
+// then it fails, and sets 'previous' to that one's function
+bool jac_add_overload(jac_function_index *index, jac_intern_id name, const jac_type_id *params, uint32_t arity,
+                      uint32_t function, uint32_t *previous);
+
+// the overloads of 'name' taking 'arity' arguments, NULL if there are none.
+// see jac_next_overload for the rest
+const jac_overload *jac_first_overload(const jac_function_index *index, jac_intern_id name, uint32_t arity);
+
+static inline const jac_overload *jac_next_overload(const jac_function_index *index, const jac_overload *overload)
+{
+    return overload->next ? index->overloads + overload->next - 1 : NULL;
+}
+
+static inline const jac_type_id *jac_overload_params(const jac_function_index *index, const jac_overload *overload)
+{
+    return index->types + overload->params;
+}
+
+// the overload taking exactly 'params'. ids are canonical, so this compares no types as such
+bool jac_find_overload(const jac_function_index *index, jac_intern_id name, const jac_type_id *params, uint32_t arity,
+                       uint32_t *function);
+
+void jac_free_function_index(jac_function_index *index);
 
 #endif
@@ -0,0 +1,45 @@
+#ifndef JAC_THREAD_H_
+#define JAC_THREAD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * Just enough threading for splitting a phase into independent work items.
+ * There is no pool that outlives a call: jac_parallel_for spawns its workers,
+ * joins them, and returns once every item is done.
+ */
+
+#if defined(_WIN32)
+typedef SRWLOCK jac_mutex;
+#define JAC_MUTEX_INIT SRWLOCK_INIT
+typedef DWORD jac_thread_id;
+#else
+typedef pthread_mutex_t jac_mutex;
+#define JAC_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+typedef pthread_t jac_thread_id;
+#endif
+
+void jac_lock(jac_mutex *mutex);
+
+void jac_unlock(jac_mutex *mutex);
+
+jac_thread_id jac_current_thread(void);
+
+bool jac_same_thread(jac_thread_id a, jac_thread_id b);
+
+// online processors, at least 1
+unsigned jac_hardware_threads(void);
+
+// calls 'work' once for every index below 'count', on up to 'threads' threads
+// including the caller. indices are handed out in increasing order, though
+// they may finish in any order
+void jac_parallel_for(size_t count, unsigned threads, void (*work)(void *context, size_t index), void *context);
+
+#endif
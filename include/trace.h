@@ -0,0 +1,78 @@
+#ifndef JAC_TRACE_H_
+#define JAC_TRACE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+/*
+ * Timing, on a monotonic clock. Once jac_enable_timing is called, every
+ * jac_enter_phase charges the time since the last switch to the phase left,
+ * which splits lexing from the parsing that drives it. Events are spans,
+ * a whole phase or a single function, kept for the function report and for
+ * --trace, which writes them in the Chrome trace-event format, a track for
+ * every thread that recorded any.
+ */
+
+typedef struct jac_trace_event jac_trace_event;
+
+struct jac_trace_event
+{
+    const char *category; // "phase" or "function"
+    size_t name;          // into the event names
+    enum jac_phase phase;
+    uint64_t start; // nanoseconds since jac_enable_timing
+    uint64_t duration;
+    uint32_t thread; // 1 for the thread that enabled timing
+    bool dropped;
+};
+
+typedef struct jac_event_range jac_event_range;
+
+// the events one thread records between jac_begin_event_range and
+// jac_end_event_range, for work that may be thrown away and done again
+struct jac_event_range
+{
+    size_t begin, end;
+    uint32_t thread;
+};
+
+extern bool jac_timing_enabled;
+extern bool jac_events_enabled;
+
+// nanoseconds, from an arbitrary origin
+uint64_t jac_now(void);
+
+void jac_enable_timing(bool events);
+
+// called by jac_enter_phase
+void jac_charge_phase_time(enum jac_phase phase);
+
+uint64_t jac_phase_time(enum jac_phase phase);
+
+static inline uint64_t jac_begin_event(void)
+{
+    return jac_events_enabled ? jac_now() : 0;
+}
+
+// 'name' need not outlive the call, it is copied
+void jac_end_event(const char *category, enum jac_phase phase, const char *name, size_t length, uint64_t start);
+
+jac_event_range jac_begin_event_range(void);
+
+void jac_end_event_range(jac_event_range *range);
+
+// leaves the events of the range out of the report and the trace
+void jac_drop_event_range(const jac_event_range *range);
+
+// 'functions' adds the slowest functions, if events were recorded
+void jac_print_time_report(FILE *stream, bool functions);
+
+void jac_write_trace(FILE *stream, const char *source_path);
+
+void jac_free_trace(void);
+
+#endif
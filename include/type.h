@@ -1,27 +1,101 @@
 #ifndef JAC_TYPE_H_
 #define JAC_TYPE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
-enum jac_type_kind
-{
-    JAC_TYPE_NONE,
-    JAC_TYPE_CUSTOM,
-    JAC_TYPE_INT8,
-    JAC_TYPE_UINT8,
-    JAC_TYPE_INT32,
-    JAC_TYPE_UINT32,
-    JAC_TYPE_INT64,
-    JAC_TYPE_UINT64
-};
+#include "constant.h"
+#include "darray.h"
+#include "intern.h"
+#include "lex.h"
+
+// canonical identifier of a type, see jac_type_table. the primitives have ids
+// equal to their enum jac_type_kind, so 0 is JAC_TYPE_NONE
+typedef uint32_t jac_type_id;
 
 typedef struct jac_type jac_type;
 
+// a type as written
 struct jac_type
 {
-    const struct jac_token *token;
+    jac_token token;
     enum jac_type_kind kind;
     uint8_t indirection;
+    jac_type_id id; // JAC_TYPE_NONE until the checker interns it
+};
+
+/*
+ * TYPE TABLE
+ */
+
+typedef struct jac_type_info jac_type_info;
+typedef struct jac_type_table jac_type_table;
+
+enum jac_type_form
+{
+    JAC_TYPE_FORM_PRIMITIVE,
+    JAC_TYPE_FORM_POINTER,
+    JAC_TYPE_FORM_ARRAY,
+    JAC_TYPE_FORM_CUSTOM,
 };
 
+struct jac_type_info
+{
+    uint8_t form;          // enum jac_type_form
+    uint8_t kind;          // enum jac_type_kind of a primitive, JAC_TYPE_CUSTOM otherwise
+    jac_type_id base;      // pointee or element type
+    uint32_t count;        // elements of an array
+    jac_intern_id name;    // of a custom type
+    uint32_t size;         // 0 while a custom type is incomplete
+    uint32_t alignment;
+};
+
+// every distinct type once, hash-consed on its form and operands. pointer and
+// array types are built from the ids of their base types, so two types are
+// the same exactly when their ids are, and their layout is an array lookup
+struct jac_type_table
+{
+    darray_t jac_type_info *types; // by id
+    jac_type_id *slots;            // ids of the composite types, 0 for an empty slot
+    uint32_t slot_mask;
+    struct jac_memory_arena *arena;
+};
+
+// NOTE: the table is allocated from 'arena', and released along with it
+void jac_init_type_table(jac_type_table *table, struct jac_memory_arena *arena);
+
+static inline jac_type_id jac_primitive_type(enum jac_type_kind kind)
+{
+    return (jac_type_id)kind;
+}
+
+jac_type_id jac_pointer_type(jac_type_table *table, jac_type_id base);
+
+jac_type_id jac_array_type(jac_type_table *table, jac_type_id element, uint32_t count);
+
+jac_type_id jac_custom_type(jac_type_table *table, jac_intern_id name);
+
+// the canonical id of a written type, its pointers included
+jac_type_id jac_intern_type(jac_type_table *table, const jac_type *type);
+
+static inline const jac_type_info *jac_type_info_of(const jac_type_table *table, jac_type_id id)
+{
+    return table->types + id;
+}
+
+static inline uint32_t jac_type_size(const jac_type_table *table, jac_type_id id)
+{
+    return table->types[id].size;
+}
+
+static inline uint32_t jac_type_alignment(const jac_type_table *table, jac_type_id id)
+{
+    return table->types[id].alignment;
+}
+
+static inline bool jac_is_numeric_type(jac_type_id id)
+{
+    return (id >= JAC_TYPE_INT8) && (id <= JAC_TYPE_FLOAT64);
+}
+
 #endif
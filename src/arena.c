@@ -0,0 +1,143 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+
+static size_t granules(size_t size)
+{
+    return (size + JAC_ARENA_GRANULE - 1) & ~(size_t)(JAC_ARENA_GRANULE - 1);
+}
+
+// the newest allocation grows and shrinks in place, while its chunk has room.
+// anything else is copied, and the old storage left for the arena to reclaim
+static void *reallocate(darray_allocator *allocator, void *ptr, size_t old_size, size_t size)
+{
+    jac_memory_arena *arena = (jac_memory_arena *)allocator;
+
+    if (ptr && ((char *)ptr + granules(old_size) == arena->cursor) &&
+        (granules(size) <= (size_t)(arena->end - (char *)ptr)))
+    {
+        arena->cursor = (char *)ptr + granules(size);
+        return ptr;
+    }
+
+    void *memory = jac_arena_alloc_impl(arena, size);
+    if (ptr)
+        memcpy(memory, ptr, (old_size < size) ? old_size : size);
+    return memory;
+}
+
+static void deallocate(darray_allocator *allocator, void *ptr)
+{
+    (void)allocator;
+    (void)ptr;
+}
+
+void jac_init_arena(jac_memory_arena *arena)
+{
+    *arena = (jac_memory_arena){
+        .allocator = {.reallocate = reallocate, .deallocate = deallocate},
+        .chunk = NULL,
+        .spare = NULL,
+        .cursor = NULL,
+        .end = NULL,
+    };
+}
+
+static char *align_up(char *c, size_t alignment)
+{
+    return (char *)(((uintptr_t)c + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+static jac_arena_chunk *new_chunk(jac_memory_arena *arena, size_t size)
+{
+    // only chunks of the default size are ever spared
+    if ((size == JAC_ARENA_CHUNK_SIZE) && arena->spare)
+    {
+        jac_arena_chunk *chunk = arena->spare;
+        arena->spare = chunk->previous;
+        return chunk;
+    }
+
+    jac_arena_chunk *chunk = DARRAY_ALLOC(sizeof(jac_arena_chunk) + size);
+    JAC_ASSERT(chunk != NULL, "no memory to allocate arena chunk.");
+    chunk->size = size;
+    return chunk;
+}
+
+static void release_chunk(jac_memory_arena *arena, jac_arena_chunk *chunk)
+{
+    if (chunk->size != JAC_ARENA_CHUNK_SIZE)
+    {
+        DARRAY_DEALLOC(chunk);
+        return;
+    }
+
+    chunk->previous = arena->spare;
+    arena->spare = chunk;
+}
+
+void *jac_arena_alloc_slow(jac_memory_arena *arena, size_t size, size_t alignment)
+{
+    JAC_ASSERT((alignment & (alignment - 1)) == 0, "alignment must be a power of two.");
+    if (alignment < JAC_ARENA_GRANULE)
+        alignment = JAC_ARENA_GRANULE;
+
+    // over-aligned allocations may still fit the current chunk
+    if (arena->chunk)
+    {
+        char *memory = align_up(arena->cursor, alignment);
+        if ((memory <= arena->end) && (size <= (size_t)(arena->end - memory)))
+        {
+            arena->cursor = memory + size;
+            return memory;
+        }
+    }
+
+    // large allocations get a chunk of their own, so they waste no more than
+    // the rest of the current one
+    size_t needed = size + (alignment - JAC_ARENA_GRANULE);
+    jac_arena_chunk *chunk = new_chunk(arena, (needed > JAC_ARENA_CHUNK_SIZE / 4) ? needed : JAC_ARENA_CHUNK_SIZE);
+
+    chunk->previous = arena->chunk;
+    arena->chunk = chunk;
+    arena->end = chunk->data + chunk->size;
+
+    char *memory = align_up(chunk->data, alignment);
+    arena->cursor = memory + size;
+    return memory;
+}
+
+void jac_arena_rewind(jac_memory_arena *arena, jac_arena_mark mark)
+{
+    while (arena->chunk != mark.chunk)
+    {
+        JAC_ASSERT(arena->chunk != NULL, "mark does not belong to the arena.");
+
+        jac_arena_chunk *chunk = arena->chunk;
+        arena->chunk = chunk->previous;
+        release_chunk(arena, chunk);
+    }
+
+    arena->cursor = mark.cursor;
+    arena->end = arena->chunk ? arena->chunk->data + arena->chunk->size : NULL;
+}
+
+void jac_reset_arena(jac_memory_arena *arena)
+{
+    jac_arena_rewind(arena, (jac_arena_mark){.chunk = NULL, .cursor = NULL});
+}
+
+void jac_free_arena(jac_memory_arena *arena)
+{
+    jac_reset_arena(arena);
+
+    while (arena->spare)
+    {
+        jac_arena_chunk *chunk = arena->spare;
+        arena->spare = chunk->previous;
+        DARRAY_DEALLOC(chunk);
+    }
+}
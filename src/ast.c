@@ -2,12 +2,13 @@
 
 #include <stdarg.h>
 
-#include "arena.h"
 #include "assert.h"
 #include "darray.h"
 #include "diagnostics.h"
 #include "lex.h"
 #include "symbol.h"
+#include "thread.h"
+#include "trace.h"
 #include "type.h"
 
 /*
@@ -18,560 +19,487 @@ typedef struct parser parser;
 
 struct parser
 {
-    const jac_token *tokens;
-    const jac_token *c;
-    jac_memory_arena *arena;
+    jac_lexer *lexer;
+    jac_ast_unit *unit;
+
+    // children of the nodes being parsed, until their parent moves them to
+    // the extra data
+    darray_t jac_ast_node *scratch;
+
+    // the parse workers hold diagnostics back, see jac_parse_unit_parallel
+    darray_t char *diagnostics; // NULL to print right away
 };
 
-static bool is_eof(const parser *parser)
+static void report(parser *parser, const jac_token *token, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+
+    if (parser->diagnostics)
+        jac_buffer_diagnostic(&parser->diagnostics, &parser->lexer->lines, token, fmt, args);
+    else
+    {
+        darray_t char *buffer = darray_new(char);
+        jac_buffer_diagnostic(&buffer, &parser->lexer->lines, token, fmt, args);
+        fwrite(buffer, sizeof(char), darray_count(buffer), stderr);
+        darray_free(buffer);
+    }
+
+    va_end(args);
+}
+
+static const jac_token *peek(parser *parser, size_t k)
 {
-    return parser->c->kind == JAC_TOKEN_EOF;
+    return jac_peek_token(parser->lexer, k);
 }
 
-static const jac_token *consume(parser *parser)
+static bool is_eof(parser *parser)
+{
+    return peek(parser, 0)->kind == JAC_TOKEN_EOF;
+}
+
+static jac_token consume(parser *parser)
 {
     JAC_ASSERT(!is_eof(parser), "unexpected EOF");
-    return parser->c++;
+    return jac_next_token(parser->lexer);
 }
 
-static const jac_token *expect(parser *parser, enum jac_token_kind expected)
+// 'token' may be NULL, if the value is of no interest
+static bool expect(parser *parser, enum jac_token_kind expected, jac_token *token)
 {
-    if (parser->c->kind != expected)
-        return NULL;
-    return consume(parser);
+    if (peek(parser, 0)->kind != expected)
+        return false;
+
+    jac_token consumed = consume(parser);
+    if (token)
+        *token = consumed;
+    return true;
+}
+
+// consumes a token of the expected kind, or reports what is there instead.
+// 'what' names the token in the diagnostic
+static bool require(parser *parser, enum jac_token_kind expected, const char *what, jac_token *token)
+{
+    if (expect(parser, expected, token))
+        return true;
+
+    report(parser, peek(parser, 0), "expected %s, got '" JAC_TOKEN_FMT "'.", what, JAC_TOKEN_ARG(peek(parser, 0)));
+    return false;
 }
 
 /*
- * PARSING
+ * NODES
  */
 
-static bool parse_expression(parser *, bool, jac_ast_expression *);
+// 'token' may be NULL, for a node without one
+static jac_ast_node add_node(parser *parser, enum jac_ast_kind kind, const jac_token *token, uint32_t lhs,
+                             uint32_t rhs)
+{
+    jac_ast_unit *unit = parser->unit;
+    darray_push(unit->kinds, (uint8_t)kind);
+    darray_push(unit->data, ((jac_ast_data){.lhs = lhs, .rhs = rhs}));
+    jac_push_token(&unit->tokens, token ? token : &(jac_token){.kind = JAC_TOKEN_EOF});
+    return (jac_ast_node)darray_count(unit->kinds) - 1;
+}
 
-static bool parse_statement_expression_call(parser *parser, bool required, jac_ast_function_call *call)
+// moves the children gathered since 'top' to the extra data, as one range
+static jac_ast_data add_children(parser *parser, size_t top)
 {
+    jac_ast_unit *unit = parser->unit;
+    jac_ast_data range = {.lhs = (uint32_t)darray_count(unit->extra)};
 
-    const jac_token *identifier = expect(parser, JAC_TOKEN_IDENTIFIER);
-    if (!identifier)
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected identifier, got '%s'.", parser->c->value);
-        return false;
-    }
+    for (size_t i = top; i < darray_count(parser->scratch); ++i)
+        darray_push(unit->extra, parser->scratch[i]);
 
-    if (!expect(parser, JAC_TOKEN_LPAREN))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '(', got '%s'.", parser->c->value);
-        return false;
-    }
+    darray_truncate(parser->scratch, top);
+    range.rhs = (uint32_t)darray_count(unit->extra);
+    return range;
+}
 
-    call->arguments = darray_new(jac_ast_expression);
+/*
+ * FIRST SETS
+ */
 
-    jac_ast_expression expression;
-    if (parse_expression(parser, false, &expression))
-    {
-        darray_push(call->arguments, expression);
+// the productions a token may begin. each is picked from the next token, and
+// the two after it for an identifier, before any of it is consumed. nothing is
+// parsed on trial and undone, so every token is looked at a bounded number of
+// times
+enum first
+{
+    FIRST_NONE,
+    FIRST_LITERAL,
+    FIRST_ADDRESS,
+    FIRST_IDENTIFIER, // a name, call, assignment, or custom type
+    FIRST_TYPE,       // a primitive type, or '*'
+    FIRST_RETURN,
+    FIRST_BLOCK,
+};
 
-        while (expect(parser, JAC_TOKEN_COMMA))
-        {
-            if (!parse_expression(parser, required, &expression))
-            {
-                if (required)
-                {
-                    jac_print_diagnostic(parser->c, "expected argument expression, got '%s'.", parser->c->value);
-                }
-                return false;
-            }
-            darray_push(call->arguments, expression);
-        }
-    }
+static const uint8_t first_sets[UINT8_MAX + 1] = {
+    [JAC_TOKEN_NUM_LITERAL] = FIRST_LITERAL, [JAC_TOKEN_STR_LITERAL] = FIRST_LITERAL,
+    [JAC_TOKEN_AMPERSAND] = FIRST_ADDRESS,   [JAC_TOKEN_IDENTIFIER] = FIRST_IDENTIFIER,
+    [JAC_TOKEN_STAR] = FIRST_TYPE,           [JAC_TOKEN_BOOL] = FIRST_TYPE,
+    [JAC_TOKEN_INT8] = FIRST_TYPE,           [JAC_TOKEN_UINT8] = FIRST_TYPE,
+    [JAC_TOKEN_INT16] = FIRST_TYPE,          [JAC_TOKEN_UINT16] = FIRST_TYPE,
+    [JAC_TOKEN_INT32] = FIRST_TYPE,          [JAC_TOKEN_UINT32] = FIRST_TYPE,
+    [JAC_TOKEN_INT64] = FIRST_TYPE,          [JAC_TOKEN_UINT64] = FIRST_TYPE,
+    [JAC_TOKEN_FLOAT32] = FIRST_TYPE,        [JAC_TOKEN_FLOAT64] = FIRST_TYPE,
+    [JAC_TOKEN_RETURN] = FIRST_RETURN,       [JAC_TOKEN_LBRACE] = FIRST_BLOCK,
+};
 
-    if (!expect(parser, JAC_TOKEN_RPAREN))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected ')', got '%s'.", parser->c->value);
-        return false;
-    }
+// JAC_TYPE_NONE for tokens that do not name a type
+static const uint8_t type_kinds[UINT8_MAX + 1] = {
+    [JAC_TOKEN_IDENTIFIER] = JAC_TYPE_CUSTOM, [JAC_TOKEN_BOOL] = JAC_TYPE_BOOL,
+    [JAC_TOKEN_INT8] = JAC_TYPE_INT8,         [JAC_TOKEN_UINT8] = JAC_TYPE_UINT8,
+    [JAC_TOKEN_INT16] = JAC_TYPE_INT16,       [JAC_TOKEN_UINT16] = JAC_TYPE_UINT16,
+    [JAC_TOKEN_INT32] = JAC_TYPE_INT32,       [JAC_TOKEN_UINT32] = JAC_TYPE_UINT32,
+    [JAC_TOKEN_INT64] = JAC_TYPE_INT64,       [JAC_TOKEN_UINT64] = JAC_TYPE_UINT64,
+    [JAC_TOKEN_FLOAT32] = JAC_TYPE_FLOAT32,   [JAC_TOKEN_FLOAT64] = JAC_TYPE_FLOAT64,
+};
 
-    call->identifier = identifier;
-    return true;
+static enum first first_of(parser *parser, size_t k)
+{
+    return (enum first)first_sets[peek(parser, k)->kind];
 }
 
-static bool parse_variable_declaration(parser *, bool, jac_symbol *);
+static bool starts_type(parser *parser)
+{
+    enum first first = first_of(parser, 0);
+    return (first == FIRST_TYPE) || (first == FIRST_IDENTIFIER);
+}
 
-static bool parse_variable_definition(parser *parser, bool required, jac_ast_variable_definition *var_def)
+static bool starts_expression(parser *parser)
 {
+    enum first first = first_of(parser, 0);
+    return (first == FIRST_LITERAL) || (first == FIRST_ADDRESS) || (first == FIRST_IDENTIFIER);
+}
 
-    if (!parse_variable_declaration(parser, required, &var_def->declaration))
-        return false;
+/*
+ * PARSING
+ */
 
-    if (!expect(parser, JAC_TOKEN_COLON))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected ':', got '%s'.", parser->c->value);
-        return false;
-    }
+static bool parse_expression(parser *, jac_ast_node *);
 
-    if (!expect(parser, JAC_TOKEN_EQUALS))
+// the caller has seen the identifier and the '('
+static bool parse_function_call(parser *parser, jac_ast_node *node)
+{
+    jac_token identifier = consume(parser);
+    consume(parser);
+
+    size_t top = darray_count(parser->scratch);
+    if (starts_expression(parser))
     {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '=', got '%s'.", parser->c->value);
-        return false;
+        do
+        {
+            jac_ast_node expression;
+            if (!parse_expression(parser, &expression))
+                return false;
+            darray_push(parser->scratch, expression);
+        } while (expect(parser, JAC_TOKEN_COMMA, NULL));
     }
 
-    jac_ast_expression expression;
-    if (!parse_expression(parser, required, &expression))
+    if (!require(parser, JAC_TOKEN_RPAREN, "')'", NULL))
         return false;
 
-    var_def->expression = jac_arena_alloc(parser->arena, jac_ast_expression);
-    *var_def->expression = expression;
+    jac_ast_data arguments = add_children(parser, top);
+    *node = add_node(parser, JAC_AST_FUNCTION_CALL, &identifier, arguments.lhs, arguments.rhs);
     return true;
 }
 
-static bool parse_assignment(parser *parser, bool required, jac_ast_assignment *assignment)
-{
+static bool parse_variable_declaration(parser *, jac_ast_node *, jac_token *);
 
-    assignment->identifier = expect(parser, JAC_TOKEN_IDENTIFIER);
-    if (!assignment->identifier)
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected identifier, got '%s'.", parser->c->value);
+static bool parse_variable_definition(parser *parser, jac_ast_node *node)
+{
+    jac_ast_node type, expression;
+    jac_token identifier;
+    if (!parse_variable_declaration(parser, &type, &identifier) || !require(parser, JAC_TOKEN_COLON, "':'", NULL) ||
+        !require(parser, JAC_TOKEN_EQUALS, "'='", NULL) || !parse_expression(parser, &expression))
         return false;
-    }
 
-    if (!expect(parser, JAC_TOKEN_COLON))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected ':', got '%s'.", parser->c->value);
-        return false;
-    }
+    *node = add_node(parser, JAC_AST_VARIABLE_DEFINITION, &identifier, type, expression);
+    return true;
+}
 
-    if (!expect(parser, JAC_TOKEN_EQUALS))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '=', got '%s'.", parser->c->value);
-        return false;
-    }
+// the caller has seen the identifier
+static bool parse_assignment(parser *parser, jac_ast_node *node)
+{
+    jac_token identifier = consume(parser);
 
-    jac_ast_expression expression;
-    if (!parse_expression(parser, required, &expression))
+    jac_ast_node expression;
+    if (!require(parser, JAC_TOKEN_COLON, "':'", NULL) || !require(parser, JAC_TOKEN_EQUALS, "'='", NULL) ||
+        !parse_expression(parser, &expression))
         return false;
 
-    assignment->expression = jac_arena_alloc(parser->arena, jac_ast_expression);
-    *assignment->expression = expression;
+    *node = add_node(parser, JAC_AST_ASSIGNMENT, &identifier, expression, JAC_AST_NONE);
     return true;
 }
 
-static bool parse_statement_expression(parser *parser, bool required, jac_ast_expression_statement *expr_statement)
+// calls, assignments and variable definitions. 'f(', 'x :=' and 'T : x' tell
+// the ones starting with an identifier apart
+static bool parse_statement_expression(parser *parser, jac_ast_node *node)
 {
-
-    switch (parser->c->kind)
+    switch (first_of(parser, 0))
     {
-    case JAC_TOKEN_IDENTIFIER: {
-
-        if (parser->c[1].kind == JAC_TOKEN_LPAREN)
-        {
-            jac_ast_function_call call;
-            if (!parse_statement_expression_call(parser, required, &call))
-                return false;
-
-            expr_statement->holds = JAC_AST_FUNCTION_CALL;
-            expr_statement->opt.call = jac_arena_alloc(parser->arena, jac_ast_function_call);
-            *expr_statement->opt.call = call;
-            return true;
-        }
-
-        else
-        {
-            jac_ast_assignment assignment;
-            if (!parse_assignment(parser, required, &assignment))
-                return false;
-
-            expr_statement->holds = JAC_AST_ASSIGNMENT;
-            expr_statement->opt.assignment = jac_arena_alloc(parser->arena, jac_ast_assignment);
-            *expr_statement->opt.assignment = assignment;
-            return true;
-        }
+    case FIRST_IDENTIFIER: {
+        enum jac_token_kind next = peek(parser, 1)->kind;
+        if (next == JAC_TOKEN_LPAREN)
+            return parse_function_call(parser, node);
+        if ((next == JAC_TOKEN_COLON) && (peek(parser, 2)->kind == JAC_TOKEN_IDENTIFIER))
+            return parse_variable_definition(parser, node);
+        return parse_assignment(parser, node);
     }
 
-    default: {
-        jac_ast_variable_definition var_def;
-        if (parse_variable_definition(parser, required, &var_def))
-        {
-            expr_statement->holds = JAC_AST_VARIABLE_DEFINITION;
-            expr_statement->opt.var_def = jac_arena_alloc(parser->arena, jac_ast_variable_definition);
-            *expr_statement->opt.var_def = var_def;
-            return true;
-        }
+    case FIRST_TYPE:
+        return parse_variable_definition(parser, node);
 
-        if (required)
-            jac_print_diagnostic(parser->c, "invalid statement expression.");
+    default:
+        report(parser, peek(parser, 0), "invalid statement expression.");
         return false;
     }
-    }
 }
 
-static bool parse_expression(parser *parser, bool required, jac_ast_expression *expression)
+static bool parse_expression(parser *parser, jac_ast_node *node)
 {
-
-    switch (parser->c->kind)
+    switch (first_of(parser, 0))
     {
-    case JAC_TOKEN_STR_LITERAL:
-    case JAC_TOKEN_INT_LITERAL: {
-        expression->holds = JAC_AST_EXPRESSION_LITERAL;
-        expression->opt.literal = consume(parser);
+    case FIRST_LITERAL: {
+        jac_token literal = consume(parser);
+        *node = add_node(parser, JAC_AST_EXPRESSION_LITERAL, &literal, JAC_AST_NONE, JAC_AST_NONE);
         return true;
     }
 
-    case JAC_TOKEN_AMPERSAND: {
+    case FIRST_ADDRESS: {
         consume(parser);
-        expression->holds = JAC_AST_EXPRESSION_ADDROF;
-        expression->opt.addrof = expect(parser, JAC_TOKEN_IDENTIFIER);
-        if (!expression->opt.addrof)
-        {
-            if (required)
-                jac_print_diagnostic(parser->c, "expected identifier, got '%s'.", parser->c->value);
+        jac_token identifier;
+        if (!require(parser, JAC_TOKEN_IDENTIFIER, "identifier", &identifier))
             return false;
-        }
+
+        *node = add_node(parser, JAC_AST_EXPRESSION_ADDROF, &identifier, JAC_AST_NONE, JAC_AST_NONE);
         return true;
     }
 
-    case JAC_TOKEN_IDENTIFIER: {
-        if (parser->c[1].kind == JAC_TOKEN_LPAREN)
-        {
-            jac_ast_expression_statement expr_statement;
-            if (!parse_statement_expression(parser, required, &expr_statement))
-                return false;
+    case FIRST_IDENTIFIER: {
+        if (peek(parser, 1)->kind == JAC_TOKEN_LPAREN)
+            return parse_function_call(parser, node);
 
-            expression->holds = JAC_AST_EXPRESSION_STATEMENT;
-            expression->opt.expr_statement = jac_arena_alloc(parser->arena, jac_ast_expression_statement);
-            *expression->opt.expr_statement = expr_statement;
-            return true;
-        }
-
-        else
-        {
-            expression->holds = JAC_AST_EXPRESSION_IDENTIFIER;
-            expression->opt.identifier = consume(parser);
-            return true;
-        }
+        jac_token identifier = consume(parser);
+        *node = add_node(parser, JAC_AST_EXPRESSION_IDENTIFIER, &identifier, JAC_AST_NONE, JAC_AST_NONE);
+        return true;
     }
 
     default:
-        if (required)
-            jac_print_diagnostic(parser->c, "invalid expression.");
+        report(parser, peek(parser, 0), "invalid expression.");
         return false;
     }
 }
 
-static bool parse_statement_return(parser *parser, bool required, jac_ast_statement_return *ret)
+// the caller has seen the keyword
+static bool parse_statement_return(parser *parser, jac_ast_node *node)
 {
+    jac_token keyword = consume(parser);
 
-    if (!expect(parser, JAC_TOKEN_RETURN))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected 'return', got '%s'.", parser->c->value);
+    jac_ast_node expression = JAC_AST_NONE;
+    if (starts_expression(parser) && !parse_expression(parser, &expression))
         return false;
-    }
 
-    jac_ast_expression expression;
-    if (!parse_expression(parser, false, &expression))
-    {
-        ret->expression = NULL;
-        return true;
-    }
-
-    ret->expression = jac_arena_alloc(parser->arena, jac_ast_expression);
-    *ret->expression = expression;
+    *node = add_node(parser, JAC_AST_STATEMENT_RETURN, &keyword, expression, JAC_AST_NONE);
     return true;
 }
 
-static bool parse_block(parser *, bool, jac_ast_block *);
+static bool parse_block(parser *, jac_ast_node *);
 
-static bool parse_scope_statement(parser *parser, bool required, jac_ast_scope_statement *statement)
+static bool parse_scope_statement(parser *parser, jac_ast_node *node)
 {
-
-    switch (parser->c->kind)
+    switch (first_of(parser, 0))
     {
+    case FIRST_RETURN:
+        return parse_statement_return(parser, node) && require(parser, JAC_TOKEN_SEMICOLON, "';'", NULL);
 
-    case JAC_TOKEN_RETURN: {
-        jac_ast_statement_return ret;
-        if (!parse_statement_return(parser, required, &ret))
-            return false;
+    case FIRST_BLOCK:
+        return parse_block(parser, node);
 
-        if (!expect(parser, JAC_TOKEN_SEMICOLON))
-        {
-            if (required)
-                jac_print_diagnostic(parser->c, "expected ';', got '%s'.", parser->c->value);
-            return false;
-        }
-
-        statement->holds = JAC_AST_STATEMENT_RETURN;
-        statement->opt.ret = jac_arena_alloc(parser->arena, jac_ast_statement_return);
-        *statement->opt.ret = ret;
-        return true;
-    }
+    case FIRST_IDENTIFIER:
+    case FIRST_TYPE:
+        return parse_statement_expression(parser, node) && require(parser, JAC_TOKEN_SEMICOLON, "';'", NULL);
 
-    case JAC_TOKEN_LBRACE: {
-        if (!parse_block(parser, required, &statement->opt.block))
-            return false;
-        statement->holds = JAC_AST_BLOCK;
-        return true;
-    }
-
-    default: {
-        jac_ast_expression_statement expr_statement;
-        if (parse_statement_expression(parser, required, &expr_statement))
-        {
-            if (!expect(parser, JAC_TOKEN_SEMICOLON))
-            {
-                if (required)
-                    jac_print_diagnostic(parser->c, "expected ';', got '%s'.", parser->c->value);
-                return false;
-            }
-
-            statement->holds = JAC_AST_EXPRESSION_STATEMENT;
-            statement->opt.expr_statement = jac_arena_alloc(parser->arena, jac_ast_expression_statement);
-            *statement->opt.expr_statement = expr_statement;
-            return true;
-        }
-
-        if (required)
-            jac_print_diagnostic(parser->c, "invalid scope statement.", parser->c->value);
+    default:
+        report(parser, peek(parser, 0), "invalid scope statement.");
         return false;
     }
-    }
 }
 
-static bool parse_block(parser *parser, bool required, jac_ast_block *block)
+static bool parse_block(parser *parser, jac_ast_node *node)
 {
-
-    if (!expect(parser, JAC_TOKEN_LBRACE))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '{', got '%s'.", parser->c->value);
+    jac_token lbrace;
+    if (!require(parser, JAC_TOKEN_LBRACE, "'{'", &lbrace))
         return false;
-    }
 
-    *block = darray_new(jac_ast_scope_statement);
+    size_t top = darray_count(parser->scratch);
 
-    while (!is_eof(parser) && (parser->c->kind != JAC_TOKEN_RBRACE))
+    while (!is_eof(parser) && (peek(parser, 0)->kind != JAC_TOKEN_RBRACE))
     {
-        jac_ast_scope_statement statement;
-        if (!parse_scope_statement(parser, required, &statement))
+        jac_ast_node statement;
+        if (!parse_scope_statement(parser, &statement))
             return false;
-        darray_push(*block, statement);
+        darray_push(parser->scratch, statement);
     }
 
-    if (!expect(parser, JAC_TOKEN_RBRACE))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '}', got '%s'.", parser->c->value);
+    if (!require(parser, JAC_TOKEN_RBRACE, "'}'", NULL))
         return false;
-    }
 
+    jac_ast_data statements = add_children(parser, top);
+    *node = add_node(parser, JAC_AST_BLOCK, &lbrace, statements.lhs, statements.rhs);
     return true;
 }
 
-static bool parse_type(parser *parser, bool required, jac_type *type)
+static bool parse_type(parser *parser, jac_ast_node *node)
 {
-    type->indirection = 0;
+    uint32_t indirection = 0;
+    while (expect(parser, JAC_TOKEN_STAR, NULL))
+        indirection += 1;
 
-    while (parser->c->kind == JAC_TOKEN_STAR)
+    enum jac_type_kind kind = (enum jac_type_kind)type_kinds[peek(parser, 0)->kind];
+    if (kind == JAC_TYPE_NONE)
     {
-        type->indirection += 1;
-        consume(parser);
-    }
-
-    switch (parser->c->kind)
-    {
-    case JAC_TOKEN_IDENTIFIER:
-        type->kind = JAC_TYPE_CUSTOM;
-        break;
-        // case JAC_TOKEN_INT8: type->kind = JAC_TYPE_INT8; break;
-    case JAC_TOKEN_UINT8:
-        type->kind = JAC_TYPE_UINT8;
-        break;
-    case JAC_TOKEN_INT32:
-        type->kind = JAC_TYPE_INT32;
-        break;
-        // case JAC_TOKEN_UINT32: type->kind = JAC_TYPE_UINT32; break;
-        // case JAC_TOKEN_INT64: type->kind = JAC_TYPE_INT64; break;
-        // case JAC_TOKEN_UINT64: type->kind = JAC_TYPE_UINT64; break;
-
-    default:
-        if (required)
-            jac_print_diagnostic(parser->c, "expected type, got '%s'.", parser->c->value);
+        report(parser, peek(parser, 0), "expected type, got '" JAC_TOKEN_FMT "'.", JAC_TOKEN_ARG(peek(parser, 0)));
         return false;
     }
 
-    type->token = consume(parser);
+    jac_token token = consume(parser);
+    *node = add_node(parser, JAC_AST_TYPE, &token, indirection, kind);
     return true;
 }
 
-static bool parse_variable_declaration(parser *parser, bool required, jac_symbol *declaration)
+// leaves the declaration node to the caller, which may make a definition of it
+static bool parse_variable_declaration(parser *parser, jac_ast_node *type, jac_token *identifier)
 {
+    return parse_type(parser, type) && require(parser, JAC_TOKEN_COLON, "':'", NULL) &&
+           require(parser, JAC_TOKEN_IDENTIFIER, "identifier", identifier);
+}
 
-    if (!parse_type(parser, required, &declaration->type))
-        return false;
-
-    if (!expect(parser, JAC_TOKEN_COLON))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected ':', got '%s'.", parser->c->value);
-        return false;
-    }
-
-    declaration->identifier = expect(parser, JAC_TOKEN_IDENTIFIER);
-    if (!declaration->identifier)
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected identifier, got '%s'.", parser->c->value);
+static bool parse_function_argument(parser *parser)
+{
+    jac_ast_node type;
+    jac_token identifier;
+    if (!parse_variable_declaration(parser, &type, &identifier))
         return false;
-    }
 
+    jac_ast_node arg = add_node(parser, JAC_AST_VARIABLE_DECLARATION, &identifier, type, JAC_AST_NONE);
+    darray_push(parser->scratch, arg);
     return true;
 }
 
-static bool parse_function_header(parser *parser, bool required, jac_function *header)
+static bool parse_function_header(parser *parser, jac_ast_node *node)
 {
-
-    if (!expect(parser, JAC_TOKEN_FUNC))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected 'func', got '%s'.", parser->c->value);
-        return false;
-    }
-
-    header->identifier = expect(parser, JAC_TOKEN_IDENTIFIER);
-    if (!header->identifier)
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected identifier, got '%s'.", parser->c->value);
+    jac_token identifier;
+    if (!require(parser, JAC_TOKEN_FUNC, "'func'", NULL) ||
+        !require(parser, JAC_TOKEN_IDENTIFIER, "identifier", &identifier))
         return false;
-    }
 
-    header->args = darray_new(jac_symbol);
-    if (expect(parser, JAC_TOKEN_LPAREN))
+    size_t top = darray_count(parser->scratch);
+    if (expect(parser, JAC_TOKEN_LPAREN, NULL))
     {
-
-        jac_symbol arg;
-        if (parse_variable_declaration(parser, false, &arg))
+        if (starts_type(parser))
         {
-            darray_push(header->args, arg);
-
-            while (expect(parser, JAC_TOKEN_COMMA))
+            do
             {
-                if (!parse_variable_declaration(parser, required, &arg))
+                if (!parse_function_argument(parser))
                     return false;
-                darray_push(header->args, arg);
-            }
+            } while (expect(parser, JAC_TOKEN_COMMA, NULL));
         }
 
-        if (!expect(parser, JAC_TOKEN_RPAREN))
-        {
-            if (required)
-                jac_print_diagnostic(parser->c, "expected ')', got '%s'.", parser->c->value);
+        if (!require(parser, JAC_TOKEN_RPAREN, "')'", NULL))
             return false;
-        }
     }
 
-    header->mangled = jac_mangle_function_name(header->identifier, header->args);
-
-    if (!expect(parser, JAC_TOKEN_MINUS))
-    {
-        header->ret_type.kind = JAC_TYPE_NONE;
-        return true;
-    }
-
-    if (!expect(parser, JAC_TOKEN_GT))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '>', got '%s'.", parser->c->value);
+    jac_ast_node ret_type = JAC_AST_NONE;
+    if (expect(parser, JAC_TOKEN_MINUS, NULL) &&
+        (!require(parser, JAC_TOKEN_GT, "'>'", NULL) || !parse_type(parser, &ret_type)))
         return false;
-    }
 
-    return parse_type(parser, true, &header->ret_type);
+    // the return type goes in front of the arguments
+    jac_ast_unit *unit = parser->unit;
+    uint32_t start = (uint32_t)darray_count(unit->extra);
+    darray_push(unit->extra, ret_type);
+
+    jac_ast_data header = add_children(parser, top);
+    *node = add_node(parser, JAC_AST_FUNCTION_HEADER, &identifier, start, header.rhs);
+    return true;
 }
 
-static bool parse_extern_block(parser *parser, bool required, jac_ast_extern_block *block)
+static bool parse_extern_block(parser *parser, jac_ast_node *node)
 {
-
-    if (!expect(parser, JAC_TOKEN_EXTERN))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected 'extern', got '%s'.", parser->c->value);
+    jac_token keyword;
+    if (!require(parser, JAC_TOKEN_EXTERN, "'extern'", &keyword) || !require(parser, JAC_TOKEN_LBRACE, "'{'", NULL))
         return false;
-    }
 
-    if (!expect(parser, JAC_TOKEN_LBRACE))
+    size_t top = darray_count(parser->scratch);
+    while ((peek(parser, 0)->kind != JAC_TOKEN_EOF) && (peek(parser, 0)->kind != JAC_TOKEN_RBRACE))
     {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '{', got '%s'.", parser->c->value);
-        return false;
+        jac_ast_node header;
+        if (!parse_function_header(parser, &header) || !require(parser, JAC_TOKEN_SEMICOLON, "';'", NULL))
+            return false;
+
+        darray_push(parser->scratch, header);
     }
 
-    *block = darray_new(jac_function);
-    while ((parser->c->kind != JAC_TOKEN_EOF) && (parser->c->kind != JAC_TOKEN_RBRACE))
-    {
-        jac_function header;
-        if (!parse_function_header(parser, true, &header))
-            return false;
+    if (!require(parser, JAC_TOKEN_RBRACE, "'}'", NULL))
+        return false;
 
-        if (!expect(parser, JAC_TOKEN_SEMICOLON))
-        {
-            if (required)
-                jac_print_diagnostic(parser->c, "expected ';', got '%s'.", parser->c->value);
-            return false;
-        }
+    jac_ast_data headers = add_children(parser, top);
+    *node = add_node(parser, JAC_AST_EXTERN_BLOCK, &keyword, headers.lhs, headers.rhs);
+    return true;
+}
 
-        darray_push(*block, header);
-    }
+static bool parse_function_definition(parser *parser, jac_ast_node *node)
+{
+    uint64_t start = jac_begin_event();
 
-    if (!expect(parser, JAC_TOKEN_RBRACE))
-    {
-        if (required)
-            jac_print_diagnostic(parser->c, "expected '}', got '%s'.", parser->c->value);
+    jac_ast_node header, block;
+    if (!parse_function_header(parser, &header) || !parse_block(parser, &block))
         return false;
-    }
 
+    jac_token identifier = jac_ast_token(parser->unit, header);
+    *node = add_node(parser, JAC_AST_FUNCTION_DEFINITION, &identifier, header, block);
+
+    jac_end_event("function", JAC_PHASE_PARSE, identifier.value, identifier.length, start);
     return true;
 }
 
-static bool parse_function_definition(parser *parser, bool required, jac_ast_function_definition *func_def)
+// '#(name)' in front of a definition, or of another hint. what the names
+// mean is left to the checker
+static bool parse_hint(parser *parser, jac_ast_node *node)
 {
-    if (!parse_function_header(parser, required, &func_def->header))
+    jac_token identifier;
+    if (!require(parser, JAC_TOKEN_HASH, "'#'", NULL) || !require(parser, JAC_TOKEN_LPAREN, "'('", NULL) ||
+        !require(parser, JAC_TOKEN_IDENTIFIER, "hint", &identifier) || !require(parser, JAC_TOKEN_RPAREN, "')'", NULL))
         return false;
-    if (!parse_block(parser, true, &func_def->block))
+
+    jac_ast_node hinted;
+    bool parsed = (peek(parser, 0)->kind == JAC_TOKEN_HASH) ? parse_hint(parser, &hinted)
+                                                             : parse_function_definition(parser, &hinted);
+    if (!parsed)
         return false;
+
+    *node = add_node(parser, JAC_AST_HINT, &identifier, hinted, JAC_AST_NONE);
     return true;
 }
 
-static bool parse_unit_statement(parser *parser, jac_ast_unit_statement *statement)
+static bool parse_unit_statement(parser *parser, jac_ast_node *node)
 {
-
-    switch (parser->c->kind)
+    switch (peek(parser, 0)->kind)
     {
-    case JAC_TOKEN_FUNC: {
-        jac_ast_function_definition func_def;
-        if (!parse_function_definition(parser, true, &func_def))
-            return false;
+    case JAC_TOKEN_FUNC:
+        return parse_function_definition(parser, node);
 
-        statement->holds = JAC_AST_FUNCTION_DEFINITION;
-        statement->opt.func_def = jac_arena_alloc(parser->arena, jac_ast_function_definition);
-        *statement->opt.func_def = func_def;
-        return true;
-    }
+    case JAC_TOKEN_HASH:
+        return parse_hint(parser, node);
 
-    case JAC_TOKEN_EXTERN: {
-        if (!parse_extern_block(parser, true, &statement->opt.extern_block))
-            return false;
-        statement->holds = JAC_AST_EXTERN_BLOCK;
-        return true;
-    }
+    case JAC_TOKEN_EXTERN:
+        return parse_extern_block(parser, node);
 
     default:
-        jac_print_diagnostic(parser->c, "invalid unit statement.");
+        report(parser, peek(parser, 0), "invalid unit statement.");
         return false;
     }
 }
@@ -581,339 +509,462 @@ static void skip_statement(parser *parser)
 
     while (!is_eof(parser))
     {
-        const jac_token *token = consume(parser);
-        if (token->kind == JAC_TOKEN_SEMICOLON)
+        jac_token token = consume(parser);
+        if ((token.kind == JAC_TOKEN_SEMICOLON) || (token.kind == JAC_TOKEN_RBRACE))
         {
-            consume(parser);
-            return;
-        }
-        if (token->kind == JAC_TOKEN_RBRACE)
-        {
-            consume(parser);
+            // a statement cut short by the end of the source leaves nothing to skip
+            if (!is_eof(parser))
+                consume(parser);
             return;
         }
     }
 }
 
-bool jac_parse_unit(jac_memory_arena *arena, darray_t jac_token *tokens, jac_ast_unit *unit)
+// parses one unit statement onto the scratch, or skips past it
+static bool parse_next_statement(parser *parser)
 {
+    size_t top = darray_count(parser->scratch);
+    jac_ast_node statement;
+    if (parse_unit_statement(parser, &statement))
+    {
+        darray_push(parser->scratch, statement);
+        return true;
+    }
+
+    darray_truncate(parser->scratch, top);
+    skip_statement(parser);
+    return false;
+}
 
-    parser parser = {.tokens = tokens, .c = tokens, .arena = arena};
-    *unit = darray_new(jac_ast_unit_statement);
+static void init_unit(jac_ast_unit *unit, const char *source, const jac_interner *interner)
+{
+    *unit = (jac_ast_unit){
+        .kinds = darray_new(uint8_t),
+        .data = darray_new(jac_ast_data),
+        .extra = darray_new(uint32_t),
+    };
+    jac_init_tokens(&unit->tokens, source, interner);
+}
+
+bool jac_parse_unit(jac_lexer *lexer, jac_ast_unit *unit)
+{
+    init_unit(unit, lexer->source, lexer->interner);
+
+    parser parser = {
+        .lexer = lexer,
+        .unit = unit,
+        .scratch = darray_new(jac_ast_node),
+        .diagnostics = NULL,
+    };
     bool success = true;
 
+    // the root has no token, and gets its children once they are all parsed
+    add_node(&parser, JAC_AST_ROOT_UNIT, NULL, 0, 0);
+
     while (!is_eof(&parser))
     {
-
-        jac_ast_unit_statement statement;
-        if (parse_unit_statement(&parser, &statement))
-        {
-            darray_push(*unit, statement);
-        }
-        else
-        {
+        if (!parse_next_statement(&parser))
             success = false;
-            skip_statement(&parser);
-        }
     }
 
-    if (!success)
-    {
-        jac_free_unit(*unit);
-        return false;
-    }
-
-    return true;
+    unit->data[JAC_AST_ROOT] = add_children(&parser, 0);
+    darray_free(parser.scratch);
+    return success;
 }
 
 /*
- * CLEANUP
+ * PARALLEL PARSING
+ *
+ * A pre-pass cuts the tokens at top-level closing braces into chunks, which
+ * workers parse into pools of their own. The chunks are then merged in source
+ * order, rebasing their node indices, and their held back diagnostics printed.
+ * Brace depth alone can be fooled by broken sources, so a chunk is only taken
+ * if the parse so far got exactly to its start, and it parsed exactly to its
+ * end. Anything else is parsed again, on the spot, and the function events
+ * its worker recorded are dropped. As statements are parsed the same either
+ * way, so are the unit and the diagnostics, whatever the number of workers.
  */
 
-static void free_expression(jac_ast_expression *);
+// tokens in a chunk, at the least. a chunk always ends a statement
+#define CHUNK_TOKENS 4096
 
-static void free_statement_expression_call(jac_ast_function_call *call)
-{
-    darray_foreach(call->arguments, jac_ast_expression, expression) free_expression(expression);
-    darray_free(call->arguments);
-}
+typedef struct chunk chunk;
 
-static void free_variable_definition(jac_ast_variable_definition *var_def)
+struct chunk
 {
-    free_expression(var_def->expression);
-}
+    size_t begin, end; // token range
+    size_t next;       // token after the last statement parsed
+    bool success;
+    bool merged;
+    jac_event_range events;
+
+    // behind a placeholder root, so that node 0 still means none
+    jac_ast_unit unit;
+    darray_t jac_ast_node *statements;
+    darray_t char *diagnostics;
+};
+
+typedef struct chunk_work chunk_work;
 
-static void free_assignment(jac_ast_assignment *assignment)
+struct chunk_work
 {
-    free_expression(assignment->expression);
-}
+    const jac_token_list *tokens;
+    chunk *chunks;
+};
 
-static void free_statement_expression(jac_ast_expression_statement *expr_statement)
+static darray_t chunk *split_chunks(const jac_token_list *tokens, size_t begin)
 {
-    switch (expr_statement->holds)
-    {
-    case JAC_AST_FUNCTION_CALL:
-        free_statement_expression_call(expr_statement->opt.call);
-        break;
-    case JAC_AST_VARIABLE_DEFINITION:
-        free_variable_definition(expr_statement->opt.var_def);
-        break;
-    case JAC_AST_ASSIGNMENT:
-        free_assignment(expr_statement->opt.assignment);
-        break;
+    darray_t chunk *chunks = darray_new(chunk);
+    size_t end = darray_count(tokens->kinds) - 1; // the EOF
+    size_t start = begin, depth = 0;
 
-    default:
-        JAC_ASSERT(false, "unreachable.");
+    for (size_t i = begin; i < end; ++i)
+    {
+        enum jac_token_kind kind = (enum jac_token_kind)tokens->kinds[i];
+        if (kind == JAC_TOKEN_LBRACE)
+            depth += 1;
+        else if ((kind == JAC_TOKEN_RBRACE) && (depth > 0) && (--depth == 0) && (i + 1 - start >= CHUNK_TOKENS))
+        {
+            darray_push(chunks, ((chunk){.begin = start, .end = i + 1}));
+            start = i + 1;
+        }
     }
+
+    if (start < end)
+        darray_push(chunks, ((chunk){.begin = start, .end = end}));
+    return chunks;
 }
 
-static void free_expression(jac_ast_expression *expression)
+static void parse_chunk(void *context, size_t index)
 {
-    switch (expression->holds)
+    const chunk_work *work = context;
+    chunk *chunk = work->chunks + index;
+    chunk->events = jac_begin_event_range();
+
+    jac_lexer lexer;
+    jac_init_replay_lexer(&lexer, work->tokens, chunk->begin, NULL);
+    init_unit(&chunk->unit, work->tokens->lines.source, work->tokens->interner);
+
+    parser parser = {
+        .lexer = &lexer,
+        .unit = &chunk->unit,
+        .scratch = darray_new(jac_ast_node),
+        .diagnostics = darray_new(char),
+    };
+    add_node(&parser, JAC_AST_ROOT_UNIT, NULL, 0, 0);
+
+    chunk->success = true;
+    while (!is_eof(&parser) && (jac_lexer_position(&lexer) < chunk->end))
     {
-    case JAC_AST_EXPRESSION_STATEMENT:
-        free_statement_expression(expression->opt.expr_statement);
-        break;
-    case JAC_AST_EXPRESSION_LITERAL:
-        break;
-    case JAC_AST_EXPRESSION_IDENTIFIER:
-        break;
-    case JAC_AST_EXPRESSION_ADDROF:
-        break;
-
-    default:
-        JAC_ASSERT(false, "unreachable.");
+        if (!parse_next_statement(&parser))
+            chunk->success = false;
     }
+
+    chunk->next = jac_lexer_position(&lexer);
+    chunk->statements = parser.scratch;
+    chunk->diagnostics = parser.diagnostics;
+    jac_end_event_range(&chunk->events);
 }
 
-static void free_return(jac_ast_statement_return *ret)
+static jac_ast_node rebase(jac_ast_node node, uint32_t base)
 {
-    if (ret->expression)
-        free_expression(ret->expression);
+    return (node == JAC_AST_NONE) ? JAC_AST_NONE : node + base;
 }
 
-static void free_block(jac_ast_block block)
+// appends the nodes of a chunk, and pushes its statements onto the scratch
+static void merge_chunk(parser *parser, const chunk *chunk)
 {
+    jac_ast_unit *unit = parser->unit;
+    const jac_ast_unit *from = &chunk->unit;
 
-    darray_foreach(block, jac_ast_scope_statement, statement)
+    // less one for the placeholder root, which is left behind
+    size_t first = darray_count(unit->kinds), count = darray_count(from->kinds) - 1;
+    uint32_t node_base = (uint32_t)first - 1;
+    uint32_t extra_base = (uint32_t)darray_count(unit->extra);
+
+    darray_append(unit->kinds, from->kinds + 1, count);
+    darray_append(unit->data, from->data + 1, count);
+    jac_append_tokens(&unit->tokens, &from->tokens, 1);
+
+    // all of the extra data are nodes
+    darray_append(unit->extra, from->extra, darray_count(from->extra));
+    for (size_t i = extra_base; i < darray_count(unit->extra); ++i)
+        unit->extra[i] = rebase(unit->extra[i], node_base);
+
+    for (jac_ast_node node = (jac_ast_node)first; node < first + count; ++node)
     {
-        switch (statement->holds)
+        jac_ast_data *data = unit->data + node;
+        switch (jac_ast_kind_of(unit, node))
         {
-        case JAC_AST_STATEMENT_RETURN:
-            free_return(statement->opt.ret);
+        case JAC_AST_FUNCTION_HEADER:
+        case JAC_AST_EXTERN_BLOCK:
+        case JAC_AST_BLOCK:
+        case JAC_AST_FUNCTION_CALL:
+            data->lhs += extra_base;
+            data->rhs += extra_base;
             break;
-        case JAC_AST_EXPRESSION_STATEMENT:
-            free_statement_expression(statement->opt.expr_statement);
+
+        case JAC_AST_FUNCTION_DEFINITION:
+        case JAC_AST_VARIABLE_DEFINITION:
+            data->lhs = rebase(data->lhs, node_base);
+            data->rhs = rebase(data->rhs, node_base);
             break;
-        case JAC_AST_BLOCK:
-            if (!statement->opt.block)
-                break;
-            free_block(statement->opt.block);
+
+        case JAC_AST_STATEMENT_RETURN:
+        case JAC_AST_VARIABLE_DECLARATION:
+        case JAC_AST_ASSIGNMENT:
+        case JAC_AST_HINT:
+            data->lhs = rebase(data->lhs, node_base);
             break;
 
         default:
-            JAC_ASSERT(false, "unreachable.");
+            break;
         }
     }
 
-    darray_free(block);
-}
+    darray_foreach(chunk->statements, const jac_ast_node, statement)
+        darray_push(parser->scratch, rebase(*statement, node_base));
 
-static void free_function_header(jac_function *header)
-{
-    darray_free(header->args);
+    fwrite(chunk->diagnostics, sizeof(char), darray_count(chunk->diagnostics), stderr);
 }
 
-static void free_function_definition(jac_ast_function_definition *func_def)
+static void free_chunk(chunk *chunk)
 {
-    if (!func_def->block)
-        return;
-    free_function_header(&func_def->header);
-    free_block(func_def->block);
+    jac_free_unit(&chunk->unit);
+    darray_free(chunk->statements);
+    darray_free(chunk->diagnostics);
 }
 
-static void free_extern_block(jac_ast_extern_block block)
+bool jac_parse_unit_parallel(jac_lexer *lexer, unsigned jobs, jac_ast_unit *unit)
 {
-    darray_foreach(block, jac_function, header) free_function_header(header);
-    darray_free(block);
-}
+    JAC_ASSERT(lexer->tokens, "parallel parsing needs a replaying lexer.");
+    const jac_token_list *tokens = lexer->tokens;
+    init_unit(unit, lexer->source, lexer->interner);
+
+    parser parser = {
+        .lexer = lexer,
+        .unit = unit,
+        .scratch = darray_new(jac_ast_node),
+        .diagnostics = NULL,
+    };
+    bool success = true;
 
-void jac_free_unit(jac_ast_unit unit)
-{
-    // if (!unit->statements) return;
+    add_node(&parser, JAC_AST_ROOT_UNIT, NULL, 0, 0);
+
+    size_t position = jac_lexer_position(lexer);
+    darray_t chunk *chunks = split_chunks(tokens, position);
+    chunk_work work = {.tokens = tokens, .chunks = chunks};
+    jac_parallel_for(darray_count(chunks), jobs, parse_chunk, &work);
 
-    darray_foreach(unit, jac_ast_unit_statement, statement)
+    size_t next_chunk = 0;
+    while (tokens->kinds[position] != JAC_TOKEN_EOF)
     {
-        switch (statement->holds)
-        {
-        case JAC_AST_FUNCTION_DEFINITION:
-            free_function_definition(statement->opt.func_def);
-            break;
-        case JAC_AST_EXTERN_BLOCK:
-            free_extern_block(statement->opt.extern_block);
-            break;
+        while ((next_chunk < darray_count(chunks)) && (chunks[next_chunk].begin < position))
+            next_chunk += 1;
 
-        default:
-            JAC_ASSERT(false, "unreachable.");
+        chunk *cut = (next_chunk < darray_count(chunks)) ? chunks + next_chunk : NULL;
+        if (cut && (cut->begin == position) && (cut->next == cut->end))
+        {
+            merge_chunk(&parser, cut);
+            cut->merged = true;
+            if (!cut->success)
+                success = false;
+            position = cut->end;
+            continue;
         }
-    }
 
-    darray_free(unit);
-}
+        // off the cuts, where recovery from an error skipped past one
+        jac_init_replay_lexer(lexer, tokens, position, lexer->interner);
+        if (!parse_next_statement(&parser))
+            success = false;
+        position = jac_lexer_position(lexer);
+    }
 
-/*
- * DEBUGGING
- */
+    darray_foreach(chunks, chunk, cut)
+    {
+        if (!cut->merged)
+            jac_drop_event_range(&cut->events);
+        free_chunk(cut);
+    }
+    darray_free(chunks);
 
-static void indented(int level, const char *msg)
-{
-    printf("%*s%s\n", level, " ", msg);
+    unit->data[JAC_AST_ROOT] = add_children(&parser, 0);
+    darray_free(parser.scratch);
+    return success;
 }
 
-static void indented_v(int level, const char *fmt, ...)
+void jac_free_unit(jac_ast_unit *unit)
 {
-    printf("%*s", level, " ");
-    va_list args;
-    va_start(args, fmt);
-    vprintf(fmt, args);
-    va_end(args);
-    putchar('\n');
-}
+    // the cache owns them
+    if (unit->mapped)
+        return;
 
-static void print_token(const jac_token *token, const char *label, int level)
-{
-    indented_v(level, "%s: %s", label, token->value);
+    darray_free(unit->kinds);
+    darray_free(unit->data);
+    darray_free(unit->extra);
+    jac_free_tokens(&unit->tokens);
 }
 
-static void print_expression(const jac_ast_expression *, int, int);
+/*
+ * COMPARISON
+ */
 
-static void print_statement_expression_call(const jac_ast_function_call *call, int level, int indent)
+static bool same_string(const jac_ast_unit *a, jac_intern_id x, const jac_ast_unit *b, jac_intern_id y)
 {
-    indented(level, "function_call");
-    print_token(call->identifier, "id", level + indent);
+    if ((x == JAC_INTERN_NONE) || (y == JAC_INTERN_NONE))
+        return x == y;
 
-    darray_foreach(call->arguments, jac_ast_expression, expression)
-        print_expression(expression, level + indent, indent);
+    size_t length = jac_interned_length(a->tokens.interner, x);
+    return (length == jac_interned_length(b->tokens.interner, y)) &&
+           (memcmp(jac_interned_value(a->tokens.interner, x), jac_interned_value(b->tokens.interner, y), length) == 0);
 }
 
-static void print_variable_declaration(const jac_symbol *, int, int);
-
-static void print_variable_definition(const jac_ast_variable_definition *var_def, int level, int indent)
+static bool same_token(const jac_ast_unit *a, const jac_ast_unit *b, jac_ast_node node)
 {
-    indented(level, "variable_definition");
-    print_variable_declaration(&var_def->declaration, level + indent, indent);
-    print_expression(var_def->expression, level + indent, indent);
+    jac_token x = jac_ast_token(a, node), y = jac_ast_token(b, node);
+    if ((x.kind != y.kind) || (x.offset != y.offset) || (x.length != y.length))
+        return false;
+
+    if (x.kind == JAC_TOKEN_NUM_LITERAL)
+        return (x.constant.holds == y.constant.holds) && (x.constant.type == y.constant.type) &&
+               (x.constant.opt.u == y.constant.opt.u);
+    return same_string(a, x.id, b, y.id);
 }
 
-static void print_assignment(const jac_ast_assignment *assignment, int level, int indent)
+// all of the extra data are nodes
+static bool same_range(const jac_ast_unit *a, const jac_ast_unit *b, jac_ast_node node)
 {
-    indented(level, "assignment");
-    print_token(assignment->identifier, "id", level + indent);
-    print_expression(assignment->expression, level + indent, indent);
+    jac_ast_data data = a->data[node];
+    return memcmp(a->extra + data.lhs, b->extra + data.lhs, (data.rhs - data.lhs) * sizeof *a->extra) == 0;
 }
 
-static void print_statement_expression(const jac_ast_expression_statement *expr_statement, int level, int indent)
+bool jac_compare_units(const jac_ast_unit *a, const jac_ast_unit *b, FILE *stream)
 {
-    indented(level, "expression_statement");
+    size_t nodes = darray_count(a->kinds), extra = darray_count(a->extra);
+    if ((nodes != darray_count(b->kinds)) || (extra != darray_count(b->extra)))
+    {
+        fprintf(stream, "units differ in size, %zu and %zu nodes, %zu and %zu extra data.\n", nodes,
+                darray_count(b->kinds), extra, darray_count(b->extra));
+        return false;
+    }
 
-    switch (expr_statement->holds)
+    for (jac_ast_node node = 0; node < nodes; ++node)
     {
-    case JAC_AST_FUNCTION_CALL:
-        print_statement_expression_call(expr_statement->opt.call, level + indent, indent);
-        break;
-    case JAC_AST_VARIABLE_DEFINITION:
-        print_variable_definition(expr_statement->opt.var_def, level + indent, indent);
-        break;
-    case JAC_AST_ASSIGNMENT:
-        print_assignment(expr_statement->opt.assignment, level + indent, indent);
-        break;
+        enum jac_ast_kind kind = jac_ast_kind_of(a, node);
+        jac_ast_data x = a->data[node], y = b->data[node];
+        if ((kind != jac_ast_kind_of(b, node)) || (x.lhs != y.lhs) || (x.rhs != y.rhs) || !same_token(a, b, node))
+        {
+            fprintf(stream, "units differ at node %u.\n", node);
+            return false;
+        }
 
-    default:
-        JAC_ASSERT(false, "unreachable.");
+        bool ranged = (kind == JAC_AST_ROOT_UNIT) || (kind == JAC_AST_EXTERN_BLOCK) ||
+                      (kind == JAC_AST_FUNCTION_HEADER) || (kind == JAC_AST_BLOCK) || (kind == JAC_AST_FUNCTION_CALL);
+        if (ranged && !same_range(a, b, node))
+        {
+            fprintf(stream, "units differ in the children of node %u.\n", node);
+            return false;
+        }
     }
+
+    return true;
 }
 
-static void print_expression(const jac_ast_expression *expression, int level, int indent)
+/*
+ * NODES, SEMANTIC VIEWS
+ */
+
+jac_type jac_ast_type(const jac_ast_unit *unit, jac_ast_node node)
 {
-    indented(level, "expression");
+    if (node == JAC_AST_NONE)
+        return (jac_type){.kind = JAC_TYPE_NONE, .indirection = 0};
+
+    JAC_ASSERT(jac_ast_kind_of(unit, node) == JAC_AST_TYPE, "node is not a type.");
+    jac_ast_data data = unit->data[node];
+    return (jac_type){
+        .token = jac_ast_token(unit, node),
+        .kind = (enum jac_type_kind)data.rhs,
+        .indirection = (uint8_t)data.lhs,
+    };
+}
 
-    switch (expression->holds)
-    {
-    case JAC_AST_EXPRESSION_LITERAL:
-        print_token(expression->opt.literal, "literal", level + indent);
-        break;
-    case JAC_AST_EXPRESSION_STATEMENT:
-        print_statement_expression(expression->opt.expr_statement, level + indent, indent);
-        break;
-    case JAC_AST_EXPRESSION_IDENTIFIER:
-        print_token(expression->opt.identifier, "id", level + indent);
-        break;
-    case JAC_AST_EXPRESSION_ADDROF:
-        print_token(expression->opt.addrof, "ref", level + indent);
-        break;
+void jac_ast_function(const jac_ast_unit *unit, jac_ast_node node, darray_allocator *allocator,
+                      jac_function *function)
+{
+    JAC_ASSERT(jac_ast_kind_of(unit, node) == JAC_AST_FUNCTION_HEADER, "node is not a function header.");
+    jac_ast_data data = unit->data[node];
 
-    default:
-        JAC_ASSERT(false, "unreachable.");
+    function->identifier = jac_ast_token(unit, node);
+    function->ret_type = jac_ast_type(unit, unit->extra[data.lhs]);
+
+    darray_small_init(function->args);
+    for (uint32_t i = data.lhs + 1; i < data.rhs; ++i)
+    {
+        jac_ast_node arg = unit->extra[i];
+        jac_symbol symbol = {
+            .identifier = jac_ast_token(unit, arg),
+            .type = jac_ast_type(unit, unit->data[arg].lhs),
+        };
+        darray_small_push(function->args, symbol, allocator);
     }
 }
 
-static void print_statement_return(const jac_ast_statement_return *ret, int level, int indent)
+/*
+ * DEBUGGING
+ */
+
+static void indented(int level, const char *msg)
 {
-    indented(level, "return_statement");
-    if (ret->expression)
-        print_expression(ret->expression, level + indent, indent);
-    else
-        indented(level + indent, "none_type");
+    printf("%*s%s\n", level, " ", msg);
 }
 
-static void print_block(const jac_ast_block block, int level, int indent)
+static void indented_v(int level, const char *fmt, ...)
 {
-    indented(level, "block");
-
-    darray_foreach(block, jac_ast_scope_statement, statement)
-    {
-        switch (statement->holds)
-        {
-        case JAC_AST_STATEMENT_RETURN:
-            print_statement_return(statement->opt.ret, level + indent, indent);
-            break;
-        case JAC_AST_BLOCK:
-            print_block(statement->opt.block, level + indent, indent);
-            break;
-        case JAC_AST_EXPRESSION_STATEMENT:
-            print_statement_expression(statement->opt.expr_statement, level + indent, indent);
-            break;
+    printf("%*s", level, " ");
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
 
-        default:
-            JAC_ASSERT(false, "unreachable.");
-        }
-    }
+static void print_token(const jac_ast_unit *unit, jac_ast_node node, const char *label, int level)
+{
+    jac_token token = jac_ast_token(unit, node);
+    indented_v(level, "%s: " JAC_TOKEN_FMT, label, JAC_TOKEN_ARG(&token));
 }
 
-static void print_type(const jac_type *type, int level, int indent)
+static void print_type(const jac_ast_unit *unit, jac_ast_node node, int level, int indent)
 {
-    if (type->indirection > 0)
+    jac_type type = jac_ast_type(unit, node);
+
+    if (type.indirection > 0)
     {
-        indented_v(level, "pointer (%lu)", type->indirection);
+        indented_v(level, "pointer (%u)", (unsigned)type.indirection);
         level += indent;
     }
 
-    switch (type->kind)
+    switch (type.kind)
     {
     case JAC_TYPE_NONE:
         indented(level, "none");
         break;
     case JAC_TYPE_CUSTOM:
-        print_token(type->token, "custom", level);
+        print_token(unit, node, "custom", level);
         break;
 
+    case JAC_TYPE_BOOL:
     case JAC_TYPE_INT8:
     case JAC_TYPE_UINT8:
+    case JAC_TYPE_INT16:
+    case JAC_TYPE_UINT16:
     case JAC_TYPE_INT32:
     case JAC_TYPE_UINT32:
     case JAC_TYPE_INT64:
     case JAC_TYPE_UINT64:
-        print_token(type->token, "intrinsic", level);
+    case JAC_TYPE_FLOAT32:
+    case JAC_TYPE_FLOAT64:
+        print_token(unit, node, "intrinsic", level);
         break;
 
     default:
@@ -921,53 +972,101 @@ static void print_type(const jac_type *type, int level, int indent)
     }
 }
 
-static void print_variable_declaration(const jac_symbol *declaration, int level, int indent)
+static void print_node(const jac_ast_unit *, jac_ast_node, int, int);
+
+static void print_range(const jac_ast_unit *unit, uint32_t start, uint32_t end, int level, int indent)
 {
-    indented(level, "variable_declaration");
-    print_token(declaration->identifier, "id", level + indent);
-    print_type(&declaration->type, level + indent, indent);
+    for (uint32_t i = start; i < end; ++i)
+        print_node(unit, unit->extra[i], level, indent);
 }
 
-static void print_function_header(const jac_function *header, int level, int indent)
+static void print_node(const jac_ast_unit *unit, jac_ast_node node, int level, int indent)
 {
-    indented(level, "function_header");
-    print_token(header->identifier, "id", level + indent);
-    indented_v(level + indent, "mangled: %s", header->mangled);
-    print_type(&header->ret_type, level + indent, indent);
+    jac_ast_data data = unit->data[node];
 
-    darray_foreach(header->args, jac_symbol, arg) print_variable_declaration(arg, level + indent, indent);
-}
+    switch (jac_ast_kind_of(unit, node))
+    {
+    case JAC_AST_FUNCTION_DEFINITION:
+        indented(level, "function_definition");
+        print_node(unit, data.lhs, level + indent, indent);
+        print_node(unit, data.rhs, level + indent, indent);
+        break;
 
-static void print_extern_block(const jac_ast_extern_block block, int level, int indent)
-{
-    indented(level, "extern_block");
-    darray_foreach(block, jac_function, header) print_function_header(header, level + indent, indent);
-}
+    case JAC_AST_HINT:
+        indented(level, "hint");
+        print_token(unit, node, "id", level + indent);
+        print_node(unit, data.lhs, level + indent, indent);
+        break;
 
-static void print_function_definition(const jac_ast_function_definition *func_def, int level, int indent)
-{
-    indented(level, "function_definition");
-    print_function_header(&func_def->header, level + indent, indent);
-    print_block(func_def->block, level + indent, indent);
+    case JAC_AST_EXTERN_BLOCK:
+        indented(level, "extern_block");
+        print_range(unit, data.lhs, data.rhs, level + indent, indent);
+        break;
+
+    case JAC_AST_FUNCTION_HEADER:
+        indented(level, "function_header");
+        print_token(unit, node, "id", level + indent);
+        print_type(unit, unit->extra[data.lhs], level + indent, indent);
+        print_range(unit, data.lhs + 1, data.rhs, level + indent, indent);
+        break;
+
+    case JAC_AST_BLOCK:
+        indented(level, "block");
+        print_range(unit, data.lhs, data.rhs, level + indent, indent);
+        break;
+
+    case JAC_AST_STATEMENT_RETURN:
+        indented(level, "return_statement");
+        if (data.lhs != JAC_AST_NONE)
+            print_node(unit, data.lhs, level + indent, indent);
+        else
+            indented(level + indent, "none_type");
+        break;
+
+    case JAC_AST_VARIABLE_DECLARATION:
+        indented(level, "variable_declaration");
+        print_token(unit, node, "id", level + indent);
+        print_type(unit, data.lhs, level + indent, indent);
+        break;
+
+    case JAC_AST_VARIABLE_DEFINITION:
+        indented(level, "variable_definition");
+        print_token(unit, node, "id", level + indent);
+        print_type(unit, data.lhs, level + indent, indent);
+        print_node(unit, data.rhs, level + indent, indent);
+        break;
+
+    case JAC_AST_ASSIGNMENT:
+        indented(level, "assignment");
+        print_token(unit, node, "id", level + indent);
+        print_node(unit, data.lhs, level + indent, indent);
+        break;
+
+    case JAC_AST_FUNCTION_CALL:
+        indented(level, "function_call");
+        print_token(unit, node, "id", level + indent);
+        print_range(unit, data.lhs, data.rhs, level + indent, indent);
+        break;
+
+    case JAC_AST_EXPRESSION_LITERAL:
+        print_token(unit, node, "literal", level);
+        break;
+    case JAC_AST_EXPRESSION_IDENTIFIER:
+        print_token(unit, node, "id", level);
+        break;
+    case JAC_AST_EXPRESSION_ADDROF:
+        print_token(unit, node, "ref", level);
+        break;
+
+    default:
+        JAC_ASSERT(false, "unreachable.");
+    }
 }
 
-void jac_print_unit(const jac_ast_unit unit, int indent)
+void jac_print_unit(const jac_ast_unit *unit, int indent)
 {
     printf("unit\n");
 
-    darray_foreach(unit, jac_ast_unit_statement, statement)
-    {
-        switch (statement->holds)
-        {
-        case JAC_AST_FUNCTION_DEFINITION:
-            print_function_definition(statement->opt.func_def, indent, indent);
-            break;
-        case JAC_AST_EXTERN_BLOCK:
-            print_extern_block(statement->opt.extern_block, indent, indent);
-            break;
-
-        default:
-            JAC_ASSERT(false, "unreachable.");
-        }
-    }
+    jac_ast_data data = unit->data[JAC_AST_ROOT];
+    print_range(unit, data.lhs, data.rhs, indent, indent);
 }
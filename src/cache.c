@@ -0,0 +1,308 @@
+#include "cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "darray.h"
+
+#ifndef JAC_VERSION
+#define JAC_VERSION "dev"
+#endif
+
+// bumped whenever the layout below, or that of any array in it, changes
+#define CACHE_FORMAT 2
+
+// of the array data. darray headers are 32 bytes, so the headers line up too
+#define CACHE_ALIGNMENT 16
+
+// byte order and word size of the writer, as read back natively
+#define CACHE_ABI (UINT32_C(0x0a0b0c00) | (uint32_t)sizeof(size_t))
+
+static const char magic[8] = {'J', 'A', 'C', 'A', 'S', 'T', '\r', '\n'};
+
+// the first ones hold a value per node
+enum section
+{
+    SECTION_KINDS,
+    SECTION_DATA,
+    SECTION_TOKEN_KINDS,
+    SECTION_TOKEN_OFFSETS,
+    SECTION_TOKEN_LENGTHS,
+    SECTION_TOKEN_IDS,
+    SECTION_EXTRA,
+    SECTION_CONSTANTS,
+    SECTION_LINES,
+    SECTION_STRINGS,
+    SECTION_ENTRIES, // values relative to the start of the file
+    SECTION_COUNT,
+};
+
+static const size_t strides[SECTION_COUNT] = {
+    [SECTION_KINDS] = sizeof(uint8_t),
+    [SECTION_DATA] = sizeof(jac_ast_data),
+    [SECTION_TOKEN_KINDS] = sizeof(uint8_t),
+    [SECTION_TOKEN_OFFSETS] = sizeof(uint32_t),
+    [SECTION_TOKEN_LENGTHS] = sizeof(uint32_t),
+    [SECTION_TOKEN_IDS] = sizeof(jac_intern_id),
+    [SECTION_EXTRA] = sizeof(uint32_t),
+    [SECTION_CONSTANTS] = sizeof(jac_constant),
+    [SECTION_LINES] = sizeof(uint32_t),
+    [SECTION_STRINGS] = sizeof(char),
+    [SECTION_ENTRIES] = sizeof(jac_interned),
+};
+
+typedef struct cache_header cache_header;
+
+struct cache_header
+{
+    char magic[8];
+    uint32_t format;
+    uint32_t abi;
+    char version[24]; // JAC_VERSION, zero-padded
+    uint64_t source_length;
+    uint64_t source_hash;
+    uint64_t sections[SECTION_COUNT]; // offsets of the array data, each just past its darray header
+};
+
+/*
+ * WRITING
+ */
+
+// appends an array with a darray header of its own, so it can be used in place
+// once mapped. returns the offset of the data
+static uint64_t put_array(darray_t char **image, const void *values, size_t count, size_t stride)
+{
+    static const char padding[CACHE_ALIGNMENT] = {0};
+    size_t misaligned = darray_count(*image) % CACHE_ALIGNMENT;
+    if (misaligned)
+        darray_append(*image, padding, CACHE_ALIGNMENT - misaligned);
+
+    // no allocator, and no room to grow
+    size_t header[DARRAY_ENUM_END_] = {0};
+    header[DARRAY_ENUM_END_ - 1 - DARRAY_TAG_STRIDE_] = stride;
+    header[DARRAY_ENUM_END_ - 1 - DARRAY_TAG_COUNT_] = count;
+    header[DARRAY_ENUM_END_ - 1 - DARRAY_TAG_CAPACITY_] = count;
+    darray_append(*image, (const char *)header, sizeof header);
+
+    uint64_t offset = darray_count(*image);
+    if (count)
+        darray_append(*image, (const char *)values, count * stride);
+    return offset;
+}
+
+#define PUT_ARRAY(image, array) put_array(image, array, darray_count(array), sizeof *(array))
+
+// the interned strings, followed by entries that point into them
+static void put_strings(darray_t char **image, const jac_interner *interner, cache_header *header)
+{
+    size_t count = darray_count(interner->entries);
+    darray_t jac_interned *entries = darray_new_reserved(jac_interned, count);
+    darray_t char *strings = darray_new(char);
+
+    // entry 0 is an empty string, rather than a null one
+    darray_push(strings, '\0');
+    darray_push(entries, ((jac_interned){0}));
+    for (jac_intern_id id = 1; id < count; ++id)
+    {
+        jac_interned entry = interner->entries[id];
+        entry.value = darray_count(strings);
+        darray_append(strings, jac_interned_value(interner, id), (size_t)entry.length + 1);
+        darray_push(entries, entry);
+    }
+
+    header->sections[SECTION_STRINGS] = PUT_ARRAY(image, strings);
+    for (jac_intern_id id = 0; id < count; ++id)
+        entries[id].value += header->sections[SECTION_STRINGS];
+    header->sections[SECTION_ENTRIES] = PUT_ARRAY(image, entries);
+
+    darray_free(strings);
+    darray_free(entries);
+}
+
+bool jac_write_ast_cache(const char *path, const jac_source *source, const jac_ast_unit *unit,
+                         const jac_line_table *lines)
+{
+    char temporary[FILENAME_MAX];
+    if ((size_t)snprintf(temporary, sizeof temporary, "%s.tmp", path) >= sizeof temporary)
+        return false;
+
+    cache_header header = {
+        .format = CACHE_FORMAT,
+        .abi = CACHE_ABI,
+        .source_length = source->length,
+        .source_hash = jac_hash_bytes(source->text, source->length),
+    };
+    memcpy(header.magic, magic, sizeof magic);
+    strncpy(header.version, JAC_VERSION, sizeof header.version);
+
+    // the header is filled in last, once the offsets are known
+    darray_t char *image = darray_new(char);
+    darray_append(image, (const char *)&header, sizeof header);
+
+    const jac_token_list *tokens = &unit->tokens;
+    header.sections[SECTION_KINDS] = PUT_ARRAY(&image, unit->kinds);
+    header.sections[SECTION_DATA] = PUT_ARRAY(&image, unit->data);
+    header.sections[SECTION_TOKEN_KINDS] = PUT_ARRAY(&image, tokens->kinds);
+    header.sections[SECTION_TOKEN_OFFSETS] = PUT_ARRAY(&image, tokens->offsets);
+    header.sections[SECTION_TOKEN_LENGTHS] = PUT_ARRAY(&image, tokens->lengths);
+    header.sections[SECTION_TOKEN_IDS] = PUT_ARRAY(&image, tokens->ids);
+    header.sections[SECTION_EXTRA] = PUT_ARRAY(&image, unit->extra);
+    header.sections[SECTION_CONSTANTS] = PUT_ARRAY(&image, tokens->constants);
+    header.sections[SECTION_LINES] = PUT_ARRAY(&image, lines->starts);
+    put_strings(&image, tokens->interner, &header);
+    memcpy(image, &header, sizeof header);
+
+    // a reader never sees a partial file
+    FILE *file = fopen(temporary, "wb");
+    bool written = file && (fwrite(image, sizeof(char), darray_count(image), file) == darray_count(image));
+    if (file)
+        written = (fclose(file) == 0) && written;
+    darray_free(image);
+
+#if defined(_WIN32)
+    // rename does not replace files here
+    if (written)
+        remove(path);
+#endif
+
+    if (written && (rename(temporary, path) == 0))
+        return true;
+
+    remove(temporary);
+    return false;
+}
+
+/*
+ * LOADING
+ */
+
+// the array is checked to be in bounds and of the expected shape, not its
+// contents. those are up to --ast-cache=verify
+static void *get_array(const jac_source *file, uint64_t offset, size_t stride)
+{
+    if ((offset % CACHE_ALIGNMENT) || (offset < sizeof(cache_header) + DARRAY_HEADER_STRIDE_) ||
+        (offset > file->length))
+        return NULL;
+
+    const size_t *block = (const size_t *)(file->text + offset);
+    size_t count = darray_count(block);
+    if ((darray_stride(block) != stride) || (darray_capacity(block) != count) || darray_allocator(block) ||
+        (count > (file->length - offset) / stride))
+        return NULL;
+
+    return (void *)block;
+}
+
+static bool check_header(const jac_source *file, const jac_source *source, void *arrays[SECTION_COUNT])
+{
+    const cache_header *header = (const cache_header *)file->text;
+    if ((file->length < sizeof *header) || (memcmp(header->magic, magic, sizeof magic) != 0) ||
+        (header->format != CACHE_FORMAT) || (header->abi != CACHE_ABI) ||
+        (strncmp(header->version, JAC_VERSION, sizeof header->version) != 0))
+        return false;
+
+    if ((header->source_length != source->length) ||
+        (header->source_hash != jac_hash_bytes(source->text, source->length)))
+        return false;
+
+    for (int section = 0; section < SECTION_COUNT; ++section)
+    {
+        arrays[section] = get_array(file, header->sections[section], strides[section]);
+        if (!arrays[section])
+            return false;
+    }
+
+    size_t nodes = darray_count(arrays[SECTION_KINDS]);
+    for (int section = SECTION_DATA; section <= SECTION_TOKEN_IDS; ++section)
+    {
+        if (darray_count(arrays[section]) != nodes)
+            return false;
+    }
+
+    // the root, the empty string and its terminator at least
+    const char *strings = arrays[SECTION_STRINGS];
+    size_t length = darray_count(strings);
+    return (nodes > 0) && (darray_count(arrays[SECTION_ENTRIES]) > 0) && (length > 0) && (strings[length - 1] == '\0');
+}
+
+bool jac_load_ast_cache(const char *path, const jac_source *source, jac_ast_cache *cache, jac_ast_unit *unit,
+                        jac_interner *interner)
+{
+    if (!jac_load_source(path, &cache->file))
+        return false;
+
+    void *arrays[SECTION_COUNT];
+    if (!check_header(&cache->file, source, arrays))
+    {
+        // a miss leaves nothing for jac_close_ast_cache to free
+        jac_free_source(&cache->file);
+        cache->file = (jac_source){0};
+        return false;
+    }
+
+    *unit = (jac_ast_unit){
+        .kinds = arrays[SECTION_KINDS],
+        .data = arrays[SECTION_DATA],
+        .extra = arrays[SECTION_EXTRA],
+        .tokens =
+            {
+                .kinds = arrays[SECTION_TOKEN_KINDS],
+                .offsets = arrays[SECTION_TOKEN_OFFSETS],
+                .lengths = arrays[SECTION_TOKEN_LENGTHS],
+                .ids = arrays[SECTION_TOKEN_IDS],
+                .constants = arrays[SECTION_CONSTANTS],
+                .lines = {.source = source->text, .starts = arrays[SECTION_LINES]},
+                .interner = interner,
+            },
+        .mapped = true,
+    };
+
+    jac_init_mapped_interner(interner, arrays[SECTION_ENTRIES], (uintptr_t)cache->file.text);
+    return true;
+}
+
+/*
+ * VERIFICATION
+ */
+
+bool jac_verify_ast_cache(const jac_source *source, const jac_ast_unit *cached, FILE *stream)
+{
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    jac_interner interner;
+    jac_init_interner(&interner);
+    jac_lexer lexer;
+    jac_init_lexer(&lexer, source->text, &strings, &interner);
+    lexer.quiet = true;
+
+    jac_ast_unit unit;
+    bool parsed = jac_parse_unit(&lexer, &unit) && !lexer.invalid;
+    if (!parsed)
+        fprintf(stream, "the source no longer parses.\n");
+
+    bool same = parsed && jac_compare_units(cached, &unit, stream);
+    const jac_line_table *lines = &cached->tokens.lines;
+    size_t count = darray_count(lines->starts);
+    if (same && ((count != darray_count(lexer.lines.starts)) ||
+                 (memcmp(lines->starts, lexer.lines.starts, count * sizeof *lines->starts) != 0)))
+    {
+        fprintf(stream, "line tables differ.\n");
+        same = false;
+    }
+
+    jac_free_unit(&unit);
+    jac_free_lexer(&lexer);
+    jac_free_interner(&interner);
+    jac_free_arena(&strings);
+    return same;
+}
+
+void jac_close_ast_cache(jac_ast_cache *cache)
+{
+    if (!cache->file.text)
+        return;
+
+    jac_free_source(&cache->file);
+    cache->file = (jac_source){0};
+}
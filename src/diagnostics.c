@@ -2,44 +2,83 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "darray.h"
 #include "lex.h"
 
-void output_diagnostic(FILE *stream, const jac_token *token, const char *fmt, va_list args)
+static void append_args(darray_t char **buffer, const char *fmt, va_list args)
 {
-    fprintf(stream, "\x1b[31;1merror:\x1b[0m ");
-    vfprintf(stream, fmt, args);
+    va_list copy;
+    va_copy(copy, args);
+    size_t length = (size_t)vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
 
-    jac_token_diagnostics d = token->diagnostics;
-    int line_digits = snprintf(NULL, 0, "%lu", d.line);
-    fprintf(stream, "\n %*c |", line_digits, ' ');
-    fprintf(stream, "\n \x1b[1m%lu\x1b[0m |    ", d.line);
+    // room for the terminator vsnprintf writes, which is not counted
+    size_t count = darray_count(*buffer);
+    if (darray_capacity(*buffer) < count + length + 1)
+        darray_resize(*buffer, 2 * (count + length + 1));
 
-    for (size_t i = 0; strchr("\n\0", d.source_line[i]) == NULL; ++i)
-        fputc(d.source_line[i], stream);
+    vsnprintf(*buffer + count, length + 1, fmt, args);
+    darray_truncate(*buffer, count + length);
+}
+
+static void append(darray_t char **buffer, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    append_args(buffer, fmt, args);
+    va_end(args);
+}
 
-    fprintf(stream, "\n %*c |   %*c", line_digits, ' ', (int)d.column, ' ');
+void jac_buffer_diagnostic(char **buffer, const jac_line_table *lines, const jac_token *token, const char *fmt,
+                           va_list args)
+{
+    append(buffer, "\x1b[31;1merror:\x1b[0m ");
+    append_args(buffer, fmt, args);
 
-    fprintf(stream, "\x1b[33m");
-    for (size_t i = 0; i < d.length; ++i)
-        fputc('^', stream);
-    fprintf(stream, "\x1b[0m");
+    size_t line, column;
+    jac_locate(lines, token->offset, &line, &column);
+    const char *source_line = lines->source + lines->starts[line - 1];
 
-    fputc('\n', stream);
+    int line_digits = snprintf(NULL, 0, "%lu", line);
+    append(buffer, "\n %*c |", line_digits, ' ');
+    append(buffer, "\n \x1b[1m%lu\x1b[0m |    ", line);
+
+    for (size_t i = 0; strchr("\n\0", source_line[i]) == NULL; ++i)
+        darray_push(*buffer, source_line[i]);
+
+    append(buffer, "\n %*c |   %*c", line_digits, ' ', (int)column, ' ');
+
+    append(buffer, "\x1b[33m");
+    for (size_t i = 0; i < jac_token_length(token); ++i)
+        darray_push(*buffer, '^');
+    append(buffer, "\x1b[0m");
+
+    darray_push(*buffer, '\n');
+}
+
+static void output_diagnostic(FILE *stream, const jac_line_table *lines, const jac_token *token, const char *fmt,
+                              va_list args)
+{
+    darray_t char *buffer = darray_new(char);
+    jac_buffer_diagnostic(&buffer, lines, token, fmt, args);
+    fwrite(buffer, sizeof(char), darray_count(buffer), stream);
+    darray_free(buffer);
 }
 
-void jac_print_diagnostic(const jac_token *token, const char *fmt, ...)
+void jac_print_diagnostic(const jac_line_table *lines, const jac_token *token, const char *fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    output_diagnostic(stderr, token, fmt, args);
+    output_diagnostic(stderr, lines, token, fmt, args);
     va_end(args);
 }
 
-void jac_log_diagnostic(FILE *file, const jac_token *token, const char *fmt, ...)
+void jac_log_diagnostic(FILE *file, const jac_line_table *lines, const jac_token *token, const char *fmt, ...)
 {
     va_list args;
     va_start(args, fmt);
-    output_diagnostic(file, token, fmt, args);
+    output_diagnostic(file, lines, token, fmt, args);
     va_end(args);
 }
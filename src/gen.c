@@ -30,7 +30,7 @@ static const char *argument_registers[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9
 struct generator
 {
     darray_t char *sections[END_SECTION];
-    const darray_t char **str_literals;
+    darray_t const jac_token **str_literals;
     darray_t jac_function *functions;
 };
 
@@ -78,7 +78,7 @@ static void init_generator(generator *gen)
 {
     for (size_t i = 0; i < END_SECTION; ++i)
         gen->sections[i] = NULL;
-    gen->str_literals = darray_new(const char *);
+    gen->str_literals = darray_new(const jac_token *);
     gen->functions = darray_new(jac_function);
 }
 
@@ -99,6 +99,26 @@ static void push(generator *gen, const char *value)
     emit(gen, SECTION_TEXT, "push %s\n", value);
 }
 
+static void push_constant(generator *gen, const jac_constant *constant)
+{
+    switch (constant->holds)
+    {
+    case JAC_CONSTANT_UINT:
+        emit(gen, SECTION_TEXT, "push %llu\n", (unsigned long long)constant->opt.u);
+        break;
+    case JAC_CONSTANT_INT:
+        emit(gen, SECTION_TEXT, "push %lld\n", (long long)constant->opt.i);
+        break;
+    case JAC_CONSTANT_FLOAT: {
+        // pushed as its bit pattern
+        uint64_t bits;
+        memcpy(&bits, &constant->opt.f, sizeof(bits));
+        emit(gen, SECTION_TEXT, "push 0x%llx\n", (unsigned long long)bits);
+    }
+    break;
+    }
+}
+
 static void pop(generator *gen, const char *register_)
 {
     emit(gen, SECTION_TEXT, "pop %s\n", register_);
@@ -112,14 +132,14 @@ static void generate_literal(generator *gen, const jac_token *literal)
 {
     switch (literal->kind)
     {
-    case JAC_TOKEN_INT_LITERAL:
-        push(gen, literal->value);
+    case JAC_TOKEN_NUM_LITERAL:
+        push_constant(gen, &literal->constant);
         break;
     case JAC_TOKEN_STR_LITERAL: {
         size_t str_count = darray_count(gen->str_literals);
         for (size_t i = 0; i < str_count; ++i)
         {
-            if (strcmp(gen->str_literals[i], literal->value) == 0)
+            if (gen->str_literals[i]->id == literal->id)
             {
                 emit(gen, SECTION_TEXT, "push S%lu\n", i);
                 return;
@@ -127,13 +147,13 @@ static void generate_literal(generator *gen, const jac_token *literal)
         }
 
         emit_noindent(gen, SECTION_RODATA, "S%lu: db ", str_count);
-        darray_push(gen->str_literals, literal->value);
+        darray_push(gen->str_literals, literal);
 
-        size_t len = darray_count(literal->value);
-        for (size_t i = 0; i < len - 1; ++i)
-            emit_noindent(gen, SECTION_RODATA, "0x%x, ", (int)literal->value[i]);
+        const char *value = jac_token_value(literal);
+        for (size_t i = 0; i < jac_token_length(literal); ++i)
+            emit_noindent(gen, SECTION_RODATA, "0x%x, ", (int)value[i]);
 
-        emit_noindent(gen, SECTION_RODATA, "0x%x\n", (int)literal->value[len - 1]);
+        emit_noindent(gen, SECTION_RODATA, "0x0\n");
         emit(gen, SECTION_TEXT, "push S%lu\n", str_count);
     }
     break;
@@ -149,16 +169,16 @@ static void generate_statement_expression_call(generator *gen, const jac_ast_fun
                                                jac_ast_variable_definition **variables)
 {
 
-    for (size_t i = 0; i < darray_count(call->arguments); ++i)
+    for (size_t i = 0; i < darray_small_count(call->arguments); ++i)
     {
-        generate_expression(gen, call->arguments + i, variables);
+        generate_expression(gen, darray_small_data(call->arguments) + i, variables);
         pop(gen, argument_registers[i]);
     }
 
     // set %rax to 0 to signal no vector registers we're used
     emit(gen, SECTION_TEXT, "xor rax, rax\n");
 
-    emit(gen, SECTION_TEXT, "call %s\n", call->identifier->value);
+    emit(gen, SECTION_TEXT, "call " JAC_TOKEN_FMT "\n", JAC_TOKEN_ARG(&call->identifier));
     push(gen, "rax");
 }
 
@@ -177,7 +197,7 @@ static void generate_assignment(generator *gen, const jac_ast_assignment *assign
 {
     darray_foreach(*variables, jac_ast_variable_definition, variable)
     {
-        if (strcmp(variable->var_decl->identifier->value, assignment->identifier->value) == 0)
+        if (variable->var_decl->identifier.id == assignment->identifier.id)
         {
             variable->expression = assignment->expression;
             generate_expression(gen, assignment->expression, variables);
@@ -213,7 +233,7 @@ static void generate_identifier(generator *gen, const jac_token *identifier, jac
 {
     darray_foreach(*variables, jac_ast_variable_definition, variable)
     {
-        if (strcmp(variable->var_decl->identifier->value, identifier->value) == 0)
+        if (variable->var_decl->identifier.id == identifier->id)
         {
             generate_expression(gen, variable->expression, variables);
             return;
@@ -229,7 +249,7 @@ static void generate_reference(generator *gen, const jac_token *addrof, jac_ast_
 
     for (size_t i = 0; i < darray_count(variables); ++i)
     {
-        if (strcmp(variables[i].var_decl->identifier->value, addrof->value) == 0)
+        if (variables[i].var_decl->identifier.id == addrof->id)
         {
             emit(gen, SECTION_TEXT, "lea rax, [rbp - %lu]\n", i * 8 + 8);
             emit(gen, SECTION_TEXT, "push rax\n");
@@ -247,16 +267,16 @@ static void generate_expression(generator *gen, const jac_ast_expression *expres
     switch (expression->holds)
     {
     case JAC_AST_EXPRESSION_LITERAL:
-        generate_literal(gen, expression->opt.literal);
+        generate_literal(gen, &expression->opt.literal);
         break;
     case JAC_AST_EXPRESSION_STATEMENT:
         generate_statement_expression(gen, expression->opt.expr_statement, variables);
         break;
     case JAC_AST_EXPRESSION_IDENTIFIER:
-        generate_identifier(gen, expression->opt.identifier, variables);
+        generate_identifier(gen, &expression->opt.identifier, variables);
         break;
     case JAC_AST_EXPRESSION_ADDROF:
-        generate_reference(gen, expression->opt.addrof, variables);
+        generate_reference(gen, &expression->opt.addrof, variables);
         break;
 
     default:
@@ -298,12 +318,12 @@ static void generate_block(generator *gen, const jac_ast_block *block, jac_ast_v
 static void generate_extern_block(generator *gen, const jac_ast_extern_block *block)
 {
     darray_foreach(block->declarations, jac_ast_function_header, header)
-        emit_noindent(gen, SECTION_TEXT, "extern %s\n", header->identifier->value);
+        emit_noindent(gen, SECTION_TEXT, "extern " JAC_TOKEN_FMT "\n", JAC_TOKEN_ARG(&header->identifier));
 }
 
 static void generate_function_definition(generator *gen, jac_ast_function_definition *func_def)
 {
-    emit_noindent(gen, SECTION_TEXT, "%s:\n", func_def->header->identifier->value);
+    emit_noindent(gen, SECTION_TEXT, JAC_TOKEN_FMT ":\n", JAC_TOKEN_ARG(func_def->header->identifier));
 
     size_t argument_count = darray_count(func_def->header->parameters);
     size_t stack_space = argument_count * 8;
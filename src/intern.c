@@ -0,0 +1,163 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "assert.h"
+#include "darray.h"
+
+#define INITIAL_SLOTS 1024
+
+// slots go through the darray hooks too, so that --stats=mem sees them
+static jac_intern_id *new_slots(size_t count)
+{
+    jac_intern_id *slots = DARRAY_ALLOC(count * sizeof(jac_intern_id));
+    JAC_ASSERT(slots != NULL, "no memory to allocate intern table.");
+    memset(slots, 0, count * sizeof(jac_intern_id));
+    return slots;
+}
+
+uint64_t jac_hash_bytes(const char *value, size_t length)
+{
+    // FNV-1a over 8-byte words, then the tail bytewise
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (; length >= 8; value += 8, length -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, value, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+    }
+
+    for (; length > 0; ++value, --length)
+        hash = (hash ^ (unsigned char)*value) * 0x100000001b3ull;
+
+    return hash;
+}
+
+uint32_t jac_hash_string(const char *value, size_t length)
+{
+    uint64_t hash = jac_hash_bytes(value, length);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+void jac_init_interner(jac_interner *interner)
+{
+    *interner = (jac_interner){
+        .entries = darray_new_reserved(jac_interned, INITIAL_SLOTS / 2),
+        .slots = new_slots(INITIAL_SLOTS),
+        .slot_mask = INITIAL_SLOTS - 1,
+    };
+    jac_init_arena(&interner->storage);
+
+    // id 0 is reserved for JAC_INTERN_NONE
+    darray_push(interner->entries, ((jac_interned){0}));
+}
+
+void jac_init_mapped_interner(jac_interner *interner, jac_interned *entries, uintptr_t base)
+{
+    *interner = (jac_interner){.entries = entries, .slots = NULL, .slot_mask = 0, .base = base};
+    jac_init_arena(&interner->storage);
+}
+
+// takes a mapped interner onto the heap, the bytes stay in the mapping
+static void thaw(jac_interner *interner)
+{
+    size_t count = darray_count(interner->entries);
+    darray_t jac_interned *entries = darray_new_reserved(jac_interned, count);
+    darray_push(entries, ((jac_interned){0}));
+    for (size_t id = 1; id < count; ++id)
+    {
+        jac_interned entry = interner->entries[id];
+        entry.value += interner->base;
+        darray_push(entries, entry);
+    }
+
+    uint32_t slot_mask = INITIAL_SLOTS - 1;
+    while ((size_t)slot_mask + 1 < count * 2)
+        slot_mask = (slot_mask << 1) | 1;
+
+    interner->entries = entries;
+    interner->base = 0;
+    interner->slots = new_slots((size_t)slot_mask + 1);
+    interner->slot_mask = slot_mask;
+
+    for (jac_intern_id id = 1; id < count; ++id)
+    {
+        uint32_t slot = entries[id].hash & slot_mask;
+        while (interner->slots[slot] != JAC_INTERN_NONE)
+            slot = (slot + 1) & slot_mask;
+        interner->slots[slot] = id;
+    }
+}
+
+static void grow_slots(jac_interner *interner)
+{
+    uint32_t slot_mask = (interner->slot_mask << 1) | 1;
+    jac_intern_id *slots = new_slots((size_t)slot_mask + 1);
+
+    for (jac_intern_id id = 1; id < darray_count(interner->entries); ++id)
+    {
+        uint32_t slot = interner->entries[id].hash & slot_mask;
+        while (slots[slot] != JAC_INTERN_NONE)
+            slot = (slot + 1) & slot_mask;
+        slots[slot] = id;
+    }
+
+    DARRAY_DEALLOC(interner->slots);
+    interner->slots = slots;
+    interner->slot_mask = slot_mask;
+}
+
+jac_intern_id jac_intern(jac_interner *interner, const char *value, size_t length, uint32_t hash)
+{
+    if (!interner->slots)
+        thaw(interner);
+
+    uint32_t slot = hash & interner->slot_mask;
+
+    for (;; slot = (slot + 1) & interner->slot_mask)
+    {
+        jac_intern_id id = interner->slots[slot];
+        if (id == JAC_INTERN_NONE)
+            break;
+
+        const jac_interned *entry = interner->entries + id;
+        if ((entry->hash == hash) && (entry->length == length) &&
+            (memcmp((const char *)entry->value, value, length) == 0))
+            return id;
+    }
+
+    char *copy = jac_arena_alloc_impl(&interner->storage, length + 1);
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+
+    jac_interned entry = {
+        .value = (uintptr_t)copy,
+        .length = (uint32_t)length,
+        .hash = hash,
+    };
+
+    jac_intern_id id = (jac_intern_id)darray_count(interner->entries);
+    darray_push(interner->entries, entry);
+    interner->slots[slot] = id;
+
+    // keep the load factor at or below a half
+    if (darray_count(interner->entries) * 2 > (size_t)interner->slot_mask + 1)
+        grow_slots(interner);
+
+    return id;
+}
+
+void jac_free_interner(jac_interner *interner)
+{
+    jac_free_arena(&interner->storage);
+
+    // still mapped, nothing of the entries is owned
+    if (!interner->slots)
+        return;
+
+    darray_free(interner->entries);
+    DARRAY_DEALLOC(interner->slots);
+}
@@ -1,34 +1,170 @@
 #include "ir.h"
 
-#include <stdarg.h>
 #include <stdbool.h>
+#include <string.h>
 
+#include "arena.h"
 #include "assert.h"
 #include "ast.h"
 #include "darray.h"
 #include "diagnostics.h"
+#include "opt.h"
 #include "symbol.h"
+#include "trace.h"
 #include "type.h"
 
 typedef struct checker checker;
+typedef struct definition definition;
 
 struct checker
 {
     jac_ir_unit *unit;
+    const jac_ast_unit *ast;
+    const jac_line_table *lines;
+    jac_memory_arena *arena;
     jac_ir_function *parent_fn;
     jac_ir_block *parent_block;
+
+    // functions by name and parameter types, and the variables in scope by
+    // name. they index 'unit->functions' and 'parent_fn->locals'
+    jac_function_index functions;
+    jac_symbol_table locals;
+    darray_t jac_type_id *keys; // scratch for signatures
+    jac_type_id string_type;
+
+    // per intern id, 1 + the index of the string in 'unit->str_literals', 0 if it is not there yet
+    darray_t uint32_t *string_indices;
 };
 
-static bool check_expression(checker *checker, const jac_ast_expression *expression, jac_ir_block *block,
-                             darray_t jac_ir_value **values)
+// a function body, checked once every header is in
+struct definition
+{
+    jac_ast_node node;
+    uint32_t function;
+};
+
+static size_t add_str_literal(checker *checker, jac_intern_id id)
+{
+    while (darray_count(checker->string_indices) <= id)
+        darray_push(checker->string_indices, 0);
+    if (checker->string_indices[id] != 0)
+        return checker->string_indices[id] - 1;
+
+    darray_push(checker->unit->str_literals, id);
+    checker->string_indices[id] = (uint32_t)darray_count(checker->unit->str_literals);
+    return checker->string_indices[id] - 1;
+}
+
+static jac_ir_symbol new_temporary(checker *checker, jac_type type)
+{
+    return (jac_ir_symbol){
+        .sym = {.identifier = {.kind = JAC_TOKEN_EOF}, .type = type},
+        .id = checker->parent_fn->tmp_counter++,
+    };
+}
+
+static void push_value(checker *checker, jac_ir_value_list *values, jac_ir_symbol symbol)
+{
+    jac_ir_value value = {.opt.variable = symbol, .holds = JAC_IR_VALUE_VARIABLE};
+    darray_small_push(*values, value, &checker->arena->allocator);
+}
+
+static bool find_local(checker *checker, const jac_token *identifier, uint32_t *local)
+{
+    if (jac_lookup_symbol(&checker->locals, identifier->id, local))
+        return true;
+
+    jac_print_diagnostic(checker->lines, identifier, "use of undeclared identifier '" JAC_TOKEN_FMT "'.",
+                         JAC_TOKEN_ARG(identifier));
+    return false;
+}
+
+// a stack slot in the innermost scope, 'what' names it in diagnostics
+static bool declare_local(checker *checker, const jac_symbol *symbol, const char *what, uint32_t *local)
+{
+    *local = (uint32_t)darray_count(checker->parent_fn->locals);
+    if (!jac_declare_symbol(&checker->locals, symbol->identifier.id, *local, NULL))
+    {
+        jac_print_diagnostic(checker->lines, &symbol->identifier, "redeclaration of %s '" JAC_TOKEN_FMT "'.", what,
+                             JAC_TOKEN_ARG(&symbol->identifier));
+        return false;
+    }
+
+    jac_ir_symbol slot = {.sym = *symbol, .id = *local};
+    slot.sym.type.id = jac_intern_type(&checker->unit->types, &symbol->type);
+    darray_push(checker->parent_fn->locals, slot);
+    return true;
+}
+
+static bool check_call(checker *, jac_ast_node, jac_ir_block *, jac_ir_value_list *);
+static bool check_store(checker *, jac_ast_node, jac_ir_block *, jac_ir_value_list *);
+
+static bool check_expression(checker *checker, jac_ast_node expression, jac_ir_block *block, jac_ir_value_list *values)
 {
-    switch (expression->holds)
+    switch (jac_ast_kind_of(checker->ast, expression))
     {
     case JAC_AST_EXPRESSION_LITERAL: {
+        jac_token token = jac_ast_token(checker->ast, expression);
+
         jac_ir_value literal;
         literal.holds = JAC_IR_VALUE_LITERAL;
-        literal.opt.literal.value = expression->opt.literal;
-        darray_push(*values, literal);
+        if (token.kind == JAC_TOKEN_NUM_LITERAL)
+        {
+            literal.opt.literal.holds = JAC_IR_LITERAL_CONSTANT;
+            literal.opt.literal.opt.constant = token.constant;
+        }
+        else
+        {
+            literal.opt.literal.holds = JAC_IR_LITERAL_STRING;
+            literal.opt.literal.opt.str_index = add_str_literal(checker, token.id);
+        }
+        darray_small_push(*values, literal, &checker->arena->allocator);
+    }
+    break;
+
+    case JAC_AST_EXPRESSION_IDENTIFIER: {
+        jac_token identifier = jac_ast_token(checker->ast, expression);
+        uint32_t local;
+        if (!find_local(checker, &identifier, &local))
+            return false;
+
+        jac_ir_symbol result = new_temporary(checker, checker->parent_fn->locals[local].sym.type);
+        darray_push(block->instructions, ((jac_ir_instruction){.op = JAC_IR_LOAD, .result = result, .local = local}));
+        push_value(checker, values, result);
+    }
+    break;
+
+    case JAC_AST_EXPRESSION_ADDROF: {
+        jac_token identifier = jac_ast_token(checker->ast, expression);
+        uint32_t local;
+        if (!find_local(checker, &identifier, &local))
+            return false;
+
+        jac_type type = checker->parent_fn->locals[local].sym.type;
+        type.indirection += 1;
+        type.id = jac_pointer_type(&checker->unit->types, type.id);
+
+        jac_ir_symbol result = new_temporary(checker, type);
+        darray_push(block->instructions, ((jac_ir_instruction){.op = JAC_IR_ADDR, .result = result, .local = local}));
+        push_value(checker, values, result);
+    }
+    break;
+
+    case JAC_AST_VARIABLE_DEFINITION:
+    case JAC_AST_ASSIGNMENT:
+        return check_store(checker, expression, block, values);
+
+    case JAC_AST_FUNCTION_CALL: {
+        if (!check_call(checker, expression, block, values))
+            return false;
+
+        if (darray_small_data(*values)[darray_small_count(*values) - 1].opt.variable.sym.type.id == JAC_TYPE_NONE)
+        {
+            jac_token identifier = jac_ast_token(checker->ast, expression);
+            jac_print_diagnostic(checker->lines, &identifier, "'" JAC_TOKEN_FMT "' does not return a value.",
+                                 JAC_TOKEN_ARG(&identifier));
+            return false;
+        }
     }
     break;
 
@@ -39,116 +175,460 @@ static bool check_expression(checker *checker, const jac_ast_expression *express
     return true;
 }
 
-static bool check_statement_return(checker *checker, const jac_ast_statement_return *ret, jac_ir_block *block)
+// untyped numeric literals are JAC_TYPE_NONE until converted, see convert_value
+static jac_type_id value_type(const checker *checker, const jac_ir_value *value)
+{
+    if (value->holds == JAC_IR_VALUE_VARIABLE)
+        return value->opt.variable.sym.type.id;
+    if (value->opt.literal.holds == JAC_IR_LITERAL_STRING)
+        return checker->string_type;
+    return jac_primitive_type(value->opt.literal.opt.constant.type);
+}
+
+static bool is_untyped(const checker *checker, const jac_ir_value *value)
+{
+    return value_type(checker, value) == JAC_TYPE_NONE;
+}
+
+// an untyped literal fits a numeric type that keeps its value, anything else
+// must have the type already
+static bool fits_value(const checker *checker, const jac_ir_value *value, jac_type_id type)
+{
+    if (!is_untyped(checker, value))
+        return value_type(checker, value) == type;
+    return jac_is_numeric_type(type) && jac_constant_fits(&value->opt.literal.opt.constant, (enum jac_type_kind)type);
+}
+
+// an untyped literal takes the type it is stored, passed or returned as, so
+// that none reaches the IR
+static bool convert_value(const checker *checker, jac_ir_value *value, jac_type_id type)
+{
+    if (!fits_value(checker, value, type))
+        return false;
+    if (!is_untyped(checker, value))
+        return true;
+
+    jac_constant converted;
+    jac_convert_constant(&value->opt.literal.opt.constant, (enum jac_type_kind)type, &converted);
+    value->opt.literal.opt.constant = converted;
+    return true;
+}
+
+static bool all_fit(const checker *checker, const jac_ir_value_list *arguments, const jac_type_id *params)
+{
+    for (size_t i = 0; i < darray_small_count(*arguments); ++i)
+    {
+        if (!fits_value(checker, darray_small_data(*arguments) + i, params[i]))
+            return false;
+    }
+    return true;
+}
+
+static bool resolve_call(checker *checker, const jac_token *identifier, const jac_ir_value_list *arguments,
+                         uint32_t *function)
+{
+    darray_clear(checker->keys);
+    bool typed = true;
+    darray_small_foreach(*arguments, const jac_ir_value, argument)
+    {
+        jac_type_id type = value_type(checker, argument);
+        typed = typed && (type != JAC_TYPE_NONE);
+        darray_push(checker->keys, type);
+    }
+
+    // all of the argument types are known, so the signature is too
+    uint32_t arity = (uint32_t)darray_count(checker->keys);
+    if (typed && jac_find_overload(&checker->functions, identifier->id, checker->keys, arity, function))
+        return true;
+
+    // untyped literals leave it to the overloads of the same arity, whose
+    // parameters hold their values
+    size_t viable = 0;
+    const jac_overload *overload = jac_first_overload(&checker->functions, identifier->id, arity);
+    for (; overload; overload = jac_next_overload(&checker->functions, overload))
+    {
+        if (!all_fit(checker, arguments, jac_overload_params(&checker->functions, overload)))
+            continue;
+        viable += 1;
+        *function = overload->function;
+    }
+
+    if (viable == 1)
+        return true;
+
+    const char *fmt = viable ? "ambiguous call to '" JAC_TOKEN_FMT "'." : "no matching function for call to '" JAC_TOKEN_FMT "'.";
+    jac_print_diagnostic(checker->lines, identifier, fmt, JAC_TOKEN_ARG(identifier));
+    return false;
+}
+
+static bool check_call(checker *checker, jac_ast_node call, jac_ir_block *block, jac_ir_value_list *values)
+{
+    jac_token identifier = jac_ast_token(checker->ast, call);
+
+    jac_ir_value_list operands;
+    darray_small_init(operands);
+
+    size_t count;
+    const jac_ast_node *arguments = jac_ast_children(checker->ast, call, &count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!check_expression(checker, arguments[i], block, &operands))
+            return false;
+    }
+
+    uint32_t function;
+    if (!resolve_call(checker, &identifier, &operands, &function))
+        return false;
+
+    // passed as the parameter types, the same as if the call were inlined
+    const jac_function *header = &checker->unit->functions[function].header;
+    for (size_t i = 0; i < count; ++i)
+        convert_value(checker, darray_small_data(operands) + i, darray_small_data(header->args)[i].type.id);
+
+    jac_ir_symbol result = new_temporary(checker, checker->unit->functions[function].header.ret_type);
+    jac_ir_instruction instruction = {.op = JAC_IR_CALL, .operands = operands, .result = result, .callee = function};
+    darray_push(block->instructions, instruction);
+    push_value(checker, values, result);
+    return true;
+}
+
+// definitions and assignments, which are expressions of the value they store
+static bool check_store(checker *checker, jac_ast_node store, jac_ir_block *block, jac_ir_value_list *values)
+{
+    jac_token identifier = jac_ast_token(checker->ast, store);
+    jac_ast_data data = checker->ast->data[store];
+    bool is_definition = (jac_ast_kind_of(checker->ast, store) == JAC_AST_VARIABLE_DEFINITION);
+
+    // the value goes first, so that 'i32: x := x' reads an outer 'x'
+    jac_ir_value_list operands;
+    darray_small_init(operands);
+    if (!check_expression(checker, is_definition ? data.rhs : data.lhs, block, &operands))
+        return false;
+
+    uint32_t local;
+    if (is_definition)
+    {
+        jac_symbol symbol = {.identifier = identifier, .type = jac_ast_type(checker->ast, data.lhs)};
+        if (!declare_local(checker, &symbol, "variable", &local))
+            return false;
+    }
+    else if (!find_local(checker, &identifier, &local))
+        return false;
+
+    jac_ir_value *value = darray_small_data(operands);
+    bool untyped = is_untyped(checker, value);
+    if (!convert_value(checker, value, checker->parent_fn->locals[local].sym.type.id))
+    {
+        if (untyped)
+            jac_print_diagnostic(checker->lines, &identifier,
+                                 "numeric literal does not fit the type of '" JAC_TOKEN_FMT "'.",
+                                 JAC_TOKEN_ARG(&identifier));
+        else
+            jac_print_diagnostic(checker->lines, &identifier, "mismatched types in %s of '" JAC_TOKEN_FMT "'.",
+                                 is_definition ? "definition" : "assignment", JAC_TOKEN_ARG(&identifier));
+        return false;
+    }
+
+    jac_ir_instruction instruction = {.op = JAC_IR_STORE, .operands = operands, .local = local};
+    darray_push(block->instructions, instruction);
+    darray_small_push(*values, *value, &checker->arena->allocator);
+    return true;
+}
+
+// the value must fit the return type, and there is one exactly when that is not empty
+static bool check_statement_return(checker *checker, jac_ast_node ret, jac_ir_block *block)
 {
-    jac_ir_value *operands = darray_new(jac_ir_value);
-    if (!check_expression(checker, ret->expression, block, &operands))
+    jac_ir_value_list operands;
+    darray_small_init(operands);
+    jac_ast_node expression = checker->ast->data[ret].lhs;
+    if ((expression != JAC_AST_NONE) && !check_expression(checker, expression, block, &operands))
+        return false;
+
+    jac_token keyword = jac_ast_token(checker->ast, ret);
+    const jac_token *function = &checker->parent_fn->header.identifier;
+    jac_type_id type = checker->parent_fn->header.ret_type.id;
+    if ((type == JAC_TYPE_NONE) != (expression == JAC_AST_NONE))
+    {
+        jac_print_diagnostic(checker->lines, &keyword,
+                             (type == JAC_TYPE_NONE) ? "'" JAC_TOKEN_FMT "' does not return a value."
+                                                     : "'" JAC_TOKEN_FMT "' must return a value.",
+                             JAC_TOKEN_ARG(function));
         return false;
+    }
+
+    if (expression != JAC_AST_NONE)
+    {
+        jac_ir_value *value = darray_small_data(operands);
+        bool untyped = is_untyped(checker, value);
+        if (!convert_value(checker, value, type))
+        {
+            jac_print_diagnostic(checker->lines, &keyword,
+                                 untyped ? "numeric literal does not fit the return type of '" JAC_TOKEN_FMT "'."
+                                         : "mismatched return type in '" JAC_TOKEN_FMT "'.",
+                                 JAC_TOKEN_ARG(function));
+            return false;
+        }
+    }
 
-    // jac_ir_symbol result = {
-    //     .id    = ir->active_func->tmp_counter++,
-    //     .label = NULL,
-    //     .type  = (jac_ir_type){ .kind = JAC_IR_INT32, .ptr_indirection = 0 },
-    // };
     jac_ir_instruction instruction = {.op = JAC_IR_RET, .operands = operands, .result = (jac_ir_symbol){0}};
     darray_push(block->instructions, instruction);
     return true;
 }
 
-static bool check_block(checker *checker, const jac_ast_block block)
+static void start_block(checker *checker)
 {
-    jac_ir_block new_block = {
-        .id = checker->parent_fn->tmp_counter++,
-        .instructions = darray_new(jac_ir_instruction),
+    *checker->parent_block = (jac_ir_block){
+        .id = darray_count(checker->parent_fn->blocks),
+        .instructions = jac_arena_darray_new(checker->arena, jac_ir_instruction),
     };
+}
 
-    darray_foreach(block, jac_ast_scope_statement, statement)
+// nested blocks open a scope of their own, but carry on in the same IR block
+static bool check_statements(checker *checker, jac_ast_node block)
+{
+    size_t count;
+    const jac_ast_node *statements = jac_ast_children(checker->ast, block, &count);
+    for (size_t i = 0; i < count; ++i)
     {
-        switch (statement->holds)
+        switch (jac_ast_kind_of(checker->ast, statements[i]))
         {
         case JAC_AST_STATEMENT_RETURN:
-            if (!check_statement_return(checker, statement->opt.ret, &new_block))
+            if (!check_statement_return(checker, statements[i], checker->parent_block))
+                return false;
+            darray_push(checker->parent_fn->blocks, *checker->parent_block);
+            start_block(checker);
+            break;
+
+        case JAC_AST_FUNCTION_CALL: {
+            jac_ir_value_list discarded;
+            darray_small_init(discarded);
+            if (!check_call(checker, statements[i], checker->parent_block, &discarded))
+                return false;
+            break;
+        }
+
+        case JAC_AST_VARIABLE_DEFINITION:
+        case JAC_AST_ASSIGNMENT: {
+            jac_ir_value_list discarded;
+            darray_small_init(discarded);
+            if (!check_store(checker, statements[i], checker->parent_block, &discarded))
                 return false;
-            darray_push(checker->parent_fn->blocks, new_block);
+            break;
+        }
 
-            new_block = (jac_ir_block){
-                .id = checker->parent_fn->tmp_counter++,
-                .instructions = darray_new(jac_ir_instruction),
-            };
+        case JAC_AST_BLOCK: {
+            jac_push_scope(&checker->locals);
+            bool checked = check_statements(checker, statements[i]);
+            jac_pop_scope(&checker->locals);
+            if (!checked)
+                return false;
             break;
+        }
 
         default:
             JAC_ASSERT(false, "unreachable.");
         }
     }
 
-    darray_push(checker->parent_fn->blocks, new_block);
     return true;
 }
 
-static bool check_function_header(checker *checker, const jac_function *header, bool is_declaration)
+// each argument gets a slot of its own, which it is stored into on entry
+static bool declare_arguments(checker *checker)
 {
-    darray_foreach(checker->unit->functions, jac_ir_function, func_symbol)
+    const jac_function *function = &checker->parent_fn->header;
+    for (size_t i = 0; i < darray_small_count(function->args); ++i)
     {
-        if (strcmp(func_symbol->header.mangled, header->mangled) != 0)
-            continue;
+        const jac_symbol *arg = darray_small_data(function->args) + i;
+        uint32_t local;
+        if (!declare_local(checker, arg, "argument", &local))
+            return false;
+
+        jac_ir_instruction instruction = {.op = JAC_IR_STORE, .local = local};
+        darray_small_init(instruction.operands);
+        push_value(checker, &instruction.operands, (jac_ir_symbol){.sym = *arg, .id = i});
+        darray_push(checker->parent_block->instructions, instruction);
+    }
+
+    return true;
+}
+
+static bool check_function_header(checker *checker, jac_ast_node header, bool is_declaration)
+{
+    jac_function function;
+    jac_ast_function(checker->ast, header, &checker->arena->allocator, &function);
+
+    // overloads differ in their parameter types
+    jac_type_table *types = &checker->unit->types;
+    function.ret_type.id = jac_intern_type(types, &function.ret_type);
+    darray_clear(checker->keys);
+    darray_small_foreach(function.args, jac_symbol, arg)
+    {
+        arg->type.id = jac_intern_type(types, &arg->type);
+        darray_push(checker->keys, arg->type.id);
+    }
 
-        jac_print_diagnostic(header->identifier, "redeclaration of function '%s'.", header->identifier->value);
+    uint32_t index = (uint32_t)darray_count(checker->unit->functions);
+    uint32_t arity = (uint32_t)darray_count(checker->keys);
+    if (!jac_add_overload(&checker->functions, function.identifier.id, checker->keys, arity, index, NULL))
+    {
+        jac_print_diagnostic(checker->lines, &function.identifier, "redeclaration of function '" JAC_TOKEN_FMT "'.",
+                             JAC_TOKEN_ARG(&function.identifier));
         return false;
     }
 
+    // the arguments are the first values
     jac_ir_function new_func = {
-        .header = *header,
-        .blocks = is_declaration ? NULL : darray_new(jac_ir_block),
-        .tmp_counter = 0,
+        .header = function,
+        .blocks = is_declaration ? NULL : jac_arena_darray_new(checker->arena, jac_ir_block),
+        .locals = is_declaration ? NULL : jac_arena_darray_new(checker->arena, jac_ir_symbol),
+        .tmp_counter = arity,
     };
 
     darray_push(checker->unit->functions, new_func);
-    checker->parent_fn = darray_last(checker->unit->functions);
     return true;
 }
 
-static bool check_function_definition(checker *checker, const jac_ast_function_definition *func_def)
+static bool check_function_definition(checker *checker, const definition *definition)
 {
-    if (!check_function_header(checker, &func_def->header, false))
+    uint64_t start = jac_begin_event();
+    jac_ast_data data = checker->ast->data[definition->node];
+    checker->parent_fn = checker->unit->functions + definition->function;
+
+    // the body shares its scope with the arguments
+    jac_ir_block entry;
+    checker->parent_block = &entry;
+    start_block(checker);
+
+    jac_push_scope(&checker->locals);
+    bool checked = declare_arguments(checker) && check_statements(checker, data.rhs);
+    jac_pop_scope(&checker->locals);
+    if (!checked)
         return false;
-    return check_block(checker, func_def->block);
+
+    darray_push(checker->parent_fn->blocks, entry);
+
+    const jac_token *identifier = &checker->parent_fn->header.identifier;
+    jac_end_event("function", JAC_PHASE_CHECK, identifier->value, identifier->length, start);
+    return true;
 }
 
-bool jac_check_unit(const jac_ast_unit unit, jac_ir_unit *ir)
+static bool is_hint(const jac_token *identifier, const char *name)
+{
+    return (jac_token_length(identifier) == strlen(name)) &&
+           (memcmp(jac_token_value(identifier), name, jac_token_length(identifier)) == 0);
+}
+
+// unwraps the hints in front of a definition, leaving 'node' at it
+static bool check_hints(checker *checker, jac_ast_node *node, enum jac_ir_inlining *inlining)
+{
+    *inlining = JAC_IR_INLINE_AUTO;
+    for (; jac_ast_kind_of(checker->ast, *node) == JAC_AST_HINT; *node = checker->ast->data[*node].lhs)
+    {
+        jac_token identifier = jac_ast_token(checker->ast, *node);
+        enum jac_ir_inlining hinted;
+        if (is_hint(&identifier, "inline"))
+            hinted = JAC_IR_INLINE_ALWAYS;
+        else if (is_hint(&identifier, "noinline"))
+            hinted = JAC_IR_INLINE_NEVER;
+        else
+        {
+            jac_print_diagnostic(checker->lines, &identifier, "unknown hint '" JAC_TOKEN_FMT "'.",
+                                 JAC_TOKEN_ARG(&identifier));
+            return false;
+        }
+
+        if ((*inlining != JAC_IR_INLINE_AUTO) && (*inlining != hinted))
+        {
+            jac_print_diagnostic(checker->lines, &identifier, "conflicting hint '" JAC_TOKEN_FMT "'.",
+                                 JAC_TOKEN_ARG(&identifier));
+            return false;
+        }
+        *inlining = hinted;
+    }
+
+    return true;
+}
+
+bool jac_check_unit(const jac_ast_unit *ast, const jac_line_table *lines, jac_memory_arena *arena, jac_ir_unit *ir)
 {
     *ir = (jac_ir_unit){
-        .functions = darray_new(jac_ir_function),
-        .globals = darray_new(jac_symbol),
-        .str_literals = darray_new(const char *),
+        .functions = jac_arena_darray_new(arena, jac_ir_function),
+        .globals = jac_arena_darray_new(arena, jac_symbol),
+        .str_literals = jac_arena_darray_new(arena, jac_intern_id),
     };
 
     checker checker = {
         .unit = ir,
+        .ast = ast,
+        .lines = lines,
+        .arena = arena,
         .parent_fn = NULL,
         .parent_block = NULL,
+        .keys = darray_new(jac_type_id),
+        .string_indices = darray_new(uint32_t),
     };
+    jac_init_type_table(&ir->types, arena);
+    checker.string_type = jac_pointer_type(&ir->types, jac_primitive_type(JAC_TYPE_UINT8));
+    jac_init_function_index(&checker.functions);
+    jac_init_symbol_table(&checker.locals);
 
     bool success = true;
 
-    darray_foreach(unit, jac_ast_unit_statement, statement)
+    // every header goes in first, so that calls may come before their callee
+    darray_t definition *definitions = darray_new(definition);
+
+    size_t count;
+    const jac_ast_node *statements = jac_ast_children(ast, JAC_AST_ROOT, &count);
+    for (size_t i = 0; i < count; ++i)
     {
-        switch (statement->holds)
+        switch (jac_ast_kind_of(ast, statements[i]))
         {
-        case JAC_AST_EXTERN_BLOCK:
-            darray_foreach(statement->opt.extern_block, jac_function,
-                           header) if (!check_function_header(&checker, header, true)) success = false;
+        case JAC_AST_EXTERN_BLOCK: {
+            size_t header_count;
+            const jac_ast_node *headers = jac_ast_children(ast, statements[i], &header_count);
+            for (size_t j = 0; j < header_count; ++j)
+                if (!check_function_header(&checker, headers[j], true))
+                    success = false;
             break;
-        case JAC_AST_FUNCTION_DEFINITION:
-            if (!check_function_definition(&checker, statement->opt.func_def))
+        }
+        case JAC_AST_HINT:
+        case JAC_AST_FUNCTION_DEFINITION: {
+            enum jac_ir_inlining inlining;
+            jac_ast_node node = statements[i];
+            if (!check_hints(&checker, &node, &inlining))
+            {
+                success = false;
+                break;
+            }
+
+            definition definition = {.node = node, .function = (uint32_t)darray_count(ir->functions)};
+            if (check_function_header(&checker, ast->data[node].lhs, false))
+            {
+                darray_push(definitions, definition);
+                darray_last(ir->functions)->inlining = inlining;
+            }
+            else
                 success = false;
             break;
+        }
 
         default:
             JAC_ASSERT(false, "unreachable.");
         }
     }
 
+    darray_foreach(definitions, const definition, definition)
+    {
+        if (!check_function_definition(&checker, definition))
+            success = false;
+    }
+
+    darray_free(definitions);
+    jac_free_function_index(&checker.functions);
+    jac_free_symbol_table(&checker.locals);
+    darray_free(checker.keys);
+    darray_free(checker.string_indices);
     return success;
 }
 
@@ -156,71 +636,167 @@ bool jac_check_unit(const jac_ast_unit unit, jac_ir_unit *ir)
  * DEBUGGING
  */
 
-// static void indented(int indent, const char* msg) { printf("%*s%s\n",
-// indent, " ", msg); }
+static void print_literal(const jac_ir_unit *unit, const jac_ir_literal *literal, const jac_interner *interner)
+{
+    if (literal->holds == JAC_IR_LITERAL_STRING)
+    {
+        printf("$%s", jac_interned_value(interner, unit->str_literals[literal->opt.str_index]));
+        return;
+    }
 
-static void indented_v(int indent, const char *fmt, ...)
+    const jac_constant *constant = &literal->opt.constant;
+    switch (constant->holds)
+    {
+    case JAC_CONSTANT_UINT:
+        printf("$%llu", (unsigned long long)constant->opt.u);
+        break;
+    case JAC_CONSTANT_INT:
+        printf("$%lld", (long long)constant->opt.i);
+        break;
+    case JAC_CONSTANT_FLOAT:
+        printf("$%g", constant->opt.f);
+        break;
+    }
+}
+
+// temporaries have no name, only their id
+static void print_symbol(const jac_ir_symbol *symbol)
 {
-    printf("%*s", indent, " ");
-    va_list args;
-    va_start(args, fmt);
-    vprintf(fmt, args);
-    va_end(args);
-    putchar('\n');
+    if (symbol->sym.identifier.kind == JAC_TOKEN_EOF)
+        printf("%%%lu", symbol->id);
+    else
+        printf("%%" JAC_TOKEN_FMT, JAC_TOKEN_ARG(&symbol->sym.identifier));
 }
 
-static void print_block(const jac_ir_block *block, int indent)
+static void print_value(const jac_ir_unit *unit, const jac_ir_value *value, const jac_interner *interner)
+{
+    if (value->holds == JAC_IR_VALUE_LITERAL)
+        print_literal(unit, &value->opt.literal, interner);
+    else if (value->holds == JAC_IR_VALUE_UNDEF)
+        printf("undef");
+    else
+        print_symbol(&value->opt.variable);
+}
+
+static const char *op_names[] = {
+    [JAC_IR_RET] = "ret",   [JAC_IR_CALL] = "call", [JAC_IR_ADDR] = "addr",     [JAC_IR_STORE] = "store",
+    [JAC_IR_LOAD] = "load", [JAC_IR_JUMP] = "jump", [JAC_IR_BRANCH] = "branch", [JAC_IR_PHI] = "phi",
+    [JAC_IR_ADD] = "add",   [JAC_IR_SUB] = "sub",   [JAC_IR_MUL] = "mul",       [JAC_IR_DIV] = "div",
+    [JAC_IR_AND] = "and",   [JAC_IR_OR] = "or",     [JAC_IR_EQ] = "eq",         [JAC_IR_NE] = "ne",
+    [JAC_IR_LT] = "lt",     [JAC_IR_LE] = "le",     [JAC_IR_GT] = "gt",         [JAC_IR_GE] = "ge",
+    [JAC_IR_NEG] = "neg",   [JAC_IR_NOT] = "not",
+};
+
+static void print_operands(const jac_ir_unit *unit, const jac_ir_instruction *instruction,
+                           const jac_interner *interner)
+{
+    darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+    {
+        if (operand != darray_small_data(instruction->operands))
+            printf(", ");
+        print_value(unit, operand, interner);
+    }
+}
+
+static void print_block(const jac_ir_unit *unit, const jac_ir_function *function, const jac_ir_block *block,
+                        const jac_interner *interner, jac_memory_arena *arena, int indent)
 {
     printf(".L%lu0\n", block->id);
 
     darray_foreach(block->instructions, jac_ir_instruction, instruction)
     {
+        printf("%*s", indent, " ");
+        if (jac_ir_has_result(instruction->op))
+        {
+            print_symbol(&instruction->result);
+            printf(" = ");
+        }
+        printf("%s", op_names[instruction->op]);
+
         switch (instruction->op)
         {
         case JAC_IR_RET:
-            indented_v(indent, "ret $%s", instruction->operands[0].opt.literal.value->value);
+            if (darray_small_count(instruction->operands) > 0)
+                putchar(' ');
+            print_operands(unit, instruction, interner);
+            break;
+
+        case JAC_IR_CALL:
+            printf(" %s(", jac_mangle_function_name(arena, &unit->functions[instruction->callee].header));
+            print_operands(unit, instruction, interner);
+            putchar(')');
+            break;
+
+        // stack slots are named after their variables
+        case JAC_IR_ADDR:
+        case JAC_IR_LOAD:
+        case JAC_IR_STORE:
+            printf(" %%" JAC_TOKEN_FMT ".slot%u", JAC_TOKEN_ARG(&function->locals[instruction->local].sym.identifier),
+                   instruction->local);
+            if (instruction->op == JAC_IR_STORE)
+            {
+                printf(", ");
+                print_operands(unit, instruction, interner);
+            }
+            break;
+
+        case JAC_IR_JUMP:
+            printf(" .L%u0", instruction->targets[0]);
+            break;
+
+        case JAC_IR_BRANCH:
+            putchar(' ');
+            print_operands(unit, instruction, interner);
+            printf(", .L%u0, .L%u0", instruction->targets[0], instruction->targets[1]);
+            break;
+
+        case JAC_IR_PHI:
+            for (size_t i = 0; i < darray_small_count(instruction->operands); ++i)
+            {
+                printf("%s[", i ? ", " : " ");
+                print_value(unit, darray_small_data(instruction->operands) + i, interner);
+                printf(", .L%u0]", darray_small_data(block->predecessors)[i]);
+            }
             break;
 
         default:
-            JAC_ASSERT(false, "unreachable.");
+            putchar(' ');
+            print_operands(unit, instruction, interner);
         }
+        putchar('\n');
     }
 
     printf(".L%lu1\n", block->id);
 }
 
-static void print_function(const jac_ir_function *function, int indent)
+static void print_function(const jac_ir_unit *unit, const jac_ir_function *function, const jac_interner *interner,
+                           jac_memory_arena *arena, int indent)
 {
     bool is_declaration = !function->blocks;
     if (is_declaration)
         printf("extern ");
 
     // function->header.identifier->value
-    printf("%s %s: ", function->header.ret_type.token->value, function->header.mangled);
+    printf(JAC_TOKEN_FMT " %s: ", JAC_TOKEN_ARG(&function->header.ret_type.token),
+           jac_mangle_function_name(arena, &function->header));
 
-    if (function->header.args)
+    darray_small_foreach(function->header.args, const jac_symbol, arg)
     {
-        jac_symbol *arg;
-        for (size_t i = 0; i < darray_count(function->header.args) - 1; ++i)
-        {
-            for (size_t j = 0; j < arg->type.indirection; ++j)
-                putchar('*');
-            arg = function->header.args + i;
-            printf("%s %%%s, ", arg->type.token->value, arg->identifier->value);
-        }
-
-        arg = darray_last(function->header.args);
+        if (arg != darray_small_data(function->header.args))
+            printf(", ");
         for (size_t i = 0; i < arg->type.indirection; ++i)
             putchar('*');
-        printf("%s %%%s\n", arg->type.token->value, arg->identifier->value);
+        printf(JAC_TOKEN_FMT " %%" JAC_TOKEN_FMT, JAC_TOKEN_ARG(&arg->type.token), JAC_TOKEN_ARG(&arg->identifier));
     }
+    putchar('\n');
 
     if (is_declaration)
         return;
-    darray_foreach(function->blocks, jac_ir_block, block) print_block(block, indent);
+    darray_foreach(function->blocks, jac_ir_block, block) print_block(unit, function, block, interner, arena, indent);
 }
 
-void jac_print_ir(const jac_ir_unit *unit, int indent)
+void jac_print_ir(const jac_ir_unit *unit, const jac_interner *interner, jac_memory_arena *arena, int indent)
 {
-    darray_foreach(unit->functions, jac_ir_function, function) print_function(function, indent);
+    darray_foreach(unit->functions, jac_ir_function, function)
+        print_function(unit, function, interner, arena, indent);
 }
@@ -1,214 +1,914 @@
 #include "lex.h"
 
-#include <ctype.h>
+#include <float.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
+#include "arena.h"
+#include "assert.h"
 #include "darray.h"
+#include "stats.h"
 
-typedef struct lexer lexer;
+typedef struct keyword keyword;
 
-struct
+struct keyword
 {
     const char *name;
+    size_t length;
     enum jac_token_kind kind;
-} keywords[] = {
-    {"return", JAC_TOKEN_RETURN}, {"func", JAC_TOKEN_FUNC}, {"extern", JAC_TOKEN_EXTERN},
-    {"i32", JAC_TOKEN_INT32},     {"u8", JAC_TOKEN_UINT8},
 };
 
-// NOTE: expects null-termination
-static bool is_keyword(darray_t char *value, enum jac_token_kind *kind)
-{
+/*
+ * Perfect hash over the reserved words, keyed on the first and last character
+ * and the length. Every keyword lands in its own slot, so classifying an
+ * identifier is a single probe and one memcmp. The constants were searched for
+ * offline; re-check that the slots stay unique when adding a keyword, as a
+ * duplicate designator silently overrides the earlier entry.
+ */
+#define KEYWORD_SLOTS 32
+#define KEYWORD_HASH(first, last, length)                                                                              \
+    ((((unsigned)(unsigned char)(first) * 3u) + ((unsigned)(unsigned char)(last) * 13u) + ((unsigned)(length) * 5u)) & \
+     (KEYWORD_SLOTS - 1))
+
+#define KEYWORD(name, first, last, kind) [KEYWORD_HASH(first, last, sizeof(name) - 1)] = {name, sizeof(name) - 1, kind}
+
+static const keyword keywords[KEYWORD_SLOTS] = {
+    KEYWORD("return", 'r', 'n', JAC_TOKEN_RETURN), KEYWORD("extern", 'e', 'n', JAC_TOKEN_EXTERN),
+    KEYWORD("func", 'f', 'c', JAC_TOKEN_FUNC),     KEYWORD("mut", 'm', 't', JAC_TOKEN_MUT),
+    KEYWORD("global", 'g', 'l', JAC_TOKEN_GLOBAL), KEYWORD("local", 'l', 'l', JAC_TOKEN_LOCAL),
+    KEYWORD("if", 'i', 'f', JAC_TOKEN_IF),         KEYWORD("elif", 'e', 'f', JAC_TOKEN_ELIF),
+    KEYWORD("else", 'e', 'e', JAC_TOKEN_ELSE),     KEYWORD("bool", 'b', 'l', JAC_TOKEN_BOOL),
+    KEYWORD("u8", 'u', '8', JAC_TOKEN_UINT8),      KEYWORD("u16", 'u', '6', JAC_TOKEN_UINT16),
+    KEYWORD("u32", 'u', '2', JAC_TOKEN_UINT32),    KEYWORD("u64", 'u', '4', JAC_TOKEN_UINT64),
+    KEYWORD("i8", 'i', '8', JAC_TOKEN_INT8),       KEYWORD("i16", 'i', '6', JAC_TOKEN_INT16),
+    KEYWORD("i32", 'i', '2', JAC_TOKEN_INT32),     KEYWORD("i64", 'i', '4', JAC_TOKEN_INT64),
+    KEYWORD("f32", 'f', '2', JAC_TOKEN_FLOAT32),   KEYWORD("f64", 'f', '4', JAC_TOKEN_FLOAT64),
+};
 
-    for (size_t i = 0; i < (sizeof(keywords) / sizeof(*keywords)); ++i)
-    {
-        const char *key_name = keywords[i].name;
-        enum jac_token_kind key_kind = keywords[i].kind;
+#ifdef JAC_LEX_LINEAR_KEYWORDS
 
-        if (strcmp(key_name, value) == 0)
+// the scan the hash replaced, a strncmp per keyword, for bench/keywords.c to
+// measure against
+static bool is_keyword(const char *value, size_t length, enum jac_token_kind *kind)
+{
+    for (size_t i = 0; i < KEYWORD_SLOTS; ++i)
+    {
+        const keyword *key = keywords + i;
+        if (key->name && (strncmp(key->name, value, length) == 0) && (key->name[length] == '\0'))
         {
-            *kind = key_kind;
+            *kind = key->kind;
             return true;
         }
     }
-
     return false;
 }
 
-struct lexer
+#else
+
+static bool is_keyword(const char *value, size_t length, enum jac_token_kind *kind)
 {
-    const char *source;
-    const char *c;
-    size_t line, column;
-    size_t line_offset;
-};
+    const keyword *key = keywords + KEYWORD_HASH(value[0], value[length - 1], length);
+
+    // empty slots have a length of 0, which never matches an identifier
+    if ((key->length != length) || (memcmp(key->name, value, length) != 0))
+        return false;
+
+    *kind = key->kind;
+    return true;
+}
+
+#endif
+
+/*
+ * LINES
+ */
+
+void jac_locate(const jac_line_table *lines, uint32_t offset, size_t *line, size_t *column)
+{
+    // last line starting at or before 'offset', the first line always starts at 0
+    size_t lo = 0, hi = darray_count(lines->starts);
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lines->starts[mid] <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    *line = lo + 1;
+    *column = (size_t)(offset - lines->starts[lo]) + 1;
+}
+
+static uint32_t offset_of(const jac_lexer *lexer, const char *c)
+{
+    return (uint32_t)(c - lexer->source);
+}
 
-static char consume(lexer *lexer)
+static void push_line(jac_lexer *lexer, const char *line_start)
+{
+    darray_push(lexer->lines.starts, offset_of(lexer, line_start));
+}
+
+static char consume(jac_lexer *lexer)
 {
     if (*lexer->c == '\n')
+        push_line(lexer, lexer->c + 1);
+
+    return *(lexer->c++);
+}
+
+/*
+ * CHARACTER CLASSES
+ */
+
+// locale-independent equivalents of isspace/isdigit/isalnum, matching the
+// vectorized classification byte for byte
+static inline bool is_space(char c)
+{
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+}
+
+static inline bool is_digit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline bool is_alpha(char c)
+{
+    return ((c | 0x20) >= 'a') && ((c | 0x20) <= 'z');
+}
+
+static inline bool is_identifier(char c)
+{
+    return is_alpha(c) || is_digit(c) || (c == '_');
+}
+
+enum scan_class
+{
+    SCAN_DIGIT,
+    SCAN_IDENTIFIER,
+    SCAN_COMMENT, // anything up to a newline or the terminator
+};
+
+static inline bool scan_classify_char(char c, enum scan_class class)
+{
+    switch (class)
     {
-        lexer->line += 1;
-        lexer->line_offset += lexer->column;
-        lexer->column = 1;
+    case SCAN_DIGIT:
+        return is_digit(c);
+    case SCAN_IDENTIFIER:
+        return is_identifier(c);
+    case SCAN_COMMENT:
+        return (c != '\n') && (c != '\0');
     }
-    else
+
+    return false;
+}
+
+/*
+ * Bulk scanning. Blocks are loaded from aligned addresses only, so a load
+ * never crosses into the page after the null-terminator, and bytes before the
+ * scan start are masked in. The terminator is never part of a class, so every
+ * scan stops at the end of the source. Define JAC_LEX_SCALAR to force the
+ * byte-at-a-time fallback, which must produce an identical token stream.
+ */
+
+#if !defined(JAC_LEX_SCALAR) && !defined(__SANITIZE_ADDRESS__) && (defined(__AVX2__) || defined(__SSE2__))
+#define JAC_LEX_SIMD
+#include <immintrin.h>
+#include <stdint.h>
+
+typedef uint32_t scan_mask;
+
+#if defined(__AVX2__)
+#define SCAN_WIDTH 32
+#define SCAN_FULL  ((scan_mask)0xffffffffu)
+
+typedef __m256i scan_vector;
+
+static inline scan_vector scan_load(const char *block)
+{
+    return _mm256_load_si256((const __m256i *)block);
+}
+
+static inline scan_mask scan_eq(scan_vector v, char c)
+{
+    return (scan_mask)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+
+// signed compares: bytes >= 0x80 are negative, and fall outside every range
+static inline scan_mask scan_range(scan_vector v, char lo, char hi)
+{
+    __m256i above = _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)(lo - 1)));
+    __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), v);
+    return (scan_mask)_mm256_movemask_epi8(_mm256_and_si256(above, below));
+}
+
+static inline scan_vector scan_fold_case(scan_vector v)
+{
+    return _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+}
+#else
+#define SCAN_WIDTH 16
+#define SCAN_FULL  ((scan_mask)0xffffu)
+
+typedef __m128i scan_vector;
+
+static inline scan_vector scan_load(const char *block)
+{
+    return _mm_load_si128((const __m128i *)block);
+}
+
+static inline scan_mask scan_eq(scan_vector v, char c)
+{
+    return (scan_mask)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+
+static inline scan_mask scan_range(scan_vector v, char lo, char hi)
+{
+    __m128i above = _mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1)));
+    __m128i below = _mm_cmpgt_epi8(_mm_set1_epi8((char)(hi + 1)), v);
+    return (scan_mask)_mm_movemask_epi8(_mm_and_si128(above, below));
+}
+
+static inline scan_vector scan_fold_case(scan_vector v)
+{
+    return _mm_or_si128(v, _mm_set1_epi8(0x20));
+}
+#endif
+
+static inline scan_mask scan_space(scan_vector v)
+{
+    return scan_range(v, '\t', '\r') | scan_eq(v, ' ');
+}
+
+static inline scan_mask scan_classify(scan_vector v, enum scan_class class)
+{
+    switch (class)
     {
-        lexer->column += 1;
+    case SCAN_DIGIT:
+        return scan_range(v, '0', '9');
+    case SCAN_IDENTIFIER:
+        return scan_range(scan_fold_case(v), 'a', 'z') | scan_range(v, '0', '9') | scan_eq(v, '_');
+    case SCAN_COMMENT:
+        return ~(scan_eq(v, '\n') | scan_eq(v, '\0')) & SCAN_FULL;
     }
 
-    return *(lexer->c++);
+    return 0;
 }
 
-static jac_token new_token(darray_t char *value, enum jac_token_kind kind, size_t column, const lexer *lexer)
+// bits set for the bytes of the block that precede 'c'
+static inline scan_mask scan_head(const char *c)
 {
-    return (jac_token){.diagnostics = (jac_token_diagnostics){.source_line = lexer->source + lexer->line_offset,
-                                                              .length = strlen(value),
-                                                              .line = lexer->line,
-                                                              .column = column},
-                       .value = value,
-                       .kind = kind};
+    return ((scan_mask)1 << ((uintptr_t)c % SCAN_WIDTH)) - 1;
 }
 
-static jac_token new_token_from_char(char value, size_t column, const lexer *lexer)
+static inline const char *scan_block(const char *c)
 {
-    char *token_value = darray_new(char);
-    darray_push(token_value, value);
-    darray_push(token_value, '\0');
-    return new_token(token_value, (enum jac_token_kind)value, column, lexer);
+    return c - ((uintptr_t)c % SCAN_WIDTH);
 }
 
-darray_t jac_token *jac_tokenize(const char *source)
+// first character at or after 'c' outside 'class'
+static inline const char *skip_class(const char *c, enum scan_class class)
 {
+    // most runs are short, so probe a couple of bytes before going wide
+    if (!scan_classify_char(c[0], class))
+        return c;
+    if (!scan_classify_char(c[1], class))
+        return c + 1;
+
+    const char *block = scan_block(c);
+    scan_mask mask = scan_classify(scan_load(block), class) | scan_head(c);
+
+    while (mask == SCAN_FULL)
+    {
+        block += SCAN_WIDTH;
+        mask = scan_classify(scan_load(block), class);
+    }
 
-    jac_token *tokens = darray_new(jac_token);
-    lexer lexer = {.source = source, .c = source, .line = 1, .column = 1, .line_offset = 0};
-    size_t column = 1;
-    bool invalid = false;
+    return block + __builtin_ctz(~mask);
+}
 
-    for (; *lexer.c != '\0'; consume(&lexer), column = lexer.column)
+static void skip_whitespace(jac_lexer *lexer)
+{
+    // a single separating space is by far the most common run
+    if (!is_space(lexer->c[0]))
+        return;
+    if ((lexer->c[0] == ' ') && !is_space(lexer->c[1]))
     {
+        lexer->c += 1;
+        return;
+    }
 
-        if (isspace(*lexer.c))
+    const char *block = scan_block(lexer->c);
+    scan_mask head = scan_head(lexer->c);
+
+    for (;;)
+    {
+        scan_vector v = scan_load(block);
+        scan_mask stop = ~(scan_space(v) | head) & SCAN_FULL;
+        scan_mask newlines = scan_eq(v, '\n') & ~head;
+
+        // only newlines before the first non-whitespace byte count
+        if (stop)
+            newlines &= (stop & -stop) - 1;
+
+        for (; newlines; newlines &= newlines - 1)
+            push_line(lexer, block + __builtin_ctz(newlines) + 1);
+
+        if (stop)
         {
+            lexer->c = block + __builtin_ctz(stop);
+            return;
+        }
+
+        block += SCAN_WIDTH;
+        head = 0;
+    }
+}
+#else
+static inline const char *skip_class(const char *c, enum scan_class class)
+{
+    while (scan_classify_char(*c, class))
+        ++c;
+    return c;
+}
+
+static void skip_whitespace(jac_lexer *lexer)
+{
+    while (is_space(*lexer->c))
+        consume(lexer);
+}
+#endif
+
+static void skip_trivia(jac_lexer *lexer)
+{
+    for (;;)
+    {
+        skip_whitespace(lexer);
+        if ((lexer->c[0] != '-') || (lexer->c[1] != '-'))
+            return;
+        lexer->c = skip_class(lexer->c + 2, SCAN_COMMENT);
+    }
+}
+
+static jac_token new_token(const char *value, size_t length, enum jac_token_kind kind, const jac_lexer *lexer)
+{
+    return (jac_token){
+        .value = value,
+        .offset = offset_of(lexer, value),
+        .length = (uint32_t)length,
+        .kind = kind,
+        .id = JAC_INTERN_NONE,
+    };
+}
+
+static jac_token new_interned_token(const char *value, size_t length, enum jac_token_kind kind, jac_lexer *lexer)
+{
+    jac_token token = new_token(value, length, kind, lexer);
+    token.id = jac_intern(lexer->interner, value, length, jac_hash_string(value, length));
+    return token;
+}
+
+// flags the source as invalid, and unless quiet, prints the error with the
+// position of 'c'
+static void report(jac_lexer *lexer, const char *c, const char *fmt, ...)
+{
+    lexer->invalid = true;
+    if (lexer->quiet)
+        return;
+
+    size_t line, column;
+    jac_locate(&lexer->lines, offset_of(lexer, c), &line, &column);
+
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "error: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, " at [%lu, %lu]\n", line, column);
+    va_end(args);
+}
+
+/*
+ * NUMERIC LITERALS
+ */
+
+// longest literal body accepted, separators excluded
+#define NUMBER_DIGITS_MAX 128
+
+static enum jac_type_kind suffix_type(enum jac_token_kind kind)
+{
+    switch (kind)
+    {
+    case JAC_TOKEN_UINT8:
+        return JAC_TYPE_UINT8;
+    case JAC_TOKEN_UINT16:
+        return JAC_TYPE_UINT16;
+    case JAC_TOKEN_UINT32:
+        return JAC_TYPE_UINT32;
+    case JAC_TOKEN_UINT64:
+        return JAC_TYPE_UINT64;
+    case JAC_TOKEN_INT8:
+        return JAC_TYPE_INT8;
+    case JAC_TOKEN_INT16:
+        return JAC_TYPE_INT16;
+    case JAC_TOKEN_INT32:
+        return JAC_TYPE_INT32;
+    case JAC_TOKEN_INT64:
+        return JAC_TYPE_INT64;
+    case JAC_TOKEN_FLOAT32:
+        return JAC_TYPE_FLOAT32;
+    case JAC_TOKEN_FLOAT64:
+        return JAC_TYPE_FLOAT64;
+
+    default:
+        return JAC_TYPE_NONE;
+    }
+}
+
+// 0 for the non-integer types
+static unsigned integer_width(enum jac_type_kind type)
+{
+    switch (type)
+    {
+    case JAC_TYPE_INT8:
+    case JAC_TYPE_UINT8:
+        return 8;
+    case JAC_TYPE_INT16:
+    case JAC_TYPE_UINT16:
+        return 16;
+    case JAC_TYPE_INT32:
+    case JAC_TYPE_UINT32:
+        return 32;
+    case JAC_TYPE_INT64:
+    case JAC_TYPE_UINT64:
+        return 64;
+
+    default:
+        return 0;
+    }
+}
+
+static bool is_signed(enum jac_type_kind type)
+{
+    return (type == JAC_TYPE_INT8) || (type == JAC_TYPE_INT16) || (type == JAC_TYPE_INT32) || (type == JAC_TYPE_INT64);
+}
+
+/*
+ * Decodes the numeric literal at the lexer position into 'constant', and
+ * moves past it. A body is digits with '_' separators and an optional
+ * fraction, where anything from a second decimal point on is ignored. An
+ * optional suffix names the type, and decides how the body is interpreted,
+ * so 0.32u8 is a u8 of 0. Literals without a suffix are left untyped, and
+ * hold an i64, or a u64 when too large, and an f64 with a fraction, until the
+ * checker converts them to the type of their use. Returns NULL, or what is
+ * wrong with the literal.
+ */
+static const char *decode_number(jac_lexer *lexer, jac_constant *constant)
+{
+    const char *c = lexer->c;
+    bool negative = (*c == '-');
+    if (negative)
+        ++c;
+
+    char digits[NUMBER_DIGITS_MAX + 1];
+    size_t length = 0;
+    uint64_t magnitude = 0;
+    bool overflow = false;
+    bool fractional = false;
+
+    for (;; ++c)
+    {
+        if (*c == '_')
             continue;
+
+        if ((*c == '.') && !fractional && is_digit(c[1]))
+            fractional = true;
+        else if (!is_digit(*c))
+            break;
+        else if (!fractional)
+        {
+            unsigned digit = (unsigned)(*c - '0');
+            overflow |= magnitude > (UINT64_MAX - digit) / 10;
+            magnitude = (magnitude * 10) + digit;
         }
 
-        else if (lexer.c[0] == '-' && lexer.c[1] == '-')
+        if (length == NUMBER_DIGITS_MAX)
+            return "numeric literal too long";
+        digits[length++] = *c;
+    }
+    digits[length] = '\0';
+
+    while ((*c == '.') && is_digit(c[1]))
+        c = skip_class(c + 1, SCAN_DIGIT);
+
+    enum jac_type_kind type = JAC_TYPE_NONE;
+    if (is_alpha(*c))
+    {
+        const char *suffix = c;
+        c = skip_class(c, SCAN_IDENTIFIER);
+
+        enum jac_token_kind kind;
+        if (is_keyword(suffix, c - suffix, &kind))
+            type = suffix_type(kind);
+        if (type == JAC_TYPE_NONE)
         {
-            while (*lexer.c != '\n')
-                consume(&lexer);
+            lexer->c = c;
+            return "invalid numeric literal suffix";
         }
+    }
+    lexer->c = c;
+
+    *constant = (jac_constant){.type = type};
+
+    if ((type == JAC_TYPE_FLOAT32) || (type == JAC_TYPE_FLOAT64) || ((type == JAC_TYPE_NONE) && fractional))
+    {
+        double value = strtod(digits, NULL);
+        if ((value > DBL_MAX) || ((type == JAC_TYPE_FLOAT32) && (value > FLT_MAX)))
+            return "numeric literal out of range";
+        if (type == JAC_TYPE_FLOAT32)
+            value = (float)value;
+
+        constant->holds = JAC_CONSTANT_FLOAT;
+        constant->opt.f = negative ? -value : value;
+        return NULL;
+    }
 
-        else if (isalpha(*lexer.c) || (*lexer.c == '_'))
+    // integers truncate a fractional body
+    if (fractional)
+    {
+        double value = strtod(digits, NULL);
+        overflow = value >= 18446744073709551616.0;
+        magnitude = overflow ? 0 : (uint64_t)value;
+    }
+
+    if (overflow)
+        return "numeric literal out of range";
+
+    if (type == JAC_TYPE_NONE)
+        type = (!negative && (magnitude > INT64_MAX)) ? JAC_TYPE_UINT64 : JAC_TYPE_INT64;
+
+    unsigned width = integer_width(type);
+    if (is_signed(type))
+    {
+        uint64_t limit = (uint64_t)1 << (width - 1);
+        if (magnitude > (negative ? limit : limit - 1))
+            return "numeric literal out of range";
+
+        constant->holds = JAC_CONSTANT_INT;
+        // negated in two steps, as the magnitude of the minimum does not fit
+        constant->opt.i = (negative && magnitude) ? -(int64_t)(magnitude - 1) - 1 : (int64_t)magnitude;
+        return NULL;
+    }
+
+    uint64_t limit = (width == 64) ? UINT64_MAX : ((uint64_t)1 << width) - 1;
+    if (negative && (magnitude != 0))
+        return "negative numeric literal of an unsigned type";
+    if (magnitude > limit)
+        return "numeric literal out of range";
+
+    constant->holds = JAC_CONSTANT_UINT;
+    constant->opt.u = magnitude;
+    return NULL;
+}
+
+static int decode_escape(char c)
+{
+    switch (c)
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case 'b':
+        return '\b';
+    case 'f':
+        return '\f';
+    case 'v':
+        return '\v';
+    case '0':
+        return '\0';
+    case '\\':
+        return '\\';
+    case '"':
+        return '"';
+
+    default:
+        return -1;
+    }
+}
+
+static jac_token lex_token(jac_lexer *lexer)
+{
+    for (;;)
+    {
+        skip_trivia(lexer);
+
+        const char *start = lexer->c;
+
+        if (*start == '\0')
+            return new_token(start, 0, JAC_TOKEN_EOF, lexer);
+
+        else if (is_alpha(*start) || (*start == '_'))
         {
-            char *value = darray_new(char);
-            darray_push(value, *lexer.c);
+            lexer->c = skip_class(start + 1, SCAN_IDENTIFIER);
+
+            size_t length = lexer->c - start;
+            enum jac_token_kind keyword_kind;
+            if (is_keyword(start, length, &keyword_kind))
+                return new_token(start, length, keyword_kind, lexer);
+            return new_interned_token(start, length, JAC_TOKEN_IDENTIFIER, lexer);
+        }
 
-            while (isalnum(lexer.c[1]) || (lexer.c[1] == '_'))
+        else if (is_digit(*start) || ((*start == '-') && is_digit(start[1])))
+        {
+            jac_constant constant;
+            const char *error = decode_number(lexer, &constant);
+            if (error)
             {
-                consume(&lexer);
-                darray_push(value, *lexer.c);
+                report(lexer, start, "%s '%.*s'", error, (int)(lexer->c - start), start);
+                continue;
             }
-            darray_push(value, '\0');
 
-            enum jac_token_kind keyword_kind;
-            if (is_keyword(value, &keyword_kind))
-                darray_push(tokens, new_token(value, keyword_kind, column, &lexer));
-            else
-                darray_push(tokens, new_token(value, JAC_TOKEN_IDENTIFIER, column, &lexer));
+            jac_token token = new_token(start, lexer->c - start, JAC_TOKEN_NUM_LITERAL, lexer);
+            token.constant = constant;
+            return token;
         }
 
-        else if (isdigit(*lexer.c) || ((*lexer.c == '-') && isdigit(lexer.c[1])))
+        else if (*start == '"')
         {
-            char *value = darray_new(char);
-            darray_push(value, *lexer.c);
+            consume(lexer);
 
-            while (isdigit(lexer.c[1]))
+            start = lexer->c;
+            bool escaped = false;
+            while ((*lexer->c != '"') && (*lexer->c != '\0'))
             {
-                consume(&lexer);
-                darray_push(value, *lexer.c);
+                if (*lexer->c == '\\')
+                {
+                    escaped = true;
+                    if (lexer->c[1] != '\0')
+                        consume(lexer);
+                }
+                consume(lexer);
             }
-            darray_push(value, '\0');
-            darray_push(tokens, new_token(value, JAC_TOKEN_INT_LITERAL, column, &lexer));
-        }
 
-        else if (*lexer.c == '"')
-        {
-            consume(&lexer);
-            column += 1;
-            char *value = darray_new(char);
+            if (*lexer->c == '\0')
+            {
+                report(lexer, start, "unterminated string literal");
+                continue;
+            }
+
+            const char *end = lexer->c;
+            consume(lexer);
 
-            while (*lexer.c != '"')
+            if (!escaped)
+                return new_interned_token(start, end - start, JAC_TOKEN_STR_LITERAL, lexer);
+
+            // only escaped literals need storage of their own, as the decoded
+            // value never fits the source slice. the token keeps the offset of
+            // the slice for diagnostics
+            char *value = jac_arena_alloc_impl(lexer->strings, end - start);
+            size_t length = 0;
+            for (const char *c = start; c != end; ++c)
             {
-                char c = consume(&lexer);
-                if (c != '\\')
+                if (*c != '\\')
                 {
-                    darray_push(value, c);
+                    value[length++] = *c;
                     continue;
                 }
 
-                c = consume(&lexer);
-                switch (c)
+                int decoded = decode_escape(*(++c));
+                if (decoded == -1)
                 {
-                case 'n':
-                    darray_push(value, '\n');
-                    break;
-                case 't':
-                    darray_push(value, '\t');
-                    break;
-                case 'r':
-                    darray_push(value, '\r');
-                    break;
-                case 'b':
-                    darray_push(value, '\b');
-                    break;
-                case 'f':
-                    darray_push(value, '\f');
-                    break;
-                case 'v':
-                    darray_push(value, '\v');
-                    break;
-                case '0':
-                    darray_push(value, '\0');
-                    break;
-
-                default:
-                    fprintf(stderr, "error: unrecognized character '%c' at [%lu, %lu]\n", *lexer.c, lexer.line, column);
-                    invalid = true;
+                    report(lexer, start, "unrecognized escape sequence '\\%c'", *c);
                 }
+                value[length++] = (char)decoded;
             }
 
-            darray_push(value, '\0');
-            darray_push(tokens, new_token(value, JAC_TOKEN_STR_LITERAL, column, &lexer));
+            jac_token token = new_token(start, length, JAC_TOKEN_STR_LITERAL, lexer);
+            token.value = value;
+            token.id = jac_intern(lexer->interner, value, length, jac_hash_string(value, length));
+            return token;
         }
 
-        else if (strchr(";:,{}()*->&=", *lexer.c))
+        else if (strchr(";:,{}()*->&=#", *start))
         {
-            darray_push(tokens, new_token_from_char(*lexer.c, column, &lexer));
+            consume(lexer);
+            return new_token(start, 1, (enum jac_token_kind)(*start), lexer);
         }
 
-        else
+        report(lexer, start, "unrecognized character '%c'", *start);
+        consume(lexer);
+    }
+}
+
+void jac_init_lexer(jac_lexer *lexer, const char *source, jac_memory_arena *strings, jac_interner *interner)
+{
+    size_t length = strlen(source);
+    JAC_ASSERT(length < UINT32_MAX, "source too large, token offsets are 32-bit.");
+
+    *lexer = (jac_lexer){
+        .source = source,
+        .c = source,
+        .lines = {.source = source, .starts = darray_new(uint32_t)},
+        .strings = strings,
+        .interner = interner,
+        .head = 0,
+        .count = 0,
+        .invalid = false,
+    };
+    darray_push(lexer->lines.starts, 0);
+}
+
+void jac_init_replay_lexer(jac_lexer *lexer, const jac_token_list *tokens, size_t position, jac_interner *interner)
+{
+    JAC_ASSERT(position < darray_count(tokens->kinds), "replay position out of range.");
+
+    *lexer = (jac_lexer){
+        .source = tokens->lines.source,
+        .c = tokens->lines.source,
+        .lines = tokens->lines,
+        .interner = interner,
+        .tokens = tokens,
+        .next = position,
+    };
+}
+
+// the list ends in EOF, which is handed out for good once reached
+static size_t last_token(const jac_lexer *lexer)
+{
+    return darray_count(lexer->tokens->kinds) - 1;
+}
+
+size_t jac_lexer_position(const jac_lexer *lexer)
+{
+    JAC_ASSERT(lexer->tokens, "lexer is not replaying.");
+    size_t position = lexer->next - lexer->count;
+    return (position < last_token(lexer)) ? position : last_token(lexer);
+}
+
+static jac_token replay_token(jac_lexer *lexer)
+{
+    size_t index = (lexer->next < last_token(lexer)) ? lexer->next : last_token(lexer);
+    lexer->next += 1;
+    return jac_get_token(lexer->tokens, index);
+}
+
+const jac_token *jac_peek_token(jac_lexer *lexer, size_t k)
+{
+    JAC_ASSERT(k < JAC_LEXER_LOOKAHEAD, "lookahead out of range.");
+
+    if (lexer->count > k)
+        return lexer->lookahead + ((lexer->head + k) % JAC_LEXER_LOOKAHEAD);
+
+    if (lexer->tokens)
+    {
+        while (lexer->count <= k)
         {
-            fprintf(stderr, "error: unrecognized character '%c' at [%lu, %lu]\n", *lexer.c, lexer.line, column);
-            invalid = true;
+            lexer->lookahead[(lexer->head + lexer->count) % JAC_LEXER_LOOKAHEAD] = replay_token(lexer);
+            lexer->count += 1;
         }
+        return lexer->lookahead + ((lexer->head + k) % JAC_LEXER_LOOKAHEAD);
+    }
+
+    // lexing is driven by the parser, so the phase is switched per token
+    enum jac_phase previous = jac_enter_phase(JAC_PHASE_LEX);
+    while (lexer->count <= k)
+    {
+        lexer->lookahead[(lexer->head + lexer->count) % JAC_LEXER_LOOKAHEAD] = lex_token(lexer);
+        lexer->count += 1;
+    }
+    jac_enter_phase(previous);
+
+    return lexer->lookahead + ((lexer->head + k) % JAC_LEXER_LOOKAHEAD);
+}
+
+jac_token jac_next_token(jac_lexer *lexer)
+{
+    jac_token token = *jac_peek_token(lexer, 0);
+    lexer->head = (lexer->head + 1) % JAC_LEXER_LOOKAHEAD;
+    lexer->count -= 1;
+    return token;
+}
+
+void jac_free_lexer(jac_lexer *lexer)
+{
+    if (!lexer->tokens)
+        darray_free(lexer->lines.starts);
+    lexer->lines.starts = NULL;
+}
+
+void jac_init_tokens(jac_token_list *tokens, const char *source, const jac_interner *interner)
+{
+    *tokens = (jac_token_list){
+        .kinds = darray_new(uint8_t),
+        .offsets = darray_new(uint32_t),
+        .lengths = darray_new(uint32_t),
+        .ids = darray_new(jac_intern_id),
+        .constants = darray_new(jac_constant),
+        .lines = {.source = source, .starts = NULL},
+        .interner = interner,
+    };
+}
+
+uint32_t jac_push_token(jac_token_list *tokens, const jac_token *token)
+{
+    darray_push(tokens->kinds, (uint8_t)token->kind);
+    darray_push(tokens->offsets, token->offset);
+    darray_push(tokens->lengths, token->length);
+    if (token->kind == JAC_TOKEN_NUM_LITERAL)
+    {
+        darray_push(tokens->ids, (jac_intern_id)darray_count(tokens->constants));
+        darray_push(tokens->constants, token->constant);
     }
+    else
+        darray_push(tokens->ids, token->id);
+
+    return (uint32_t)darray_count(tokens->kinds) - 1;
+}
 
-    if (invalid)
+void jac_append_tokens(jac_token_list *tokens, const jac_token_list *from, size_t begin)
+{
+    size_t first = darray_count(tokens->kinds);
+    size_t count = darray_count(from->kinds) - begin;
+    jac_intern_id constant_base = (jac_intern_id)darray_count(tokens->constants);
+
+    darray_append(tokens->kinds, from->kinds + begin, count);
+    darray_append(tokens->offsets, from->offsets + begin, count);
+    darray_append(tokens->lengths, from->lengths + begin, count);
+    darray_append(tokens->ids, from->ids + begin, count);
+    darray_append(tokens->constants, from->constants, darray_count(from->constants));
+
+    for (size_t i = first; i < first + count; ++i)
+    {
+        if (tokens->kinds[i] == JAC_TOKEN_NUM_LITERAL)
+            tokens->ids[i] += constant_base;
+    }
+}
+
+bool jac_tokenize(const char *source, jac_memory_arena *strings, jac_interner *interner, jac_token_list *tokens)
+{
+    jac_lexer lexer;
+    jac_init_lexer(&lexer, source, strings, interner);
+    jac_init_tokens(tokens, source, interner);
+    lexer.quiet = true;
+
+    jac_token token;
+    do
+    {
+        token = jac_next_token(&lexer);
+        jac_push_token(tokens, &token);
+    } while (token.kind != JAC_TOKEN_EOF);
+
+    tokens->lines = lexer.lines;
+    if (lexer.invalid)
     {
         jac_free_tokens(tokens);
-        return NULL;
+        return false;
     }
 
-    darray_push(tokens, new_token_from_char('\0', column, &lexer));
-    return tokens;
+    return true;
 }
 
-void jac_free_tokens(darray_t jac_token *tokens)
+jac_token jac_get_token(const jac_token_list *tokens, size_t index)
 {
-    darray_foreach(tokens, jac_token, token)
+    JAC_ASSERT(index < darray_count(tokens->kinds), "token index out of range.");
+
+    jac_token token = {
+        .value = tokens->lines.source + tokens->offsets[index],
+        .offset = tokens->offsets[index],
+        .length = tokens->lengths[index],
+        .kind = (enum jac_token_kind)tokens->kinds[index],
+        .id = tokens->ids[index],
+    };
+
+    // the decoded value of an escaped literal only lives in the interner
+    if (token.kind == JAC_TOKEN_STR_LITERAL)
+        token.value = jac_interned_value(tokens->interner, token.id);
+    else if (token.kind == JAC_TOKEN_NUM_LITERAL)
     {
-        darray_free(token->value);
+        token.constant = tokens->constants[token.id];
+        token.id = JAC_INTERN_NONE;
     }
-    darray_free(tokens);
+    return token;
+}
+
+void jac_free_tokens(jac_token_list *tokens)
+{
+    // a zeroed list was never filled
+    if (!tokens->kinds)
+        return;
+
+    darray_free(tokens->kinds);
+    darray_free(tokens->offsets);
+    darray_free(tokens->lengths);
+    darray_free(tokens->ids);
+    darray_free(tokens->constants);
+    if (tokens->lines.starts)
+        darray_free(tokens->lines.starts);
+    *tokens = (jac_token_list){0};
 }
@@ -1,79 +1,309 @@
 #include <stdio.h>
-#include <time.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "arena.h"
 #include "ast.h"
+#include "cache.h"
 #include "diagnostics.h"
 #include "ir.h"
 #include "lex.h"
+#include "opt.h"
+#include "source.h"
+#include "ssa.h"
+#include "stats.h"
+#include "thread.h"
+#include "trace.h"
+
+typedef struct jac_options jac_options;
+
+struct jac_options
+{
+    const char *source_path;
+    const char *stats_json_path;
+    const char *trace_path;
+    bool memory_stats;
+    bool pass_stats;
+    bool remarks;
+    bool time_report;
+    bool function_times;
+    unsigned jobs; // parse threads, 0 to lex and parse as one stream
+    bool ast_cache;
+    bool verify_ast_cache; // parse anyway, and compare with the cached unit
+    bool verify_ir;
+};
+
+static bool parse_options(int argc, char *argv[], jac_options *options)
+{
+    *options = (jac_options){0};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--stats") == 0)
+            options->pass_stats = true;
+        else if (strcmp(arg, "--remarks") == 0)
+            options->remarks = jac_remarks_enabled = true;
+        else if (strcmp(arg, "--stats=mem") == 0)
+            options->memory_stats = true;
+        else if (strncmp(arg, "--stats-json=", 13) == 0)
+            options->stats_json_path = arg + 13;
+        else if (strcmp(arg, "-ftime-report") == 0)
+            options->time_report = true;
+        else if (strcmp(arg, "-ftime-report=functions") == 0)
+            options->time_report = options->function_times = true;
+        else if (strncmp(arg, "--trace=", 8) == 0)
+            options->trace_path = arg + 8;
+        else if (strcmp(arg, "--ast-cache") == 0)
+            options->ast_cache = true;
+        else if (strcmp(arg, "--ast-cache=verify") == 0)
+            options->ast_cache = options->verify_ast_cache = true;
+        else if (strcmp(arg, "--verify-ir") == 0)
+            options->verify_ir = true;
+        else if (strcmp(arg, "-j") == 0)
+            options->jobs = jac_hardware_threads();
+        else if ((strncmp(arg, "-j", 2) == 0) && (atoi(arg + 2) > 0))
+            options->jobs = (unsigned)atoi(arg + 2);
+        else if (arg[0] == '-')
+        {
+            fprintf(stderr, "error: unknown option '%s', exiting.\n", arg);
+            return false;
+        }
+        else if (!options->source_path)
+            options->source_path = arg;
+    }
+
+    return true;
+}
+
+static bool report_memory_stats(const jac_options *options, size_t source_bytes, size_t lines)
+{
+    if (options->memory_stats)
+        jac_print_memory_stats(stderr, lines);
+
+    if (!options->stats_json_path)
+        return true;
+
+    FILE *file = fopen(options->stats_json_path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "error: could not open file '%s'.\n", options->stats_json_path);
+        return false;
+    }
+
+    jac_write_memory_stats_json(file, options->source_path, source_bytes, lines);
+    fclose(file);
+    return true;
+}
+
+static bool report_times(const jac_options *options)
+{
+    if (options->time_report)
+        jac_print_time_report(stderr, options->function_times);
+
+    if (!options->trace_path)
+        return true;
+
+    FILE *file = fopen(options->trace_path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "error: could not open file '%s'.\n", options->trace_path);
+        return false;
+    }
+
+    jac_write_trace(file, options->source_path);
+    fclose(file);
+    return true;
+}
+
+// back to the driver, and record the phase as one span
+static void end_phase(enum jac_phase phase, uint64_t start)
+{
+    jac_enter_phase(JAC_PHASE_DRIVER);
+
+    const char *name = jac_phase_name(phase);
+    jac_end_event("phase", phase, name, strlen(name), start);
+}
 
 int main(int argc, char *argv[])
 {
-    clock_t time_start = clock();
+    uint64_t time_start = jac_now();
+
+    jac_options options;
+    if (!parse_options(argc, argv, &options))
+        return 1;
+
+    if ((options.memory_stats || options.stats_json_path) && !jac_enable_memory_stats())
+    {
+        fprintf(stderr, "error: memory statistics need a build with DARRAY_CUSTOM_ALLOC, exiting.\n");
+        return 1;
+    }
+
+    if (options.time_report || options.trace_path)
+        jac_enable_timing(options.function_times || options.trace_path);
 
-    if (argc == 1)
+    if (!options.source_path)
     {
         fprintf(stderr, "jac: no files to compile, exiting.\n");
         return 0;
     }
 
-    const char *source_path = argv[1];
+    const char *source_path = options.source_path;
     printf("jac: compiling %s...\n", source_path);
 
-    char *source = NULL;
+    jac_source source;
+    uint64_t phase_start = jac_begin_event();
+    jac_enter_phase(JAC_PHASE_READ);
+    bool loaded = jac_load_source(source_path, &source);
+    end_phase(JAC_PHASE_READ, phase_start);
+    if (!loaded)
     {
-        FILE *file = fopen(source_path, "r");
-        if (!file)
-        {
-            fprintf(stderr, "error: could not open source file '%s', exiting.\n", source_path);
-            return 1;
-        }
+        fprintf(stderr, "error: could not open source file '%s', exiting.\n", source_path);
+        return 1;
+    }
+
+    // the unit of an unchanged source is read from "<source>.ast", and stands in
+    // for lexing and parsing it
+    char cache_path[FILENAME_MAX];
+    bool use_cache = options.ast_cache && (strcmp(source_path, "-") != 0) &&
+                     ((size_t)snprintf(cache_path, sizeof cache_path, "%s.ast", source_path) < sizeof cache_path);
+
+    jac_ast_cache cache = {0};
+    jac_ast_unit unit;
+    jac_interner interner;
+    bool cached = false;
+    if (use_cache)
+    {
+        phase_start = jac_begin_event();
+        jac_enter_phase(JAC_PHASE_READ);
+        cached = jac_load_ast_cache(cache_path, &source, &cache, &unit, &interner);
+        end_phase(JAC_PHASE_READ, phase_start);
+    }
 
-        fseek(file, 0, SEEK_END);
-        size_t length = ftell(file) + 1;
-        rewind(file);
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    if (!cached)
+        jac_init_interner(&interner);
 
-        source = malloc(length * sizeof(char));
-        fread((void *)source, sizeof(char), length, file);
-        fclose(file);
+    // the parse workers need all of the tokens up front. an invalid source is
+    // lexed again as a stream, which reports the errors in their usual order
+    jac_token_list tokens = {0};
+    bool lexed = false;
+    if (options.jobs && !cached)
+    {
+        phase_start = jac_begin_event();
+        jac_enter_phase(JAC_PHASE_LEX);
+        lexed = jac_tokenize(source.text, &strings, &interner, &tokens);
+        end_phase(JAC_PHASE_LEX, phase_start);
     }
 
-    jac_token *tokens = jac_tokenize(source);
-    if (!tokens)
+    jac_lexer lexer;
+    if (cached)
+        jac_init_replay_lexer(&lexer, &unit.tokens, 0, &interner);
+    else if (lexed)
+        jac_init_replay_lexer(&lexer, &tokens, 0, &interner);
+    else
+        jac_init_lexer(&lexer, source.text, &strings, &interner);
+
+    bool parsed = true;
+    phase_start = jac_begin_event();
+    jac_enter_phase(JAC_PHASE_PARSE);
+    if (cached && options.verify_ast_cache)
+    {
+        parsed = jac_verify_ast_cache(&source, &unit, stderr);
+        if (!parsed)
+            fprintf(stderr, "error: AST cache '%s' differs from a fresh parse.\n", cache_path);
+    }
+    else if (!cached)
+        parsed = lexed ? jac_parse_unit_parallel(&lexer, options.jobs, &unit) : jac_parse_unit(&lexer, &unit);
+    end_phase(JAC_PHASE_PARSE, phase_start);
+    if (!parsed)
     {
-        free((void *)source);
+        jac_free_unit(&unit);
+        jac_free_lexer(&lexer);
+        jac_free_tokens(&tokens);
+        jac_free_interner(&interner);
+        jac_close_ast_cache(&cache);
+        jac_free_arena(&strings);
+        jac_free_source(&source);
         return 1;
     }
 
-    jac_memory_arena arena = {.memory = darray_new_reserved(char, 1024 * 2)};
-    jac_ast_unit unit;
-    if (!jac_parse_unit(&arena, tokens, &unit))
+    if (lexer.invalid)
     {
-        jac_free_arena(&arena);
-        jac_free_tokens(tokens);
-        free((void *)source);
+        jac_free_unit(&unit);
+        jac_free_lexer(&lexer);
+        jac_free_tokens(&tokens);
+        jac_free_interner(&interner);
+        jac_close_ast_cache(&cache);
+        jac_free_arena(&strings);
+        jac_free_source(&source);
         return 1;
     }
 
-    // jac_print_unit(unit, 3);
+    if (use_cache && !cached)
+    {
+        phase_start = jac_begin_event();
+        jac_enter_phase(JAC_PHASE_WRITE);
+        if (!jac_write_ast_cache(cache_path, &source, &unit, &lexer.lines))
+            fprintf(stderr, "warning: could not write AST cache '%s'.\n", cache_path);
+        end_phase(JAC_PHASE_WRITE, phase_start);
+    }
+
+    // jac_print_unit(&unit, 3);
 
+    jac_memory_arena ir_arena;
+    jac_init_arena(&ir_arena);
     jac_ir_unit ir;
-    if (!jac_check_unit(unit, &ir))
+    phase_start = jac_begin_event();
+    jac_enter_phase(JAC_PHASE_CHECK);
+    bool checked = jac_check_unit(&unit, &lexer.lines, &ir_arena, &ir);
+    end_phase(JAC_PHASE_CHECK, phase_start);
+    if (!checked)
+    {
+        jac_free_arena(&ir_arena);
+        jac_free_unit(&unit);
+        jac_free_lexer(&lexer);
+        jac_free_tokens(&tokens);
+        jac_free_interner(&interner);
+        jac_close_ast_cache(&cache);
+        jac_free_arena(&strings);
+        jac_free_source(&source);
+        return 1;
+    }
+
+    phase_start = jac_begin_event();
+    jac_enter_phase(JAC_PHASE_OPT);
+    jac_construct_ssa(&ir, &ir_arena);
+    jac_optimize_unit(&ir, &ir_arena);
+    bool verified = !options.verify_ir || jac_verify_unit(&ir, stderr);
+    end_phase(JAC_PHASE_OPT, phase_start);
+    if (!verified)
     {
-        jac_free_arena(&arena);
-        jac_free_tokens(tokens);
-        free((void *)source);
+        fprintf(stderr, "error: invalid IR, exiting.\n");
+        jac_free_arena(&ir_arena);
+        jac_free_unit(&unit);
+        jac_free_lexer(&lexer);
+        jac_free_tokens(&tokens);
+        jac_free_interner(&interner);
+        jac_close_ast_cache(&cache);
+        jac_free_arena(&strings);
+        jac_free_source(&source);
         return 1;
     }
 
-    jac_print_ir(&ir, 3);
+    jac_print_ir(&ir, &interner, &ir_arena, 3);
 
     // darray_t char* asm_source = NULL;
     // if (!jac_generate_unit(&unit, &asm_source)) {
+    //     jac_free_arena(&ir_arena);
     //     jac_free_unit(&unit);
-    //     jac_free_arena(&arena);
-    //     jac_free_tokens(tokens);
-    //     free((void*)source);
+    //     jac_free_lexer(&lexer);
+    //     jac_free_tokens(&tokens);
+    //     jac_free_interner(&interner);
+    //     jac_free_arena(&strings);
+    //     jac_free_source(&source);
     //     return 1;
     // }
 
@@ -91,10 +321,13 @@ int main(int argc, char *argv[])
     //     FILE* file = fopen(full_path, "w");
     //     if (!file) {
     //         darray_free(asm_source);
+    //         jac_free_arena(&ir_arena);
     //         jac_free_unit(&unit);
-    //         jac_free_arena(&arena);
-    //         jac_free_tokens(tokens);
-    //         free((void*)source);
+    //         jac_free_lexer(&lexer);
+    //         jac_free_tokens(&tokens);
+    //         jac_free_interner(&interner);
+    //         jac_free_arena(&strings);
+    //         jac_free_source(&source);
 
     //         fprintf(stderr, "error: could not open file '%s'.\n", full_path);
     //         return 1;
@@ -105,11 +338,27 @@ int main(int argc, char *argv[])
     // }
 
     // darray_free(asm_source);
-    jac_free_unit(unit);
-    jac_free_arena(&arena);
-    jac_free_tokens(tokens);
-    free((void *)source);
+    size_t lines = darray_count(lexer.lines.starts);
+    jac_free_arena(&ir_arena);
+    jac_free_unit(&unit);
+    jac_free_lexer(&lexer);
+    jac_free_tokens(&tokens);
+    jac_free_interner(&interner);
+    jac_close_ast_cache(&cache);
+    jac_free_arena(&strings);
+    jac_free_source(&source);
+
+    printf("jac: compilation finished in %.4fs (%lu bytes %s).\n", (double)(jac_now() - time_start) / 1e9,
+           source.length, jac_source_is_mapped(&source) ? "mapped" : "read");
 
-    printf("jac: compilation finished in %.4fs.\n", (double)(clock() - time_start) / CLOCKS_PER_SEC);
+    if (options.remarks)
+        jac_print_remarks(stderr);
+    if (options.pass_stats)
+        jac_print_pass_stats(stderr);
+
+    bool reported = report_times(&options);
+    jac_free_trace();
+    if (!report_memory_stats(&options, source.length, lines) || !reported)
+        return 1;
     return 0;
 }
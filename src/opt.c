@@ -0,0 +1,1401 @@
+#include "opt.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "arena.h"
+#include "assert.h"
+#include "darray.h"
+#include "ir.h"
+#include "ssa.h"
+#include "stats.h"
+#include "trace.h"
+
+/*
+ * FOLDING
+ */
+
+static const uint8_t widths[] = {
+    [JAC_TYPE_BOOL] = 1,    [JAC_TYPE_INT8] = 8,    [JAC_TYPE_UINT8] = 8,  [JAC_TYPE_INT16] = 16,
+    [JAC_TYPE_UINT16] = 16, [JAC_TYPE_INT32] = 32,  [JAC_TYPE_UINT32] = 32, [JAC_TYPE_INT64] = 64,
+    [JAC_TYPE_UINT64] = 64,
+};
+
+static bool is_integer(enum jac_type_kind kind)
+{
+    return (kind >= JAC_TYPE_BOOL) && (kind <= JAC_TYPE_UINT64);
+}
+
+static bool is_signed(enum jac_type_kind kind)
+{
+    return (kind == JAC_TYPE_INT8) || (kind == JAC_TYPE_INT16) || (kind == JAC_TYPE_INT32) || (kind == JAC_TYPE_INT64);
+}
+
+static bool is_float(enum jac_type_kind kind)
+{
+    return (kind == JAC_TYPE_FLOAT32) || (kind == JAC_TYPE_FLOAT64);
+}
+
+// the low bits of 'bits' that fit 'kind', sign extended for the signed kinds
+static jac_constant make_integer(enum jac_type_kind kind, uint64_t bits)
+{
+    unsigned width = widths[kind];
+    if (width < 64)
+    {
+        uint64_t mask = (UINT64_C(1) << width) - 1;
+        bits &= mask;
+        if (is_signed(kind) && ((bits >> (width - 1)) & 1))
+            bits |= ~mask;
+    }
+
+    jac_constant constant = {.holds = is_signed(kind) ? JAC_CONSTANT_INT : JAC_CONSTANT_UINT, .type = kind};
+    constant.opt.u = bits;
+    return constant;
+}
+
+static jac_constant make_float(enum jac_type_kind kind, double value)
+{
+    jac_constant constant = {.holds = JAC_CONSTANT_FLOAT, .type = kind};
+    constant.opt.f = (kind == JAC_TYPE_FLOAT32) ? (double)(float)value : value;
+    return constant;
+}
+
+static jac_constant make_bool(bool value)
+{
+    return make_integer(JAC_TYPE_BOOL, value);
+}
+
+bool jac_convert_constant(const jac_constant *constant, enum jac_type_kind kind, jac_constant *result)
+{
+    if (is_float(kind))
+    {
+        double value = (constant->holds == JAC_CONSTANT_FLOAT) ? constant->opt.f
+                       : (constant->holds == JAC_CONSTANT_INT) ? (double)constant->opt.i
+                                                               : (double)constant->opt.u;
+        *result = make_float(kind, value);
+        return true;
+    }
+
+    if (!is_integer(kind))
+        return false;
+
+    uint64_t bits = constant->opt.u;
+    if (constant->holds == JAC_CONSTANT_FLOAT)
+    {
+        // NaN fails both tests
+        double value = constant->opt.f;
+        if (!((value >= -9223372036854775808.0) && (value < 18446744073709551616.0)))
+            return false;
+        bits = (value < 0) ? (uint64_t)(int64_t)value : (uint64_t)value;
+        if (kind == JAC_TYPE_BOOL)
+            bits = (value != 0);
+    }
+    else if (kind == JAC_TYPE_BOOL)
+        bits = (bits != 0);
+
+    *result = make_integer(kind, bits);
+    return true;
+}
+
+bool jac_constant_fits(const jac_constant *constant, enum jac_type_kind kind)
+{
+    jac_constant converted;
+    if (!jac_convert_constant(constant, kind, &converted))
+        return false;
+    if (is_float(kind))
+        return isfinite(converted.opt.f);
+    if (constant->holds == JAC_CONSTANT_FLOAT)
+        return false;
+
+    // the same bits, read with the same sign
+    bool negative = (constant->holds == JAC_CONSTANT_INT) && (constant->opt.i < 0);
+    return (negative == (is_signed(kind) && (converted.opt.i < 0))) && (converted.opt.u == constant->opt.u);
+}
+
+static bool is_true(const jac_constant *constant)
+{
+    return (constant->holds == JAC_CONSTANT_FLOAT) ? (constant->opt.f != 0) : (constant->opt.u != 0);
+}
+
+bool jac_fold_unary(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *operand, jac_constant *result)
+{
+    jac_constant value;
+    if (!jac_convert_constant(operand, kind, &value))
+        return false;
+
+    switch (op)
+    {
+    case JAC_IR_NEG:
+        if (kind == JAC_TYPE_BOOL)
+            return false;
+        *result = is_float(kind) ? make_float(kind, -value.opt.f) : make_integer(kind, UINT64_C(0) - value.opt.u);
+        return true;
+
+    case JAC_IR_NOT:
+        *result = make_bool(!is_true(&value));
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+// integer arithmetic wraps around in the width of the kind, computed on the
+// 64 bits and cut back, whose low bits are the same for either signedness
+static bool fold_integer(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *a, const jac_constant *b,
+                         jac_constant *result)
+{
+    if (kind == JAC_TYPE_BOOL)
+        return false;
+
+    switch (op)
+    {
+    case JAC_IR_ADD:
+        *result = make_integer(kind, a->opt.u + b->opt.u);
+        return true;
+
+    case JAC_IR_SUB:
+        *result = make_integer(kind, a->opt.u - b->opt.u);
+        return true;
+
+    case JAC_IR_MUL:
+        *result = make_integer(kind, a->opt.u * b->opt.u);
+        return true;
+
+    case JAC_IR_DIV:
+        if (b->opt.u == 0)
+            return false;
+        if (!is_signed(kind))
+        {
+            *result = make_integer(kind, a->opt.u / b->opt.u);
+            return true;
+        }
+
+        // the quotient of the least value by -1 does not fit, and traps like division by zero
+        if ((b->opt.i == -1) && (a->opt.u == (~UINT64_C(0) << (widths[kind] - 1))))
+            return false;
+        *result = make_integer(kind, (uint64_t)(a->opt.i / b->opt.i));
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static bool fold_float(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *a, const jac_constant *b,
+                       jac_constant *result)
+{
+    // one rounding to float of the exact result in double is the float result
+    switch (op)
+    {
+    case JAC_IR_ADD:
+        *result = make_float(kind, a->opt.f + b->opt.f);
+        return true;
+
+    case JAC_IR_SUB:
+        *result = make_float(kind, a->opt.f - b->opt.f);
+        return true;
+
+    case JAC_IR_MUL:
+        *result = make_float(kind, a->opt.f * b->opt.f);
+        return true;
+
+    case JAC_IR_DIV:
+        *result = make_float(kind, a->opt.f / b->opt.f);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static bool compare(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *a, const jac_constant *b)
+{
+    // -1, 0 or 1, and 2 for unordered floats, which are only unequal
+    int order;
+    if (is_float(kind))
+        order = (a->opt.f < b->opt.f) ? -1 : (a->opt.f > b->opt.f) ? 1 : (a->opt.f == b->opt.f) ? 0 : 2;
+    else if (is_signed(kind))
+        order = (a->opt.i > b->opt.i) - (a->opt.i < b->opt.i);
+    else
+        order = (a->opt.u > b->opt.u) - (a->opt.u < b->opt.u);
+
+    switch (op)
+    {
+    case JAC_IR_EQ:
+        return order == 0;
+    case JAC_IR_NE:
+        return order != 0;
+    case JAC_IR_LT:
+        return order == -1;
+    case JAC_IR_LE:
+        return (order == -1) || (order == 0);
+    case JAC_IR_GT:
+        return order == 1;
+    default:
+        return (order == 1) || (order == 0);
+    }
+}
+
+bool jac_fold_binary(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *left, const jac_constant *right,
+                     jac_constant *result)
+{
+    jac_constant a, b;
+    if (!jac_convert_constant(left, kind, &a) || !jac_convert_constant(right, kind, &b))
+        return false;
+
+    switch (op)
+    {
+    case JAC_IR_AND:
+        *result = make_bool(is_true(&a) && is_true(&b));
+        return true;
+
+    case JAC_IR_OR:
+        *result = make_bool(is_true(&a) || is_true(&b));
+        return true;
+
+    case JAC_IR_EQ:
+    case JAC_IR_NE:
+    case JAC_IR_LT:
+    case JAC_IR_LE:
+    case JAC_IR_GT:
+    case JAC_IR_GE:
+        *result = make_bool(compare(op, kind, &a, &b));
+        return true;
+
+    default:
+        return is_float(kind) ? fold_float(op, kind, &a, &b, result) : fold_integer(op, kind, &a, &b, result);
+    }
+}
+
+/*
+ * SCCP
+ */
+
+typedef struct cell cell;
+typedef struct use use;
+typedef struct propagator propagator;
+
+// a value in the lattice, which only ever goes down
+struct cell
+{
+    enum
+    {
+        CELL_UNKNOWN, // no definition reached yet
+        CELL_CONSTANT,
+        CELL_VARYING,
+    } state;
+    jac_constant constant;
+};
+
+struct use
+{
+    uint32_t block;
+    uint32_t index;
+};
+
+struct propagator
+{
+    jac_ir_function *function;
+    cell *cells; // per value
+    use *uses;   // per value, from 'first_use'
+    uint32_t *first_use;
+    bool *reachable;   // per block
+    uint8_t *feasible; // per block, a bit per edge out of it, in the order of its successors
+
+    uint32_t *blocks; // reachable, and yet to be visited
+    uint32_t block_count;
+    uint32_t *values; // changed, and yet to be visited. a value changes at most twice
+    uint32_t value_count;
+};
+
+static enum jac_type_kind kind_of_type(jac_type_id type)
+{
+    return (type <= JAC_TYPE_FLOAT64) ? (enum jac_type_kind)type : JAC_TYPE_CUSTOM;
+}
+
+static enum jac_type_kind kind_of_value(const jac_ir_value *value)
+{
+    if (value->holds == JAC_IR_VALUE_VARIABLE)
+        return kind_of_type(value->opt.variable.sym.type.id);
+    if ((value->holds != JAC_IR_VALUE_LITERAL) || (value->opt.literal.holds != JAC_IR_LITERAL_CONSTANT))
+        return JAC_TYPE_CUSTOM;
+
+    // the checker gave every literal the type of its use
+    return value->opt.literal.opt.constant.type;
+}
+
+// the type the operands of an instruction are read in, see enum jac_ir_op
+static enum jac_type_kind operand_kind(const jac_ir_instruction *instruction)
+{
+    bool of_result = (instruction->op == JAC_IR_PHI) || (instruction->op == JAC_IR_NEG) ||
+                     ((instruction->op >= JAC_IR_ADD) && (instruction->op <= JAC_IR_DIV));
+    if (of_result)
+        return kind_of_type(instruction->result.sym.type.id);
+    return kind_of_value(darray_small_data(instruction->operands));
+}
+
+static bool same_constant(const jac_constant *a, const jac_constant *b)
+{
+    return (a->holds == b->holds) && (a->type == b->type) && (a->opt.u == b->opt.u);
+}
+
+static cell varying(void)
+{
+    return (cell){.state = CELL_VARYING};
+}
+
+// of an operand, as one of 'kind'. undefined values are taken for any
+// constant in phis, and for unknowable elsewhere
+static cell operand_cell(const propagator *propagator, const jac_ir_value *value, enum jac_type_kind kind, bool in_phi)
+{
+    cell result = {.state = CELL_CONSTANT};
+    switch (value->holds)
+    {
+    case JAC_IR_VALUE_UNDEF:
+        return in_phi ? (cell){.state = CELL_UNKNOWN} : varying();
+
+    case JAC_IR_VALUE_LITERAL:
+        if ((value->opt.literal.holds != JAC_IR_LITERAL_CONSTANT) ||
+            !jac_convert_constant(&value->opt.literal.opt.constant, kind, &result.constant))
+            return varying();
+        return result;
+
+    default: {
+        const cell *of = propagator->cells + value->opt.variable.id;
+        if (of->state != CELL_CONSTANT)
+            return *of;
+        if (!jac_convert_constant(&of->constant, kind, &result.constant))
+            return varying();
+        return result;
+    }
+    }
+}
+
+static cell meet(cell a, cell b)
+{
+    if (a.state == CELL_UNKNOWN)
+        return b;
+    if (b.state == CELL_UNKNOWN)
+        return a;
+    if ((a.state == CELL_CONSTANT) && (b.state == CELL_CONSTANT) && same_constant(&a.constant, &b.constant))
+        return a;
+    return varying();
+}
+
+static void lower(propagator *propagator, size_t id, cell value)
+{
+    cell *old = propagator->cells + id;
+    value = meet(*old, value);
+    if ((value.state == old->state) &&
+        ((value.state != CELL_CONSTANT) || same_constant(&value.constant, &old->constant)))
+        return;
+
+    *old = value;
+    propagator->values[propagator->value_count++] = (uint32_t)id;
+}
+
+static bool is_feasible(const propagator *propagator, uint32_t from, uint32_t to)
+{
+    const jac_ir_block_list *successors = &propagator->function->blocks[from].successors;
+    for (size_t s = 0; s < darray_small_count(*successors); ++s)
+    {
+        if ((darray_small_data(*successors)[s] == to) && (propagator->feasible[from] & (1u << s)))
+            return true;
+    }
+    return false;
+}
+
+static void visit(propagator *propagator, uint32_t b, uint32_t index);
+
+static void mark_feasible(propagator *propagator, uint32_t from, uint32_t successor)
+{
+    if (propagator->feasible[from] & (1u << successor))
+        return;
+    propagator->feasible[from] |= (uint8_t)(1u << successor);
+
+    uint32_t to = darray_small_data(propagator->function->blocks[from].successors)[successor];
+    if (!propagator->reachable[to])
+    {
+        propagator->reachable[to] = true;
+        propagator->blocks[propagator->block_count++] = to;
+        return;
+    }
+
+    // only the phis see the new edge
+    const jac_ir_block *block = propagator->function->blocks + to;
+    for (uint32_t i = 0; (i < darray_count(block->instructions)) && (block->instructions[i].op == JAC_IR_PHI); ++i)
+        visit(propagator, to, i);
+}
+
+static void visit(propagator *propagator, uint32_t b, uint32_t index)
+{
+    const jac_ir_block *block = propagator->function->blocks + b;
+    const jac_ir_instruction *instruction = block->instructions + index;
+    const jac_ir_value *operands = darray_small_data(instruction->operands);
+    enum jac_type_kind kind = operand_kind(instruction);
+
+    switch (instruction->op)
+    {
+    case JAC_IR_PHI: {
+        cell value = {.state = CELL_UNKNOWN};
+        for (size_t i = 0; i < darray_small_count(instruction->operands); ++i)
+        {
+            if (is_feasible(propagator, darray_small_data(block->predecessors)[i], b))
+                value = meet(value, operand_cell(propagator, operands + i, kind, true));
+        }
+        lower(propagator, instruction->result.id, value);
+    }
+    break;
+
+    case JAC_IR_JUMP:
+        mark_feasible(propagator, b, 0);
+        break;
+
+    case JAC_IR_BRANCH: {
+        cell condition = operand_cell(propagator, operands, kind, false);
+        if (condition.state == CELL_CONSTANT)
+            mark_feasible(propagator, b, is_true(&condition.constant) ? 0 : 1);
+        else if (condition.state == CELL_VARYING)
+        {
+            mark_feasible(propagator, b, 0);
+            mark_feasible(propagator, b, 1);
+        }
+    }
+    break;
+
+    case JAC_IR_RET:
+    case JAC_IR_STORE:
+        break;
+
+    default: {
+        if (!jac_ir_is_unary(instruction->op) && !jac_ir_is_binary(instruction->op))
+        {
+            lower(propagator, instruction->result.id, varying());
+            break;
+        }
+
+        cell left = operand_cell(propagator, operands, kind, false);
+        cell right = jac_ir_is_binary(instruction->op) ? operand_cell(propagator, operands + 1, kind, false) : left;
+        if ((left.state == CELL_VARYING) || (right.state == CELL_VARYING))
+            lower(propagator, instruction->result.id, varying());
+        if ((left.state != CELL_CONSTANT) || (right.state != CELL_CONSTANT))
+            break;
+
+        cell value = {.state = CELL_CONSTANT};
+        bool folded = jac_ir_is_unary(instruction->op)
+                          ? jac_fold_unary(instruction->op, kind, &left.constant, &value.constant)
+                          : jac_fold_binary(instruction->op, kind, &left.constant, &right.constant, &value.constant);
+
+        // as the type of the result, which arithmetic on a custom type does not have
+        enum jac_type_kind result_kind = kind_of_type(instruction->result.sym.type.id);
+        if (!folded || !jac_convert_constant(&value.constant, result_kind, &value.constant))
+            value = varying();
+        lower(propagator, instruction->result.id, value);
+    }
+    }
+}
+
+// the uses of each value, in order
+static void find_uses(propagator *propagator, jac_memory_arena *scratch)
+{
+    jac_ir_function *function = propagator->function;
+    size_t values = function->tmp_counter;
+    uint32_t *first_use = jac_arena_alloc_array(scratch, uint32_t, values);
+    memset(first_use, 0, (values + 1) * sizeof(uint32_t));
+
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+            {
+                if (operand->holds == JAC_IR_VALUE_VARIABLE)
+                    first_use[operand->opt.variable.id] += 1;
+            }
+        }
+    }
+
+    // to the end of each range, which the uses are then put in front of
+    for (size_t id = 1; id <= values; ++id)
+        first_use[id] += first_use[id - 1];
+
+    use *uses = jac_arena_alloc_array(scratch, use, first_use[values]);
+    for (uint32_t b = (uint32_t)darray_count(function->blocks); b-- > 0;)
+    {
+        const jac_ir_block *block = function->blocks + b;
+        for (uint32_t i = (uint32_t)darray_count(block->instructions); i-- > 0;)
+        {
+            darray_small_foreach(block->instructions[i].operands, const jac_ir_value, operand)
+            {
+                if (operand->holds == JAC_IR_VALUE_VARIABLE)
+                    uses[--first_use[operand->opt.variable.id]] = (use){.block = b, .index = i};
+            }
+        }
+    }
+
+    propagator->uses = uses;
+    propagator->first_use = first_use;
+}
+
+static void propagate(propagator *propagator)
+{
+    propagator->reachable[0] = true;
+    propagator->blocks[propagator->block_count++] = 0;
+
+    while ((propagator->block_count > 0) || (propagator->value_count > 0))
+    {
+        while (propagator->value_count > 0)
+        {
+            uint32_t id = propagator->values[--propagator->value_count];
+            for (uint32_t u = propagator->first_use[id]; u < propagator->first_use[id + 1]; ++u)
+            {
+                const use *use = propagator->uses + u;
+                if (propagator->reachable[use->block])
+                    visit(propagator, use->block, use->index);
+            }
+        }
+
+        if (propagator->block_count > 0)
+        {
+            uint32_t b = propagator->blocks[--propagator->block_count];
+            for (uint32_t i = 0; i < darray_count(propagator->function->blocks[b].instructions); ++i)
+                visit(propagator, b, i);
+        }
+    }
+}
+
+static jac_ir_value literal_of(const jac_constant *constant)
+{
+    jac_ir_value value = {.holds = JAC_IR_VALUE_LITERAL};
+    value.opt.literal.holds = JAC_IR_LITERAL_CONSTANT;
+    value.opt.literal.opt.constant = *constant;
+    return value;
+}
+
+// the constants go in place of their values, and their definitions go
+static void rewrite(propagator *propagator)
+{
+    jac_ir_function *function = propagator->function;
+    size_t folded = 0, folded_branches = 0;
+
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        size_t kept = 0;
+        darray_foreach(block->instructions, jac_ir_instruction, instruction)
+        {
+            darray_small_foreach(instruction->operands, jac_ir_value, operand)
+            {
+                if ((operand->holds == JAC_IR_VALUE_VARIABLE) &&
+                    (propagator->cells[operand->opt.variable.id].state == CELL_CONSTANT))
+                    *operand = literal_of(&propagator->cells[operand->opt.variable.id].constant);
+            }
+
+            // only the pure ops ever have a constant cell
+            if (jac_ir_has_result(instruction->op) &&
+                (propagator->cells[instruction->result.id].state == CELL_CONSTANT))
+            {
+                folded += 1;
+                continue;
+            }
+            block->instructions[kept++] = *instruction;
+        }
+        darray_truncate(block->instructions, kept);
+    }
+
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        jac_ir_block *block = function->blocks + b;
+        uint8_t feasible = propagator->feasible[b];
+        if (!propagator->reachable[b] || (darray_count(block->instructions) == 0) ||
+            ((*darray_last(block->instructions)).op != JAC_IR_BRANCH) || ((feasible != 1) && (feasible != 2)))
+            continue;
+
+        jac_ir_instruction *branch = darray_last(block->instructions);
+        uint32_t taken = branch->targets[feasible - 1];
+        uint32_t dropped = branch->targets[2 - feasible];
+        branch->op = JAC_IR_JUMP;
+        branch->targets[0] = taken;
+        branch->targets[1] = 0;
+        branch->operands.count = 0;
+        jac_remove_edge(function, b, dropped);
+        folded_branches += 1;
+    }
+
+    jac_count(JAC_COUNTER_FOLDED, folded);
+    jac_count(JAC_COUNTER_FOLDED_BRANCHES, folded_branches);
+}
+
+void jac_propagate_constants(jac_ir_function *function, jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    size_t values = function->tmp_counter;
+    if (count == 0)
+        return;
+
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+    propagator propagator = {
+        .function = function,
+        .cells = jac_arena_alloc_array(scratch, cell, values),
+        .reachable = jac_arena_alloc_array(scratch, bool, count),
+        .feasible = jac_arena_alloc_array(scratch, uint8_t, count),
+        .blocks = jac_arena_alloc_array(scratch, uint32_t, count),
+        .values = jac_arena_alloc_array(scratch, uint32_t, 2 * values),
+    };
+    memset(propagator.reachable, 0, count * sizeof(bool));
+    memset(propagator.feasible, 0, count * sizeof(uint8_t));
+    for (size_t id = 0; id < values; ++id)
+        propagator.cells[id] = (cell){.state = CELL_UNKNOWN};
+
+    // the arguments come from the caller
+    for (size_t id = 0; id < darray_small_count(function->header.args); ++id)
+        propagator.cells[id] = varying();
+
+    find_uses(&propagator, scratch);
+    propagate(&propagator);
+    rewrite(&propagator);
+    jac_arena_rewind(scratch, mark);
+}
+
+/*
+ * DEAD CODE
+ */
+
+// what must stay even if its value is unused. a division may trap, unless by
+// a constant neither 0 nor -1, or of floats
+static bool has_effect(const jac_ir_instruction *instruction)
+{
+    switch (instruction->op)
+    {
+    case JAC_IR_CALL:
+    case JAC_IR_STORE:
+    case JAC_IR_RET:
+    case JAC_IR_JUMP:
+    case JAC_IR_BRANCH:
+        return true;
+
+    case JAC_IR_DIV: {
+        enum jac_type_kind kind = operand_kind(instruction);
+        const jac_ir_value *divisor = darray_small_data(instruction->operands) + 1;
+        jac_constant value;
+        if (is_float(kind))
+            return false;
+        if ((divisor->holds != JAC_IR_VALUE_LITERAL) || (divisor->opt.literal.holds != JAC_IR_LITERAL_CONSTANT) ||
+            !jac_convert_constant(&divisor->opt.literal.opt.constant, kind, &value))
+            return true;
+        return (value.opt.u == 0) || (is_signed(kind) && (value.opt.i == -1));
+    }
+
+    default:
+        return false;
+    }
+}
+
+// drops the blocks not in 'keep', which nothing left may branch to, and
+// renumbers the others in order
+static void remove_blocks(jac_ir_function *function, const bool *keep, jac_memory_arena *arena,
+                          jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    uint32_t *ids = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t kept = 0;
+    for (uint32_t b = 0; b < count; ++b)
+        ids[b] = keep[b] ? kept++ : JAC_IR_NO_BLOCK;
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        if (!keep[b])
+            continue;
+
+        jac_ir_block *block = function->blocks + b;
+        for (uint32_t i = 0; i < jac_ir_target_count(block); ++i)
+        {
+            uint32_t *target = (*darray_last(block->instructions)).targets + i;
+            JAC_ASSERT(ids[*target] != JAC_IR_NO_BLOCK, "branch to a removed block.");
+            *target = ids[*target];
+        }
+        darray_small_foreach(block->predecessors, uint32_t, predecessor)
+            *predecessor = ids[*predecessor];
+
+        block->id = ids[b];
+        function->blocks[ids[b]] = *block;
+    }
+
+    darray_truncate(function->blocks, kept);
+    jac_update_cfg(function, arena, scratch);
+}
+
+static size_t remove_unreachable_blocks(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    bool *reached = jac_arena_alloc_array(scratch, bool, count);
+    uint32_t *stack = jac_arena_alloc_array(scratch, uint32_t, count);
+    memset(reached, 0, count * sizeof(bool));
+
+    uint32_t top = 0;
+    reached[0] = true;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        uint32_t b = stack[--top];
+        darray_small_foreach(function->blocks[b].successors, const uint32_t, successor)
+        {
+            if (!reached[*successor])
+            {
+                reached[*successor] = true;
+                stack[top++] = *successor;
+            }
+        }
+    }
+
+    size_t removed = 0;
+    for (uint32_t b = 0; b < count; ++b)
+        removed += !reached[b];
+    if (removed > 0)
+        remove_blocks(function, reached, arena, scratch);
+    return removed;
+}
+
+static void mark_live(const jac_ir_instruction *instruction, bool *live, uint32_t *work, uint32_t *top)
+{
+    darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+    {
+        if ((operand->holds == JAC_IR_VALUE_VARIABLE) && !live[operand->opt.variable.id])
+        {
+            live[operand->opt.variable.id] = true;
+            work[(*top)++] = (uint32_t)operand->opt.variable.id;
+        }
+    }
+}
+
+// mark and sweep, from the instructions with an effect, so that cycles of
+// phis nothing else reads go too
+static size_t remove_dead_instructions(jac_ir_function *function, jac_memory_arena *scratch)
+{
+    size_t values = function->tmp_counter;
+    bool *live = jac_arena_alloc_array(scratch, bool, values);
+    const jac_ir_instruction **definitions = jac_arena_alloc_array(scratch, const jac_ir_instruction *, values);
+    uint32_t *work = jac_arena_alloc_array(scratch, uint32_t, values);
+    memset(live, 0, values * sizeof(bool));
+    memset(definitions, 0, values * sizeof(const jac_ir_instruction *));
+
+    uint32_t top = 0;
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if (jac_ir_has_result(instruction->op))
+                definitions[instruction->result.id] = instruction;
+            if (has_effect(instruction))
+                mark_live(instruction, live, work, &top);
+        }
+    }
+
+    // the arguments have no definition
+    while (top > 0)
+    {
+        const jac_ir_instruction *definition = definitions[work[--top]];
+        if (definition)
+            mark_live(definition, live, work, &top);
+    }
+
+    size_t removed = 0;
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        size_t kept = 0;
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if (jac_ir_has_result(instruction->op) && !live[instruction->result.id] && !has_effect(instruction))
+            {
+                removed += 1;
+                continue;
+            }
+            block->instructions[kept++] = *instruction;
+        }
+        darray_truncate(block->instructions, kept);
+    }
+    return removed;
+}
+
+// the stores to slots that are never loaded, and whose address is never
+// taken. the slots go with them, and the others are renumbered
+static size_t remove_dead_stores(jac_ir_function *function, jac_memory_arena *scratch)
+{
+    size_t locals = darray_count(function->locals);
+    bool *read = jac_arena_alloc_array(scratch, bool, locals);
+    uint32_t *slots = jac_arena_alloc_array(scratch, uint32_t, locals);
+    memset(read, 0, locals * sizeof(bool));
+
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if ((instruction->op == JAC_IR_LOAD) || (instruction->op == JAC_IR_ADDR))
+                read[instruction->local] = true;
+        }
+    }
+
+    uint32_t kept = 0;
+    for (size_t local = 0; local < locals; ++local)
+    {
+        slots[local] = read[local] ? kept : JAC_IR_NO_BLOCK;
+        if (read[local])
+        {
+            function->locals[kept] = function->locals[local];
+            function->locals[kept].id = kept;
+            kept += 1;
+        }
+    }
+    if (kept == locals)
+        return 0;
+    darray_truncate(function->locals, kept);
+
+    size_t removed = 0;
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        size_t count = 0;
+        darray_foreach(block->instructions, jac_ir_instruction, instruction)
+        {
+            bool is_slot = (instruction->op == JAC_IR_LOAD) || (instruction->op == JAC_IR_ADDR) ||
+                           (instruction->op == JAC_IR_STORE);
+            if (is_slot && (slots[instruction->local] == JAC_IR_NO_BLOCK))
+            {
+                removed += 1;
+                continue;
+            }
+            if (is_slot)
+                instruction->local = slots[instruction->local];
+            block->instructions[count++] = *instruction;
+        }
+        darray_truncate(block->instructions, count);
+    }
+    return removed;
+}
+
+static jac_ir_value resolve(jac_ir_value value, const jac_ir_value *replacements, const bool *replaced)
+{
+    while ((value.holds == JAC_IR_VALUE_VARIABLE) && replaced[value.opt.variable.id])
+        value = replacements[value.opt.variable.id];
+    return value;
+}
+
+// a block that only its predecessor jumps to goes at the end of it, its phis
+// each standing for their one operand
+static size_t merge_blocks(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    size_t values = function->tmp_counter;
+    bool *keep = jac_arena_alloc_array(scratch, bool, count);
+    jac_ir_value *replacements = jac_arena_alloc_array(scratch, jac_ir_value, values);
+    bool *replaced = jac_arena_alloc_array(scratch, bool, values);
+    memset(keep, true, count * sizeof(bool));
+    memset(replaced, 0, values * sizeof(bool));
+
+    size_t merged = 0;
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        jac_ir_block *block = function->blocks + b;
+        while (keep[b] && (darray_count(block->instructions) > 0) &&
+               ((*darray_last(block->instructions)).op == JAC_IR_JUMP))
+        {
+            uint32_t t = (*darray_last(block->instructions)).targets[0];
+            jac_ir_block *target = function->blocks + t;
+            if ((t == b) || (darray_small_count(target->predecessors) != 1))
+                break;
+
+            darray_truncate(block->instructions, darray_count(block->instructions) - 1);
+            darray_foreach(target->instructions, const jac_ir_instruction, instruction)
+            {
+                if (instruction->op == JAC_IR_PHI)
+                {
+                    replacements[instruction->result.id] = darray_small_data(instruction->operands)[0];
+                    replaced[instruction->result.id] = true;
+                }
+                else
+                    darray_push(block->instructions, *instruction);
+            }
+
+            // the edges out of the target now leave from here
+            block->successors = target->successors;
+            darray_small_foreach(target->successors, const uint32_t, successor)
+            {
+                darray_small_foreach(function->blocks[*successor].predecessors, uint32_t, predecessor)
+                {
+                    if (*predecessor == t)
+                        *predecessor = b;
+                }
+            }
+
+            darray_truncate(target->instructions, 0);
+            darray_small_init(target->successors);
+            keep[t] = false;
+            merged += 1;
+        }
+    }
+
+    if (merged == 0)
+        return 0;
+
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, jac_ir_instruction, instruction)
+        {
+            darray_small_foreach(instruction->operands, jac_ir_value, operand)
+                *operand = resolve(*operand, replacements, replaced);
+        }
+    }
+
+    remove_blocks(function, keep, arena, scratch);
+    return merged;
+}
+
+void jac_eliminate_dead_code(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    if (darray_count(function->blocks) == 0)
+        return;
+
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+    jac_count(JAC_COUNTER_UNREACHABLE_BLOCKS, remove_unreachable_blocks(function, arena, scratch));
+
+    // the values of dead stores may be all that kept others alive
+    size_t stores;
+    do
+    {
+        jac_count(JAC_COUNTER_DEAD_INSTRUCTIONS, remove_dead_instructions(function, scratch));
+        stores = remove_dead_stores(function, scratch);
+        jac_count(JAC_COUNTER_DEAD_STORES, stores);
+    } while (stores > 0);
+
+    jac_count(JAC_COUNTER_MERGED_BLOCKS, merge_blocks(function, arena, scratch));
+    jac_arena_rewind(scratch, mark);
+}
+
+/*
+ * INLINING
+ */
+
+// the cost model, in instructions. a call saves its own sequence, and one per
+// argument passed, and a literal argument is likely to fold some of the callee
+#define INLINE_THRESHOLD       20
+#define INLINE_CALL_SAVING     4
+#define INLINE_ARGUMENT_SAVING 1
+#define INLINE_LITERAL_BONUS   4
+#define INLINE_CALLER_LIMIT    4096 // a caller stops growing here, hinted or not
+
+#define UNVISITED UINT32_MAX
+
+typedef struct inliner inliner;
+
+struct inliner
+{
+    jac_ir_unit *unit;
+    jac_memory_arena *arena;
+    jac_memory_arena *scratch;
+    uint32_t *components; // per function, its strongly connected component of the call graph
+    size_t *sizes;        // per function, its instructions less the phis
+};
+
+static size_t function_size(const jac_ir_function *function)
+{
+    size_t size = 0;
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+            size += (instruction->op != JAC_IR_PHI);
+    }
+    return size;
+}
+
+// Tarjan's algorithm, without recursion. a component is complete only after
+// those it calls, so 'order' has every function after its callees, outside of
+// cycles
+static void find_components(const jac_ir_unit *unit, jac_memory_arena *scratch, uint32_t *components, uint32_t *order)
+{
+    uint32_t count = (uint32_t)darray_count(unit->functions);
+
+    // the calls out of each function, in CSR form
+    uint32_t *first = jac_arena_alloc_array(scratch, uint32_t, count + 1);
+    first[0] = 0;
+    for (uint32_t f = 0; f < count; ++f)
+    {
+        first[f + 1] = first[f];
+        if (!unit->functions[f].blocks)
+            continue;
+        darray_foreach(unit->functions[f].blocks, const jac_ir_block, block)
+        {
+            darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+                first[f + 1] += (instruction->op == JAC_IR_CALL);
+        }
+    }
+
+    uint32_t *callees = jac_arena_alloc_array(scratch, uint32_t, first[count]);
+    for (uint32_t f = 0, edge = 0; f < count; ++f)
+    {
+        if (!unit->functions[f].blocks)
+            continue;
+        darray_foreach(unit->functions[f].blocks, const jac_ir_block, block)
+        {
+            darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+            {
+                if (instruction->op == JAC_IR_CALL)
+                    callees[edge++] = (uint32_t)instruction->callee;
+            }
+        }
+    }
+
+    uint32_t *index = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *low = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *stack = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *frames = jac_arena_alloc_array(scratch, uint32_t, count); // the functions being visited
+    uint32_t *edges = jac_arena_alloc_array(scratch, uint32_t, count);  // and the next call out of each
+    bool *on_stack = jac_arena_alloc_array(scratch, bool, count);
+    memset(index, 0xff, count * sizeof(uint32_t));
+    memset(on_stack, 0, count * sizeof(bool));
+
+    uint32_t visited = 0, top = 0, found = 0, component = 0;
+    for (uint32_t root = 0; root < count; ++root)
+    {
+        if (index[root] != UNVISITED)
+            continue;
+
+        uint32_t depth = 0;
+        uint32_t f = root;
+        for (;;)
+        {
+            if (index[f] == UNVISITED)
+            {
+                index[f] = low[f] = visited++;
+                stack[top++] = f;
+                on_stack[f] = true;
+                frames[depth] = f;
+                edges[depth++] = first[f];
+            }
+
+            f = frames[depth - 1];
+            if (edges[depth - 1] < first[f + 1])
+            {
+                uint32_t callee = callees[edges[depth - 1]++];
+                if (index[callee] == UNVISITED)
+                    f = callee;
+                else if (on_stack[callee] && (index[callee] < low[f]))
+                    low[f] = index[callee];
+                continue;
+            }
+
+            if (low[f] == index[f])
+            {
+                uint32_t member;
+                do
+                {
+                    member = stack[--top];
+                    on_stack[member] = false;
+                    components[member] = component;
+                    order[found++] = member;
+                } while (member != f);
+                component += 1;
+            }
+
+            if (--depth == 0)
+                break;
+            uint32_t caller = frames[depth - 1];
+            if (low[f] < low[caller])
+                low[caller] = low[f];
+        }
+    }
+}
+
+// decides on a call, and reports why
+static bool should_inline(const inliner *inliner, size_t caller, const jac_ir_instruction *call, size_t caller_size)
+{
+    const jac_ir_function *callee = inliner->unit->functions + call->callee;
+    const jac_token *from = &inliner->unit->functions[caller].header.identifier;
+    const jac_token *to = &callee->header.identifier;
+    const char *reason = NULL;
+
+    long saving = INLINE_CALL_SAVING;
+    darray_small_foreach(call->operands, const jac_ir_value, operand)
+    {
+        saving += INLINE_ARGUMENT_SAVING;
+        if (operand->holds == JAC_IR_VALUE_LITERAL)
+            saving += INLINE_LITERAL_BONUS;
+    }
+    long cost = (long)inliner->sizes[call->callee] - saving;
+
+    if (!callee->blocks)
+        reason = "no definition";
+    else if (inliner->components[call->callee] == inliner->components[caller])
+        reason = "recursive";
+    else if (callee->inlining == JAC_IR_INLINE_NEVER)
+        reason = "hinted #(noinline)";
+    else if (caller_size + inliner->sizes[call->callee] > INLINE_CALLER_LIMIT)
+        reason = "caller too large";
+    else if (callee->inlining == JAC_IR_INLINE_ALWAYS)
+    {
+        jac_remark("inlined '" JAC_TOKEN_FMT "' into '" JAC_TOKEN_FMT "', hinted #(inline)", JAC_TOKEN_ARG(to),
+                   JAC_TOKEN_ARG(from));
+        return true;
+    }
+    else if (cost <= INLINE_THRESHOLD)
+    {
+        jac_remark("inlined '" JAC_TOKEN_FMT "' into '" JAC_TOKEN_FMT "', cost %ld within %d", JAC_TOKEN_ARG(to),
+                   JAC_TOKEN_ARG(from), cost, INLINE_THRESHOLD);
+        return true;
+    }
+
+    if (reason)
+        jac_remark("did not inline '" JAC_TOKEN_FMT "' into '" JAC_TOKEN_FMT "', %s", JAC_TOKEN_ARG(to),
+                   JAC_TOKEN_ARG(from), reason);
+    else
+        jac_remark("did not inline '" JAC_TOKEN_FMT "' into '" JAC_TOKEN_FMT "', cost %ld over %d", JAC_TOKEN_ARG(to),
+                   JAC_TOKEN_ARG(from), cost, INLINE_THRESHOLD);
+    return false;
+}
+
+// a literal takes the type of the parameter, as it would by being passed
+static jac_ir_value pass_argument(jac_ir_value argument, const jac_symbol *parameter)
+{
+    jac_constant converted;
+    if ((argument.holds != JAC_IR_VALUE_LITERAL) || (argument.opt.literal.holds != JAC_IR_LITERAL_CONSTANT) ||
+        !jac_convert_constant(&argument.opt.literal.opt.constant, kind_of_type(parameter->type.id), &converted))
+        return argument;
+    return literal_of(&converted);
+}
+
+// the callee's arguments are the values passed, and its other values follow
+// those of the caller
+static jac_ir_value remap_value(jac_ir_value value, const jac_ir_value *arguments, size_t arity, size_t values)
+{
+    if (value.holds != JAC_IR_VALUE_VARIABLE)
+        return value;
+    if (value.opt.variable.id < arity)
+        return arguments[value.opt.variable.id];
+
+    value.opt.variable.id += values - arity;
+    return value;
+}
+
+// block 'b' jumps to a copy of the callee at the call, and the rest of it
+// goes to a block after the copy, where the returns meet. the predecessors
+// are left to jac_update_cfg
+static void inline_call(inliner *inliner, jac_ir_function *caller, uint32_t b, size_t k)
+{
+    jac_memory_arena *arena = inliner->arena;
+    jac_ir_instruction call = caller->blocks[b].instructions[k];
+    const jac_ir_function *callee = inliner->unit->functions + call.callee;
+
+    uint32_t base = (uint32_t)darray_count(caller->blocks);
+    uint32_t rest = base + (uint32_t)darray_count(callee->blocks);
+    uint32_t locals = (uint32_t)darray_count(caller->locals);
+    size_t values = caller->tmp_counter;
+    size_t arity = darray_small_count(callee->header.args);
+
+    jac_ir_value *arguments = jac_arena_alloc_array(inliner->scratch, jac_ir_value, arity);
+    for (size_t i = 0; i < arity; ++i)
+        arguments[i] = pass_argument(darray_small_data(call.operands)[i], darray_small_data(callee->header.args) + i);
+
+    darray_foreach(callee->locals, const jac_ir_symbol, local)
+    {
+        jac_ir_symbol slot = *local;
+        slot.id += locals;
+        darray_push(caller->locals, slot);
+    }
+
+    // the returns become jumps to the rest, and their values its phi
+    jac_ir_instruction phi = {.op = JAC_IR_PHI, .result = call.result};
+    jac_ir_block_list returns;
+    darray_small_init(phi.operands);
+    darray_small_init(returns);
+
+    darray_foreach(callee->blocks, const jac_ir_block, from)
+    {
+        jac_ir_block copy = {
+            .id = base + from->id,
+            .instructions = jac_arena_darray_new(arena, jac_ir_instruction),
+        };
+        darray_reserve(copy.instructions, darray_count(from->instructions) + 1);
+        darray_small_init(copy.successors);
+        darray_small_init(copy.predecessors);
+        darray_small_foreach(from->predecessors, const uint32_t, predecessor)
+            darray_small_push(copy.predecessors, base + *predecessor, &arena->allocator);
+
+        darray_foreach(from->instructions, const jac_ir_instruction, instruction)
+        {
+            jac_ir_instruction copied = *instruction;
+            darray_small_init(copied.operands);
+            darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+            {
+                jac_ir_value value = remap_value(*operand, arguments, arity, values);
+                darray_small_push(copied.operands, value, &arena->allocator);
+            }
+
+            if (jac_ir_has_result(copied.op))
+                copied.result.id += values - arity;
+            if ((copied.op == JAC_IR_ADDR) || (copied.op == JAC_IR_LOAD) || (copied.op == JAC_IR_STORE))
+                copied.local += locals;
+            if ((copied.op == JAC_IR_JUMP) || (copied.op == JAC_IR_BRANCH))
+            {
+                copied.targets[0] += base;
+                copied.targets[1] += base;
+            }
+
+            if (copied.op == JAC_IR_RET)
+            {
+                jac_ir_value value = {.holds = JAC_IR_VALUE_UNDEF};
+                if (darray_small_count(copied.operands) > 0)
+                    value = darray_small_data(copied.operands)[0];
+                darray_small_push(phi.operands, value, &arena->allocator);
+                darray_small_push(returns, copy.id, &arena->allocator);
+
+                copied = (jac_ir_instruction){.op = JAC_IR_JUMP, .targets = {rest, 0}};
+                darray_small_init(copied.operands);
+            }
+            darray_push(copy.instructions, copied);
+        }
+
+        // falling off the end returns nothing
+        if ((darray_count(copy.instructions) == 0) || !jac_ir_is_terminator(darray_last(copy.instructions)->op))
+        {
+            jac_ir_instruction jump = {.op = JAC_IR_JUMP, .targets = {rest, 0}};
+            darray_small_init(jump.operands);
+            darray_push(copy.instructions, jump);
+            darray_small_push(phi.operands, ((jac_ir_value){.holds = JAC_IR_VALUE_UNDEF}), &arena->allocator);
+            darray_small_push(returns, copy.id, &arena->allocator);
+        }
+        darray_push(caller->blocks, copy);
+    }
+    caller->tmp_counter += callee->tmp_counter - arity;
+
+    jac_ir_block *block = caller->blocks + b;
+    jac_ir_block after = {
+        .id = rest,
+        .instructions = jac_arena_darray_new(arena, jac_ir_instruction),
+        .successors = block->successors,
+        .predecessors = returns,
+    };
+    size_t tail = darray_count(block->instructions) - k - 1;
+    darray_reserve(after.instructions, tail + 1);
+    if (call.result.sym.type.id != JAC_TYPE_NONE)
+        darray_push(after.instructions, phi);
+    darray_append(after.instructions, block->instructions + k + 1, tail);
+
+    // the edges out of the block now leave from the rest
+    darray_small_foreach(block->successors, const uint32_t, successor)
+    {
+        darray_small_foreach(caller->blocks[*successor].predecessors, uint32_t, predecessor)
+        {
+            if (*predecessor == b)
+                *predecessor = rest;
+        }
+    }
+
+    darray_truncate(block->instructions, k);
+    jac_ir_instruction jump = {.op = JAC_IR_JUMP, .targets = {base, 0}};
+    darray_small_init(jump.operands);
+    darray_push(block->instructions, jump);
+    darray_small_init(block->successors);
+    darray_small_push(block->successors, base, &arena->allocator);
+
+    darray_push(caller->blocks, after);
+}
+
+// the calls of a block are decided in order, and inlined from the last, so
+// that each instruction after them moves once. the copies are left alone,
+// the callee already had its calls decided
+static void inline_calls_in(inliner *inliner, uint32_t caller)
+{
+    jac_ir_function *function = inliner->unit->functions + caller;
+    size_t size = inliner->sizes[caller];
+    bool inlined = false;
+
+    darray_t size_t *calls = darray_new(size_t);
+    for (uint32_t b = 0, blocks = (uint32_t)darray_count(function->blocks); b < blocks; ++b)
+    {
+        darray_clear(calls);
+        for (size_t k = 0; k < darray_count(function->blocks[b].instructions); ++k)
+        {
+            const jac_ir_instruction *call = function->blocks[b].instructions + k;
+            if ((call->op != JAC_IR_CALL) || !should_inline(inliner, caller, call, size))
+                continue;
+
+            size += inliner->sizes[call->callee];
+            darray_push(calls, k);
+        }
+
+        for (size_t i = darray_count(calls); i > 0; --i)
+            inline_call(inliner, function, b, calls[i - 1]);
+        jac_count(JAC_COUNTER_INLINED, darray_count(calls));
+        inlined |= (darray_count(calls) > 0);
+    }
+
+    darray_free(calls);
+    if (!inlined)
+        return;
+
+    // simplified before its own callers copy it
+    jac_update_cfg(function, inliner->arena, inliner->scratch);
+    jac_propagate_constants(function, inliner->scratch);
+    jac_eliminate_dead_code(function, inliner->arena, inliner->scratch);
+    inliner->sizes[caller] = function_size(function);
+}
+
+void jac_inline_calls(jac_ir_unit *unit, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+    uint32_t count = (uint32_t)darray_count(unit->functions);
+
+    inliner inliner = {
+        .unit = unit,
+        .arena = arena,
+        .scratch = scratch,
+        .components = jac_arena_alloc_array(scratch, uint32_t, count),
+        .sizes = jac_arena_alloc_array(scratch, size_t, count),
+    };
+    uint32_t *order = jac_arena_alloc_array(scratch, uint32_t, count);
+    find_components(unit, scratch, inliner.components, order);
+
+    for (uint32_t f = 0; f < count; ++f)
+        inliner.sizes[f] = unit->functions[f].blocks ? function_size(unit->functions + f) : 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (unit->functions[order[i]].blocks)
+            inline_calls_in(&inliner, order[i]);
+    }
+
+    jac_arena_rewind(scratch, mark);
+}
+
+/*
+ * PIPELINE
+ */
+
+// the callees are simplified before inlining, so that what is copied, and
+// what the cost model sees, is what they come down to
+void jac_optimize_unit(jac_ir_unit *unit, jac_memory_arena *arena)
+{
+    jac_memory_arena scratch;
+    jac_init_arena(&scratch);
+
+    uint64_t start = jac_begin_event();
+    darray_foreach(unit->functions, jac_ir_function, function)
+    {
+        if (function->blocks)
+            jac_propagate_constants(function, &scratch);
+    }
+    jac_end_event("pass", JAC_PHASE_OPT, "sccp", 4, start);
+
+    start = jac_begin_event();
+    darray_foreach(unit->functions, jac_ir_function, function)
+    {
+        if (function->blocks)
+            jac_eliminate_dead_code(function, arena, &scratch);
+    }
+    jac_end_event("pass", JAC_PHASE_OPT, "dce", 3, start);
+
+    start = jac_begin_event();
+    jac_inline_calls(unit, arena, &scratch);
+    jac_end_event("pass", JAC_PHASE_OPT, "inline", 6, start);
+
+    jac_free_arena(&scratch);
+}
@@ -0,0 +1,114 @@
+#define _DEFAULT_SOURCE
+
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JAC_SOURCE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool read_source(FILE *file, jac_source *source)
+{
+    size_t capacity = 1024 * 4;
+    size_t length = 0;
+    char *text = malloc(capacity);
+    if (!text)
+        return false;
+
+    for (;;)
+    {
+        length += fread(text + length, sizeof(char), capacity - length - 1, file);
+        if (length + 1 < capacity)
+            break;
+
+        char *grown = realloc(text, capacity * 2);
+        if (!grown)
+        {
+            free(text);
+            return false;
+        }
+
+        text = grown;
+        capacity *= 2;
+    }
+
+    if (ferror(file))
+    {
+        free(text);
+        return false;
+    }
+
+    text[length] = '\0';
+    *source = (jac_source){.text = text, .length = length, .mapped_size = 0};
+    return true;
+}
+
+#ifdef JAC_SOURCE_MMAP
+static bool map_source(int fd, size_t length, jac_source *source)
+{
+    // reserve at least one zeroed byte past the end of the file, then map the
+    // file over the front of the reservation. the file mapping zero-fills its
+    // last page, and the anonymous tail stands in as a sentinel page when the
+    // file ends exactly on a page boundary
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapped_size = (length / page + 1) * page;
+
+    char *text = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (text == MAP_FAILED)
+        return false;
+
+    if ((length > 0) && (mmap(text, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED))
+    {
+        munmap(text, mapped_size);
+        return false;
+    }
+
+    posix_madvise(text, length, POSIX_MADV_SEQUENTIAL);
+    *source = (jac_source){.text = text, .length = length, .mapped_size = mapped_size};
+    return true;
+}
+#endif
+
+bool jac_load_source(const char *path, jac_source *source)
+{
+    if (strcmp(path, "-") == 0)
+        return read_source(stdin, source);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+#ifdef JAC_SOURCE_MMAP
+    struct stat info;
+    int fd = fileno(file);
+    if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode) && map_source(fd, (size_t)info.st_size, source))
+    {
+        fclose(file);
+        return true;
+    }
+#endif
+
+    bool success = read_source(file, source);
+    fclose(file);
+    return success;
+}
+
+void jac_free_source(jac_source *source)
+{
+#ifdef JAC_SOURCE_MMAP
+    if (jac_source_is_mapped(source))
+    {
+        munmap((void *)source->text, source->mapped_size);
+        return;
+    }
+#endif
+
+    free((void *)source->text);
+}
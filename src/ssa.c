@@ -0,0 +1,1123 @@
+#include "ssa.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "arena.h"
+#include "assert.h"
+#include "darray.h"
+#include "ir.h"
+#include "trace.h"
+
+static void fill(uint32_t *values, uint32_t value, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        values[i] = value;
+}
+
+/*
+ * CFG
+ */
+
+// the predecessors come in the order of the blocks, so that building the CFG
+// again over the same edges keeps the phis in step
+void jac_build_cfg(jac_ir_function *function, jac_memory_arena *arena)
+{
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        darray_small_init(block->successors);
+        darray_small_init(block->predecessors);
+    }
+
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        jac_ir_block *block = function->blocks + b;
+        uint32_t targets = jac_ir_target_count(block);
+        for (uint32_t i = 0; i < targets; ++i)
+        {
+            uint32_t target = (*darray_last(block->instructions)).targets[i];
+            darray_small_push(block->successors, target, &arena->allocator);
+            darray_small_push(function->blocks[target].predecessors, b, &arena->allocator);
+        }
+    }
+}
+
+void jac_remove_edge(jac_ir_function *function, uint32_t from, uint32_t to)
+{
+    jac_ir_block_list *successors = &function->blocks[from].successors;
+    size_t s = darray_small_count(*successors);
+    while ((s > 0) && (darray_small_data(*successors)[s - 1] != to))
+        s -= 1;
+    JAC_ASSERT(s > 0, "no edge to remove.");
+    memmove(darray_small_data(*successors) + s - 1, darray_small_data(*successors) + s,
+            (darray_small_count(*successors) - s) * sizeof(uint32_t));
+    successors->count -= 1;
+
+    // the last of the edges from 'from', as they sit together
+    jac_ir_block *block = function->blocks + to;
+    size_t p = darray_small_count(block->predecessors);
+    while (darray_small_data(block->predecessors)[p - 1] != from)
+        p -= 1;
+    memmove(darray_small_data(block->predecessors) + p - 1, darray_small_data(block->predecessors) + p,
+            (darray_small_count(block->predecessors) - p) * sizeof(uint32_t));
+    block->predecessors.count -= 1;
+
+    darray_foreach(block->instructions, jac_ir_instruction, instruction)
+    {
+        if (instruction->op != JAC_IR_PHI)
+            break;
+        jac_ir_value *operands = darray_small_data(instruction->operands);
+        memmove(operands + p - 1, operands + p, (darray_small_count(instruction->operands) - p) * sizeof(jac_ir_value));
+        instruction->operands.count -= 1;
+    }
+}
+
+void jac_update_cfg(jac_ir_function *function, jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+
+    // the edges as they were, to find the one of each phi operand again
+    uint32_t *first = jac_arena_alloc_array(scratch, uint32_t, count + 1);
+    first[0] = 0;
+    for (uint32_t b = 0; b < count; ++b)
+        first[b + 1] = first[b] + (uint32_t)darray_small_count(function->blocks[b].predecessors);
+
+    uint32_t *before = jac_arena_alloc_array(scratch, uint32_t, first[count]);
+    bool *matched = jac_arena_alloc_array(scratch, bool, first[count]);
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        const jac_ir_block_list *predecessors = &function->blocks[b].predecessors;
+        memcpy(before + first[b], darray_small_data(*predecessors),
+               darray_small_count(*predecessors) * sizeof(uint32_t));
+    }
+
+    jac_build_cfg(function, arena);
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        jac_ir_block *block = function->blocks + b;
+        if ((darray_count(block->instructions) == 0) || (block->instructions[0].op != JAC_IR_PHI))
+            continue;
+
+        // each edge takes the first unmatched one from the same block. there
+        // are few predecessors, so the search is quadratic
+        uint32_t old_count = first[b + 1] - first[b];
+        memset(matched, 0, old_count * sizeof(bool));
+        size_t new_count = darray_small_count(block->predecessors);
+        uint32_t *source = jac_arena_alloc_array(scratch, uint32_t, new_count);
+        for (size_t j = 0; j < new_count; ++j)
+        {
+            source[j] = JAC_IR_NO_BLOCK;
+            for (uint32_t i = 0; i < old_count; ++i)
+            {
+                if (!matched[i] && (before[first[b] + i] == darray_small_data(block->predecessors)[j]))
+                {
+                    matched[i] = true;
+                    source[j] = i;
+                    break;
+                }
+            }
+        }
+
+        darray_foreach(block->instructions, jac_ir_instruction, instruction)
+        {
+            if (instruction->op != JAC_IR_PHI)
+                break;
+
+            jac_ir_value_list operands;
+            darray_small_init(operands);
+            for (size_t j = 0; j < new_count; ++j)
+            {
+                jac_ir_value value = {.holds = JAC_IR_VALUE_UNDEF};
+                if (source[j] != JAC_IR_NO_BLOCK)
+                    value = darray_small_data(instruction->operands)[source[j]];
+                darray_small_push(operands, value, &arena->allocator);
+            }
+            instruction->operands = operands;
+        }
+    }
+
+    jac_arena_rewind(scratch, mark);
+}
+
+/*
+ * DOMINATORS
+ */
+
+// the nearest common dominator, walking up from the one further down
+static uint32_t intersect(const uint32_t *idom, const uint32_t *postorder, uint32_t a, uint32_t b)
+{
+    while (a != b)
+    {
+        while (postorder[a] < postorder[b])
+            a = idom[a];
+        while (postorder[b] < postorder[a])
+            b = idom[b];
+    }
+    return a;
+}
+
+static uint32_t number_postorder(const jac_ir_function *function, jac_dominator_tree *tree, uint32_t *stack,
+                                 uint32_t *cursor)
+{
+    uint32_t numbered = 0, top = 0;
+    stack[top++] = 0;
+    cursor[0] = 0;
+
+    // the cursor of a block is the next edge to follow, or JAC_IR_NO_BLOCK
+    // before it is first seen
+    while (top > 0)
+    {
+        uint32_t b = stack[top - 1];
+        const jac_ir_block_list *successors = &function->blocks[b].successors;
+        if (cursor[b] < darray_small_count(*successors))
+        {
+            uint32_t successor = darray_small_data(*successors)[cursor[b]++];
+            if (cursor[successor] == JAC_IR_NO_BLOCK)
+            {
+                cursor[successor] = 0;
+                stack[top++] = successor;
+            }
+            continue;
+        }
+
+        tree->postorder[b] = numbered;
+        tree->order[numbered++] = b;
+        top -= 1;
+    }
+
+    for (uint32_t i = 0; i < numbered / 2; ++i)
+    {
+        uint32_t swap = tree->order[i];
+        tree->order[i] = tree->order[numbered - 1 - i];
+        tree->order[numbered - 1 - i] = swap;
+    }
+    return numbered;
+}
+
+// children of each block, grouped by parent, then preorder intervals over them
+static void number_tree(jac_dominator_tree *tree, uint32_t count, uint32_t *stack, uint32_t *cursor)
+{
+    memset(tree->first_child, 0, (count + 1) * sizeof(uint32_t));
+    for (uint32_t i = 1; i < tree->reachable; ++i)
+        tree->first_child[tree->idom[tree->order[i]] + 1] += 1;
+    for (uint32_t b = 0; b < count; ++b)
+        tree->first_child[b + 1] += tree->first_child[b];
+
+    memcpy(cursor, tree->first_child, count * sizeof(uint32_t));
+    for (uint32_t i = 1; i < tree->reachable; ++i)
+    {
+        uint32_t b = tree->order[i];
+        tree->children[cursor[tree->idom[b]]++] = b;
+    }
+
+    memset(tree->enter, 0, count * sizeof(uint32_t));
+    memset(tree->exit, 0, count * sizeof(uint32_t));
+    memcpy(cursor, tree->first_child, count * sizeof(uint32_t));
+
+    uint32_t clock = 0, top = 0;
+    stack[top++] = 0;
+    tree->enter[0] = clock++;
+    while (top > 0)
+    {
+        uint32_t b = stack[top - 1];
+        if (cursor[b] < tree->first_child[b + 1])
+        {
+            uint32_t child = tree->children[cursor[b]++];
+            tree->enter[child] = clock++;
+            stack[top++] = child;
+            continue;
+        }
+
+        tree->exit[b] = clock++;
+        top -= 1;
+    }
+}
+
+void jac_build_dominators(const jac_ir_function *function, jac_memory_arena *arena, jac_dominator_tree *tree)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    *tree = (jac_dominator_tree){
+        .idom = jac_arena_alloc_array(arena, uint32_t, count),
+        .postorder = jac_arena_alloc_array(arena, uint32_t, count),
+        .order = jac_arena_alloc_array(arena, uint32_t, count),
+        .children = jac_arena_alloc_array(arena, uint32_t, count),
+        .first_child = jac_arena_alloc_array(arena, uint32_t, count + 1),
+        .enter = jac_arena_alloc_array(arena, uint32_t, count),
+        .exit = jac_arena_alloc_array(arena, uint32_t, count),
+    };
+    fill(tree->idom, JAC_IR_NO_BLOCK, count);
+    fill(tree->postorder, JAC_IR_NO_BLOCK, count);
+    if (count == 0)
+        return;
+
+    uint32_t *stack = jac_arena_alloc_array(arena, uint32_t, count);
+    uint32_t *cursor = jac_arena_alloc_array(arena, uint32_t, count);
+    fill(cursor, JAC_IR_NO_BLOCK, count);
+    tree->reachable = number_postorder(function, tree, stack, cursor);
+
+    // predecessors not yet given a dominator are skipped, the unreachable
+    // ones included. in reverse postorder there is always one that has one
+    tree->idom[0] = 0;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (uint32_t i = 1; i < tree->reachable; ++i)
+        {
+            uint32_t b = tree->order[i];
+            uint32_t idom = JAC_IR_NO_BLOCK;
+            darray_small_foreach(function->blocks[b].predecessors, const uint32_t, predecessor)
+            {
+                if (tree->idom[*predecessor] == JAC_IR_NO_BLOCK)
+                    continue;
+                idom = (idom == JAC_IR_NO_BLOCK) ? *predecessor
+                                                 : intersect(tree->idom, tree->postorder, *predecessor, idom);
+            }
+
+            if (tree->idom[b] != idom)
+            {
+                tree->idom[b] = idom;
+                changed = true;
+            }
+        }
+    }
+
+    number_tree(tree, count, stack, cursor);
+}
+
+jac_ir_block_list *jac_dominance_frontiers(const jac_ir_function *function, const jac_dominator_tree *tree,
+                                           jac_memory_arena *arena)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    jac_ir_block_list *frontiers = jac_arena_alloc_array(arena, jac_ir_block_list, count);
+    for (uint32_t b = 0; b < count; ++b)
+        darray_small_init(frontiers[b]);
+
+    // each predecessor of a join, and its dominators up to the join's own, see
+    // the join in their frontier. a walk that meets it there already stops
+    for (uint32_t i = 0; i < tree->reachable; ++i)
+    {
+        uint32_t b = tree->order[i];
+        const jac_ir_block_list *predecessors = &function->blocks[b].predecessors;
+        if (darray_small_count(*predecessors) < 2)
+            continue;
+
+        darray_small_foreach(*predecessors, const uint32_t, predecessor)
+        {
+            if (!jac_is_reachable(tree, *predecessor))
+                continue;
+
+            for (uint32_t runner = *predecessor; runner != tree->idom[b]; runner = tree->idom[runner])
+            {
+                jac_ir_block_list *frontier = frontiers + runner;
+                size_t size = darray_small_count(*frontier);
+                if (size && (darray_small_data(*frontier)[size - 1] == b))
+                    break;
+                darray_small_push(*frontier, b, &arena->allocator);
+            }
+        }
+    }
+
+    return frontiers;
+}
+
+/*
+ * ESCAPE ANALYSIS
+ */
+
+// whether an instruction may let an address among its operands out of the
+// function. calls, returns and the stores left, to memory, do. so may the
+// arithmetic, for all that is known of it. phis only merge addresses
+static bool lets_out(enum jac_ir_op op)
+{
+    return op != JAC_IR_PHI;
+}
+
+// the slots whose every address stays within the function, when the slots
+// without one are values already. references can only be passed to functions,
+// never stored to memory or returned, and there is no dereference, so an
+// address that reaches nothing but phis is never read through
+static bool find_private_slots(const jac_ir_function *function, bool *promote, jac_memory_arena *scratch)
+{
+    size_t values = function->tmp_counter;
+    bool *escapes = jac_arena_alloc_array(scratch, bool, values);
+    const jac_ir_instruction **phi_of = jac_arena_alloc_array(scratch, const jac_ir_instruction *, values);
+    uint32_t *work = jac_arena_alloc_array(scratch, uint32_t, values);
+    memset(escapes, 0, values * sizeof(bool));
+    memset(phi_of, 0, values * sizeof(const jac_ir_instruction *));
+
+    uint32_t top = 0;
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if (instruction->op == JAC_IR_PHI)
+                phi_of[instruction->result.id] = instruction;
+            if (!lets_out(instruction->op))
+                continue;
+
+            darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+            {
+                if ((operand->holds == JAC_IR_VALUE_VARIABLE) && !escapes[operand->opt.variable.id])
+                {
+                    escapes[operand->opt.variable.id] = true;
+                    work[top++] = (uint32_t)operand->opt.variable.id;
+                }
+            }
+        }
+    }
+
+    // back through the phis, to the addresses they merge
+    while (top > 0)
+    {
+        const jac_ir_instruction *phi = phi_of[work[--top]];
+        if (!phi)
+            continue;
+
+        darray_small_foreach(phi->operands, const jac_ir_value, operand)
+        {
+            if ((operand->holds == JAC_IR_VALUE_VARIABLE) && !escapes[operand->opt.variable.id])
+            {
+                escapes[operand->opt.variable.id] = true;
+                work[top++] = (uint32_t)operand->opt.variable.id;
+            }
+        }
+    }
+
+    size_t locals = darray_count(function->locals);
+    memset(promote, true, locals * sizeof(bool));
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if ((instruction->op == JAC_IR_ADDR) && escapes[instruction->result.id])
+                promote[instruction->local] = false;
+        }
+    }
+
+    for (size_t local = 0; local < locals; ++local)
+    {
+        if (promote[local])
+            return true;
+    }
+    return false;
+}
+
+static bool reads_dropped(const jac_ir_instruction *instruction, const bool *dropped)
+{
+    darray_small_foreach(instruction->operands, const jac_ir_value, operand)
+    {
+        if ((operand->holds == JAC_IR_VALUE_VARIABLE) && dropped[operand->opt.variable.id])
+            return true;
+    }
+    return false;
+}
+
+// removes the addresses of the slots in 'promote', and the phis that merge
+// them. none of those escape, so nothing else reads them
+static void drop_addresses(jac_ir_function *function, const bool *promote, jac_memory_arena *scratch)
+{
+    bool *dropped = jac_arena_alloc_array(scratch, bool, function->tmp_counter);
+    memset(dropped, 0, function->tmp_counter * sizeof(bool));
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if ((instruction->op == JAC_IR_ADDR) && promote[instruction->local])
+                dropped[instruction->result.id] = true;
+        }
+    }
+
+    // phis over addresses are rare, and their chains short
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        darray_foreach(function->blocks, const jac_ir_block, block)
+        {
+            darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+            {
+                if ((instruction->op != JAC_IR_PHI) || dropped[instruction->result.id] ||
+                    !reads_dropped(instruction, dropped))
+                    continue;
+                dropped[instruction->result.id] = true;
+                changed = true;
+            }
+        }
+    }
+
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        size_t kept = 0;
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            bool has_result = (instruction->op == JAC_IR_ADDR) || (instruction->op == JAC_IR_PHI);
+            if (!has_result || !dropped[instruction->result.id])
+                block->instructions[kept++] = *instruction;
+        }
+        darray_truncate(block->instructions, kept);
+    }
+}
+
+/*
+ * CONSTRUCTION
+ */
+
+typedef struct phi phi;
+typedef struct renamer renamer;
+typedef struct renaming renaming;
+
+// a phi yet to be placed
+struct phi
+{
+    uint32_t local;
+    uint32_t next; // of the same block, or JAC_IR_NO_BLOCK
+    jac_ir_symbol result;
+    jac_ir_value_list operands;
+};
+
+// a binding the renamer undoes on leaving the block that made it
+struct renaming
+{
+    uint32_t local;
+    jac_ir_value previous;
+};
+
+struct renamer
+{
+    jac_ir_function *function;
+    const bool *promote;
+    jac_memory_arena *arena;
+
+    darray_t phi *phis;
+    uint32_t *first_phi; // per block
+    jac_ir_value *current; // per slot, its value at this point of the walk
+    darray_t renaming *undo;
+    jac_ir_value *replacements; // per value, for the results of the loads that go
+    bool *replaced;
+};
+
+static bool is_promoted(const renamer *renamer, const jac_ir_instruction *instruction)
+{
+    return ((instruction->op == JAC_IR_LOAD) || (instruction->op == JAC_IR_STORE)) &&
+           renamer->promote[instruction->local];
+}
+
+static void bind(renamer *renamer, uint32_t local, jac_ir_value value)
+{
+    darray_push(renamer->undo, ((renaming){.local = local, .previous = renamer->current[local]}));
+    renamer->current[local] = value;
+}
+
+static void unwind(renamer *renamer, size_t mark)
+{
+    while (darray_count(renamer->undo) > mark)
+    {
+        const renaming *last = darray_last(renamer->undo);
+        renamer->current[last->local] = last->previous;
+        darray_truncate(renamer->undo, darray_count(renamer->undo) - 1);
+    }
+}
+
+static void substitute(const renamer *renamer, jac_ir_instruction *instruction)
+{
+    darray_small_foreach(instruction->operands, jac_ir_value, operand)
+    {
+        if ((operand->holds == JAC_IR_VALUE_VARIABLE) && renamer->replaced[operand->opt.variable.id])
+            *operand = renamer->replacements[operand->opt.variable.id];
+    }
+}
+
+// the phis of the block bind first, then its stores in order. the loads read
+// whatever is bound, and the phis of the successors take what is left
+static void rename_block(renamer *renamer, uint32_t b)
+{
+    jac_ir_block *block = renamer->function->blocks + b;
+    for (uint32_t p = renamer->first_phi[b]; p != JAC_IR_NO_BLOCK; p = renamer->phis[p].next)
+    {
+        jac_ir_value value = {.opt.variable = renamer->phis[p].result, .holds = JAC_IR_VALUE_VARIABLE};
+        bind(renamer, renamer->phis[p].local, value);
+    }
+
+    darray_foreach(block->instructions, jac_ir_instruction, instruction)
+    {
+        substitute(renamer, instruction);
+        if (!is_promoted(renamer, instruction))
+            continue;
+
+        if (instruction->op == JAC_IR_LOAD)
+        {
+            renamer->replacements[instruction->result.id] = renamer->current[instruction->local];
+            renamer->replaced[instruction->result.id] = true;
+        }
+        else
+            bind(renamer, instruction->local, darray_small_data(instruction->operands)[0]);
+    }
+
+    darray_small_foreach(block->successors, const uint32_t, successor)
+    {
+        const jac_ir_block_list *predecessors = &renamer->function->blocks[*successor].predecessors;
+        for (uint32_t p = renamer->first_phi[*successor]; p != JAC_IR_NO_BLOCK; p = renamer->phis[p].next)
+        {
+            phi *phi = renamer->phis + p;
+            for (size_t i = 0; i < darray_small_count(*predecessors); ++i)
+            {
+                if (darray_small_data(*predecessors)[i] == b)
+                    darray_small_data(phi->operands)[i] = renamer->current[phi->local];
+            }
+        }
+    }
+}
+
+// down the dominator tree, so that every load sees the stores above it. the
+// unreachable blocks are renamed on their own, from nothing
+static void rename_blocks(renamer *renamer, const jac_dominator_tree *tree, jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(renamer->function->blocks);
+    uint32_t *stack = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *cursor = jac_arena_alloc_array(scratch, uint32_t, count);
+    size_t *marks = jac_arena_alloc_array(scratch, size_t, count);
+
+    uint32_t top = 0;
+    stack[top++] = 0;
+    cursor[0] = tree->first_child[0];
+    marks[0] = darray_count(renamer->undo);
+    rename_block(renamer, 0);
+    while (top > 0)
+    {
+        uint32_t b = stack[top - 1];
+        if (cursor[b] < tree->first_child[b + 1])
+        {
+            uint32_t child = tree->children[cursor[b]++];
+            cursor[child] = tree->first_child[child];
+            marks[child] = darray_count(renamer->undo);
+            rename_block(renamer, child);
+            stack[top++] = child;
+            continue;
+        }
+
+        unwind(renamer, marks[b]);
+        top -= 1;
+    }
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        if (jac_is_reachable(tree, b))
+            continue;
+        rename_block(renamer, b);
+        unwind(renamer, 0);
+    }
+}
+
+// semi-pruned: only slots read in some block before being stored in it need
+// phis at all, and those go on the iterated frontier of the stores
+static void place_phis(renamer *renamer, const jac_dominator_tree *tree, const jac_ir_block_list *frontiers,
+                       jac_memory_arena *scratch)
+{
+    jac_ir_function *function = renamer->function;
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    uint32_t locals = (uint32_t)darray_count(function->locals);
+
+    bool *crosses = jac_arena_alloc_array(scratch, bool, locals);
+    uint32_t *stored_in = jac_arena_alloc_array(scratch, uint32_t, locals);
+    jac_ir_block_list *stores = jac_arena_alloc_array(scratch, jac_ir_block_list, locals);
+    memset(crosses, 0, locals * sizeof(bool));
+    fill(stored_in, JAC_IR_NO_BLOCK, locals);
+    for (uint32_t local = 0; local < locals; ++local)
+        darray_small_init(stores[local]);
+
+    for (uint32_t i = 0; i < tree->reachable; ++i)
+    {
+        uint32_t b = tree->order[i];
+        darray_foreach(function->blocks[b].instructions, const jac_ir_instruction, instruction)
+        {
+            if (!is_promoted(renamer, instruction))
+                continue;
+
+            if (instruction->op == JAC_IR_LOAD)
+                crosses[instruction->local] |= (stored_in[instruction->local] != b);
+            else if (stored_in[instruction->local] != b)
+            {
+                stored_in[instruction->local] = b;
+                darray_small_push(stores[instruction->local], b, &scratch->allocator);
+            }
+        }
+    }
+
+    // marks of the slot last given a phi in, or queued for, each block
+    uint32_t *has_phi = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *queued = jac_arena_alloc_array(scratch, uint32_t, count);
+    uint32_t *work = jac_arena_alloc_array(scratch, uint32_t, count);
+    fill(has_phi, JAC_IR_NO_BLOCK, count);
+    fill(queued, JAC_IR_NO_BLOCK, count);
+
+    for (uint32_t local = 0; local < locals; ++local)
+    {
+        if (!renamer->promote[local] || !crosses[local])
+            continue;
+
+        uint32_t top = 0;
+        darray_small_foreach(stores[local], const uint32_t, b)
+        {
+            queued[*b] = local;
+            work[top++] = *b;
+        }
+
+        while (top > 0)
+        {
+            uint32_t b = work[--top];
+            darray_small_foreach(frontiers[b], const uint32_t, join)
+            {
+                if (has_phi[*join] != local)
+                {
+                    has_phi[*join] = local;
+
+                    phi phi = {
+                        .local = local,
+                        .next = renamer->first_phi[*join],
+                        .result = {.sym = function->locals[local].sym, .id = function->tmp_counter++},
+                    };
+                    phi.result.sym.identifier = (jac_token){.kind = JAC_TOKEN_EOF};
+
+                    // undefined along the edges the renamer does not fill in
+                    darray_small_init(phi.operands);
+                    size_t predecessors = darray_small_count(function->blocks[*join].predecessors);
+                    for (size_t i = 0; i < predecessors; ++i)
+                        darray_small_push(phi.operands, ((jac_ir_value){.holds = JAC_IR_VALUE_UNDEF}),
+                                          &renamer->arena->allocator);
+
+                    renamer->first_phi[*join] = (uint32_t)darray_count(renamer->phis);
+                    darray_push(renamer->phis, phi);
+                }
+
+                if (queued[*join] != local)
+                {
+                    queued[*join] = local;
+                    work[top++] = *join;
+                }
+            }
+        }
+    }
+}
+
+// drops the promoted loads and stores, renumbers the slots that are left, and
+// puts the phis in front
+static void rewrite_blocks(renamer *renamer, const uint32_t *slots)
+{
+    jac_ir_function *function = renamer->function;
+    darray_foreach(function->blocks, jac_ir_block, block)
+    {
+        size_t kept = 0;
+        darray_foreach(block->instructions, jac_ir_instruction, instruction)
+        {
+            if (is_promoted(renamer, instruction))
+                continue;
+
+            // phis from before may come ahead of the loads they read
+            if (instruction->op == JAC_IR_PHI)
+                substitute(renamer, instruction);
+            if ((instruction->op == JAC_IR_ADDR) || (instruction->op == JAC_IR_LOAD) ||
+                (instruction->op == JAC_IR_STORE))
+                instruction->local = slots[instruction->local];
+            block->instructions[kept++] = *instruction;
+        }
+        darray_truncate(block->instructions, kept);
+
+        uint32_t p = renamer->first_phi[block->id];
+        if (p == JAC_IR_NO_BLOCK)
+            continue;
+
+        darray_t jac_ir_instruction *instructions = jac_arena_darray_new(renamer->arena, jac_ir_instruction);
+        for (; p != JAC_IR_NO_BLOCK; p = renamer->phis[p].next)
+        {
+            const phi *phi = renamer->phis + p;
+            jac_ir_instruction instruction = {.op = JAC_IR_PHI, .result = phi->result, .operands = phi->operands};
+            darray_push(instructions, instruction);
+        }
+        if (kept > 0)
+            darray_append(instructions, block->instructions, kept);
+        block->instructions = instructions;
+    }
+
+    size_t kept = 0;
+    for (size_t local = 0; local < darray_count(function->locals); ++local)
+    {
+        if (renamer->promote[local])
+            continue;
+        function->locals[kept] = function->locals[local];
+        function->locals[kept].id = kept;
+        kept += 1;
+    }
+    darray_truncate(function->locals, kept);
+}
+
+void jac_promote_locals(jac_ir_function *function, const bool *promote, jac_memory_arena *arena,
+                        jac_memory_arena *scratch)
+{
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    uint32_t locals = (uint32_t)darray_count(function->locals);
+    if (count == 0)
+        return;
+
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+    uint32_t *slots = jac_arena_alloc_array(scratch, uint32_t, locals);
+    uint32_t kept = 0;
+    for (uint32_t local = 0; local < locals; ++local)
+        slots[local] = promote[local] ? JAC_IR_NO_BLOCK : kept++;
+
+    if (kept == locals)
+    {
+        jac_arena_rewind(scratch, mark);
+        return;
+    }
+
+    jac_dominator_tree tree;
+    jac_build_dominators(function, scratch, &tree);
+    jac_ir_block_list *frontiers = jac_dominance_frontiers(function, &tree, scratch);
+
+    renamer renamer = {
+        .function = function,
+        .promote = promote,
+        .arena = arena,
+        .phis = jac_arena_darray_new(scratch, phi),
+        .first_phi = jac_arena_alloc_array(scratch, uint32_t, count),
+        .current = jac_arena_alloc_array(scratch, jac_ir_value, locals),
+        .undo = jac_arena_darray_new(scratch, renaming),
+    };
+    fill(renamer.first_phi, JAC_IR_NO_BLOCK, count);
+    for (uint32_t local = 0; local < locals; ++local)
+        renamer.current[local] = (jac_ir_value){.holds = JAC_IR_VALUE_UNDEF};
+
+    place_phis(&renamer, &tree, frontiers, scratch);
+
+    // sized once the phis have their ids
+    renamer.replacements = jac_arena_alloc_array(scratch, jac_ir_value, function->tmp_counter);
+    renamer.replaced = jac_arena_alloc_array(scratch, bool, function->tmp_counter);
+    memset(renamer.replaced, 0, function->tmp_counter * sizeof(bool));
+
+    rename_blocks(&renamer, &tree, scratch);
+    rewrite_blocks(&renamer, slots);
+    jac_arena_rewind(scratch, mark);
+}
+
+void jac_construct_ssa(jac_ir_unit *unit, jac_memory_arena *arena)
+{
+    jac_memory_arena scratch;
+    jac_init_arena(&scratch);
+
+    darray_foreach(unit->functions, jac_ir_function, function)
+    {
+        if (!function->blocks)
+            continue;
+
+        uint64_t start = jac_begin_event();
+        jac_build_cfg(function, arena);
+
+        // the slots whose address is never taken first. the addresses stored
+        // in those are then values, which the escape analysis follows
+        size_t locals = darray_count(function->locals);
+        bool *promote = jac_arena_alloc_array(&scratch, bool, locals);
+        memset(promote, true, locals * sizeof(bool));
+        darray_foreach(function->blocks, const jac_ir_block, block)
+        {
+            darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+            {
+                if (instruction->op == JAC_IR_ADDR)
+                    promote[instruction->local] = false;
+            }
+        }
+
+        jac_promote_locals(function, promote, arena, &scratch);
+        jac_reset_arena(&scratch);
+
+        // then those whose addresses do not escape, leaving memory to the rest
+        if (darray_count(function->locals) > 0)
+        {
+            promote = jac_arena_alloc_array(&scratch, bool, darray_count(function->locals));
+            if (find_private_slots(function, promote, &scratch))
+            {
+                drop_addresses(function, promote, &scratch);
+                jac_promote_locals(function, promote, arena, &scratch);
+            }
+            jac_reset_arena(&scratch);
+        }
+
+        const jac_token *identifier = &function->header.identifier;
+        jac_end_event("function", JAC_PHASE_OPT, identifier->value, identifier->length, start);
+    }
+
+    jac_free_arena(&scratch);
+}
+
+/*
+ * VERIFIER
+ */
+
+typedef struct verifier verifier;
+
+struct verifier
+{
+    const jac_ir_unit *unit;
+    const jac_ir_function *function;
+    FILE *stream;
+    bool valid;
+
+    // per value, where it is defined. the arguments at position 0 of the
+    // entry, instructions at their index plus 1
+    uint32_t *defined_in;
+    uint32_t *defined_at;
+};
+
+static void fail(verifier *verifier, uint32_t block, const char *fmt, ...)
+{
+    const jac_token *identifier = &verifier->function->header.identifier;
+    fprintf(verifier->stream, "error: in '" JAC_TOKEN_FMT "', block %u: ", JAC_TOKEN_ARG(identifier), block);
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(verifier->stream, fmt, args);
+    va_end(args);
+
+    fputc('\n', verifier->stream);
+    verifier->valid = false;
+}
+
+// how many operands each op takes, where that is fixed
+static bool check_shape(verifier *verifier, uint32_t b, const jac_ir_instruction *instruction)
+{
+    const jac_ir_function *function = verifier->function;
+    size_t operands = darray_small_count(instruction->operands);
+    size_t blocks = darray_count(function->blocks);
+
+    switch (instruction->op)
+    {
+    case JAC_IR_RET:
+        if (operands > 1)
+            fail(verifier, b, "ret takes at most one value.");
+        break;
+
+    case JAC_IR_CALL:
+        if (instruction->callee >= darray_count(verifier->unit->functions))
+            fail(verifier, b, "call of a function that does not exist.");
+        else if (operands != darray_small_count(verifier->unit->functions[instruction->callee].header.args))
+            fail(verifier, b, "call with %zu arguments, of a function taking a different count.", operands);
+        break;
+
+    case JAC_IR_ADDR:
+    case JAC_IR_LOAD:
+    case JAC_IR_STORE:
+        if (instruction->local >= darray_count(function->locals))
+            fail(verifier, b, "%s of slot %u, which does not exist.",
+                 (instruction->op == JAC_IR_STORE) ? "store" : "load or addr", instruction->local);
+        if (operands != ((instruction->op == JAC_IR_STORE) ? 1 : 0))
+            fail(verifier, b, "load, store or addr with the wrong count of operands.");
+        break;
+
+    case JAC_IR_JUMP:
+    case JAC_IR_BRANCH:
+        for (uint32_t i = 0; i < ((instruction->op == JAC_IR_JUMP) ? 1u : 2u); ++i)
+        {
+            if (instruction->targets[i] >= blocks)
+                fail(verifier, b, "branch to block %u, which does not exist.", instruction->targets[i]);
+            else if (instruction->targets[i] == 0)
+                fail(verifier, b, "branch to the entry.");
+        }
+        if (operands != ((instruction->op == JAC_IR_JUMP) ? 0 : 1))
+            fail(verifier, b, "jump or branch with the wrong count of operands.");
+        break;
+
+    case JAC_IR_PHI:
+        if (operands != darray_small_count(function->blocks[b].predecessors))
+            fail(verifier, b, "phi with %zu operands, in a block with %zu predecessors.", operands,
+                 darray_small_count(function->blocks[b].predecessors));
+        break;
+
+    default:
+        if (jac_ir_is_binary(instruction->op) || jac_ir_is_unary(instruction->op))
+        {
+            if (operands != (jac_ir_is_unary(instruction->op) ? 1 : 2))
+                fail(verifier, b, "%s op with %zu operands.", jac_ir_is_unary(instruction->op) ? "unary" : "binary",
+                     operands);
+            break;
+        }
+        fail(verifier, b, "unknown op %d.", (int)instruction->op);
+    }
+
+    return verifier->valid;
+}
+
+// the edges are those of the terminators, in the order jac_build_cfg makes them
+static bool check_cfg(verifier *verifier, jac_memory_arena *scratch)
+{
+    const jac_ir_function *function = verifier->function;
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    uint32_t *seen = jac_arena_alloc_array(scratch, uint32_t, count);
+    memset(seen, 0, count * sizeof(uint32_t));
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        const jac_ir_block *block = function->blocks + b;
+        if (block->id != b)
+            fail(verifier, b, "block numbered %zu.", block->id);
+
+        size_t size = darray_count(block->instructions);
+        bool past_phis = false;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const jac_ir_instruction *instruction = block->instructions + i;
+            if (!check_shape(verifier, b, instruction))
+                return false;
+            if (jac_ir_is_terminator(instruction->op) && (i + 1 != size))
+                fail(verifier, b, "%s before the end of the block.",
+                     (instruction->op == JAC_IR_RET) ? "ret" : "branch");
+            if ((instruction->op == JAC_IR_PHI) && past_phis)
+                fail(verifier, b, "phi after other instructions.");
+            past_phis = past_phis || (instruction->op != JAC_IR_PHI);
+        }
+
+        uint32_t targets = jac_ir_target_count(block);
+        if (darray_small_count(block->successors) != targets)
+        {
+            fail(verifier, b, "%zu successors, for a terminator with %u targets.",
+                 darray_small_count(block->successors), targets);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < targets; ++i)
+        {
+            uint32_t target = (*darray_last(block->instructions)).targets[i];
+            const jac_ir_block_list *predecessors = &function->blocks[target].predecessors;
+            if (darray_small_data(block->successors)[i] != target)
+                fail(verifier, b, "successor %u is not the target of the terminator.", i);
+            else if ((seen[target] >= darray_small_count(*predecessors)) ||
+                     (darray_small_data(*predecessors)[seen[target]++] != b))
+                fail(verifier, target, "predecessors out of step with the edge from block %u.", b);
+        }
+    }
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        if (seen[b] != darray_small_count(function->blocks[b].predecessors))
+            fail(verifier, b, "predecessors without an edge.");
+    }
+
+    return verifier->valid;
+}
+
+static void define(verifier *verifier, uint32_t b, uint32_t position, size_t id)
+{
+    if (id >= verifier->function->tmp_counter)
+        fail(verifier, b, "value %%%zu past the count of values.", id);
+    else if (verifier->defined_in[id] != JAC_IR_NO_BLOCK)
+        fail(verifier, b, "value %%%zu defined twice, first in block %u.", id, verifier->defined_in[id]);
+    else
+    {
+        verifier->defined_in[id] = b;
+        verifier->defined_at[id] = position;
+    }
+}
+
+static void check_use(verifier *verifier, const jac_dominator_tree *tree, uint32_t b, uint32_t position,
+                      const jac_ir_instruction *instruction, size_t operand)
+{
+    const jac_ir_value *value = darray_small_data(instruction->operands) + operand;
+    bool is_phi = (instruction->op == JAC_IR_PHI);
+    bool reachable = jac_is_reachable(tree, b);
+
+    // literals and undef, which a load before any store becomes, are always defined
+    if (value->holds != JAC_IR_VALUE_VARIABLE)
+        return;
+
+    size_t id = value->opt.variable.id;
+    if ((id >= verifier->function->tmp_counter) || (verifier->defined_in[id] == JAC_IR_NO_BLOCK))
+    {
+        fail(verifier, b, "use of %%%zu, which is never defined.", id);
+        return;
+    }
+
+    if (!reachable)
+        return;
+
+    // a phi reads its operand at the end of the edge it comes in by
+    uint32_t in = verifier->defined_in[id];
+    if (is_phi)
+    {
+        uint32_t predecessor = darray_small_data(verifier->function->blocks[b].predecessors)[operand];
+        if (jac_is_reachable(tree, predecessor) && !jac_dominates(tree, in, predecessor))
+            fail(verifier, b, "phi operand %%%zu does not dominate the edge from block %u.", id, predecessor);
+        if (jac_ir_has_result(instruction->op) && (value->opt.variable.sym.type.id != instruction->result.sym.type.id))
+            fail(verifier, b, "phi operand %%%zu of another type.", id);
+    }
+    else if ((in == b) ? (verifier->defined_at[id] >= position) : !jac_dominates(tree, in, b))
+        fail(verifier, b, "use of %%%zu, which does not dominate it.", id);
+}
+
+bool jac_verify_function(const jac_ir_unit *unit, const jac_ir_function *function, jac_memory_arena *scratch,
+                         FILE *stream)
+{
+    jac_arena_mark mark = jac_arena_get_mark(scratch);
+    verifier verifier = {.unit = unit, .function = function, .stream = stream, .valid = true};
+
+    uint32_t count = (uint32_t)darray_count(function->blocks);
+    if (count == 0)
+        fail(&verifier, 0, "a definition without blocks.");
+    else if (darray_small_count(function->blocks[0].predecessors) > 0)
+        fail(&verifier, 0, "the entry has predecessors.");
+
+    if (!verifier.valid || !check_cfg(&verifier, scratch))
+    {
+        jac_arena_rewind(scratch, mark);
+        return false;
+    }
+
+    jac_dominator_tree tree;
+    jac_build_dominators(function, scratch, &tree);
+
+    verifier.defined_in = jac_arena_alloc_array(scratch, uint32_t, function->tmp_counter);
+    verifier.defined_at = jac_arena_alloc_array(scratch, uint32_t, function->tmp_counter);
+    fill(verifier.defined_in, JAC_IR_NO_BLOCK, function->tmp_counter);
+
+    for (size_t arg = 0; arg < darray_small_count(function->header.args); ++arg)
+        define(&verifier, 0, 0, arg);
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        const jac_ir_block *block = function->blocks + b;
+        for (size_t i = 0; i < darray_count(block->instructions); ++i)
+        {
+            if (jac_ir_has_result(block->instructions[i].op))
+                define(&verifier, b, (uint32_t)i + 1, block->instructions[i].result.id);
+        }
+    }
+
+    for (uint32_t b = 0; b < count; ++b)
+    {
+        const jac_ir_block *block = function->blocks + b;
+        for (size_t i = 0; i < darray_count(block->instructions); ++i)
+        {
+            const jac_ir_instruction *instruction = block->instructions + i;
+            for (size_t operand = 0; operand < darray_small_count(instruction->operands); ++operand)
+                check_use(&verifier, &tree, b, (uint32_t)i + 1, instruction, operand);
+        }
+    }
+
+    jac_arena_rewind(scratch, mark);
+    return verifier.valid;
+}
+
+bool jac_verify_unit(const jac_ir_unit *unit, FILE *stream)
+{
+    jac_memory_arena scratch;
+    jac_init_arena(&scratch);
+
+    bool valid = true;
+    darray_foreach(unit->functions, const jac_ir_function, function)
+    {
+        if (function->blocks && !jac_verify_function(unit, function, &scratch, stream))
+            valid = false;
+    }
+
+    jac_free_arena(&scratch);
+    return valid;
+}
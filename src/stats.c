@@ -0,0 +1,300 @@
+#include "stats.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "darray.h"
+#include "thread.h"
+#include "trace.h"
+
+bool jac_memory_stats_enabled = false;
+
+// counting may happen on the parse workers
+static jac_mutex lock = JAC_MUTEX_INIT;
+
+static enum jac_phase current_phase = JAC_PHASE_DRIVER;
+static jac_memory_stats phases[JAC_PHASE_COUNT];
+static size_t live, peak_live;
+
+static const char *phase_names[JAC_PHASE_COUNT] = {
+    [JAC_PHASE_DRIVER] = "driver", [JAC_PHASE_READ] = "read", [JAC_PHASE_LEX] = "lex",
+    [JAC_PHASE_PARSE] = "parse",   [JAC_PHASE_CHECK] = "check", [JAC_PHASE_OPT] = "opt",
+    [JAC_PHASE_GEN] = "gen",       [JAC_PHASE_WRITE] = "write",
+};
+
+const char *jac_phase_name(enum jac_phase phase)
+{
+    return phase_names[phase];
+}
+
+static void track_peak(void)
+{
+    if (live > phases[current_phase].peak_live)
+        phases[current_phase].peak_live = live;
+    if (live > peak_live)
+        peak_live = live;
+}
+
+enum jac_phase jac_enter_phase(enum jac_phase phase)
+{
+    enum jac_phase previous = current_phase;
+    if (jac_timing_enabled)
+        jac_charge_phase_time(previous);
+
+    current_phase = phase;
+    track_peak();
+    return previous;
+}
+
+void jac_count_arena_allocation(size_t size)
+{
+    jac_lock(&lock);
+    phases[current_phase].arena_allocations += 1;
+    phases[current_phase].arena_bytes += size;
+    jac_unlock(&lock);
+}
+
+/*
+ * ALLOCATION HOOKS
+ */
+
+#ifdef DARRAY_CUSTOM_ALLOC
+
+// counted blocks carry their size in front, padded to keep the alignment of malloc
+typedef union block_header block_header;
+
+union block_header
+{
+    size_t size;
+    long double align_;
+    void *align_pointer_;
+};
+
+bool jac_enable_memory_stats(void)
+{
+    jac_memory_stats_enabled = true;
+    return true;
+}
+
+void *darray_alloc(size_t count)
+{
+    if (!jac_memory_stats_enabled)
+        return malloc(count);
+
+    block_header *header = malloc(sizeof(block_header) + count);
+    if (!header)
+        return NULL;
+    header->size = count;
+
+    jac_lock(&lock);
+    phases[current_phase].allocations += 1;
+    phases[current_phase].bytes += count;
+    live += count;
+    track_peak();
+    jac_unlock(&lock);
+    return header + 1;
+}
+
+void *darray_realloc(void *ptr, size_t count)
+{
+    if (!jac_memory_stats_enabled)
+        return realloc(ptr, count);
+    if (!ptr)
+        return darray_alloc(count);
+
+    block_header *header = (block_header *)ptr - 1;
+    size_t old_count = header->size;
+
+    header = realloc(header, sizeof(block_header) + count);
+    if (!header)
+        return NULL;
+    header->size = count;
+
+    jac_lock(&lock);
+    phases[current_phase].reallocations += 1;
+    if (count > old_count)
+        phases[current_phase].bytes += count - old_count;
+    live += count - old_count;
+    track_peak();
+    jac_unlock(&lock);
+    return header + 1;
+}
+
+void darray_dealloc(void *ptr)
+{
+    if (!jac_memory_stats_enabled)
+    {
+        free(ptr);
+        return;
+    }
+    if (!ptr)
+        return;
+
+    block_header *header = (block_header *)ptr - 1;
+    jac_lock(&lock);
+    phases[current_phase].frees += 1;
+    live -= header->size;
+    jac_unlock(&lock);
+    free(header);
+}
+
+#else
+
+bool jac_enable_memory_stats(void)
+{
+    return false;
+}
+
+#endif
+
+/*
+ * REPORTING
+ */
+
+static jac_memory_stats total_stats(void)
+{
+    jac_memory_stats total = {0};
+    for (int phase = 0; phase < JAC_PHASE_COUNT; ++phase)
+    {
+        total.allocations += phases[phase].allocations;
+        total.reallocations += phases[phase].reallocations;
+        total.frees += phases[phase].frees;
+        total.bytes += phases[phase].bytes;
+        total.arena_allocations += phases[phase].arena_allocations;
+        total.arena_bytes += phases[phase].arena_bytes;
+    }
+
+    total.peak_live = peak_live;
+    return total;
+}
+
+static double per_line(size_t bytes, size_t lines)
+{
+    return lines ? (double)bytes / (double)lines : 0.0;
+}
+
+static void print_row(FILE *stream, const char *name, const jac_memory_stats *stats, size_t lines)
+{
+    fprintf(stream, "  %-8s %10zu %10zu %10zu %14zu %14zu %12zu %14zu %10.1f\n", name, stats->allocations,
+            stats->reallocations, stats->frees, stats->bytes, stats->peak_live, stats->arena_allocations,
+            stats->arena_bytes, per_line(stats->bytes, lines));
+}
+
+void jac_print_memory_stats(FILE *stream, size_t lines)
+{
+    fprintf(stream, "jac: memory statistics (%zu lines)\n", lines);
+    fprintf(stream, "  %-8s %10s %10s %10s %14s %14s %12s %14s %10s\n", "phase", "allocs", "reallocs", "frees",
+            "bytes", "peak live", "arena allocs", "arena bytes", "bytes/line");
+
+    for (int phase = 0; phase < JAC_PHASE_COUNT; ++phase)
+        print_row(stream, phase_names[phase], phases + phase, lines);
+
+    jac_memory_stats total = total_stats();
+    print_row(stream, "total", &total, lines);
+}
+
+static void write_json_stats(FILE *stream, const jac_memory_stats *stats, size_t lines)
+{
+    fprintf(stream,
+            "{\"allocations\": %zu, \"reallocations\": %zu, \"frees\": %zu, \"bytes\": %zu, \"peak_live_bytes\": %zu, "
+            "\"arena_allocations\": %zu, \"arena_bytes\": %zu, \"bytes_per_line\": %.2f}",
+            stats->allocations, stats->reallocations, stats->frees, stats->bytes, stats->peak_live,
+            stats->arena_allocations, stats->arena_bytes, per_line(stats->bytes, lines));
+}
+
+void jac_write_memory_stats_json(FILE *stream, const char *source_path, size_t source_bytes, size_t lines)
+{
+    fprintf(stream, "{\n  \"source\": \"");
+    for (const char *c = source_path; *c; ++c)
+    {
+        if ((*c == '"') || (*c == '\\'))
+            fputc('\\', stream);
+        fputc(*c, stream);
+    }
+    fprintf(stream, "\",\n  \"source_bytes\": %zu,\n  \"source_lines\": %zu,\n  \"memory\": {\n", source_bytes, lines);
+
+    for (int phase = 0; phase < JAC_PHASE_COUNT; ++phase)
+    {
+        fprintf(stream, "    \"%s\": ", phase_names[phase]);
+        write_json_stats(stream, phases + phase, lines);
+        fprintf(stream, ",\n");
+    }
+
+    jac_memory_stats total = total_stats();
+    fprintf(stream, "    \"total\": ");
+    write_json_stats(stream, &total, lines);
+    fprintf(stream, "\n  }\n}\n");
+}
+
+/*
+ * PASS STATISTICS
+ */
+
+static size_t counters[JAC_COUNTER_COUNT];
+
+static const char *counter_names[JAC_COUNTER_COUNT] = {
+    [JAC_COUNTER_FOLDED] = "folded instructions",
+    [JAC_COUNTER_FOLDED_BRANCHES] = "folded branches",
+    [JAC_COUNTER_UNREACHABLE_BLOCKS] = "unreachable blocks",
+    [JAC_COUNTER_DEAD_INSTRUCTIONS] = "dead instructions",
+    [JAC_COUNTER_DEAD_STORES] = "dead stores",
+    [JAC_COUNTER_MERGED_BLOCKS] = "merged blocks",
+    [JAC_COUNTER_INLINED] = "inlined calls",
+};
+
+void jac_count(enum jac_counter counter, size_t count)
+{
+    counters[counter] += count;
+}
+
+void jac_print_pass_stats(FILE *stream)
+{
+    fprintf(stream, "jac: pass statistics\n");
+    for (int counter = 0; counter < JAC_COUNTER_COUNT; ++counter)
+        fprintf(stream, "  %-24s %10zu\n", counter_names[counter], counters[counter]);
+}
+
+/*
+ * PASS REMARKS
+ */
+
+bool jac_remarks_enabled = false;
+
+static darray_t char *remarks = NULL;
+
+void jac_remark(const char *fmt, ...)
+{
+    if (!jac_remarks_enabled)
+        return;
+    if (!remarks)
+        remarks = darray_new(char);
+    darray_push(remarks, ' ');
+    darray_push(remarks, ' ');
+
+    va_list args, copy;
+    va_start(args, fmt);
+    va_copy(copy, args);
+    size_t length = (size_t)vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+
+    // room for the terminator vsnprintf writes, which is not counted
+    size_t count = darray_count(remarks);
+    if (darray_capacity(remarks) < count + length + 2)
+        darray_resize(remarks, 2 * (count + length + 2));
+    vsnprintf(remarks + count, length + 1, fmt, args);
+    va_end(args);
+
+    darray_truncate(remarks, count + length);
+    darray_push(remarks, '\n');
+}
+
+void jac_print_remarks(FILE *stream)
+{
+    fprintf(stream, "jac: remarks\n");
+    if (!remarks)
+        return;
+
+    fwrite(remarks, sizeof(char), darray_count(remarks), stream);
+    darray_free(remarks);
+    remarks = NULL;
+}
@@ -1,49 +1,319 @@
 #include "symbol.h"
 
+#include <string.h>
+
+#include "arena.h"
+#include "assert.h"
 #include "darray.h"
+#include "intern.h"
 #include "lex.h"
 
 static char type_coding[] = {
-    [JAC_TYPE_INT8] = 'c',   [JAC_TYPE_UINT8] = 'C', [JAC_TYPE_INT32] = 'i',
-    [JAC_TYPE_UINT32] = 'I', [JAC_TYPE_INT64] = 'l', [JAC_TYPE_UINT64] = 'L',
+    [JAC_TYPE_BOOL] = 'b',    [JAC_TYPE_INT8] = 'c',    [JAC_TYPE_UINT8] = 'C',  [JAC_TYPE_INT16] = 's',
+    [JAC_TYPE_UINT16] = 'S',  [JAC_TYPE_INT32] = 'i',   [JAC_TYPE_UINT32] = 'I', [JAC_TYPE_INT64] = 'l',
+    [JAC_TYPE_UINT64] = 'L',  [JAC_TYPE_FLOAT32] = 'f', [JAC_TYPE_FLOAT64] = 'd',
 };
 
-const char *jac_mangle_function_name(const jac_token *identifier, darray_t jac_symbol *args)
+// digits of the length, then the name itself
+static size_t name_length(const jac_token *token)
+{
+    size_t length = jac_token_length(token), digits = 1;
+    for (size_t n = length; n >= 10; n /= 10)
+        digits += 1;
+    return digits + length;
+}
+
+static char *put_name(char *end, const jac_token *token)
+{
+    end += sprintf(end, "%lu", jac_token_length(token));
+    memcpy(end, jac_token_value(token), jac_token_length(token));
+    return end + jac_token_length(token);
+}
+
+const char *jac_mangle_function_name(jac_memory_arena *arena, const jac_function *function)
 {
-    char mangled[1024];
+    // measured first, so the name takes just what it needs of the arena
+    size_t length = 2 + name_length(&function->identifier);
+    darray_small_foreach(function->args, const jac_symbol, arg)
+    {
+        if (arg->type.kind != JAC_TYPE_NONE)
+            length += arg->type.indirection + ((arg->type.kind == JAC_TYPE_CUSTOM) ? name_length(&arg->type.token) : 1);
+    }
+
+    char *mangled = jac_arena_alloc_impl(arena, length + 1);
     char *end = mangled;
     end[0] = '_';
     end[1] = 'N';
-    end += 2;
-
-    end += snprintf(end, 128, "%lu%s", identifier->diagnostics.length, identifier->value);
+    end = put_name(end + 2, &function->identifier);
 
-    darray_foreach(args, jac_symbol, arg)
+    darray_small_foreach(function->args, const jac_symbol, arg)
     {
         if (arg->type.kind == JAC_TYPE_NONE)
             continue;
 
-        for (size_t i = 0; i < arg->type.indirection; ++i)
-        {
-            *end = 'P';
-            end += 1;
-        }
+        memset(end, 'P', arg->type.indirection);
+        end += arg->type.indirection;
 
         if (arg->type.kind == JAC_TYPE_CUSTOM)
+            end = put_name(end, &arg->type.token);
+        else
+            *end++ = type_coding[arg->type.kind];
+    }
+
+    *end = '\0';
+    return mangled;
+}
+
+/*
+ * SYMBOL TABLE
+ */
+
+#define INITIAL_SLOTS 64
+
+static jac_symbol_slot *new_slots(size_t count)
+{
+    jac_symbol_slot *slots = DARRAY_ALLOC(count * sizeof(jac_symbol_slot));
+    JAC_ASSERT(slots != NULL, "no memory to allocate symbol table.");
+    memset(slots, 0, count * sizeof(jac_symbol_slot));
+    return slots;
+}
+
+// ids are handed out densely, so a multiplicative hash spreads them evenly
+static uint32_t find_slot(const jac_symbol_slot *slots, uint32_t slot_mask, jac_intern_id name)
+{
+    uint32_t slot = (name * 2654435761u) & slot_mask;
+    while ((slots[slot].name != name) && (slots[slot].name != JAC_INTERN_NONE))
+        slot = (slot + 1) & slot_mask;
+    return slot;
+}
+
+static void grow_slots(jac_symbol_table *table)
+{
+    uint32_t slot_mask = (table->slot_mask << 1) | 1;
+    jac_symbol_slot *slots = new_slots((size_t)slot_mask + 1);
+
+    for (uint32_t i = 0; i <= table->slot_mask; ++i)
+    {
+        if (table->slots[i].name != JAC_INTERN_NONE)
+            slots[find_slot(slots, slot_mask, table->slots[i].name)] = table->slots[i];
+    }
+
+    DARRAY_DEALLOC(table->slots);
+    table->slots = slots;
+    table->slot_mask = slot_mask;
+}
+
+void jac_init_symbol_table(jac_symbol_table *table)
+{
+    *table = (jac_symbol_table){
+        .slots = new_slots(INITIAL_SLOTS),
+        .slot_mask = INITIAL_SLOTS - 1,
+        .names = 0,
+        .bindings = darray_new(jac_binding),
+        .scopes = darray_new(uint32_t),
+    };
+    jac_push_scope(table);
+}
+
+void jac_push_scope(jac_symbol_table *table)
+{
+    darray_push(table->scopes, (uint32_t)darray_count(table->bindings));
+}
+
+void jac_pop_scope(jac_symbol_table *table)
+{
+    JAC_ASSERT(darray_count(table->scopes) > 0, "no scope to pop.");
+    uint32_t start = *darray_last(table->scopes);
+    darray_truncate(table->scopes, darray_count(table->scopes) - 1);
+
+    // the names stay in the table, bound to whatever they were before
+    for (size_t i = darray_count(table->bindings); i > start; --i)
+    {
+        const jac_binding *binding = table->bindings + i - 1;
+        table->slots[find_slot(table->slots, table->slot_mask, binding->name)].binding = binding->shadowed;
+    }
+    darray_truncate(table->bindings, start);
+}
+
+bool jac_declare_symbol(jac_symbol_table *table, jac_intern_id name, uint32_t value, uint32_t *previous)
+{
+    JAC_ASSERT(name != JAC_INTERN_NONE, "cannot declare an unnamed symbol.");
+
+    uint32_t slot = find_slot(table->slots, table->slot_mask, name);
+    if (table->slots[slot].name == JAC_INTERN_NONE)
+    {
+        // at most half full
+        if ((table->names + 1) * 2 > table->slot_mask + 1)
         {
-            end += snprintf(end, 128, "%lu%s", arg->type.token->diagnostics.length, arg->type.token->value);
+            grow_slots(table);
+            slot = find_slot(table->slots, table->slot_mask, name);
         }
-        else
+
+        table->slots[slot].name = name;
+        table->names += 1;
+    }
+
+    uint32_t innermost = table->slots[slot].binding;
+    if (innermost > *darray_last(table->scopes))
+    {
+        if (previous)
+            *previous = table->bindings[innermost - 1].value;
+        return false;
+    }
+
+    darray_push(table->bindings, ((jac_binding){.name = name, .value = value, .shadowed = innermost}));
+    table->slots[slot].binding = (uint32_t)darray_count(table->bindings);
+    return true;
+}
+
+bool jac_lookup_symbol(const jac_symbol_table *table, jac_intern_id name, uint32_t *value)
+{
+    const jac_symbol_slot *slot = table->slots + find_slot(table->slots, table->slot_mask, name);
+    if (slot->binding == 0)
+        return false;
+
+    *value = table->bindings[slot->binding - 1].value;
+    return true;
+}
+
+void jac_free_symbol_table(jac_symbol_table *table)
+{
+    DARRAY_DEALLOC(table->slots);
+    darray_free(table->bindings);
+    darray_free(table->scopes);
+}
+
+/*
+ * FUNCTION INDEX
+ */
+
+static jac_overload_slot *new_overload_slots(size_t count)
+{
+    jac_overload_slot *slots = DARRAY_ALLOC(count * sizeof(jac_overload_slot));
+    JAC_ASSERT(slots != NULL, "no memory to allocate function index.");
+    memset(slots, 0, count * sizeof(jac_overload_slot));
+    return slots;
+}
+
+static uint32_t find_overload_slot(const jac_overload_slot *slots, uint32_t slot_mask, jac_intern_id name,
+                                   uint32_t arity)
+{
+    uint32_t slot = ((name * 2654435761u) ^ (arity * 2246822519u)) & slot_mask;
+    while ((slots[slot].name != JAC_INTERN_NONE) && ((slots[slot].name != name) || (slots[slot].arity != arity)))
+        slot = (slot + 1) & slot_mask;
+    return slot;
+}
+
+static void grow_overload_slots(jac_function_index *index)
+{
+    uint32_t slot_mask = (index->slot_mask << 1) | 1;
+    jac_overload_slot *slots = new_overload_slots((size_t)slot_mask + 1);
+
+    for (uint32_t i = 0; i <= index->slot_mask; ++i)
+    {
+        const jac_overload_slot *slot = index->slots + i;
+        if (slot->name != JAC_INTERN_NONE)
+            slots[find_overload_slot(slots, slot_mask, slot->name, slot->arity)] = *slot;
+    }
+
+    DARRAY_DEALLOC(index->slots);
+    index->slots = slots;
+    index->slot_mask = slot_mask;
+}
+
+uint32_t jac_signature_hash(const jac_type_id *params, uint32_t arity)
+{
+    uint32_t hash = 0x811c9dc5u ^ arity;
+    for (uint32_t i = 0; i < arity; ++i)
+        hash = (hash ^ params[i]) * 0x01000193u;
+    return hash;
+}
+
+static const jac_overload *find_in_list(const jac_function_index *index, const jac_overload *overload,
+                                        const jac_type_id *params, uint32_t arity, uint32_t hash)
+{
+    for (; overload; overload = jac_next_overload(index, overload))
+    {
+        if ((overload->hash == hash) &&
+            (memcmp(jac_overload_params(index, overload), params, arity * sizeof(jac_type_id)) == 0))
+            return overload;
+    }
+    return NULL;
+}
+
+void jac_init_function_index(jac_function_index *index)
+{
+    *index = (jac_function_index){
+        .slots = new_overload_slots(INITIAL_SLOTS),
+        .slot_mask = INITIAL_SLOTS - 1,
+        .used = 0,
+        .overloads = darray_new(jac_overload),
+        .types = darray_new(jac_type_id),
+    };
+}
+
+bool jac_add_overload(jac_function_index *index, jac_intern_id name, const jac_type_id *params, uint32_t arity,
+                      uint32_t function, uint32_t *previous)
+{
+    JAC_ASSERT(name != JAC_INTERN_NONE, "cannot index an unnamed function.");
+
+    uint32_t hash = jac_signature_hash(params, arity);
+    uint32_t slot = find_overload_slot(index->slots, index->slot_mask, name, arity);
+    if (index->slots[slot].name == JAC_INTERN_NONE)
+    {
+        // at most half full
+        if ((index->used + 1) * 2 > index->slot_mask + 1)
         {
-            *end = type_coding[arg->type.kind];
-            end += 1;
+            grow_overload_slots(index);
+            slot = find_overload_slot(index->slots, index->slot_mask, name, arity);
         }
+
+        index->slots[slot] = (jac_overload_slot){.name = name, .arity = arity, .first = 0};
+        index->used += 1;
     }
 
-    *end = '\0';
-    end += 1;
+    const jac_overload *same = find_in_list(index, jac_first_overload(index, name, arity), params, arity, hash);
+    if (same)
+    {
+        if (previous)
+            *previous = same->function;
+        return false;
+    }
 
-    char *out = malloc(end - mangled);
-    strcpy(out, mangled);
-    return out;
+    jac_overload overload = {
+        .function = function,
+        .hash = hash,
+        .params = (uint32_t)darray_count(index->types),
+        .next = index->slots[slot].first,
+    };
+    if (arity > 0)
+        darray_append(index->types, params, arity);
+    darray_push(index->overloads, overload);
+    index->slots[slot].first = (uint32_t)darray_count(index->overloads);
+    return true;
+}
+
+const jac_overload *jac_first_overload(const jac_function_index *index, jac_intern_id name, uint32_t arity)
+{
+    const jac_overload_slot *slot = index->slots + find_overload_slot(index->slots, index->slot_mask, name, arity);
+    return slot->first ? index->overloads + slot->first - 1 : NULL;
+}
+
+bool jac_find_overload(const jac_function_index *index, jac_intern_id name, const jac_type_id *params, uint32_t arity,
+                       uint32_t *function)
+{
+    const jac_overload *overload = find_in_list(index, jac_first_overload(index, name, arity), params, arity,
+                                                jac_signature_hash(params, arity));
+    if (!overload)
+        return false;
+
+    *function = overload->function;
+    return true;
+}
+
+void jac_free_function_index(jac_function_index *index)
+{
+    DARRAY_DEALLOC(index->slots);
+    darray_free(index->overloads);
+    darray_free(index->types);
 }
@@ -0,0 +1,142 @@
+#define _DEFAULT_SOURCE
+
+#include "thread.h"
+
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#define MAX_THREADS 64
+
+typedef struct work_queue work_queue;
+
+struct work_queue
+{
+    jac_mutex mutex;
+    size_t next, count;
+    void (*work)(void *context, size_t index);
+    void *context;
+};
+
+void jac_lock(jac_mutex *mutex)
+{
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void jac_unlock(jac_mutex *mutex)
+{
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+jac_thread_id jac_current_thread(void)
+{
+#if defined(_WIN32)
+    return GetCurrentThreadId();
+#else
+    return pthread_self();
+#endif
+}
+
+bool jac_same_thread(jac_thread_id a, jac_thread_id b)
+{
+#if defined(_WIN32)
+    return a == b;
+#else
+    return pthread_equal(a, b) != 0;
+#endif
+}
+
+unsigned jac_hardware_threads(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (unsigned)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (unsigned)count : 1;
+#endif
+}
+
+// items are coarse, so a locked counter is plenty
+static void drain(work_queue *queue)
+{
+    for (;;)
+    {
+        jac_lock(&queue->mutex);
+        size_t index = queue->next;
+        if (index < queue->count)
+            queue->next += 1;
+        jac_unlock(&queue->mutex);
+
+        if (index >= queue->count)
+            return;
+        queue->work(queue->context, index);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI run_worker(LPVOID queue)
+{
+    drain(queue);
+    return 0;
+}
+#else
+static void *run_worker(void *queue)
+{
+    drain(queue);
+    return NULL;
+}
+#endif
+
+void jac_parallel_for(size_t count, unsigned threads, void (*work)(void *context, size_t index), void *context)
+{
+    work_queue queue = {.mutex = JAC_MUTEX_INIT, .next = 0, .count = count, .work = work, .context = context};
+
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if (threads > count)
+        threads = (unsigned)count;
+
+    // the caller is one of the threads. a worker that fails to start only
+    // leaves more of the items to the others
+#if defined(_WIN32)
+    HANDLE workers[MAX_THREADS];
+    unsigned started = 0;
+    for (unsigned i = 1; i < threads; ++i)
+    {
+        workers[started] = CreateThread(NULL, 0, run_worker, &queue, 0, NULL);
+        if (workers[started])
+            started += 1;
+    }
+
+    drain(&queue);
+    for (unsigned i = 0; i < started; ++i)
+    {
+        WaitForSingleObject(workers[i], INFINITE);
+        CloseHandle(workers[i]);
+    }
+#else
+    pthread_t workers[MAX_THREADS];
+    unsigned started = 0;
+    for (unsigned i = 1; i < threads; ++i)
+    {
+        if (pthread_create(&workers[started], NULL, run_worker, &queue) == 0)
+            started += 1;
+    }
+
+    drain(&queue);
+    for (unsigned i = 0; i < started; ++i)
+        pthread_join(workers[i], NULL);
+#endif
+}
@@ -0,0 +1,259 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "darray.h"
+#include "thread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define SLOWEST_FUNCTIONS 10
+
+bool jac_timing_enabled = false;
+bool jac_events_enabled = false;
+
+static uint64_t origin, last_switch;
+static uint64_t phase_times[JAC_PHASE_COUNT];
+
+static darray_t jac_trace_event *events = NULL;
+static darray_t char *names = NULL;
+
+// functions are parsed on several threads with -j. each thread that records
+// an event is numbered by its place here, from 1
+static darray_t jac_thread_id *threads = NULL;
+static jac_mutex lock = JAC_MUTEX_INIT;
+
+uint64_t jac_now(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void jac_enable_timing(bool record_events)
+{
+    jac_timing_enabled = true;
+    jac_events_enabled = record_events;
+    origin = last_switch = jac_now();
+
+    if (record_events)
+    {
+        events = darray_new(jac_trace_event);
+        names = darray_new(char);
+        threads = darray_new(jac_thread_id);
+        darray_push(threads, jac_current_thread());
+    }
+}
+
+void jac_charge_phase_time(enum jac_phase phase)
+{
+    uint64_t now = jac_now();
+    phase_times[phase] += now - last_switch;
+    last_switch = now;
+}
+
+uint64_t jac_phase_time(enum jac_phase phase)
+{
+    return phase_times[phase];
+}
+
+// the number of the calling thread, under the lock. there are only ever a
+// handful of threads
+static uint32_t current_thread(void)
+{
+    jac_thread_id self = jac_current_thread();
+    size_t count = darray_count(threads);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (jac_same_thread(threads[i], self))
+            return (uint32_t)i + 1;
+    }
+
+    darray_push(threads, self);
+    return (uint32_t)count + 1;
+}
+
+void jac_end_event(const char *category, enum jac_phase phase, const char *name, size_t length, uint64_t start)
+{
+    if (!jac_events_enabled)
+        return;
+
+    uint64_t end = jac_now();
+    jac_lock(&lock);
+
+    jac_trace_event event = {
+        .category = category,
+        .name = darray_count(names),
+        .phase = phase,
+        .start = start - origin,
+        .duration = end - start,
+        .thread = current_thread(),
+        .dropped = false,
+    };
+    darray_push(events, event);
+
+    for (size_t i = 0; i < length; ++i)
+        darray_push(names, name[i]);
+    darray_push(names, '\0');
+
+    jac_unlock(&lock);
+}
+
+jac_event_range jac_begin_event_range(void)
+{
+    jac_event_range range = {0};
+    if (!jac_events_enabled)
+        return range;
+
+    jac_lock(&lock);
+    range.begin = range.end = darray_count(events);
+    range.thread = current_thread();
+    jac_unlock(&lock);
+    return range;
+}
+
+void jac_end_event_range(jac_event_range *range)
+{
+    if (!jac_events_enabled)
+        return;
+
+    jac_lock(&lock);
+    range->end = darray_count(events);
+    jac_unlock(&lock);
+}
+
+// other threads may have recorded events in between, those are kept
+void jac_drop_event_range(const jac_event_range *range)
+{
+    for (size_t i = range->begin; i < range->end; ++i)
+    {
+        if (events[i].thread == range->thread)
+            events[i].dropped = true;
+    }
+}
+
+/*
+ * REPORTING
+ */
+
+static double milliseconds(uint64_t nanoseconds)
+{
+    return (double)nanoseconds / 1e6;
+}
+
+static int by_duration(const void *a, const void *b)
+{
+    const jac_trace_event *left = a, *right = b;
+    return (left->duration < right->duration) - (left->duration > right->duration);
+}
+
+static void print_slowest_functions(FILE *stream)
+{
+    darray_t jac_trace_event *functions = darray_new(jac_trace_event);
+    darray_foreach(events, jac_trace_event, event)
+    {
+        if (!event->dropped && (strcmp(event->category, "function") == 0))
+            darray_push(functions, *event);
+    }
+
+    qsort(functions, darray_count(functions), sizeof(jac_trace_event), by_duration);
+
+    size_t count = darray_count(functions);
+    fprintf(stream, "  slowest functions (%zu timed)\n", count);
+    for (size_t i = 0; (i < count) && (i < SLOWEST_FUNCTIONS); ++i)
+        fprintf(stream, "  %-8s %12.3f  %s\n", jac_phase_name(functions[i].phase), milliseconds(functions[i].duration),
+                names + functions[i].name);
+
+    darray_free(functions);
+}
+
+void jac_print_time_report(FILE *stream, bool functions)
+{
+    jac_charge_phase_time(JAC_PHASE_DRIVER);
+
+    uint64_t total = 0;
+    for (int phase = 0; phase < JAC_PHASE_COUNT; ++phase)
+        total += phase_times[phase];
+
+    fprintf(stream, "jac: time report (wall clock)\n");
+    fprintf(stream, "  %-8s %12s %7s\n", "phase", "ms", "%");
+    for (int phase = 0; phase < JAC_PHASE_COUNT; ++phase)
+        fprintf(stream, "  %-8s %12.3f %7.1f\n", jac_phase_name(phase), milliseconds(phase_times[phase]),
+                total ? 100.0 * (double)phase_times[phase] / (double)total : 0.0);
+    fprintf(stream, "  %-8s %12.3f %7.1f\n", "total", milliseconds(total), 100.0);
+
+    if (functions && jac_events_enabled)
+        print_slowest_functions(stream);
+}
+
+static void write_string(FILE *stream, const char *string)
+{
+    fputc('"', stream);
+    for (const char *c = string; *c; ++c)
+    {
+        if ((*c == '"') || (*c == '\\'))
+            fputc('\\', stream);
+        fputc(*c, stream);
+    }
+    fputc('"', stream);
+}
+
+void jac_write_trace(FILE *stream, const char *source_path)
+{
+    fprintf(stream, "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"source\": ");
+    write_string(stream, source_path);
+    fprintf(stream, "},\n\"traceEvents\": [\n");
+    fprintf(stream, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"jac\"}}");
+    for (size_t thread = 1; thread <= darray_count(threads); ++thread)
+    {
+        fprintf(stream, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %zu, ", thread);
+        if (thread == 1)
+            fprintf(stream, "\"args\": {\"name\": \"main\"}}");
+        else
+            fprintf(stream, "\"args\": {\"name\": \"worker %zu\"}}", thread - 1);
+    }
+
+    // timestamps and durations are in microseconds
+    darray_foreach(events, jac_trace_event, event)
+    {
+        if (event->dropped)
+            continue;
+
+        fprintf(stream, ",\n{\"name\": ");
+        write_string(stream, names + event->name);
+        fprintf(stream,
+                ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, "
+                "\"args\": {\"phase\": \"%s\"}}",
+                event->category, (unsigned)event->thread, (double)event->start / 1e3, (double)event->duration / 1e3,
+                jac_phase_name(event->phase));
+    }
+
+    fprintf(stream, "\n]}\n");
+}
+
+void jac_free_trace(void)
+{
+    if (!events)
+        return;
+
+    darray_free(events);
+    darray_free(names);
+    darray_free(threads);
+    events = NULL;
+    names = NULL;
+    threads = NULL;
+}
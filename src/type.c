@@ -0,0 +1,158 @@
+#include "type.h"
+
+#include <string.h>
+
+#include "arena.h"
+#include "assert.h"
+#include "darray.h"
+
+#define INITIAL_SLOTS 64
+
+#define POINTER_SIZE 8
+
+static const uint32_t primitive_sizes[] = {
+    [JAC_TYPE_NONE] = 0,    [JAC_TYPE_CUSTOM] = 0,  [JAC_TYPE_BOOL] = 1,   [JAC_TYPE_INT8] = 1,
+    [JAC_TYPE_UINT8] = 1,   [JAC_TYPE_INT16] = 2,   [JAC_TYPE_UINT16] = 2, [JAC_TYPE_INT32] = 4,
+    [JAC_TYPE_UINT32] = 4,  [JAC_TYPE_INT64] = 8,   [JAC_TYPE_UINT64] = 8, [JAC_TYPE_FLOAT32] = 4,
+    [JAC_TYPE_FLOAT64] = 8,
+};
+
+static jac_type_id *new_slots(jac_memory_arena *arena, size_t count)
+{
+    jac_type_id *slots = jac_arena_alloc_impl(arena, count * sizeof(jac_type_id));
+    memset(slots, 0, count * sizeof(jac_type_id));
+    return slots;
+}
+
+static uint32_t hash_type(const jac_type_info *info)
+{
+    uint32_t hash = (0x811c9dc5u ^ info->form) * 0x01000193u;
+    hash = (hash ^ info->base) * 0x01000193u;
+    hash = (hash ^ info->count) * 0x01000193u;
+    return (hash ^ info->name) * 0x01000193u;
+}
+
+static bool same_type(const jac_type_info *a, const jac_type_info *b)
+{
+    return (a->form == b->form) && (a->base == b->base) && (a->count == b->count) && (a->name == b->name);
+}
+
+static uint32_t find_slot(const jac_type_table *table, const jac_type_id *slots, uint32_t slot_mask,
+                          const jac_type_info *info)
+{
+    uint32_t slot = hash_type(info) & slot_mask;
+    while (slots[slot] && !same_type(table->types + slots[slot], info))
+        slot = (slot + 1) & slot_mask;
+    return slot;
+}
+
+static void grow_slots(jac_type_table *table)
+{
+    uint32_t slot_mask = (table->slot_mask << 1) | 1;
+    jac_type_id *slots = new_slots(table->arena, (size_t)slot_mask + 1);
+
+    for (uint32_t i = 0; i <= table->slot_mask; ++i)
+    {
+        if (table->slots[i])
+            slots[find_slot(table, slots, slot_mask, table->types + table->slots[i])] = table->slots[i];
+    }
+
+    // the old slots stay in the arena until it goes
+    table->slots = slots;
+    table->slot_mask = slot_mask;
+}
+
+void jac_init_type_table(jac_type_table *table, jac_memory_arena *arena)
+{
+    *table = (jac_type_table){
+        .types = jac_arena_darray_new(arena, jac_type_info),
+        .slots = new_slots(arena, INITIAL_SLOTS),
+        .slot_mask = INITIAL_SLOTS - 1,
+        .arena = arena,
+    };
+
+    // the primitives take the ids of their kinds. the one of JAC_TYPE_CUSTOM
+    // stands for no type in particular, like that of JAC_TYPE_NONE
+    for (int kind = JAC_TYPE_NONE; kind <= JAC_TYPE_FLOAT64; ++kind)
+    {
+        uint32_t size = primitive_sizes[kind];
+        jac_type_info info = {
+            .form = JAC_TYPE_FORM_PRIMITIVE,
+            .kind = (uint8_t)kind,
+            .size = size,
+            .alignment = size ? size : 1,
+        };
+        darray_push(table->types, info);
+    }
+}
+
+// the id of the one type like 'info', which is added if it is new
+static jac_type_id intern_info(jac_type_table *table, jac_type_info info)
+{
+    uint32_t slot = find_slot(table, table->slots, table->slot_mask, &info);
+    if (table->slots[slot])
+        return table->slots[slot];
+
+    // at most half full, the primitives are not in the slots
+    size_t composites = darray_count(table->types) - (JAC_TYPE_FLOAT64 + 1);
+    if ((composites + 1) * 2 > (size_t)table->slot_mask + 1)
+    {
+        grow_slots(table);
+        slot = find_slot(table, table->slots, table->slot_mask, &info);
+    }
+
+    jac_type_id id = (jac_type_id)darray_count(table->types);
+    darray_push(table->types, info);
+    table->slots[slot] = id;
+    return id;
+}
+
+jac_type_id jac_pointer_type(jac_type_table *table, jac_type_id base)
+{
+    jac_type_info info = {
+        .form = JAC_TYPE_FORM_POINTER,
+        .kind = JAC_TYPE_CUSTOM,
+        .base = base,
+        .size = POINTER_SIZE,
+        .alignment = POINTER_SIZE,
+    };
+    return intern_info(table, info);
+}
+
+jac_type_id jac_array_type(jac_type_table *table, jac_type_id element, uint32_t count)
+{
+    const jac_type_info *of = jac_type_info_of(table, element);
+    jac_type_info info = {
+        .form = JAC_TYPE_FORM_ARRAY,
+        .kind = JAC_TYPE_CUSTOM,
+        .base = element,
+        .count = count,
+        .size = of->size * count,
+        .alignment = of->alignment,
+    };
+    return intern_info(table, info);
+}
+
+jac_type_id jac_custom_type(jac_type_table *table, jac_intern_id name)
+{
+    JAC_ASSERT(name != JAC_INTERN_NONE, "cannot intern an unnamed type.");
+
+    // incomplete, until there are struct declarations to lay it out
+    jac_type_info info = {
+        .form = JAC_TYPE_FORM_CUSTOM,
+        .kind = JAC_TYPE_CUSTOM,
+        .name = name,
+        .size = 0,
+        .alignment = 1,
+    };
+    return intern_info(table, info);
+}
+
+jac_type_id jac_intern_type(jac_type_table *table, const jac_type *type)
+{
+    jac_type_id id = (type->kind == JAC_TYPE_CUSTOM) ? jac_custom_type(table, type->token.id)
+                                                     : jac_primitive_type(type->kind);
+    for (uint8_t i = 0; i < type->indirection; ++i)
+        id = jac_pointer_type(table, id);
+    return id;
+}
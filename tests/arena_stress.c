@@ -0,0 +1,403 @@
+/*
+ * Stresses the memory arena, on its own and under the whole compiler. A
+ * generated source of a few megabytes is parsed, checked and optimized, and
+ * every AST node must still read back what the source says once the arenas
+ * have been through all of that. Then the arena is churned directly, with
+ * allocations of every size and alignment, arena darrays, marks and rewinds,
+ * and every allocation must keep its contents until it is released.
+ *
+ * usage: arena_stress [<megabytes>]
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "intern.h"
+#include "ir.h"
+#include "lex.h"
+#include "opt.h"
+#include "ssa.h"
+#include "test.h"
+
+/*
+ * GENERATED SOURCE
+ */
+
+static void append(darray_t char **text, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof line, format, args);
+    va_end(args);
+
+    for (int i = 0; i < length; ++i)
+        darray_push(*text, line[i]);
+}
+
+// identifiers of every length, so the interner's storage is carved up unevenly
+static void append_name(darray_t char **text, const char *prefix, uint32_t n)
+{
+    append(text, "%s%u", prefix, n);
+    for (uint32_t i = test_random(40); i > 0; --i)
+        darray_push(*text, "abcxyz_"[test_random(7)]);
+}
+
+// functions of nested scopes, with variables, calls and string literals, both
+// escaped and plain, until the source is 'size' bytes long
+static darray_t char *generate_source(size_t size, size_t *functions)
+{
+    darray_t char *text = darray_new(char);
+    append(&text, "extern {\n    func puts(*u8: s) -> i32;\n    func sink(i64: v) -> i64;\n}\n");
+
+    for (*functions = 0; darray_count(text) < size; ++*functions)
+    {
+        append(&text, "func fn%zu(i32: a, i64: b) -> i32 {\n", *functions);
+        append(&text, "    i32: r := a;\n");
+
+        size_t depth = 0;
+        for (uint32_t statements = 8 + test_random(24); statements > 0; --statements)
+        {
+            switch (test_random(6))
+            {
+            case 0:
+                append(&text, "    i64: ");
+                append_name(&text, "v", statements);
+                append(&text, " := sink(%u);\n", test_random(1000000));
+                break;
+            case 1:
+                append(&text, "    r := puts(\"plain %u\");\n", test_random(1000));
+                break;
+            case 2:
+                append(&text, "    r := puts(\"tab\\t%u\\n\\\"q\\\"\");\n", test_random(1000));
+                break;
+            case 3:
+                append(&text, "    {\n");
+                ++depth;
+                break;
+            case 4:
+                if (depth > 0)
+                {
+                    append(&text, "    }\n");
+                    --depth;
+                }
+                break;
+            default:
+                append(&text, "    i64: ");
+                append_name(&text, "w", statements);
+                append(&text, " := b;\n");
+                break;
+            }
+        }
+        for (; depth > 0; --depth)
+            append(&text, "    }\n");
+        append(&text, "    return r;\n}\n");
+    }
+
+    darray_push(text, '\0');
+    return text;
+}
+
+/*
+ * AST CHECKS
+ */
+
+// the value of the string literal whose contents start at 'c', decoded again
+// from the source
+static size_t decode_literal(const char *c, char *value)
+{
+    size_t length = 0;
+    for (; *c != '"'; ++c)
+    {
+        if (*c != '\\')
+        {
+            value[length++] = *c;
+            continue;
+        }
+
+        switch (*(++c))
+        {
+        case 't':
+            value[length++] = '\t';
+            break;
+        case 'n':
+            value[length++] = '\n';
+            break;
+        default:
+            value[length++] = *c;
+            break;
+        }
+    }
+    return length;
+}
+
+// every node must be well formed, and its token must still read back the
+// source, through the interner for identifiers and string literals
+static size_t check_nodes(const jac_ast_unit *unit, const char *source, size_t source_length,
+                          const jac_interner *interner)
+{
+    size_t count = darray_count(unit->kinds);
+    CHECK(darray_count(unit->data) == count);
+
+    for (jac_ast_node node = 0; node < count; ++node)
+    {
+        enum jac_ast_kind kind = jac_ast_kind_of(unit, node);
+        CHECK(kind <= JAC_AST_HINT);
+
+        jac_ast_data data = unit->data[node];
+        switch (kind)
+        {
+        case JAC_AST_ROOT_UNIT:
+        case JAC_AST_EXTERN_BLOCK:
+        case JAC_AST_FUNCTION_HEADER:
+        case JAC_AST_BLOCK:
+        case JAC_AST_FUNCTION_CALL: {
+            // children come before their parents
+            CHECK((data.lhs <= data.rhs) && (data.rhs <= darray_count(unit->extra)));
+            size_t children;
+            const jac_ast_node *child = jac_ast_children(unit, node, &children);
+            for (size_t i = 0; i < children; ++i)
+            {
+                // a header without a return type has NONE in its place
+                CHECK((child[i] != JAC_AST_NONE) || (kind == JAC_AST_FUNCTION_HEADER));
+                CHECK((child[i] < count) && ((child[i] < node) || (kind == JAC_AST_ROOT_UNIT)));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (node == JAC_AST_ROOT)
+            continue;
+
+        jac_token token = jac_ast_token(unit, node);
+        CHECK(token.offset < source_length);
+        if (token.kind == JAC_TOKEN_IDENTIFIER)
+        {
+            CHECK(token.id != JAC_INTERN_NONE);
+            CHECK(jac_interned_length(interner, token.id) == token.length);
+            CHECK(memcmp(jac_interned_value(interner, token.id), source + token.offset, token.length) == 0);
+        }
+        else if (token.kind == JAC_TOKEN_STR_LITERAL)
+        {
+            char value[256];
+            size_t length = decode_literal(source + token.offset, value);
+            CHECK(token.id != JAC_INTERN_NONE);
+            CHECK((token.length == length) && (jac_interned_length(interner, token.id) == length));
+            CHECK(memcmp(token.value, value, length) == 0);
+        }
+    }
+
+    return count;
+}
+
+static void stress_compiler(size_t size)
+{
+    size_t functions;
+    darray_t char *source = generate_source(size, &functions);
+    size_t source_length = darray_count(source) - 1;
+
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    jac_interner interner;
+    jac_init_interner(&interner);
+
+    jac_lexer lexer;
+    jac_init_lexer(&lexer, source, &strings, &interner);
+
+    jac_ast_unit unit;
+    bool parsed = jac_parse_unit(&lexer, &unit);
+    CHECK(parsed && !lexer.invalid);
+
+    // the later phases allocate from an arena of their own, churning it
+    // while the interner's stays put
+    jac_memory_arena ir_arena;
+    jac_init_arena(&ir_arena);
+    jac_ir_unit ir;
+    bool checked = parsed && jac_check_unit(&unit, &lexer.lines, &ir_arena, &ir);
+    CHECK(checked);
+    if (checked)
+    {
+        CHECK(darray_count(ir.functions) == functions + 2);
+        jac_construct_ssa(&ir, &ir_arena);
+        jac_optimize_unit(&ir, &ir_arena);
+        CHECK(jac_verify_unit(&ir, stderr));
+    }
+
+    size_t nodes = parsed ? check_nodes(&unit, source, source_length, &interner) : 0;
+    printf("compiler: %zu bytes, %zu functions, %zu nodes\n", source_length, functions, nodes);
+
+    jac_free_arena(&ir_arena);
+    if (parsed)
+        jac_free_unit(&unit);
+    jac_free_lexer(&lexer);
+    jac_free_interner(&interner);
+    jac_free_arena(&strings);
+    darray_free(source);
+}
+
+/*
+ * ARENA CHECKS
+ */
+
+typedef struct allocation allocation;
+
+struct allocation
+{
+    unsigned char *memory;
+    size_t size;
+    unsigned char pattern;
+};
+
+static allocation allocate(jac_memory_arena *arena, size_t size, size_t alignment)
+{
+    allocation a = {
+        .memory = jac_arena_alloc_aligned(arena, size, alignment),
+        .size = size,
+        .pattern = (unsigned char)test_random(256),
+    };
+    CHECK(a.memory != NULL);
+    CHECK(((uintptr_t)a.memory % (alignment < JAC_ARENA_GRANULE ? JAC_ARENA_GRANULE : alignment)) == 0);
+    memset(a.memory, a.pattern, size);
+    return a;
+}
+
+static bool intact(const allocation *a)
+{
+    for (size_t i = 0; i < a->size; ++i)
+        if (a->memory[i] != a->pattern)
+            return false;
+    return true;
+}
+
+// mostly small sizes, now and then one past a chunk, or a large one of its own
+static size_t random_size(void)
+{
+    switch (test_random(64))
+    {
+    case 0:
+        return JAC_ARENA_CHUNK_SIZE / 4 + test_random(3 * JAC_ARENA_CHUNK_SIZE);
+    case 1:
+        return JAC_ARENA_CHUNK_SIZE - test_random(64);
+    default:
+        return 1 + test_random(200);
+    }
+}
+
+static size_t random_alignment(void)
+{
+    return (size_t)1 << test_random(9);
+}
+
+// allocations of every size and alignment, interleaved with arena darrays
+// growing a push at a time, must all keep their contents
+static void stress_churn(void)
+{
+    jac_memory_arena arena;
+    jac_init_arena(&arena);
+
+    darray_t allocation *allocations = darray_new(allocation);
+    darray_t uint32_t *numbers = jac_arena_darray_new(&arena, uint32_t);
+    darray_t uint64_t *others = jac_arena_darray_new(&arena, uint64_t);
+
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        darray_push(allocations, allocate(&arena, random_size(), random_alignment()));
+        darray_push(numbers, i);
+        if (i % 3 == 0)
+            darray_push(others, (uint64_t)i * 0x9e3779b97f4a7c15u);
+    }
+
+    size_t broken = 0;
+    darray_foreach(allocations, const allocation, a) broken += !intact(a);
+    CHECK(broken == 0);
+
+    CHECK(darray_count(numbers) == 100000);
+    for (uint32_t i = 0; i < darray_count(numbers); ++i)
+        CHECK(numbers[i] == i);
+    for (uint32_t i = 0; i < darray_count(others); ++i)
+        CHECK(others[i] == (uint64_t)(3 * i) * 0x9e3779b97f4a7c15u);
+
+    printf("churn: %zu allocations, %zu broken\n", darray_count(allocations), broken);
+
+    darray_free(allocations);
+    jac_free_arena(&arena);
+}
+
+// a rewind releases exactly what was allocated after its mark: everything
+// before it keeps its contents, and the arena hands out the same memory again
+static void stress_rewind(void)
+{
+    jac_memory_arena arena;
+    jac_init_arena(&arena);
+
+    // a mark of an empty arena rewinds it to nothing
+    jac_arena_mark empty = jac_arena_get_mark(&arena);
+    allocation first = allocate(&arena, 24, 8);
+    jac_arena_rewind(&arena, empty);
+    CHECK((arena.chunk == NULL) && (arena.cursor == NULL));
+    CHECK(jac_arena_alloc_impl(&arena, 24) == first.memory);
+
+    darray_t allocation *kept = darray_new(allocation);
+    size_t rewinds = 0;
+    for (uint32_t round = 0; round < 1000; ++round)
+    {
+        for (uint32_t i = test_random(8); i > 0; --i)
+            darray_push(kept, allocate(&arena, random_size(), random_alignment()));
+
+        jac_arena_mark mark = jac_arena_get_mark(&arena);
+        allocation probe = allocate(&arena, 16, 8);
+
+        // nested marks, across chunks of every kind
+        jac_arena_mark inner = jac_arena_get_mark(&arena);
+        for (uint32_t i = 1 + test_random(40); i > 0; --i)
+            allocate(&arena, random_size(), random_alignment());
+        jac_arena_rewind(&arena, inner);
+        CHECK((arena.chunk == inner.chunk) && (arena.cursor == inner.cursor));
+        CHECK(intact(&probe));
+
+        for (uint32_t i = 1 + test_random(40); i > 0; --i)
+            allocate(&arena, random_size(), random_alignment());
+        jac_arena_rewind(&arena, mark);
+        CHECK((arena.chunk == mark.chunk) && (arena.cursor == mark.cursor));
+        ++rewinds;
+
+        // the first allocation after a rewind lands where the released one was
+        allocation again = allocate(&arena, 16, 8);
+        CHECK(again.memory == probe.memory);
+    }
+
+    size_t broken = 0;
+    darray_foreach(kept, const allocation, a) broken += !intact(a);
+    CHECK(broken == 0);
+
+    // released chunks of the default size are kept and handed out again,
+    // instead of going back to the heap
+    jac_reset_arena(&arena);
+    CHECK((arena.chunk == NULL) && (arena.spare != NULL));
+    jac_arena_chunk *spare = arena.spare;
+    jac_arena_alloc_impl(&arena, 8);
+    CHECK(arena.chunk == spare);
+
+    printf("rewind: %zu rewinds, %zu kept allocations, %zu broken\n", rewinds, darray_count(kept), broken);
+
+    darray_free(kept);
+    jac_free_arena(&arena);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 4;
+
+    stress_compiler(megabytes * 1024 * 1024);
+    stress_churn();
+    stress_rewind();
+
+    return test_finish("arena_stress");
+}
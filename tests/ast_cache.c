@@ -0,0 +1,98 @@
+/*
+ * Loads the AST cache of a source that changed since it was written. The miss
+ * must leave the cache closed, so that closing it, as the compiler does on
+ * every way out, frees nothing twice. Then the cache written for the new
+ * source must hit, and close once however often it is closed.
+ *
+ * usage: ast_cache
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arena.h"
+#include "ast.h"
+#include "cache.h"
+#include "intern.h"
+#include "lex.h"
+#include "source.h"
+#include "test.h"
+
+#define SOURCE_PATH "ast_cache_test.jac"
+#define CACHE_PATH SOURCE_PATH ".ast"
+
+static const char first[] = "func main(i32: a) -> i32 {\n    return a;\n}\n";
+static const char second[] = "func main(i32: a) -> i32 {\n    i32: b := a;\n    return b;\n}\n";
+
+static bool write_text(const char *path, const char *text)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    bool written = fwrite(text, 1, strlen(text), file) == strlen(text);
+    return (fclose(file) == 0) && written;
+}
+
+// writes 'text' as the source, and the cache of it as the compiler would
+static bool write_unit(const char *text)
+{
+    jac_source source;
+    if (!write_text(SOURCE_PATH, text) || !jac_load_source(SOURCE_PATH, &source))
+        return false;
+
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+    jac_interner interner;
+    jac_init_interner(&interner);
+    jac_lexer lexer;
+    jac_init_lexer(&lexer, source.text, &strings, &interner);
+
+    jac_ast_unit unit;
+    bool written = jac_parse_unit(&lexer, &unit) && !lexer.invalid &&
+                   jac_write_ast_cache(CACHE_PATH, &source, &unit, &lexer.lines);
+
+    jac_free_unit(&unit);
+    jac_free_lexer(&lexer);
+    jac_free_interner(&interner);
+    jac_free_arena(&strings);
+    jac_free_source(&source);
+    return written;
+}
+
+static void test_edited_source(void)
+{
+    if (!CHECK(write_unit(first)) || !CHECK(write_text(SOURCE_PATH, second)))
+        return;
+
+    jac_source source;
+    if (!CHECK(jac_load_source(SOURCE_PATH, &source)))
+        return;
+
+    jac_ast_cache cache = {0};
+    jac_ast_unit unit;
+    jac_interner interner;
+    CHECK(!jac_load_ast_cache(CACHE_PATH, &source, &cache, &unit, &interner));
+    CHECK(!cache.file.text && !cache.file.length && !cache.file.mapped_size);
+    jac_close_ast_cache(&cache);
+
+    if (CHECK(write_unit(second)) && CHECK(jac_load_ast_cache(CACHE_PATH, &source, &cache, &unit, &interner)))
+    {
+        CHECK(cache.file.text != NULL);
+        jac_free_unit(&unit);
+        jac_free_interner(&interner);
+        jac_close_ast_cache(&cache);
+        CHECK(!cache.file.text);
+        jac_close_ast_cache(&cache);
+    }
+
+    jac_free_source(&source);
+}
+
+int main(void)
+{
+    test_edited_source();
+    remove(CACHE_PATH);
+    remove(SOURCE_PATH);
+    return test_finish("ast_cache");
+}
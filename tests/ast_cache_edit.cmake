@@ -0,0 +1,35 @@
+# cmake -DPROGRAM=<jac> -DSOURCE=<file.jac> -DWORK=<directory> -P ast_cache_edit.cmake
+#
+# compiles a copy of the source with --ast-cache, edits it, and compiles it
+# again. the stale cache must be dropped for a fresh parse, giving the IR an
+# uncached run gives, and rewritten, so that a third run reads it back
+
+function(compile output)
+    execute_process(COMMAND ${PROGRAM} ${ARGN} RESULT_VARIABLE result OUTPUT_VARIABLE ir ERROR_VARIABLE errors)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${PROGRAM} ${ARGN} exited with ${result}\n${errors}")
+    endif()
+    string(REGEX REPLACE "jac: compil[^\n]*\n" "" ir "${ir}")
+    set(${output} "${ir}" PARENT_SCOPE)
+endfunction()
+
+set(copy "${WORK}/ast_cache_edit.jac")
+file(COPY_FILE "${SOURCE}" "${copy}")
+file(REMOVE "${copy}.ast")
+
+compile(first --ast-cache "${copy}")
+if(NOT EXISTS "${copy}.ast")
+    message(FATAL_ERROR "the first run wrote no cache")
+endif()
+
+file(APPEND "${copy}" "\nfunc added(i32: a) -> i32 {\n    return sink(a);\n}\n")
+compile(edited --ast-cache "${copy}")
+compile(fresh "${copy}")
+if(NOT edited STREQUAL fresh)
+    message(FATAL_ERROR "the edited source compiled from a stale cache:\n${edited}")
+endif()
+
+compile(cached --ast-cache=verify "${copy}")
+if(NOT cached STREQUAL fresh)
+    message(FATAL_ERROR "the rewritten cache gives other IR:\n${cached}")
+endif()
@@ -0,0 +1,20 @@
+# cmake -DPROGRAM=<jac> -DSOURCE=<file.jac> -DEXPECTED=<file> -P compare_expected.cmake
+#
+# compiles the source with its remarks and the IR verified, and fails unless
+# it succeeds and prints what the expected file holds: the remarks, then the
+# IR. the lines naming the file and the time taken are left out
+
+execute_process(COMMAND ${PROGRAM} --remarks --verify-ir ${SOURCE}
+                RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE remarks)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} exited with ${result}\n${remarks}")
+endif()
+
+string(REGEX REPLACE "jac: compil[^\n]*\n" "" output "${output}")
+set(output "${remarks}${output}")
+file(READ "${EXPECTED}" expected)
+if(NOT output STREQUAL expected)
+    get_filename_component(name "${SOURCE}" NAME_WE)
+    file(WRITE "${name}.out" "${output}")
+    message(FATAL_ERROR "${SOURCE} differs from ${EXPECTED}, see ${name}.out")
+endif()
@@ -0,0 +1,34 @@
+# cmake -DPROGRAMS=<a;b;...> -DARGS=<args> -P compare_outputs.cmake
+#
+# runs each program with the same arguments, and fails unless they all exit
+# with 0 and print the same. a program exiting with 77 cannot run on this
+# machine, and is left out of the comparison
+
+set(reference "")
+set(compared 0)
+foreach(program IN LISTS PROGRAMS)
+    execute_process(COMMAND ${program} ${ARGS} RESULT_VARIABLE result OUTPUT_VARIABLE output)
+    if(result EQUAL 77)
+        message(STATUS "skipped ${program}")
+        continue()
+    elseif(NOT result EQUAL 0)
+        message(FATAL_ERROR "${program} exited with ${result}")
+    endif()
+
+    if(compared EQUAL 0)
+        set(reference "${output}")
+        set(reference_program "${program}")
+    elseif(NOT output STREQUAL reference)
+        get_filename_component(name "${program}" NAME)
+        file(WRITE "${name}.out" "${output}")
+        get_filename_component(reference_name "${reference_program}" NAME)
+        file(WRITE "${reference_name}.out" "${reference}")
+        message(FATAL_ERROR "${program} differs from ${reference_program}, see ${name}.out and ${reference_name}.out")
+    endif()
+    math(EXPR compared "${compared} + 1")
+endforeach()
+
+if(compared LESS 2)
+    message(FATAL_ERROR "fewer than two programs ran, nothing was compared")
+endif()
+message(STATUS "${compared} programs printed the same")
@@ -0,0 +1,621 @@
+#include "ir_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opt.h"
+#include "test.h"
+
+/*
+ * BUILDING
+ */
+
+static jac_ir_function *function_at(test_builder *builder, size_t function)
+{
+    return builder->unit.functions + function;
+}
+
+static jac_ir_instruction new_instruction(enum jac_ir_op op)
+{
+    jac_ir_instruction instruction = {.op = op};
+    darray_small_init(instruction.operands);
+    return instruction;
+}
+
+static jac_ir_instruction *emit(test_builder *builder, size_t function, uint32_t block,
+                                jac_ir_instruction instruction)
+{
+    jac_ir_block *b = function_at(builder, function)->blocks + block;
+    darray_push(b->instructions, instruction);
+    return b->instructions + darray_count(b->instructions) - 1;
+}
+
+static void push_operand(test_builder *builder, jac_ir_instruction *instruction, jac_ir_value value)
+{
+    darray_small_push(instruction->operands, value, &builder->arena->allocator);
+}
+
+static jac_ir_symbol new_value(test_builder *builder, size_t function, enum jac_type_kind kind)
+{
+    jac_ir_symbol symbol = {.id = function_at(builder, function)->tmp_counter++};
+    symbol.sym.type.id = kind;
+    return symbol;
+}
+
+static jac_ir_value variable(jac_ir_symbol symbol)
+{
+    return (jac_ir_value){.opt.variable = symbol, .holds = JAC_IR_VALUE_VARIABLE};
+}
+
+void test_init_builder(test_builder *builder, jac_memory_arena *arena)
+{
+    *builder = (test_builder){.arena = arena};
+    builder->unit.functions = jac_arena_darray_new(arena, jac_ir_function);
+
+    size_t sink = test_add_function(builder, JAC_TYPE_INT32);
+    function_at(builder, sink)->blocks = NULL;
+    function_at(builder, sink)->locals = NULL;
+}
+
+size_t test_add_function(test_builder *builder, enum jac_type_kind ret)
+{
+    jac_ir_function function = {
+        .blocks = jac_arena_darray_new(builder->arena, jac_ir_block),
+        .locals = jac_arena_darray_new(builder->arena, jac_ir_symbol),
+        .tmp_counter = 1,
+        .inlining = JAC_IR_INLINE_AUTO,
+    };
+    function.header.ret_type.id = ret;
+    darray_small_init(function.header.args);
+
+    jac_symbol argument = {0};
+    argument.type.id = JAC_TYPE_INT32;
+    darray_small_push(function.header.args, argument, &builder->arena->allocator);
+
+    darray_push(builder->unit.functions, function);
+    return darray_count(builder->unit.functions) - 1;
+}
+
+uint32_t test_add_block(test_builder *builder, size_t function)
+{
+    jac_ir_function *f = function_at(builder, function);
+    jac_ir_block block = {
+        .instructions = jac_arena_darray_new(builder->arena, jac_ir_instruction),
+        .id = darray_count(f->blocks),
+    };
+    darray_small_init(block.successors);
+    darray_small_init(block.predecessors);
+
+    darray_push(f->blocks, block);
+    return (uint32_t)block.id;
+}
+
+uint32_t test_add_local(test_builder *builder, size_t function, enum jac_type_kind kind)
+{
+    jac_ir_function *f = function_at(builder, function);
+    jac_ir_symbol local = {.id = darray_count(f->locals)};
+    local.sym.type.id = kind;
+
+    darray_push(f->locals, local);
+    return (uint32_t)local.id;
+}
+
+jac_ir_value test_constant(enum jac_type_kind kind, int64_t value)
+{
+    jac_constant constant = {.opt.i = value, .holds = JAC_CONSTANT_INT, .type = JAC_TYPE_NONE};
+    if ((kind == JAC_TYPE_FLOAT32) || (kind == JAC_TYPE_FLOAT64))
+        constant = (jac_constant){.opt.f = (double)value, .holds = JAC_CONSTANT_FLOAT, .type = JAC_TYPE_NONE};
+
+    jac_ir_value literal = {.holds = JAC_IR_VALUE_LITERAL};
+    literal.opt.literal.holds = JAC_IR_LITERAL_CONSTANT;
+    jac_convert_constant(&constant, kind, &literal.opt.literal.opt.constant);
+    return literal;
+}
+
+jac_ir_value test_argument(void)
+{
+    jac_ir_symbol argument = {.id = 0};
+    argument.sym.type.id = JAC_TYPE_INT32;
+    return variable(argument);
+}
+
+jac_ir_value test_emit_op(test_builder *builder, size_t function, uint32_t block, enum jac_ir_op op,
+                          enum jac_type_kind kind, jac_ir_value left, jac_ir_value right)
+{
+    bool gives_bool = (op >= JAC_IR_AND) && (op <= JAC_IR_GE);
+
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(op));
+    push_operand(builder, instruction, left);
+    if (!jac_ir_is_unary(op))
+        push_operand(builder, instruction, right);
+    instruction->result = new_value(builder, function, gives_bool ? JAC_TYPE_BOOL : kind);
+    return variable(instruction->result);
+}
+
+jac_ir_value test_emit_load(test_builder *builder, size_t function, uint32_t block, uint32_t local)
+{
+    enum jac_type_kind kind = (enum jac_type_kind)function_at(builder, function)->locals[local].sym.type.id;
+
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_LOAD));
+    instruction->local = local;
+    instruction->result = new_value(builder, function, kind);
+    return variable(instruction->result);
+}
+
+void test_emit_store(test_builder *builder, size_t function, uint32_t block, uint32_t local, jac_ir_value value)
+{
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_STORE));
+    instruction->local = local;
+    push_operand(builder, instruction, value);
+}
+
+jac_ir_value test_emit_addr(test_builder *builder, size_t function, uint32_t block, uint32_t local)
+{
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_ADDR));
+    instruction->local = local;
+    instruction->result = new_value(builder, function, JAC_TYPE_UINT64);
+    return variable(instruction->result);
+}
+
+jac_ir_value test_emit_call(test_builder *builder, size_t function, uint32_t block, size_t callee,
+                            jac_ir_value argument)
+{
+    enum jac_type_kind kind = (enum jac_type_kind)function_at(builder, callee)->header.ret_type.id;
+
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_CALL));
+    instruction->callee = callee;
+    push_operand(builder, instruction, argument);
+    instruction->result = new_value(builder, function, kind);
+    return variable(instruction->result);
+}
+
+void test_emit_jump(test_builder *builder, size_t function, uint32_t block, uint32_t target)
+{
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_JUMP));
+    instruction->targets[0] = target;
+}
+
+void test_emit_branch(test_builder *builder, size_t function, uint32_t block, jac_ir_value condition,
+                      uint32_t if_true, uint32_t if_false)
+{
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_BRANCH));
+    push_operand(builder, instruction, condition);
+    instruction->targets[0] = if_true;
+    instruction->targets[1] = if_false;
+}
+
+void test_emit_return(test_builder *builder, size_t function, uint32_t block, const jac_ir_value *value)
+{
+    jac_ir_instruction *instruction = emit(builder, function, block, new_instruction(JAC_IR_RET));
+    if (value)
+        push_operand(builder, instruction, *value);
+}
+
+size_t test_count_ops(const jac_ir_function *function, enum jac_ir_op op)
+{
+    size_t count = 0;
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction) count += instruction->op == op;
+    }
+    return count;
+}
+
+size_t test_count_instructions(const jac_ir_function *function)
+{
+    size_t count = 0;
+    darray_foreach(function->blocks, const jac_ir_block, block) count += darray_count(block->instructions);
+    return count;
+}
+
+const jac_ir_instruction *test_find_op(const jac_ir_function *function, enum jac_ir_op op, size_t nth)
+{
+    darray_foreach(function->blocks, const jac_ir_block, block)
+    {
+        darray_foreach(block->instructions, const jac_ir_instruction, instruction)
+        {
+            if ((instruction->op == op) && (nth-- == 0))
+                return instruction;
+        }
+    }
+    return NULL;
+}
+
+const jac_ir_value *test_sink_argument(const jac_ir_function *function, size_t nth)
+{
+    const jac_ir_instruction *call = test_find_op(function, JAC_IR_CALL, nth);
+    return call ? darray_small_data(call->operands) : NULL;
+}
+
+bool test_is_constant(const jac_ir_value *value, int64_t expected)
+{
+    return (value->holds == JAC_IR_VALUE_LITERAL) && (value->opt.literal.holds == JAC_IR_LITERAL_CONSTANT) &&
+           (value->opt.literal.opt.constant.holds != JAC_CONSTANT_FLOAT) &&
+           (value->opt.literal.opt.constant.opt.i == expected);
+}
+
+/*
+ * RANDOM FUNCTIONS
+ */
+
+// two slots of each, then two bools
+static const enum jac_type_kind slot_kinds[] = {
+    JAC_TYPE_INT8, JAC_TYPE_UINT8, JAC_TYPE_INT32, JAC_TYPE_UINT32, JAC_TYPE_INT64, JAC_TYPE_FLOAT32,
+};
+
+#define KINDS       (sizeof(slot_kinds) / sizeof(slot_kinds[0]))
+#define SLOTS       (2 * KINDS + 2)
+#define INT32_SLOTS 2 // the first of each, see slot_kinds
+
+static enum jac_type_kind slot_kind(uint32_t slot)
+{
+    return (slot < 2 * KINDS) ? slot_kinds[slot % KINDS] : JAC_TYPE_BOOL;
+}
+
+// mostly small values, which meet in comparisons and divisions, now and then
+// one large enough to wrap
+static jac_ir_value random_constant(enum jac_type_kind kind)
+{
+    if ((kind == JAC_TYPE_FLOAT32) || test_random(4))
+        return test_constant(kind, (int64_t)test_random(7) - 3);
+    return test_constant(kind, (int64_t)test_random(1000) * 1000003);
+}
+
+static jac_ir_value random_operand(test_builder *builder, size_t function, uint32_t block, uint32_t slot)
+{
+    if (test_random(3) == 0)
+        return random_constant(slot_kind(slot));
+    return test_emit_load(builder, function, block, slot);
+}
+
+static void emit_random_statement(test_builder *builder, size_t function, uint32_t block, size_t callees)
+{
+    uint32_t slot = test_random(SLOTS);
+    enum jac_type_kind kind = slot_kind(slot);
+    unsigned choice = test_random(10);
+
+    // arithmetic in the kind of the slot, with its twin
+    if ((choice < 5) && (kind != JAC_TYPE_BOOL))
+    {
+        enum jac_ir_op op = test_random(5) ? (enum jac_ir_op)(JAC_IR_ADD + test_random(4)) : JAC_IR_NEG;
+        jac_ir_value left = random_operand(builder, function, block, slot);
+        uint32_t twin = (slot + KINDS) % (2 * KINDS);
+        jac_ir_value right = (op == JAC_IR_NEG) ? left : random_operand(builder, function, block, twin);
+        test_emit_store(builder, function, block, slot, test_emit_op(builder, function, block, op, kind, left, right));
+        return;
+    }
+
+    // a comparison of twins, or a logical op of the bools, into a bool
+    if (choice < 7)
+    {
+        uint32_t a = test_random(2 * KINDS), b = (a + KINDS) % (2 * KINDS);
+        enum jac_ir_op op = (enum jac_ir_op)(JAC_IR_EQ + test_random(6));
+        if (test_random(6) == 0)
+        {
+            op = test_random(2) ? JAC_IR_AND : JAC_IR_OR;
+            a = 2 * KINDS;
+            b = 2 * KINDS + 1;
+        }
+        jac_ir_value left = random_operand(builder, function, block, a);
+        jac_ir_value right = random_operand(builder, function, block, b);
+        jac_ir_value result = test_emit_op(builder, function, block, op, slot_kind(a), left, right);
+        test_emit_store(builder, function, block, 2 * KINDS + test_random(2), result);
+        return;
+    }
+
+    // the sink observes a slot, another function takes and gives an i32
+    if ((callees == 0) || test_random(2))
+    {
+        test_emit_call(builder, function, block, TEST_SINK, random_operand(builder, function, block, slot));
+        return;
+    }
+    uint32_t from = INT32_SLOTS + KINDS * test_random(2), to = INT32_SLOTS + KINDS * test_random(2);
+    size_t callee = 1 + test_random((uint32_t)callees);
+    jac_ir_value result =
+        test_emit_call(builder, function, block, callee, random_operand(builder, function, block, from));
+    test_emit_store(builder, function, block, to, result);
+}
+
+void test_build_random(test_builder *builder, size_t function, unsigned blocks, unsigned per_block, size_t callees)
+{
+    for (uint32_t slot = 0; slot < SLOTS; ++slot)
+        test_add_local(builder, function, slot_kind(slot));
+
+    jac_ir_function *f = function_at(builder, function);
+    enum jac_type_kind ret = (enum jac_type_kind)f->header.ret_type.id;
+    for (unsigned b = 0; b < blocks; ++b)
+        test_add_block(builder, function);
+
+    for (uint32_t block = 0; block < blocks; ++block)
+    {
+        // every slot starts out constant, one of them now and then as the argument
+        if (block == 0)
+        {
+            for (uint32_t slot = 0; slot < SLOTS; ++slot)
+            {
+                bool from_argument = (slot == INT32_SLOTS) && test_random(2);
+                test_emit_store(builder, function, block, slot,
+                                from_argument ? test_argument() : random_constant(slot_kind(slot)));
+            }
+        }
+
+        for (unsigned i = 0; i < per_block; ++i)
+            emit_random_statement(builder, function, block, callees);
+
+        // nothing branches back to the entry
+        if ((block + 1 < blocks) && test_random(6))
+        {
+            uint32_t if_true = 1 + test_random(blocks - 1), if_false = 1 + test_random(blocks - 1);
+            if (test_random(4) == 0)
+                test_emit_jump(builder, function, block, if_true);
+            else
+            {
+                jac_ir_value condition = random_operand(builder, function, block, 2 * KINDS + test_random(2));
+                test_emit_branch(builder, function, block, condition, if_true, if_false);
+            }
+            continue;
+        }
+
+        if (ret == JAC_TYPE_NONE)
+            test_emit_return(builder, function, block, NULL);
+        else
+        {
+            jac_ir_value value = random_operand(builder, function, block, INT32_SLOTS);
+            test_emit_return(builder, function, block, &value);
+        }
+    }
+}
+
+/*
+ * INTERPRETER
+ */
+
+#define MAX_STEPS 4000 // blocks entered, over the whole run
+#define MAX_DEPTH 40
+
+// what a run records in place of the rest, once an instruction traps
+#define TRAP_MARK UINT64_C(0x7a7a7a7a7a7a7a7a)
+
+typedef struct interpreter interpreter;
+
+struct interpreter
+{
+    const jac_ir_unit *unit;
+    test_trace *trace;
+    long steps;
+    bool stopped; // cut off, or trapped
+};
+
+static const jac_constant undefined = {.opt.u = 0xdeadbeef, .holds = JAC_CONSTANT_UINT, .type = JAC_TYPE_NONE};
+
+static jac_constant read_value(const jac_ir_value *value, const jac_constant *values)
+{
+    if (value->holds == JAC_IR_VALUE_LITERAL)
+        return value->opt.literal.opt.constant;
+    if (value->holds == JAC_IR_VALUE_UNDEF)
+        return undefined;
+    return values[value->opt.variable.id];
+}
+
+// converted to the type of what it goes in, as is, where that fails
+static jac_constant convert(jac_constant constant, jac_type_id type)
+{
+    jac_constant converted;
+    return jac_convert_constant(&constant, (enum jac_type_kind)type, &converted) ? converted : constant;
+}
+
+static void record(interpreter *interpreter, jac_constant constant)
+{
+    test_trace *trace = interpreter->trace;
+    if (trace->count == TEST_TRACE_LENGTH)
+    {
+        trace->cut = true;
+        interpreter->stopped = true;
+        return;
+    }
+
+    uint64_t bits = constant.opt.u;
+    if (constant.holds == JAC_CONSTANT_FLOAT)
+        memcpy(&bits, &constant.opt.f, sizeof bits);
+    trace->values[trace->count++] = bits;
+}
+
+// the kind an op reads its operands as, see enum jac_ir_op
+static enum jac_type_kind operand_kind(const jac_ir_instruction *instruction)
+{
+    if ((instruction->op >= JAC_IR_AND) && (instruction->op <= JAC_IR_GE))
+    {
+        const jac_ir_value *first = darray_small_data(instruction->operands);
+        if (first->holds == JAC_IR_VALUE_VARIABLE)
+            return (enum jac_type_kind)first->opt.variable.sym.type.id;
+        return first->opt.literal.opt.constant.type;
+    }
+    return (enum jac_type_kind)instruction->result.sym.type.id;
+}
+
+static jac_constant call(interpreter *interpreter, size_t callee, jac_constant argument, int depth);
+
+// runs the block from its first instruction after the phis, and returns the
+// next one, or JAC_IR_NO_BLOCK once the function is done
+static uint32_t run_block(interpreter *interpreter, const jac_ir_function *function, const jac_ir_block *block,
+                          size_t first, jac_constant *values, jac_constant *memory, jac_constant *result, int depth)
+{
+    for (size_t i = first; i < darray_count(block->instructions); ++i)
+    {
+        if (interpreter->stopped)
+            return JAC_IR_NO_BLOCK;
+
+        const jac_ir_instruction *instruction = block->instructions + i;
+        const jac_ir_value *operands = darray_small_data(instruction->operands);
+        if (jac_ir_is_unary(instruction->op) || jac_ir_is_binary(instruction->op))
+        {
+            jac_constant left = read_value(operands, values), folded;
+            bool defined;
+            if (jac_ir_is_unary(instruction->op))
+                defined = jac_fold_unary(instruction->op, operand_kind(instruction), &left, &folded);
+            else
+            {
+                jac_constant right = read_value(operands + 1, values);
+                defined = jac_fold_binary(instruction->op, operand_kind(instruction), &left, &right, &folded);
+            }
+
+            if (!defined)
+            {
+                interpreter->trace->values[interpreter->trace->count++] = TRAP_MARK;
+                interpreter->stopped = true;
+                return JAC_IR_NO_BLOCK;
+            }
+            values[instruction->result.id] = convert(folded, instruction->result.sym.type.id);
+            continue;
+        }
+
+        switch (instruction->op)
+        {
+        case JAC_IR_ADDR:
+            values[instruction->result.id] = (jac_constant){.opt.u = instruction->local, .holds = JAC_CONSTANT_UINT};
+            break;
+        case JAC_IR_LOAD:
+            values[instruction->result.id] = memory[instruction->local];
+            break;
+        case JAC_IR_STORE:
+            memory[instruction->local] =
+                convert(read_value(operands, values), function->locals[instruction->local].sym.type.id);
+            break;
+        case JAC_IR_CALL: {
+            jac_constant argument = read_value(operands, values), returned = argument;
+            if (instruction->callee == TEST_SINK)
+                record(interpreter, argument);
+            else
+                returned = call(interpreter, instruction->callee, argument, depth + 1);
+            values[instruction->result.id] = convert(returned, instruction->result.sym.type.id);
+            break;
+        }
+        case JAC_IR_JUMP:
+            return instruction->targets[0];
+        case JAC_IR_BRANCH: {
+            jac_constant condition = read_value(operands, values);
+            bool taken = (condition.holds == JAC_CONSTANT_FLOAT) ? (condition.opt.f != 0) : (condition.opt.u != 0);
+            return instruction->targets[taken ? 0 : 1];
+        }
+        case JAC_IR_RET:
+            if (darray_small_count(instruction->operands) > 0)
+                *result = read_value(operands, values);
+            return JAC_IR_NO_BLOCK;
+        default:
+            break;
+        }
+    }
+
+    // fell off the end of the function
+    return JAC_IR_NO_BLOCK;
+}
+
+static jac_constant call(interpreter *interpreter, size_t callee, jac_constant argument, int depth)
+{
+    const jac_ir_function *function = interpreter->unit->functions + callee;
+    if (depth > MAX_DEPTH)
+    {
+        interpreter->trace->cut = true;
+        interpreter->stopped = true;
+        return undefined;
+    }
+
+    jac_constant *values = calloc(function->tmp_counter + 1, sizeof(jac_constant));
+    jac_constant *memory = calloc(darray_count(function->locals) + 1, sizeof(jac_constant));
+    jac_constant *incoming = NULL;
+    values[0] = convert(argument, JAC_TYPE_INT32);
+
+    jac_constant result = undefined;
+    uint32_t previous = JAC_IR_NO_BLOCK;
+    for (uint32_t block = 0; block != JAC_IR_NO_BLOCK;)
+    {
+        if (interpreter->stopped)
+            break;
+        if (--interpreter->steps < 0)
+        {
+            interpreter->trace->cut = true;
+            interpreter->stopped = true;
+            break;
+        }
+
+        // the phis read their operands all at once, along the edge taken
+        const jac_ir_block *b = function->blocks + block;
+        size_t phis = 0;
+        while ((phis < darray_count(b->instructions)) && (b->instructions[phis].op == JAC_IR_PHI))
+            ++phis;
+        if (phis > 0)
+        {
+            size_t edge = 0;
+            while (darray_small_data(b->predecessors)[edge] != previous)
+                ++edge;
+
+            incoming = realloc(incoming, phis * sizeof(jac_constant));
+            for (size_t i = 0; i < phis; ++i)
+                incoming[i] = convert(read_value(darray_small_data(b->instructions[i].operands) + edge, values),
+                                      b->instructions[i].result.sym.type.id);
+            for (size_t i = 0; i < phis; ++i)
+                values[b->instructions[i].result.id] = incoming[i];
+        }
+
+        previous = block;
+        block = run_block(interpreter, function, b, phis, values, memory, &result, depth);
+    }
+
+    free(incoming);
+    free(memory);
+    free(values);
+    return result;
+}
+
+void test_run(const jac_ir_unit *unit, size_t function, int32_t argument, test_trace *trace)
+{
+    *trace = (test_trace){.count = 0};
+    interpreter interpreter = {.unit = unit, .trace = trace, .steps = MAX_STEPS};
+
+    jac_constant a = {.opt.i = argument, .holds = JAC_CONSTANT_INT, .type = JAC_TYPE_INT32};
+    jac_constant result = call(&interpreter, function, a, 0);
+    if (!interpreter.stopped && (unit->functions[function].header.ret_type.id != JAC_TYPE_NONE))
+        record(&interpreter, result);
+}
+
+bool test_same_trace(const test_trace *before, const test_trace *after)
+{
+    size_t common = (before->count < after->count) ? before->count : after->count;
+    if (memcmp(before->values, after->values, common * sizeof(uint64_t)) != 0)
+        return false;
+
+    // a run cut off may only stop short of the other
+    if (!before->cut && !after->cut)
+        return before->count == after->count;
+    if (!before->cut)
+        return after->count <= before->count;
+    if (!after->cut)
+        return before->count <= after->count;
+    return true;
+}
+
+const int32_t test_arguments[TEST_ARGUMENT_COUNT] = {0, 1, -1, 5, 2147483647};
+
+void test_run_arguments(const jac_ir_unit *unit, size_t function, test_trace traces[TEST_ARGUMENT_COUNT])
+{
+    for (size_t a = 0; a < TEST_ARGUMENT_COUNT; ++a)
+        test_run(unit, function, test_arguments[a], traces + a);
+}
+
+bool test_check_same_runs(const jac_ir_unit *unit, size_t function, const test_trace before[TEST_ARGUMENT_COUNT])
+{
+    bool same = true;
+    for (size_t a = 0; a < TEST_ARGUMENT_COUNT; ++a)
+    {
+        test_trace after;
+        test_run(unit, function, test_arguments[a], &after);
+        if (!CHECK(test_same_trace(before + a, &after)))
+        {
+            same = false;
+            if (test_verbose())
+                fprintf(stderr, "  function %zu, argument %d\n", function, (int)test_arguments[a]);
+        }
+    }
+    return same;
+}
@@ -0,0 +1,132 @@
+#ifndef JAC_IR_TEST_H_
+#define JAC_IR_TEST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "ir.h"
+
+/*
+ * What the tests of the passes share: helpers that build IR straight into an
+ * arena, the way the checker lays it out, a generator of random functions,
+ * and an interpreter to run them before and after a pass.
+ */
+
+/*
+ * BUILDING
+ */
+
+typedef struct test_builder test_builder;
+
+// function 0 of the unit is 'sink', an extern taking an i32, whose calls the
+// interpreter records
+struct test_builder
+{
+    jac_ir_unit unit;
+    jac_memory_arena *arena;
+};
+
+#define TEST_SINK 0
+
+void test_init_builder(test_builder *builder, jac_memory_arena *arena);
+
+// a function of one i32 argument, which is value 0, returning 'ret', or
+// nothing for JAC_TYPE_NONE. returns its index
+size_t test_add_function(test_builder *builder, enum jac_type_kind ret);
+
+uint32_t test_add_block(test_builder *builder, size_t function);
+
+uint32_t test_add_local(test_builder *builder, size_t function, enum jac_type_kind kind);
+
+// an integer literal of 'kind', cut to it, or a float one
+jac_ir_value test_constant(enum jac_type_kind kind, int64_t value);
+
+jac_ir_value test_argument(void);
+
+// an arithmetic op gives 'kind', a comparison or logical op reads its operands
+// as 'kind' and gives a bool. 'right' is ignored for the unary ops
+jac_ir_value test_emit_op(test_builder *builder, size_t function, uint32_t block, enum jac_ir_op op,
+                          enum jac_type_kind kind, jac_ir_value left, jac_ir_value right);
+
+jac_ir_value test_emit_load(test_builder *builder, size_t function, uint32_t block, uint32_t local);
+
+void test_emit_store(test_builder *builder, size_t function, uint32_t block, uint32_t local, jac_ir_value value);
+
+// the address of 'local', which keeps it in memory
+jac_ir_value test_emit_addr(test_builder *builder, size_t function, uint32_t block, uint32_t local);
+
+// a call of one argument, giving what the callee returns
+jac_ir_value test_emit_call(test_builder *builder, size_t function, uint32_t block, size_t callee,
+                            jac_ir_value argument);
+
+void test_emit_jump(test_builder *builder, size_t function, uint32_t block, uint32_t target);
+
+void test_emit_branch(test_builder *builder, size_t function, uint32_t block, jac_ir_value condition,
+                      uint32_t if_true, uint32_t if_false);
+
+// 'value' may be null, for a bare return
+void test_emit_return(test_builder *builder, size_t function, uint32_t block, const jac_ir_value *value);
+
+// instructions with 'op' in the function, to check what a pass left
+size_t test_count_ops(const jac_ir_function *function, enum jac_ir_op op);
+
+size_t test_count_instructions(const jac_ir_function *function);
+
+// the 'nth' instruction with 'op', in block order, or null
+const jac_ir_instruction *test_find_op(const jac_ir_function *function, enum jac_ir_op op, size_t nth);
+
+// the argument of the 'nth' call, in block order, or null. the calls the
+// tests look at are those of the sink
+const jac_ir_value *test_sink_argument(const jac_ir_function *function, size_t nth);
+
+// whether 'value' is an integer literal equal to 'expected'
+bool test_is_constant(const jac_ir_value *value, int64_t expected);
+
+/*
+ * RANDOM FUNCTIONS
+ */
+
+// fills an empty function with 'blocks' blocks of about 'per_block'
+// statements over slots of a few kinds: arithmetic, comparisons, calls and
+// branches, on literals, loads and the argument. calls go to the sink, and to
+// functions 1 to 'callees', the function itself included, if it is one of them
+void test_build_random(test_builder *builder, size_t function, unsigned blocks, unsigned per_block, size_t callees);
+
+/*
+ * INTERPRETER
+ */
+
+#define TEST_TRACE_LENGTH 200
+
+typedef struct test_trace test_trace;
+
+// what a run did: the argument of each call of the sink, then what the
+// function returned. a trap ends the trace with a mark of its own. a run that
+// goes on for too long or too deep is cut off, and only its prefix counts
+struct test_trace
+{
+    uint64_t values[TEST_TRACE_LENGTH + 1];
+    size_t count;
+    bool cut;
+};
+
+void test_run(const jac_ir_unit *unit, size_t function, int32_t argument, test_trace *trace);
+
+// whether the runs agree as far as both of them got
+bool test_same_trace(const test_trace *before, const test_trace *after);
+
+// what every function is run with, the edges of an i32 among them
+#define TEST_ARGUMENT_COUNT 5
+
+extern const int32_t test_arguments[TEST_ARGUMENT_COUNT];
+
+// a run of 'function' with each of the arguments
+void test_run_arguments(const jac_ir_unit *unit, size_t function, test_trace traces[TEST_ARGUMENT_COUNT]);
+
+// runs 'function' again, after a pass, and checks that each run agrees with
+// the one 'before'. returns whether they all did
+bool test_check_same_runs(const jac_ir_unit *unit, size_t function, const test_trace before[TEST_ARGUMENT_COUNT]);
+
+#endif
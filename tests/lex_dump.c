@@ -0,0 +1,207 @@
+/*
+ * Prints the token stream of each source given, or of random fragments with
+ * --random, one token per line. The build links it against each variant of
+ * the lexer, scalar and vector, whose dumps must be identical.
+ *
+ * usage: lex_dump (--random <fragments> | <source>...)
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "darray.h"
+#include "intern.h"
+#include "lex.h"
+#include "source.h"
+
+// the exit code CTest reads as a skip, for a variant the CPU cannot run
+#define SKIP_CODE 77
+
+static void dump_constant(const jac_constant *constant)
+{
+    switch (constant->holds)
+    {
+    case JAC_CONSTANT_UINT:
+        printf(" u%llu", (unsigned long long)constant->opt.u);
+        break;
+    case JAC_CONSTANT_INT:
+        printf(" i%lld", (long long)constant->opt.i);
+        break;
+    case JAC_CONSTANT_FLOAT:
+        printf(" f%a", constant->opt.f);
+        break;
+    }
+    printf(":%d", (int)constant->type);
+}
+
+// every token, with its position, value and decoded contents
+static void dump_tokens(const char *source, jac_interner *interner)
+{
+    jac_memory_arena strings;
+    jac_init_arena(&strings);
+
+    jac_lexer lexer;
+    jac_init_lexer(&lexer, source, &strings, interner);
+    lexer.quiet = true;
+
+    darray_t jac_token *tokens = darray_new(jac_token);
+    jac_token token;
+    do
+    {
+        token = jac_next_token(&lexer);
+        darray_push(tokens, token);
+    } while (token.kind != JAC_TOKEN_EOF);
+
+    // the line table is complete once the whole source is scanned
+    darray_foreach(tokens, const jac_token, t)
+    {
+        size_t line, column;
+        jac_locate(&lexer.lines, t->offset, &line, &column);
+        printf("%d %u:%zu:%zu %u [" JAC_TOKEN_FMT "] %u", (int)t->kind, t->offset, line, column, t->length,
+               JAC_TOKEN_ARG(t), t->id);
+        if (t->kind == JAC_TOKEN_NUM_LITERAL)
+            dump_constant(&t->constant);
+        putchar('\n');
+    }
+    printf("lines %zu%s\n", darray_count(lexer.lines.starts), lexer.invalid ? ", invalid" : "");
+
+    darray_free(tokens);
+    jac_free_lexer(&lexer);
+    jac_free_arena(&strings);
+}
+
+/*
+ * RANDOM FRAGMENTS
+ */
+
+static uint64_t state = 0x9e3779b97f4a7c15u;
+
+static uint32_t next_random(uint32_t bound)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state % bound);
+}
+
+static void append_run(darray_t char **text, const char *alphabet, size_t length)
+{
+    size_t size = strlen(alphabet);
+    for (size_t i = 0; i < length; ++i)
+        darray_push(*text, alphabet[next_random((uint32_t)size)]);
+}
+
+// runs of every class, long enough to cross a few vector blocks, around the
+// tokens that end them
+static void append_piece(darray_t char **text)
+{
+    static const char *const words[] = {
+        "func", "extern", "return", "i32", "u8", "f64", "mut", "elif", "#(inline)", ";", "->", "&", ":=", "{}", "()",
+    };
+
+    switch (next_random(9))
+    {
+    case 0:
+        append_run(text, " \t\n\r", 1 + next_random(80));
+        break;
+    case 1:
+        darray_push(*text, '-');
+        darray_push(*text, '-');
+        append_run(text, "abc -_#\t\"", next_random(70));
+        if (next_random(2))
+            darray_push(*text, '\n');
+        break;
+    case 2:
+        append_run(text, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_", 1);
+        append_run(text, "abcXYZ_0189", next_random(90));
+        break;
+    case 3:
+        append_run(text, "0123456789", 1 + next_random(40));
+        if (next_random(3) == 0)
+            append_run(text, "_.0123456789", next_random(30));
+        if (next_random(3) == 0)
+            append_run(text, "iuf", 1);
+        if (next_random(2) == 0)
+            append_run(text, "0123468", 1);
+        break;
+    case 4:
+        darray_push(*text, '-');
+        append_run(text, "0123456789", 1 + next_random(20));
+        break;
+    case 5:
+        darray_push(*text, '"');
+        append_run(text, "abc \\nt\t", next_random(50));
+        if (next_random(4))
+            darray_push(*text, '"');
+        break;
+    case 6:
+        append_run(text, "@$?!~", 1);
+        break;
+    default: {
+        const char *word = words[next_random(sizeof words / sizeof words[0])];
+        for (const char *c = word; *c; ++c)
+            darray_push(*text, *c);
+        break;
+    }
+    }
+}
+
+static void dump_random(size_t fragments)
+{
+    jac_interner interner;
+    jac_init_interner(&interner);
+
+    darray_t char *text = darray_new(char);
+    for (size_t i = 0; i < fragments; ++i)
+    {
+        darray_clear(text);
+        for (uint32_t pieces = 1 + next_random(24); pieces > 0; --pieces)
+            append_piece(&text);
+        darray_push(text, '\0');
+
+        printf("fragment %zu\n", i);
+        dump_tokens(text, &interner);
+    }
+
+    darray_free(text);
+    jac_free_interner(&interner);
+}
+
+int main(int argc, char *argv[])
+{
+#if defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__))
+    if (!__builtin_cpu_supports("avx2"))
+    {
+        fprintf(stderr, "lex_dump: no AVX2 on this CPU, skipping.\n");
+        return SKIP_CODE;
+    }
+#endif
+
+    if ((argc == 3) && (strcmp(argv[1], "--random") == 0))
+    {
+        dump_random((size_t)strtoul(argv[2], NULL, 10));
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i)
+    {
+        jac_source source;
+        if (!jac_load_source(argv[i], &source))
+        {
+            fprintf(stderr, "error: could not open source file '%s'.\n", argv[i]);
+            return 1;
+        }
+
+        jac_interner interner;
+        jac_init_interner(&interner);
+        printf("source %s\n", argv[i]);
+        dump_tokens(source.text, &interner);
+        jac_free_interner(&interner);
+        jac_free_source(&source);
+    }
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * Tests dead code elimination on CFGs built directly: unreachable blocks,
+ * unused values, dead stores and the slots they leave, and the merging of
+ * blocks into their one predecessor. Random functions are then run before
+ * and after it, in memory form and after SCCP in SSA form, and must call the
+ * sink with the same values, in the same order, and trap in the same place.
+ *
+ * usage: opt_dce [<random functions>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir_test.h"
+#include "opt.h"
+#include "ssa.h"
+#include "test.h"
+
+/*
+ * DIRECTED
+ */
+
+// a chain of jumps, each block the only successor of the one before, becomes
+// a single block, its calls still in order
+static void test_merge_chain(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    for (uint32_t b = 0; b < 4; ++b)
+        test_add_block(&builder, f);
+
+    // laid out out of order, 0 -> 2 -> 1 -> 3
+    const uint32_t next[] = {2, 3, 1};
+    for (uint32_t b = 0; b < 3; ++b)
+    {
+        test_emit_call(&builder, f, b, TEST_SINK, test_constant(JAC_TYPE_INT32, b));
+        test_emit_jump(&builder, f, b, next[b]);
+    }
+    test_emit_call(&builder, f, 3, TEST_SINK, test_constant(JAC_TYPE_INT32, 3));
+    test_emit_return(&builder, f, 3, NULL);
+
+    jac_construct_ssa(&builder.unit, arena);
+    jac_ir_function *function = builder.unit.functions + f;
+    test_trace before[TEST_ARGUMENT_COUNT];
+    test_run_arguments(&builder.unit, f, before);
+    jac_eliminate_dead_code(function, arena, scratch);
+
+    CHECK(darray_count(function->blocks) == 1);
+    CHECK(test_count_ops(function, JAC_IR_JUMP) == 0);
+    CHECK(test_is_constant(test_sink_argument(function, 0), 0));
+    CHECK(test_is_constant(test_sink_argument(function, 1), 2));
+    CHECK(test_is_constant(test_sink_argument(function, 2), 1));
+    CHECK(test_is_constant(test_sink_argument(function, 3), 3));
+    CHECK((*darray_last(function->blocks[0].instructions)).op == JAC_IR_RET);
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    test_check_same_runs(&builder.unit, f, before);
+    jac_reset_arena(arena);
+}
+
+// a diamond whose branch SCCP folded: the dead arm goes, and the join, left
+// with one predecessor, merges into it, its phi standing for the one operand
+static void test_merge_pruned_diamond(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t x = test_add_local(&builder, f, JAC_TYPE_INT32);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t then = test_add_block(&builder, f);
+    uint32_t otherwise = test_add_block(&builder, f);
+    uint32_t join = test_add_block(&builder, f);
+
+    jac_ir_value condition = test_emit_op(&builder, f, entry, JAC_IR_EQ, JAC_TYPE_INT32,
+                                          test_constant(JAC_TYPE_INT32, 1), test_constant(JAC_TYPE_INT32, 1));
+    test_emit_branch(&builder, f, entry, condition, then, otherwise);
+    test_emit_store(&builder, f, then, x,
+                    test_emit_op(&builder, f, then, JAC_IR_ADD, JAC_TYPE_INT32, test_argument(),
+                                 test_constant(JAC_TYPE_INT32, 1)));
+    test_emit_jump(&builder, f, then, join);
+    test_emit_store(&builder, f, otherwise, x,
+                    test_emit_op(&builder, f, otherwise, JAC_IR_ADD, JAC_TYPE_INT32, test_argument(),
+                                 test_constant(JAC_TYPE_INT32, 2)));
+    test_emit_jump(&builder, f, otherwise, join);
+    test_emit_call(&builder, f, join, TEST_SINK, test_emit_load(&builder, f, join, x));
+    test_emit_return(&builder, f, join, NULL);
+
+    jac_construct_ssa(&builder.unit, arena);
+    jac_ir_function *function = builder.unit.functions + f;
+    test_trace before[TEST_ARGUMENT_COUNT];
+    test_run_arguments(&builder.unit, f, before);
+    jac_propagate_constants(function, scratch);
+    jac_eliminate_dead_code(function, arena, scratch);
+
+    CHECK(darray_count(function->blocks) == 1);
+    CHECK(test_count_ops(function, JAC_IR_PHI) == 0);
+    CHECK(test_count_ops(function, JAC_IR_ADD) == 1);
+
+    // the call reads the sum straight, where it read the phi
+    const jac_ir_instruction *sum = test_find_op(function, JAC_IR_ADD, 0);
+    const jac_ir_value *argument = test_sink_argument(function, 0);
+    CHECK(sum && argument && (argument->holds == JAC_IR_VALUE_VARIABLE) &&
+          (argument->opt.variable.id == sum->result.id));
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    test_check_same_runs(&builder.unit, f, before);
+    jac_reset_arena(arena);
+}
+
+// blocks nothing reaches go, and the rest are renumbered in order, their
+// edges with them
+static void test_unreachable_blocks(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t dead = test_add_block(&builder, f);
+    uint32_t then = test_add_block(&builder, f);
+    uint32_t otherwise = test_add_block(&builder, f);
+
+    jac_ir_value condition = test_emit_op(&builder, f, entry, JAC_IR_GT, JAC_TYPE_INT32, test_argument(),
+                                          test_constant(JAC_TYPE_INT32, 0));
+    test_emit_branch(&builder, f, entry, condition, then, otherwise);
+    test_emit_call(&builder, f, dead, TEST_SINK, test_constant(JAC_TYPE_INT32, 99));
+    test_emit_jump(&builder, f, dead, then);
+    test_emit_call(&builder, f, then, TEST_SINK, test_constant(JAC_TYPE_INT32, 1));
+    test_emit_return(&builder, f, then, NULL);
+    test_emit_call(&builder, f, otherwise, TEST_SINK, test_constant(JAC_TYPE_INT32, 2));
+    test_emit_return(&builder, f, otherwise, NULL);
+
+    jac_construct_ssa(&builder.unit, arena);
+    jac_ir_function *function = builder.unit.functions + f;
+    test_trace before[TEST_ARGUMENT_COUNT];
+    test_run_arguments(&builder.unit, f, before);
+    jac_eliminate_dead_code(function, arena, scratch);
+
+    CHECK(darray_count(function->blocks) == 3);
+    CHECK(test_count_ops(function, JAC_IR_CALL) == 2);
+    const jac_ir_instruction *branch = darray_last(function->blocks[0].instructions);
+    CHECK((branch->op == JAC_IR_BRANCH) && (branch->targets[0] == 1) && (branch->targets[1] == 2));
+    for (uint32_t b = 0; b < darray_count(function->blocks); ++b)
+        CHECK(function->blocks[b].id == b);
+    CHECK(test_is_constant(darray_small_data(function->blocks[1].instructions[0].operands), 1));
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    test_check_same_runs(&builder.unit, f, before);
+    jac_reset_arena(arena);
+}
+
+// unused values go, along with what only they read, and so does a cycle of
+// phis around a loop that nothing reads. calls, and divisions that may trap,
+// stay whether their value is used or not
+static void test_dead_values(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t counter = test_add_local(&builder, f, JAC_TYPE_INT64);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t loop = test_add_block(&builder, f);
+    uint32_t exit = test_add_block(&builder, f);
+
+    jac_ir_value sum = test_emit_op(&builder, f, entry, JAC_IR_ADD, JAC_TYPE_INT32, test_argument(),
+                                    test_constant(JAC_TYPE_INT32, 3));
+    test_emit_op(&builder, f, entry, JAC_IR_MUL, JAC_TYPE_INT32, sum, sum);
+    test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_INT32, test_argument(), test_constant(JAC_TYPE_INT32, 3));
+    test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_INT32, test_constant(JAC_TYPE_INT32, 3), test_argument());
+    test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_INT32, test_argument(), test_constant(JAC_TYPE_INT32, -1));
+    test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_UINT32, test_argument(), test_constant(JAC_TYPE_UINT32, -1));
+    test_emit_call(&builder, f, entry, TEST_SINK, test_constant(JAC_TYPE_INT32, 0));
+    test_emit_store(&builder, f, entry, counter, test_constant(JAC_TYPE_INT64, 0));
+    test_emit_jump(&builder, f, entry, loop);
+
+    jac_ir_value next = test_emit_op(&builder, f, loop, JAC_IR_ADD, JAC_TYPE_INT64,
+                                     test_emit_load(&builder, f, loop, counter), test_constant(JAC_TYPE_INT64, 1));
+    test_emit_store(&builder, f, loop, counter, next);
+    jac_ir_value again = test_emit_op(&builder, f, loop, JAC_IR_LT, JAC_TYPE_INT32, test_argument(),
+                                      test_constant(JAC_TYPE_INT32, 0));
+    test_emit_branch(&builder, f, loop, again, loop, exit);
+    test_emit_return(&builder, f, exit, NULL);
+
+    jac_construct_ssa(&builder.unit, arena);
+    jac_ir_function *function = builder.unit.functions + f;
+    CHECK(test_count_ops(function, JAC_IR_PHI) == 1);
+    jac_eliminate_dead_code(function, arena, scratch);
+
+    CHECK(test_count_ops(function, JAC_IR_MUL) == 0);
+    CHECK(test_count_ops(function, JAC_IR_ADD) == 0);
+    CHECK(test_count_ops(function, JAC_IR_PHI) == 0);
+    CHECK(test_count_ops(function, JAC_IR_CALL) == 1);
+    CHECK(test_count_ops(function, JAC_IR_LT) == 1);
+
+    // by a constant neither 0 nor -1 it cannot trap, by the argument it may,
+    // and a signed one by -1 overflows
+    const jac_ir_instruction *by_argument = test_find_op(function, JAC_IR_DIV, 0);
+    const jac_ir_instruction *by_minus_one = test_find_op(function, JAC_IR_DIV, 1);
+    CHECK(test_count_ops(function, JAC_IR_DIV) == 2);
+    CHECK(by_argument && (darray_small_data(by_argument->operands)[1].holds == JAC_IR_VALUE_VARIABLE));
+    CHECK(by_minus_one && test_is_constant(darray_small_data(by_minus_one->operands) + 1, -1));
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    jac_reset_arena(arena);
+}
+
+// in memory form: a slot never loaded loses its stores, the values only they
+// read, and the slot itself. one that is loaded, or whose address is taken,
+// keeps them
+static void test_dead_stores(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t unread = test_add_local(&builder, f, JAC_TYPE_INT32);
+    uint32_t read = test_add_local(&builder, f, JAC_TYPE_INT16);
+    uint32_t escapes = test_add_local(&builder, f, JAC_TYPE_UINT32);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t tail = test_add_block(&builder, f);
+
+    jac_ir_value product = test_emit_op(&builder, f, entry, JAC_IR_MUL, JAC_TYPE_INT32, test_argument(),
+                                        test_constant(JAC_TYPE_INT32, 7));
+    test_emit_store(&builder, f, entry, unread, product);
+    test_emit_store(&builder, f, entry, read, test_constant(JAC_TYPE_INT16, -5));
+    test_emit_store(&builder, f, entry, escapes, test_constant(JAC_TYPE_UINT32, 9));
+    test_emit_call(&builder, f, entry, TEST_SINK, test_emit_addr(&builder, f, entry, escapes));
+    test_emit_jump(&builder, f, entry, tail);
+    test_emit_store(&builder, f, tail, unread, test_argument());
+    test_emit_call(&builder, f, tail, TEST_SINK, test_emit_load(&builder, f, tail, read));
+    test_emit_return(&builder, f, tail, NULL);
+
+    jac_ir_function *function = builder.unit.functions + f;
+    jac_build_cfg(function, arena);
+    test_trace before[TEST_ARGUMENT_COUNT];
+    test_run_arguments(&builder.unit, f, before);
+    jac_eliminate_dead_code(function, arena, scratch);
+
+    // the two slots left are renumbered, and the instructions with them
+    CHECK(darray_count(function->locals) == 2);
+    CHECK((function->locals[0].id == 0) && (function->locals[0].sym.type.id == JAC_TYPE_INT16));
+    CHECK((function->locals[1].id == 1) && (function->locals[1].sym.type.id == JAC_TYPE_UINT32));
+    CHECK(test_count_ops(function, JAC_IR_STORE) == 2);
+    CHECK(test_count_ops(function, JAC_IR_MUL) == 0);
+    CHECK(test_count_ops(function, JAC_IR_ADDR) == 1);
+    CHECK(test_find_op(function, JAC_IR_LOAD, 0)->local == 0);
+    CHECK(test_find_op(function, JAC_IR_ADDR, 0)->local == 1);
+    CHECK(darray_count(function->blocks) == 1);
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    jac_reset_arena(arena);
+}
+
+/*
+ * RANDOM
+ */
+
+// in SSA form after SCCP, as the pipeline runs it, or in memory form, where
+// the stores and slots are all still there
+static void test_random_functions(jac_memory_arena *arena, jac_memory_arena *scratch, int count, bool in_ssa)
+{
+    size_t before = 0, after = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        test_builder builder;
+        test_init_builder(&builder, arena);
+        size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+        test_build_random(&builder, f, 2 + test_random(14), test_random(8), 0);
+
+        jac_ir_function *function = builder.unit.functions + f;
+        if (in_ssa)
+            jac_construct_ssa(&builder.unit, arena);
+        else
+            jac_build_cfg(function, arena);
+        if (!CHECK(jac_verify_unit(&builder.unit, stderr)))
+        {
+            jac_reset_arena(arena);
+            continue;
+        }
+
+        test_trace traces[TEST_ARGUMENT_COUNT];
+        test_run_arguments(&builder.unit, f, traces);
+
+        before += test_count_instructions(function);
+        if (in_ssa)
+            jac_propagate_constants(function, scratch);
+        jac_eliminate_dead_code(function, arena, scratch);
+        after += test_count_instructions(function);
+
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+        test_check_same_runs(&builder.unit, f, traces);
+        jac_reset_arena(arena);
+    }
+
+    printf("random, %s: %d functions, %zu instructions before, %zu after\n", in_ssa ? "ssa" : "memory", count,
+           before, after);
+}
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 2000;
+
+    jac_memory_arena arena, scratch;
+    jac_init_arena(&arena);
+    jac_init_arena(&scratch);
+
+    test_merge_chain(&arena, &scratch);
+    test_merge_pruned_diamond(&arena, &scratch);
+    test_unreachable_blocks(&arena, &scratch);
+    test_dead_values(&arena, &scratch);
+    test_dead_stores(&arena, &scratch);
+    test_random_functions(&arena, &scratch, count, true);
+    test_random_functions(&arena, &scratch, count, false);
+
+    jac_free_arena(&scratch);
+    jac_free_arena(&arena);
+    return test_finish("opt_dce");
+}
@@ -0,0 +1,334 @@
+/*
+ * Checks constant folding against the C compiler's own arithmetic. Every op
+ * of every primitive kind, over the edges of each width and random operands,
+ * must give what the same op on the C type gives, wraparound and rounding
+ * included, and fail exactly where the instruction would trap.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "opt.h"
+#include "test.h"
+
+#define ROUNDS 50000
+
+static const enum jac_ir_op integer_ops[] = {
+    JAC_IR_ADD, JAC_IR_SUB, JAC_IR_MUL, JAC_IR_DIV, JAC_IR_AND, JAC_IR_OR,  JAC_IR_EQ,
+    JAC_IR_NE,  JAC_IR_LT,  JAC_IR_LE,  JAC_IR_GT,  JAC_IR_GE,  JAC_IR_NEG, JAC_IR_NOT,
+};
+
+static const enum jac_ir_op float_ops[] = {
+    JAC_IR_ADD, JAC_IR_SUB, JAC_IR_MUL, JAC_IR_DIV, JAC_IR_EQ, JAC_IR_NE,
+    JAC_IR_LT,  JAC_IR_LE,  JAC_IR_GT,  JAC_IR_GE,  JAC_IR_NEG,
+};
+
+static const uint64_t edges[] = {
+    0,
+    1,
+    2,
+    3,
+    10,
+    100,
+    0x7f,
+    0x80,
+    0xff,
+    0x7fff,
+    0x8000,
+    0xffff,
+    0x7fffffff,
+    0x80000000u,
+    0xffffffffu,
+    0x7fffffffffffffffu,
+    0x8000000000000000u,
+    0xfffffffffffffffeu,
+    0xffffffffffffffffu,
+};
+
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+// an edge two times in three, so the interesting cases meet each other often
+static uint64_t pick_bits(void)
+{
+    return test_random(3) ? edges[test_random(COUNT_OF(edges))] : test_random_bits();
+}
+
+// of every magnitude, and now and then zero
+static double pick_float(void)
+{
+    if (test_random(8) == 0)
+        return 0.0;
+    return ldexp((double)(int64_t)test_random_bits(), (int)test_random(160) - 100);
+}
+
+static jac_constant make_uint(uint64_t value)
+{
+    return (jac_constant){.opt.u = value, .holds = JAC_CONSTANT_UINT, .type = JAC_TYPE_NONE};
+}
+
+static jac_constant make_float(double value)
+{
+    return (jac_constant){.opt.f = value, .holds = JAC_CONSTANT_FLOAT, .type = JAC_TYPE_NONE};
+}
+
+static bool fold(enum jac_ir_op op, enum jac_type_kind kind, const jac_constant *left, const jac_constant *right,
+                 jac_constant *result)
+{
+    if ((op == JAC_IR_NEG) || (op == JAC_IR_NOT))
+        return jac_fold_unary(op, kind, left, result);
+    return jac_fold_binary(op, kind, left, right, result);
+}
+
+/*
+ * NATIVE ARITHMETIC
+ */
+
+// 'op' over 'x' and 'y' cut to T, by C itself, with the result sign extended
+// to 64 bits, as jac_convert_constant leaves it. fails where it would trap.
+// sums, differences and products go through uint64_t, as C only wraps those
+// of the unsigned types, and the cast back to T cuts them
+#define DEFINE_NATIVE_INTEGER(name, T)                                                                                \
+    static bool name(enum jac_ir_op op, uint64_t x, uint64_t y, uint64_t *result)                                     \
+    {                                                                                                                 \
+        T a = (T)x, b = (T)y;                                                                                         \
+        T least = ((T)-1 < 0) ? (T)((uint64_t)1 << (sizeof(T) * 8 - 1)) : 0;                                          \
+        switch (op)                                                                                                   \
+        {                                                                                                             \
+        case JAC_IR_ADD:                                                                                              \
+            *result = (uint64_t)(T)((uint64_t)a + (uint64_t)b);                                                       \
+            return true;                                                                                              \
+        case JAC_IR_SUB:                                                                                              \
+            *result = (uint64_t)(T)((uint64_t)a - (uint64_t)b);                                                       \
+            return true;                                                                                              \
+        case JAC_IR_MUL:                                                                                              \
+            *result = (uint64_t)(T)((uint64_t)a * (uint64_t)b);                                                       \
+            return true;                                                                                              \
+        case JAC_IR_DIV:                                                                                              \
+            if ((b == 0) || (((T)-1 < 0) && (a == least) && (b == (T)-1)))                                            \
+                return false;                                                                                         \
+            *result = (uint64_t)(T)(a / b);                                                                           \
+            return true;                                                                                              \
+        case JAC_IR_AND:                                                                                              \
+            *result = a && b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_OR:                                                                                               \
+            *result = a || b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_EQ:                                                                                               \
+            *result = a == b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_NE:                                                                                               \
+            *result = a != b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_LT:                                                                                               \
+            *result = a < b;                                                                                          \
+            return true;                                                                                              \
+        case JAC_IR_LE:                                                                                               \
+            *result = a <= b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_GT:                                                                                               \
+            *result = a > b;                                                                                          \
+            return true;                                                                                              \
+        case JAC_IR_GE:                                                                                               \
+            *result = a >= b;                                                                                         \
+            return true;                                                                                              \
+        case JAC_IR_NEG:                                                                                              \
+            *result = (uint64_t)(T)(0 - (uint64_t)a);                                                                 \
+            return true;                                                                                              \
+        case JAC_IR_NOT:                                                                                              \
+            *result = !a;                                                                                             \
+            return true;                                                                                              \
+        default:                                                                                                      \
+            return false;                                                                                             \
+        }                                                                                                             \
+    }
+
+DEFINE_NATIVE_INTEGER(native_int8, int8_t)
+DEFINE_NATIVE_INTEGER(native_uint8, uint8_t)
+DEFINE_NATIVE_INTEGER(native_int16, int16_t)
+DEFINE_NATIVE_INTEGER(native_uint16, uint16_t)
+DEFINE_NATIVE_INTEGER(native_int32, int32_t)
+DEFINE_NATIVE_INTEGER(native_uint32, uint32_t)
+DEFINE_NATIVE_INTEGER(native_int64, int64_t)
+DEFINE_NATIVE_INTEGER(native_uint64, uint64_t)
+
+// the same for the floats. a volatile T rounds each result to its width
+// before it is widened back, and comparisons give 0 or 1 in 'bits'
+#define DEFINE_NATIVE_FLOAT(name, T)                                                                                  \
+    static bool name(enum jac_ir_op op, double x, double y, double *result, uint64_t *bits)                           \
+    {                                                                                                                 \
+        T a = (T)x, b = (T)y;                                                                                         \
+        volatile T e = 0;                                                                                             \
+        *bits = 0;                                                                                                    \
+        switch (op)                                                                                                   \
+        {                                                                                                             \
+        case JAC_IR_ADD:                                                                                              \
+            e = a + b;                                                                                                \
+            break;                                                                                                    \
+        case JAC_IR_SUB:                                                                                              \
+            e = a - b;                                                                                                \
+            break;                                                                                                    \
+        case JAC_IR_MUL:                                                                                              \
+            e = a * b;                                                                                                \
+            break;                                                                                                    \
+        case JAC_IR_DIV:                                                                                              \
+            e = a / b;                                                                                                \
+            break;                                                                                                    \
+        case JAC_IR_NEG:                                                                                              \
+            e = -a;                                                                                                   \
+            break;                                                                                                    \
+        case JAC_IR_EQ:                                                                                               \
+            *bits = a == b;                                                                                           \
+            return true;                                                                                              \
+        case JAC_IR_NE:                                                                                               \
+            *bits = a != b;                                                                                           \
+            return true;                                                                                              \
+        case JAC_IR_LT:                                                                                               \
+            *bits = a < b;                                                                                            \
+            return true;                                                                                              \
+        case JAC_IR_LE:                                                                                               \
+            *bits = a <= b;                                                                                           \
+            return true;                                                                                              \
+        case JAC_IR_GT:                                                                                               \
+            *bits = a > b;                                                                                            \
+            return true;                                                                                              \
+        case JAC_IR_GE:                                                                                               \
+            *bits = a >= b;                                                                                           \
+            return true;                                                                                              \
+        default:                                                                                                      \
+            return false;                                                                                             \
+        }                                                                                                             \
+        *result = e;                                                                                                  \
+        return true;                                                                                                  \
+    }
+
+DEFINE_NATIVE_FLOAT(native_float32, float)
+DEFINE_NATIVE_FLOAT(native_float64, double)
+
+/*
+ * CHECKS
+ */
+
+typedef bool (*native_integer)(enum jac_ir_op op, uint64_t x, uint64_t y, uint64_t *result);
+typedef bool (*native_float)(enum jac_ir_op op, double x, double y, double *result, uint64_t *bits);
+
+static bool is_comparison(enum jac_ir_op op)
+{
+    return (op >= JAC_IR_AND) && (op <= JAC_IR_GE);
+}
+
+static void check_integers(enum jac_type_kind kind, native_integer native)
+{
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        uint64_t x = pick_bits(), y = pick_bits();
+        jac_constant left = make_uint(x), right = make_uint(y), result;
+
+        // conversion keeps the sign extension of the cut value, see the sum with 0
+        uint64_t expected;
+        native(JAC_IR_ADD, x, 0, &expected);
+        if (!CHECK(jac_convert_constant(&left, kind, &result) && (result.opt.u == expected) &&
+                   (result.type == kind)) &&
+            test_verbose())
+            fprintf(stderr, "  convert %llx to kind %d\n", (unsigned long long)x, (int)kind);
+
+        for (size_t i = 0; i < COUNT_OF(integer_ops); ++i)
+        {
+            enum jac_ir_op op = integer_ops[i];
+            bool defined = native(op, x, y, &expected);
+            bool folded = fold(op, kind, &left, &right, &result);
+
+            enum jac_type_kind type = is_comparison(op) || (op == JAC_IR_NOT) ? JAC_TYPE_BOOL : kind;
+            if (!CHECK((folded == defined) && (!defined || ((result.opt.u == expected) && (result.type == type)))) &&
+                test_verbose())
+                fprintf(stderr, "  op %d of kind %d over %llx and %llx: %s %llx, expected %s %llx\n", (int)op,
+                        (int)kind, (unsigned long long)x, (unsigned long long)y, folded ? "folded" : "trapped",
+                        (unsigned long long)result.opt.u, defined ? "" : "trap", (unsigned long long)expected);
+        }
+    }
+}
+
+static bool same_float(double a, double b)
+{
+    return (isnan(a) && isnan(b)) || (memcmp(&a, &b, sizeof a) == 0);
+}
+
+static void check_floats(enum jac_type_kind kind, native_float native)
+{
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        double x = pick_float(), y = pick_float();
+        jac_constant left = make_float(x), right = make_float(y), result;
+
+        for (size_t i = 0; i < COUNT_OF(float_ops); ++i)
+        {
+            enum jac_ir_op op = float_ops[i];
+            double expected = 0;
+            uint64_t bits;
+            bool defined = native(op, x, y, &expected, &bits);
+            bool folded = fold(op, kind, &left, &right, &result);
+
+            bool same = is_comparison(op) ? (result.opt.u == bits) : same_float(result.opt.f, expected);
+            if (!CHECK(folded && defined && same) && test_verbose())
+                fprintf(stderr, "  op %d of kind %d over %a and %a: %a, expected %a\n", (int)op, (int)kind, x, y,
+                        result.opt.f, expected);
+        }
+    }
+}
+
+// NaN compares unordered, and converts to no integer at all
+static void check_nan(void)
+{
+    jac_constant nan = make_float(NAN), one = make_float(1.0), result;
+
+    CHECK(jac_fold_binary(JAC_IR_NE, JAC_TYPE_FLOAT64, &nan, &nan, &result) && (result.opt.u == 1));
+    CHECK(jac_fold_binary(JAC_IR_EQ, JAC_TYPE_FLOAT64, &nan, &nan, &result) && (result.opt.u == 0));
+    CHECK(jac_fold_binary(JAC_IR_GE, JAC_TYPE_FLOAT32, &nan, &one, &result) && (result.opt.u == 0));
+    CHECK(jac_fold_binary(JAC_IR_LT, JAC_TYPE_FLOAT32, &nan, &one, &result) && (result.opt.u == 0));
+    CHECK(!jac_convert_constant(&nan, JAC_TYPE_INT32, &result));
+    CHECK(!jac_constant_fits(&nan, JAC_TYPE_FLOAT64));
+}
+
+// a constant fits a kind where C's own conversion keeps its value
+static void check_fits(void)
+{
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        uint64_t x = pick_bits();
+        jac_constant u = make_uint(x);
+        jac_constant i = {.opt.i = (int64_t)x, .holds = JAC_CONSTANT_INT, .type = JAC_TYPE_NONE};
+
+        CHECK(jac_constant_fits(&u, JAC_TYPE_UINT8) == ((uint8_t)x == x));
+        CHECK(jac_constant_fits(&u, JAC_TYPE_INT16) == (x <= INT16_MAX));
+        CHECK(jac_constant_fits(&u, JAC_TYPE_UINT64));
+        CHECK(jac_constant_fits(&u, JAC_TYPE_INT64) == ((int64_t)x >= 0));
+        CHECK(jac_constant_fits(&i, JAC_TYPE_INT8) == ((int8_t)i.opt.i == i.opt.i));
+        CHECK(jac_constant_fits(&i, JAC_TYPE_UINT32) == ((i.opt.i >= 0) && ((uint32_t)i.opt.i == i.opt.u)));
+        CHECK(jac_constant_fits(&i, JAC_TYPE_FLOAT64));
+
+        // a float fits no integer kind, whole or not
+        jac_constant f = make_float(pick_float());
+        CHECK(!jac_constant_fits(&f, JAC_TYPE_INT32));
+        CHECK(jac_constant_fits(&f, JAC_TYPE_FLOAT64));
+    }
+}
+
+int main(void)
+{
+    check_integers(JAC_TYPE_INT8, native_int8);
+    check_integers(JAC_TYPE_UINT8, native_uint8);
+    check_integers(JAC_TYPE_INT16, native_int16);
+    check_integers(JAC_TYPE_UINT16, native_uint16);
+    check_integers(JAC_TYPE_INT32, native_int32);
+    check_integers(JAC_TYPE_UINT32, native_uint32);
+    check_integers(JAC_TYPE_INT64, native_int64);
+    check_integers(JAC_TYPE_UINT64, native_uint64);
+    check_floats(JAC_TYPE_FLOAT32, native_float32);
+    check_floats(JAC_TYPE_FLOAT64, native_float64);
+    check_nan();
+    check_fits();
+
+    return test_finish("opt_fold");
+}
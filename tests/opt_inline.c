@@ -0,0 +1,334 @@
+/*
+ * Tests the inliner on units built directly. The directed cases check which
+ * calls the hints and the cost model have inlined, that calls within
+ * recursion stay, and what a callee falling off the end leaves. Random units,
+ * whose functions call each other with random hints, are then run before and
+ * after it, and each function must call the sink with the same values, in the
+ * same order, and trap in the same place.
+ *
+ * usage: opt_inline [<random units>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir_test.h"
+#include "opt.h"
+#include "ssa.h"
+#include "test.h"
+
+// calls of 'callee' left in 'function'
+static size_t count_calls(const jac_ir_function *function, size_t callee)
+{
+    const jac_ir_instruction *call;
+    size_t calls = 0;
+    for (size_t nth = 0; (call = test_find_op(function, JAC_IR_CALL, nth)); ++nth)
+        calls += call->callee == callee;
+    return calls;
+}
+
+// returns its argument, after passing it to the sink 'calls' times
+static size_t add_callee(test_builder *builder, size_t calls)
+{
+    size_t f = test_add_function(builder, JAC_TYPE_INT32);
+    test_add_block(builder, f);
+    for (size_t i = 0; i < calls; ++i)
+        test_emit_call(builder, f, 0, TEST_SINK, test_argument());
+    jac_ir_value argument = test_argument();
+    test_emit_return(builder, f, 0, &argument);
+    return f;
+}
+
+// sink(callee(argument)), for each callee
+static size_t add_caller(test_builder *builder, const size_t *callees, size_t count)
+{
+    size_t f = test_add_function(builder, JAC_TYPE_NONE);
+    test_add_block(builder, f);
+    for (size_t i = 0; i < count; ++i)
+        test_emit_call(builder, f, 0, TEST_SINK, test_emit_call(builder, f, 0, callees[i], test_argument()));
+    test_emit_return(builder, f, 0, NULL);
+    return f;
+}
+
+// the CFG and SSA form the inliner expects, and the runs of 'function' before
+static bool prepare(test_builder *builder, size_t function, test_trace *traces)
+{
+    jac_construct_ssa(&builder->unit, builder->arena);
+    if (!CHECK(jac_verify_unit(&builder->unit, stderr)))
+        return false;
+    test_run_arguments(&builder->unit, function, traces);
+    return true;
+}
+
+/*
+ * DIRECTED
+ */
+
+// a small callee is inlined, one over the threshold is not, unless hinted
+// #(inline), and #(noinline) keeps even the smallest
+static void test_hints(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t small = add_callee(&builder, 1);
+    size_t large = add_callee(&builder, 40);
+    size_t hinted = add_callee(&builder, 40);
+    size_t kept = add_callee(&builder, 1);
+    builder.unit.functions[hinted].inlining = JAC_IR_INLINE_ALWAYS;
+    builder.unit.functions[kept].inlining = JAC_IR_INLINE_NEVER;
+    const size_t callees[] = {small, large, hinted, kept};
+    size_t f = add_caller(&builder, callees, 4);
+
+    test_trace before[TEST_ARGUMENT_COUNT];
+    if (prepare(&builder, f, before))
+    {
+        jac_inline_calls(&builder.unit, arena, scratch);
+        const jac_ir_function *function = builder.unit.functions + f;
+        CHECK(count_calls(function, small) == 0);
+        CHECK(count_calls(function, large) == 1);
+        CHECK(count_calls(function, hinted) == 0);
+        CHECK(count_calls(function, kept) == 1);
+        CHECK(count_calls(function, TEST_SINK) == 1 + 40 + 4);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+        test_check_same_runs(&builder.unit, f, before);
+    }
+    jac_reset_arena(arena);
+}
+
+// calls within a cycle of the call graph stay, hinted or not, while a call
+// into the cycle from outside is inlined once
+static void test_recursion(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t self = test_add_function(&builder, JAC_TYPE_INT32);
+    size_t even = test_add_function(&builder, JAC_TYPE_INT32);
+    size_t odd = test_add_function(&builder, JAC_TYPE_INT32);
+    const size_t cycle[][2] = {{self, self}, {even, odd}, {odd, even}};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        size_t f = cycle[i][0];
+        builder.unit.functions[f].inlining = JAC_IR_INLINE_ALWAYS;
+        test_add_block(&builder, f);
+        test_emit_call(&builder, f, 0, TEST_SINK, test_argument());
+        jac_ir_value returned = test_emit_call(&builder, f, 0, cycle[i][1], test_argument());
+        test_emit_return(&builder, f, 0, &returned);
+    }
+    const size_t callees[] = {self, even};
+    size_t f = add_caller(&builder, callees, 2);
+
+    test_trace before[TEST_ARGUMENT_COUNT];
+    if (prepare(&builder, f, before))
+    {
+        jac_inline_calls(&builder.unit, arena, scratch);
+        CHECK(count_calls(builder.unit.functions + self, self) == 1);
+        CHECK(count_calls(builder.unit.functions + even, odd) == 1);
+        CHECK(count_calls(builder.unit.functions + odd, even) == 1);
+
+        // the copies call on into the cycle
+        const jac_ir_function *function = builder.unit.functions + f;
+        CHECK((count_calls(function, self) == 1) && (count_calls(function, even) == 0));
+        CHECK(count_calls(function, odd) == 1);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+        test_check_same_runs(&builder.unit, f, before);
+    }
+    jac_reset_arena(arena);
+}
+
+// if argument > 0 { return argument } else { sink(7) } and off the end: the
+// value of the call is undefined along that path, so only the runs that
+// return are compared. a void callee falls off both ways
+static void test_falls_off(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t partial = test_add_function(&builder, JAC_TYPE_INT32);
+    size_t nothing = test_add_function(&builder, JAC_TYPE_NONE);
+    const size_t callees[] = {partial, nothing};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        size_t g = callees[i];
+        uint32_t entry = test_add_block(&builder, g);
+        uint32_t then = test_add_block(&builder, g);
+        uint32_t otherwise = test_add_block(&builder, g);
+        jac_ir_value positive = test_emit_op(&builder, g, entry, JAC_IR_GT, JAC_TYPE_INT32, test_argument(),
+                                             test_constant(JAC_TYPE_INT32, 0));
+        test_emit_branch(&builder, g, entry, positive, then, otherwise);
+        if (g == partial)
+        {
+            jac_ir_value argument = test_argument();
+            test_emit_return(&builder, g, then, &argument);
+        }
+        else
+            test_emit_call(&builder, g, then, TEST_SINK, test_argument());
+        test_emit_call(&builder, g, otherwise, TEST_SINK, test_constant(JAC_TYPE_INT32, 7));
+    }
+
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    test_add_block(&builder, f);
+    test_emit_call(&builder, f, 0, nothing, test_argument());
+    test_emit_call(&builder, f, 0, TEST_SINK, test_emit_call(&builder, f, 0, partial, test_argument()));
+    test_emit_return(&builder, f, 0, NULL);
+
+    test_trace before[TEST_ARGUMENT_COUNT];
+    if (prepare(&builder, f, before))
+    {
+        jac_inline_calls(&builder.unit, arena, scratch);
+        const jac_ir_function *function = builder.unit.functions + f;
+        CHECK((count_calls(function, partial) == 0) && (count_calls(function, nothing) == 0));
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+        for (size_t a = 0; a < TEST_ARGUMENT_COUNT; ++a)
+        {
+            test_trace after;
+            test_run(&builder.unit, f, test_arguments[a], &after);
+            if (test_arguments[a] > 0)
+                CHECK(test_same_trace(before + a, &after));
+            else
+                CHECK((after.count == before[a].count) && (after.values[0] == 7) && (after.values[1] == 7));
+        }
+    }
+    jac_reset_arena(arena);
+}
+
+// the slots of the copy come after the caller's own, and a literal argument
+// takes the type of the parameter, as it would by being passed
+static void test_slots_and_literals(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t callee = test_add_function(&builder, JAC_TYPE_INT32);
+    uint32_t own = test_add_local(&builder, callee, JAC_TYPE_INT32);
+    test_add_block(&builder, callee);
+    test_emit_store(&builder, callee, 0, own, test_argument());
+    test_emit_call(&builder, callee, 0, TEST_SINK, test_emit_addr(&builder, callee, 0, own));
+    test_emit_call(&builder, callee, 0, TEST_SINK, test_argument());
+    jac_ir_value loaded = test_emit_load(&builder, callee, 0, own);
+    test_emit_return(&builder, callee, 0, &loaded);
+
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t kept = test_add_local(&builder, f, JAC_TYPE_INT32);
+    test_add_block(&builder, f);
+    test_emit_store(&builder, f, 0, kept, test_constant(JAC_TYPE_INT32, 100));
+    test_emit_call(&builder, f, 0, TEST_SINK, test_emit_addr(&builder, f, 0, kept));
+    test_emit_call(&builder, f, 0, TEST_SINK, test_emit_call(&builder, f, 0, callee, test_argument()));
+    jac_ir_value five = test_constant(JAC_TYPE_FLOAT64, 5);
+    test_emit_call(&builder, f, 0, TEST_SINK, test_emit_call(&builder, f, 0, callee, five));
+    test_emit_call(&builder, f, 0, TEST_SINK, test_emit_load(&builder, f, 0, kept));
+    test_emit_return(&builder, f, 0, NULL);
+
+    test_trace before[TEST_ARGUMENT_COUNT];
+    if (prepare(&builder, f, before))
+    {
+        jac_inline_calls(&builder.unit, arena, scratch);
+        const jac_ir_function *function = builder.unit.functions + f;
+        CHECK(count_calls(function, callee) == 0);
+        CHECK(darray_count(function->locals) == 3);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+
+        // the addresses differ, the values must not
+        for (size_t a = 0; a < TEST_ARGUMENT_COUNT; ++a)
+        {
+            test_trace after;
+            test_run(&builder.unit, f, test_arguments[a], &after);
+            CHECK((after.count == 8) && (after.values[2] == before[a].values[2]) &&
+                  (after.values[3] == before[a].values[3]) && (after.values[5] == 5) && (after.values[6] == 5) &&
+                  (after.values[7] == 100));
+        }
+    }
+    jac_reset_arena(arena);
+}
+
+// a caller grown past the limit inlines nothing more, however small
+static void test_caller_limit(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t small = add_callee(&builder, 1);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    test_add_block(&builder, f);
+    for (int i = 0; i < 5000; ++i)
+        test_emit_call(&builder, f, 0, TEST_SINK, test_constant(JAC_TYPE_INT32, i));
+    test_emit_call(&builder, f, 0, small, test_argument());
+    test_emit_return(&builder, f, 0, NULL);
+
+    test_trace before[TEST_ARGUMENT_COUNT];
+    if (prepare(&builder, f, before))
+    {
+        jac_inline_calls(&builder.unit, arena, scratch);
+        CHECK(count_calls(builder.unit.functions + f, small) == 1);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+    }
+    jac_reset_arena(arena);
+}
+
+/*
+ * RANDOM
+ */
+
+// a few functions calling each other, and themselves, with random hints. the
+// generator's calls take and give an i32
+static void test_random_units(jac_memory_arena *arena, jac_memory_arena *scratch, int count)
+{
+    static const enum jac_ir_inlining hints[] = {JAC_IR_INLINE_AUTO, JAC_IR_INLINE_AUTO, JAC_IR_INLINE_ALWAYS,
+                                                 JAC_IR_INLINE_NEVER};
+
+    size_t calls_before = 0, calls_after = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        test_builder builder;
+        test_init_builder(&builder, arena);
+        size_t functions = 1 + test_random(5);
+        for (size_t f = 1; f <= functions; ++f)
+        {
+            test_add_function(&builder, JAC_TYPE_INT32);
+            builder.unit.functions[f].inlining = hints[test_random(4)];
+        }
+        for (size_t f = 1; f <= functions; ++f)
+            test_build_random(&builder, f, 1 + test_random(6), test_random(6), functions);
+
+        jac_construct_ssa(&builder.unit, arena);
+        if (!CHECK(jac_verify_unit(&builder.unit, stderr)))
+        {
+            jac_reset_arena(arena);
+            continue;
+        }
+
+        test_trace traces[6][TEST_ARGUMENT_COUNT];
+        for (size_t f = 1; f <= functions; ++f)
+        {
+            test_run_arguments(&builder.unit, f, traces[f - 1]);
+            calls_before += test_count_ops(builder.unit.functions + f, JAC_IR_CALL);
+        }
+
+        jac_inline_calls(&builder.unit, arena, scratch);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+        for (size_t f = 1; f <= functions; ++f)
+        {
+            test_check_same_runs(&builder.unit, f, traces[f - 1]);
+            calls_after += test_count_ops(builder.unit.functions + f, JAC_IR_CALL);
+        }
+        jac_reset_arena(arena);
+    }
+
+    printf("random: %d units, %zu calls before, %zu after\n", count, calls_before, calls_after);
+}
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 1000;
+
+    jac_memory_arena arena, scratch;
+    jac_init_arena(&arena);
+    jac_init_arena(&scratch);
+
+    test_hints(&arena, &scratch);
+    test_recursion(&arena, &scratch);
+    test_falls_off(&arena, &scratch);
+    test_slots_and_literals(&arena, &scratch);
+    test_caller_limit(&arena, &scratch);
+    test_random_units(&arena, &scratch, count);
+
+    jac_free_arena(&scratch);
+    jac_free_arena(&arena);
+    return test_finish("opt_inline");
+}
@@ -0,0 +1,283 @@
+/*
+ * Tests sparse conditional constant propagation on CFGs built directly. The
+ * directed cases check what it folds, which branches it prunes, and what it
+ * must leave alone. Random functions are then run before and after it, with
+ * a few arguments, and must call the sink with the same values, in the same
+ * order, and trap in the same place.
+ *
+ * usage: opt_sccp [<random functions>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ir_test.h"
+#include "opt.h"
+#include "ssa.h"
+#include "test.h"
+
+// the CFG and SSA form the pass expects, as the compiler builds them
+static jac_ir_function *prepare(test_builder *builder, size_t function)
+{
+    jac_construct_ssa(&builder->unit, builder->arena);
+    CHECK(jac_verify_unit(&builder->unit, stderr));
+    return builder->unit.functions + function;
+}
+
+static const jac_ir_instruction *terminator(const jac_ir_function *function, uint32_t block)
+{
+    const jac_ir_block *b = function->blocks + block;
+    return (darray_count(b->instructions) > 0) ? darray_last(b->instructions) : NULL;
+}
+
+/*
+ * DIRECTED
+ */
+
+// x := 6; sink(x * 7 - 2) folds the whole chain, which leaves nothing but the call
+static void test_fold_chain(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t x = test_add_local(&builder, f, JAC_TYPE_INT32);
+    uint32_t entry = test_add_block(&builder, f);
+
+    test_emit_store(&builder, f, entry, x, test_constant(JAC_TYPE_INT32, 6));
+    jac_ir_value product = test_emit_op(&builder, f, entry, JAC_IR_MUL, JAC_TYPE_INT32,
+                                        test_emit_load(&builder, f, entry, x), test_constant(JAC_TYPE_INT32, 7));
+    jac_ir_value difference =
+        test_emit_op(&builder, f, entry, JAC_IR_SUB, JAC_TYPE_INT32, product, test_constant(JAC_TYPE_INT32, 2));
+    test_emit_call(&builder, f, entry, TEST_SINK, difference);
+    test_emit_return(&builder, f, entry, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    jac_propagate_constants(function, scratch);
+
+    CHECK(test_is_constant(test_sink_argument(function, 0), 40));
+    CHECK(test_count_ops(function, JAC_IR_MUL) == 0);
+    CHECK(test_count_ops(function, JAC_IR_SUB) == 0);
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    jac_reset_arena(arena);
+}
+
+// if 3 < 5 { x := 1 } else { x := 2 }; sink(x). the branch becomes a jump,
+// and the store of the arm never taken does not reach the join
+static void test_prune_branch(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t x = test_add_local(&builder, f, JAC_TYPE_INT64);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t then = test_add_block(&builder, f);
+    uint32_t otherwise = test_add_block(&builder, f);
+    uint32_t join = test_add_block(&builder, f);
+
+    jac_ir_value condition = test_emit_op(&builder, f, entry, JAC_IR_LT, JAC_TYPE_INT32,
+                                          test_constant(JAC_TYPE_INT32, 3), test_constant(JAC_TYPE_INT32, 5));
+    test_emit_branch(&builder, f, entry, condition, then, otherwise);
+    test_emit_store(&builder, f, then, x, test_constant(JAC_TYPE_INT64, 1));
+    test_emit_jump(&builder, f, then, join);
+    test_emit_store(&builder, f, otherwise, x, test_constant(JAC_TYPE_INT64, 2));
+    test_emit_jump(&builder, f, otherwise, join);
+    test_emit_call(&builder, f, join, TEST_SINK, test_emit_load(&builder, f, join, x));
+    test_emit_return(&builder, f, join, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    CHECK(test_count_ops(function, JAC_IR_PHI) == 1);
+    jac_propagate_constants(function, scratch);
+
+    const jac_ir_instruction *jump = terminator(function, entry);
+    CHECK(jump && (jump->op == JAC_IR_JUMP) && (jump->targets[0] == then));
+    CHECK(darray_small_count(function->blocks[otherwise].predecessors) == 0);
+    CHECK(darray_small_count(function->blocks[join].predecessors) == 2);
+    CHECK(test_is_constant(test_sink_argument(function, 0), 1));
+    CHECK(test_count_ops(function, JAC_IR_LT) == 0);
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    jac_reset_arena(arena);
+}
+
+// the same diamond on the argument: both arms stay, and the join only folds
+// where both arms agree
+static void test_keep_branch(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t same = test_add_local(&builder, f, JAC_TYPE_UINT8);
+    uint32_t differs = test_add_local(&builder, f, JAC_TYPE_UINT8);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t then = test_add_block(&builder, f);
+    uint32_t otherwise = test_add_block(&builder, f);
+    uint32_t join = test_add_block(&builder, f);
+
+    jac_ir_value condition = test_emit_op(&builder, f, entry, JAC_IR_GT, JAC_TYPE_INT32, test_argument(),
+                                          test_constant(JAC_TYPE_INT32, 0));
+    test_emit_branch(&builder, f, entry, condition, then, otherwise);
+    test_emit_store(&builder, f, then, same, test_constant(JAC_TYPE_UINT8, 7));
+    test_emit_store(&builder, f, then, differs, test_constant(JAC_TYPE_UINT8, 1));
+    test_emit_jump(&builder, f, then, join);
+    test_emit_store(&builder, f, otherwise, same, test_constant(JAC_TYPE_UINT8, 7));
+    test_emit_store(&builder, f, otherwise, differs, test_constant(JAC_TYPE_UINT8, 2));
+    test_emit_jump(&builder, f, otherwise, join);
+    test_emit_call(&builder, f, join, TEST_SINK, test_emit_load(&builder, f, join, same));
+    test_emit_call(&builder, f, join, TEST_SINK, test_emit_load(&builder, f, join, differs));
+    test_emit_return(&builder, f, join, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    jac_propagate_constants(function, scratch);
+
+    const jac_ir_instruction *branch = terminator(function, entry);
+    CHECK(branch && (branch->op == JAC_IR_BRANCH));
+    CHECK(test_is_constant(test_sink_argument(function, 0), 7));
+    CHECK(test_sink_argument(function, 1)->holds == JAC_IR_VALUE_VARIABLE);
+    CHECK(test_count_ops(function, JAC_IR_PHI) == 1);
+    CHECK(jac_verify_unit(&builder.unit, stderr));
+    jac_reset_arena(arena);
+}
+
+// a counter around a loop never settles, and neither does its exit
+static void test_loop_varies(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t i = test_add_local(&builder, f, JAC_TYPE_INT32);
+    uint32_t entry = test_add_block(&builder, f);
+    uint32_t loop = test_add_block(&builder, f);
+    uint32_t exit = test_add_block(&builder, f);
+
+    test_emit_store(&builder, f, entry, i, test_constant(JAC_TYPE_INT32, 0));
+    test_emit_jump(&builder, f, entry, loop);
+    jac_ir_value next = test_emit_op(&builder, f, loop, JAC_IR_ADD, JAC_TYPE_INT32,
+                                     test_emit_load(&builder, f, loop, i), test_constant(JAC_TYPE_INT32, 1));
+    test_emit_store(&builder, f, loop, i, next);
+    jac_ir_value more =
+        test_emit_op(&builder, f, loop, JAC_IR_LT, JAC_TYPE_INT32, next, test_constant(JAC_TYPE_INT32, 10));
+    test_emit_branch(&builder, f, loop, more, loop, exit);
+    test_emit_call(&builder, f, exit, TEST_SINK, test_emit_load(&builder, f, exit, i));
+    test_emit_return(&builder, f, exit, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    jac_propagate_constants(function, scratch);
+
+    const jac_ir_instruction *branch = terminator(function, loop);
+    CHECK(branch && (branch->op == JAC_IR_BRANCH));
+    CHECK(test_count_ops(function, JAC_IR_ADD) == 1);
+    CHECK(test_sink_argument(function, 0)->holds == JAC_IR_VALUE_VARIABLE);
+
+    test_trace trace;
+    test_run(&builder.unit, f, 0, &trace);
+    CHECK((trace.count == 1) && (trace.values[0] == 10));
+    jac_reset_arena(arena);
+}
+
+// a division that would trap is left for the program to trap at, and so is
+// one by a constant that does not trap, if its dividend varies
+static void test_keep_trap(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t entry = test_add_block(&builder, f);
+
+    jac_ir_value by_zero = test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_INT32,
+                                        test_constant(JAC_TYPE_INT32, 1), test_constant(JAC_TYPE_INT32, 0));
+    test_emit_call(&builder, f, entry, TEST_SINK, by_zero);
+    jac_ir_value least = test_emit_op(&builder, f, entry, JAC_IR_DIV, JAC_TYPE_INT8, test_constant(JAC_TYPE_INT8, -128),
+                                      test_constant(JAC_TYPE_INT8, -1));
+    test_emit_call(&builder, f, entry, TEST_SINK, least);
+    test_emit_return(&builder, f, entry, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    jac_propagate_constants(function, scratch);
+
+    CHECK(test_count_ops(function, JAC_IR_DIV) == 2);
+    CHECK(test_sink_argument(function, 0)->holds == JAC_IR_VALUE_VARIABLE);
+    CHECK(test_sink_argument(function, 1)->holds == JAC_IR_VALUE_VARIABLE);
+    jac_reset_arena(arena);
+}
+
+// arithmetic wraps in the width of its kind: 250 + 10 in a u8 is 4
+static void test_fold_wraps(jac_memory_arena *arena, jac_memory_arena *scratch)
+{
+    test_builder builder;
+    test_init_builder(&builder, arena);
+    size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+    uint32_t entry = test_add_block(&builder, f);
+
+    jac_ir_value sum = test_emit_op(&builder, f, entry, JAC_IR_ADD, JAC_TYPE_UINT8, test_constant(JAC_TYPE_UINT8, 250),
+                                    test_constant(JAC_TYPE_UINT8, 10));
+    test_emit_call(&builder, f, entry, TEST_SINK, sum);
+    jac_ir_value negated = test_emit_op(&builder, f, entry, JAC_IR_NEG, JAC_TYPE_INT8,
+                                        test_constant(JAC_TYPE_INT8, -128), test_constant(JAC_TYPE_INT8, 0));
+    test_emit_call(&builder, f, entry, TEST_SINK, negated);
+    test_emit_return(&builder, f, entry, NULL);
+
+    jac_ir_function *function = prepare(&builder, f);
+    jac_propagate_constants(function, scratch);
+
+    CHECK(test_is_constant(test_sink_argument(function, 0), 4));
+    CHECK(test_is_constant(test_sink_argument(function, 1), -128));
+    jac_reset_arena(arena);
+}
+
+/*
+ * RANDOM
+ */
+
+static void test_random_functions(jac_memory_arena *arena, jac_memory_arena *scratch, int count)
+{
+    size_t before = 0, after = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        test_builder builder;
+        test_init_builder(&builder, arena);
+        size_t f = test_add_function(&builder, JAC_TYPE_NONE);
+        test_build_random(&builder, f, 2 + test_random(14), test_random(8), 0);
+
+        jac_construct_ssa(&builder.unit, arena);
+        jac_ir_function *function = builder.unit.functions + f;
+        if (!CHECK(jac_verify_unit(&builder.unit, stderr)))
+        {
+            jac_reset_arena(arena);
+            continue;
+        }
+
+        test_trace traces[TEST_ARGUMENT_COUNT];
+        test_run_arguments(&builder.unit, f, traces);
+
+        before += test_count_instructions(function);
+        jac_propagate_constants(function, scratch);
+        after += test_count_instructions(function);
+        CHECK(jac_verify_unit(&builder.unit, stderr));
+
+        if (!test_check_same_runs(&builder.unit, f, traces) && test_verbose())
+            fprintf(stderr, "  random function %d\n", i);
+        jac_reset_arena(arena);
+    }
+
+    printf("random: %d functions, %zu instructions before, %zu after\n", count, before, after);
+}
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 3000;
+
+    jac_memory_arena arena, scratch;
+    jac_init_arena(&arena);
+    jac_init_arena(&scratch);
+
+    test_fold_chain(&arena, &scratch);
+    test_prune_branch(&arena, &scratch);
+    test_keep_branch(&arena, &scratch);
+    test_loop_varies(&arena, &scratch);
+    test_keep_trap(&arena, &scratch);
+    test_fold_wraps(&arena, &scratch);
+    test_random_functions(&arena, &scratch, count);
+
+    jac_free_arena(&scratch);
+    jac_free_arena(&arena);
+    return test_finish("opt_sccp");
+}
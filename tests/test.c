@@ -0,0 +1,49 @@
+#include "test.h"
+
+#include <stdio.h>
+
+// the first failures say the most, the ones after are mostly their echoes
+#define REPORTED_FAILURES 20
+
+size_t test_failures = 0;
+
+static uint64_t state = 0x2545f4914f6cdd1du;
+
+bool test_check(bool condition, const char *file, int line, const char *text)
+{
+    if (!condition && (test_failures++ < REPORTED_FAILURES))
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+    return condition;
+}
+
+bool test_verbose(void)
+{
+    return test_failures <= REPORTED_FAILURES;
+}
+
+uint64_t test_random_bits(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void test_seed(uint64_t seed)
+{
+    state = seed;
+}
+
+uint32_t test_random(uint32_t bound)
+{
+    return (uint32_t)(test_random_bits() % bound);
+}
+
+int test_finish(const char *name)
+{
+    if (test_failures == 0)
+        return 0;
+
+    fprintf(stderr, "%s: %zu checks failed.\n", name, test_failures);
+    return 1;
+}
@@ -0,0 +1,35 @@
+#ifndef JAC_TEST_H_
+#define JAC_TEST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * What the test programs share. A failed check is reported and counted, and
+ * the test goes on, so one run shows every failure, up to a point.
+ */
+
+extern size_t test_failures;
+
+// whether 'condition' held. only the first few failures are printed
+bool test_check(bool condition, const char *file, int line, const char *text);
+
+#define CHECK(condition) test_check((condition), __FILE__, __LINE__, #condition)
+
+// whether the failures so far are still worth the details, see test_check
+bool test_verbose(void);
+
+// xorshift from a fixed seed, so every run checks the same cases
+uint32_t test_random(uint32_t bound);
+
+uint64_t test_random_bits(void);
+
+// starts the sequence over from 'seed', which must not be 0, for a program
+// that needs the same cases again
+void test_seed(uint64_t seed);
+
+// the exit code of a test program, after a line on how it went
+int test_finish(const char *name);
+
+#endif